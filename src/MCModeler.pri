@@ -0,0 +1,225 @@
+# Everything MCModeler is built from except main(), so that other targets (such as the benchmark in
+# tools/MCModelerBenchmark) can link against exactly the code the editor runs.  Every path is anchored at $$PWD so that
+# this file can be included from any directory.
+
+HEADERS = \
+    $$PWD/about_box.h \
+    $$PWD/application.h \
+    $$PWD/bill_of_materials_window.h \
+    $$PWD/block_instance.h \
+    $$PWD/block_manager.h \
+    $$PWD/block_oracle.h \
+    $$PWD/block_orientation.h \
+    $$PWD/block_position.h \
+    $$PWD/block_properties.h \
+    $$PWD/block_prototype.h \
+    $$PWD/block_type.h \
+    $$PWD/camera.h \
+    $$PWD/diagram.h \
+    $$PWD/enums.h \
+    $$PWD/frame_timer.h \
+    $$PWD/gl_preview_window.h \
+    $$PWD/gl_widget.h \
+    $$PWD/level_widget.h \
+    $$PWD/main_window.h \
+    $$PWD/matrix.h \
+    $$PWD/mouselook_cam.h \
+    $$PWD/overlapping_faces_renderable.h \
+    $$PWD/rectangular_prism_renderable.h \
+    $$PWD/render_delegate.h \
+    $$PWD/renderable.h \
+    $$PWD/texture.h \
+    $$PWD/block_transaction.h \
+    $$PWD/macros.h \
+    $$PWD/tool.h \
+    $$PWD/line_tool.h \
+    $$PWD/bed_renderable.h \
+    $$PWD/door_renderable.h \
+    $$PWD/stairs_renderable.h \
+    $$PWD/basic_renderable.h \
+    $$PWD/skybox_renderable.h \
+    $$PWD/block_picker.h \
+    $$PWD/block_picker_item_delegate.h \
+    $$PWD/ladder_renderable.h \
+    $$PWD/sprite_engine.h \
+    $$PWD/texture_pack.h \
+    $$PWD/pencil_tool.h \
+    $$PWD/rectangle_tool.h \
+    $$PWD/tool_picker.h \
+    $$PWD/tool_picker_item_delegate.h \
+    $$PWD/pane_renderable.h \
+    $$PWD/qvariant_ptr.h \
+    $$PWD/undo_command.h \
+    $$PWD/eraser_tool.h \
+    $$PWD/filled_rectangle_tool.h \
+    $$PWD/flood_fill_tool.h \
+    $$PWD/track_renderable.h \
+    $$PWD/torch_renderable.h \
+    $$PWD/enumeration.h \
+    $$PWD/enumeration_impl.h \
+    $$PWD/block_geometry.h \
+    $$PWD/flow_block_renderable.h \
+    $$PWD/block_property_keys.h \
+    $$PWD/tree_tool.h \
+    $$PWD/circle_tool.h \
+    $$PWD/sphere_tool.h \
+    $$PWD/replace_blocks_dialog.h \
+    $$PWD/shape.h \
+    $$PWD/shape_rasterizer.h \
+    $$PWD/expression.h \
+    $$PWD/volume_generator.h \
+    $$PWD/generate_volume_dialog.h \
+    $$PWD/occupancy_mask.h \
+    $$PWD/noise.h \
+    $$PWD/terrain_generator.h \
+    $$PWD/generate_terrain_dialog.h \
+    $$PWD/image_height_field.h \
+    $$PWD/palette_matcher.h \
+    $$PWD/template_converter.h \
+    $$PWD/convert_template_dialog.h \
+    $$PWD/triangle_mesh.h \
+    $$PWD/mesh_voxelizer.h \
+    $$PWD/import_mesh_dialog.h \
+    $$PWD/random.h \
+    $$PWD/tree.h \
+    $$PWD/scatter_tool.h \
+    $$PWD/flow_solver.h \
+    $$PWD/auto_connector.h \
+    $$PWD/redstone_simulator.h \
+    $$PWD/hollow_out_dialog.h \
+    $$PWD/connectivity_analyzer.h \
+    $$PWD/diagram_diff.h \
+    $$PWD/chunk_table.h \
+    $$PWD/prefab.h \
+    $$PWD/create_prefab_dialog.h \
+    $$PWD/place_prefab_dialog.h \
+    $$PWD/position_hash.h \
+    $$PWD/position_hash_impl.h \
+    $$PWD/scene_mesh.h \
+    $$PWD/scene_geometry.h \
+    $$PWD/buffer_arena.h \
+    $$PWD/render_quality.h
+
+SOURCES = \
+    $$PWD/about_box.cc \
+    $$PWD/application.cc \
+    $$PWD/bill_of_materials_window.cc \
+    $$PWD/block_manager.cc \
+    $$PWD/block_orientation.cc \
+    $$PWD/block_position.cc \
+    $$PWD/block_properties.cc \
+    $$PWD/block_prototype.cc \
+    $$PWD/diagram.cc \
+    $$PWD/frame_timer.cc \
+    $$PWD/gl_preview_window.cc \
+    $$PWD/gl_widget.cc \
+    $$PWD/level_widget.cc \
+    $$PWD/main_window.cc \
+    $$PWD/matrix.cc \
+    $$PWD/mouselook_cam.cc \
+    $$PWD/overlapping_faces_renderable.cc \
+    $$PWD/rectangular_prism_renderable.cc \
+    $$PWD/renderable.cc \
+    $$PWD/texture.cc \
+    $$PWD/block_transaction.cc \
+    $$PWD/block_instance.cc \
+    $$PWD/line_tool.cc \
+    $$PWD/bed_renderable.cc \
+    $$PWD/door_renderable.cc \
+    $$PWD/stairs_renderable.cc \
+    $$PWD/basic_renderable.cc \
+    $$PWD/skybox_renderable.cc \
+    $$PWD/block_picker.cc \
+    $$PWD/block_picker_item_delegate.cc \
+    $$PWD/ladder_renderable.cc \
+    $$PWD/sprite_engine.cc \
+    $$PWD/texture_pack.cc \
+    $$PWD/tool.cc \
+    $$PWD/pencil_tool.cc \
+    $$PWD/rectangle_tool.cc \
+    $$PWD/tool_picker.cc \
+    $$PWD/tool_picker_item_delegate.cc \
+    $$PWD/pane_renderable.cc \
+    $$PWD/undo_command.cc \
+    $$PWD/eraser_tool.cc \
+    $$PWD/filled_rectangle_tool.cc \
+    $$PWD/flood_fill_tool.cc \
+    $$PWD/track_renderable.cc \
+    $$PWD/torch_renderable.cc \
+    $$PWD/flow_block_renderable.cc \
+    $$PWD/tree_tool.cc \
+    $$PWD/circle_tool.cc \
+    $$PWD/sphere_tool.cc \
+    $$PWD/replace_blocks_dialog.cc \
+    $$PWD/shape.cc \
+    $$PWD/shape_rasterizer.cc \
+    $$PWD/expression.cc \
+    $$PWD/volume_generator.cc \
+    $$PWD/generate_volume_dialog.cc \
+    $$PWD/occupancy_mask.cc \
+    $$PWD/noise.cc \
+    $$PWD/terrain_generator.cc \
+    $$PWD/generate_terrain_dialog.cc \
+    $$PWD/image_height_field.cc \
+    $$PWD/palette_matcher.cc \
+    $$PWD/template_converter.cc \
+    $$PWD/convert_template_dialog.cc \
+    $$PWD/triangle_mesh.cc \
+    $$PWD/mesh_voxelizer.cc \
+    $$PWD/import_mesh_dialog.cc \
+    $$PWD/random.cc \
+    $$PWD/tree.cc \
+    $$PWD/scatter_tool.cc \
+    $$PWD/flow_solver.cc \
+    $$PWD/auto_connector.cc \
+    $$PWD/redstone_simulator.cc \
+    $$PWD/hollow_out_dialog.cc \
+    $$PWD/connectivity_analyzer.cc \
+    $$PWD/diagram_diff.cc \
+    $$PWD/chunk_table.cc \
+    $$PWD/prefab.cc \
+    $$PWD/create_prefab_dialog.cc \
+    $$PWD/place_prefab_dialog.cc \
+    $$PWD/scene_mesh.cc \
+    $$PWD/scene_geometry.cc \
+    $$PWD/buffer_arena.cc \
+    $$PWD/render_quality.cc
+
+QT += opengl
+
+RESOURCES += \
+    $$PWD/textures.qrc \
+    $$PWD/icons.qrc
+
+FORMS += \
+    $$PWD/about_box.ui \
+    $$PWD/bill_of_materials_window.ui \
+    $$PWD/gl_preview_window.ui \
+    $$PWD/main_window.ui \
+    $$PWD/block_picker.ui \
+    $$PWD/tool_picker.ui \
+    $$PWD/replace_blocks_dialog.ui \
+    $$PWD/generate_volume_dialog.ui \
+    $$PWD/generate_terrain_dialog.ui \
+    $$PWD/convert_template_dialog.ui \
+    $$PWD/import_mesh_dialog.ui \
+    $$PWD/hollow_out_dialog.ui \
+    $$PWD/create_prefab_dialog.ui \
+    $$PWD/place_prefab_dialog.ui
+
+INCLUDEPATH += $$PWD \
+               $$PWD/../third_party \
+               $$PWD/../third_party/qjson/include
+
+win32:INCLUDEPATH += $$PWD/../third_party/zlib-1.2.5
+win32:QMAKE_LFLAGS += -static-libgcc
+
+macx {
+    QMAKE_LFLAGS += -F $$PWD/../third_party/qjson/lib -L $$PWD/../third_party/quazip/lib
+    LIBS += -lquazip.1 -framework qjson -framework CoreFoundation
+}
+
+win32 {
+    LIBS += $$PWD/../third_party/quazip/lib/release/quazip.dll \
+            $$PWD/../third_party/qjson/lib/qjson0.dll
+}
@@ -16,14 +16,18 @@
 #include "application.h"
 
 #include "gl_preview_window.h"
+#include "gl_widget.h"
 #include "main_window.h"
 
 #include "block_prototype.h"
 
 #include <QDebug>
 
+/** How far each new diagram's windows are moved down and right from the last one's, in pixels. */
+static const int kWindowCascadeOffset = 24;
+
 Application::Application(int& argc, char** argv)
-    : QApplication(argc, argv), block_mgr_(NULL) {
+    : QApplication(argc, argv), block_mgr_(NULL), document_count_(0), documents_opened_(0) {
   setApplicationName("MCModeler");
   setApplicationVersion("0.3 dev 2");
   setOrganizationName("Caffeinix");
@@ -31,23 +35,17 @@ Application::Application(int& argc, char** argv)
 
   BlockPrototype::setupBlockProperties();
 
-  MainWindow* main_window = new MainWindow(NULL);
-  GLPreviewWindow* gl_preview_window = new GLPreviewWindow(NULL);
-
-  diagram_.reset(new Diagram());
-  block_mgr_.reset(new BlockManager(diagram_.data(), gl_preview_window->glWidget()));
-  diagram_->setBlockManager(block_mgr_.data());
+  // The windows of each diagram come and go, so the textures live in a context that outlives them all.  It is never
+  // drawn to, so it doesn't need sample buffers even when the previews have them.
+  shared_gl_widget_.reset(new QGLWidget(QGLFormat()));
+  GLWidget::setSharedContextWidget(shared_gl_widget_.data());
+  block_mgr_.reset(new BlockManager(shared_gl_widget_.data()));
 
   settings_.reset(new QSettings());
 
-  gl_preview_window->setDiagram(diagram_.data());
-  gl_preview_window->setBlockManager(block_mgr_.data());
-
-  main_window->setBlockManager(block_mgr_.data());
-  main_window->setDiagram(diagram_.data());
-
-  main_window->show();
-  gl_preview_window->show();
+  // Closing a diagram's windows doesn't quit while other diagrams are open; onDocumentClosed() does that.
+  setQuitOnLastWindowClosed(false);
+  newDocument();
 }
 
 Application::~Application() {
@@ -60,3 +58,36 @@ Application* Application::instance() {
 QSettings* Application::settings() const {
   return settings_.data();
 }
+
+MainWindow* Application::newDocument() {
+  MainWindow* main_window = new MainWindow(NULL);
+  GLPreviewWindow* gl_preview_window = new GLPreviewWindow(NULL);
+
+  Diagram* diagram = new Diagram(main_window);
+  diagram->setBlockManager(block_mgr_.data());
+
+  gl_preview_window->setDiagram(diagram);
+  gl_preview_window->setBlockManager(block_mgr_.data());
+
+  main_window->setBlockManager(block_mgr_.data());
+  main_window->setDiagram(diagram);
+  main_window->setPreviewWindow(gl_preview_window);
+
+  QPoint cascade(kWindowCascadeOffset * documents_opened_, kWindowCascadeOffset * documents_opened_);
+  main_window->move(main_window->pos() + cascade);
+  gl_preview_window->move(gl_preview_window->pos() + cascade);
+  ++documents_opened_;
+  ++document_count_;
+  connect(main_window, SIGNAL(destroyed()), SLOT(onDocumentClosed()));
+
+  main_window->show();
+  gl_preview_window->show();
+  return main_window;
+}
+
+void Application::onDocumentClosed() {
+  --document_count_;
+  if (document_count_ == 0) {
+    quit();
+  }
+}
@@ -17,15 +17,21 @@
 #define APPLICATION_H
 
 #include <QApplication>
+#include <QGLWidget>
 #include <QScopedPointer>
 
 #include "block_manager.h"
 #include "diagram.h"
 
+class MainWindow;
+
 /**
   * Represents the application.  Since Qt guarantees that there will only ever be one of these, it is a convenient owner
-  * for other effectively global objects such as the BlockManager and Diagram.  If you ever think you need a global
-  * object or a singleton, what you really want to do is add another member to Application.
+  * for other effectively global objects such as the BlockManager.  If you ever think you need a global object or a
+  * singleton, what you really want to do is add another member to Application.
+  *
+  * Each open diagram has a MainWindow of its own, which owns the Diagram and its 3D preview window.  Every diagram
+  * shares the BlockManager, and every preview shares one GL context, so textures and sprites are only loaded once.
   */
 class Application : public QApplication {
   Q_OBJECT
@@ -43,10 +49,29 @@ class Application : public QApplication {
     */
   QSettings* settings() const;
 
+  /**
+    * Opens a new, empty diagram in a new main window and 3D preview window.
+    * @return The main window of the new diagram.
+    */
+  MainWindow* newDocument();
+
+ private slots:
+  /**
+    * Quits once the last diagram has been closed.
+    */
+  void onDocumentClosed();
+
  private:
-  QScopedPointer<Diagram> diagram_;
+  /// A hidden widget whose GL context holds the textures and is shared by every GLWidget.
+  QScopedPointer<QGLWidget> shared_gl_widget_;
   QScopedPointer<BlockManager> block_mgr_;
   QScopedPointer<QSettings> settings_;
+
+  /// The number of diagrams that are open.
+  int document_count_;
+
+  /// The number of diagrams that have been opened so far, used to cascade their windows.
+  int documents_opened_;
 };
 
 #endif // APPLICATION_H
@@ -0,0 +1,223 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "auto_connector.h"
+
+#include <QSet>
+
+#include "block_geometry.h"
+#include "block_orientation.h"
+#include "block_prototype.h"
+
+namespace {
+
+/** The bits of a neighbour mask. */
+enum Side {
+  kNorth = 1,
+  kSouth = 2,
+  kEast = 4,
+  kWest = 8
+};
+
+const int kSideCount = 4;
+const int kMaskCount = 16;
+
+const BlockPosition kUp(0, 1, 0);
+const BlockPosition kDown(0, -1, 0);
+
+/** The offset to the neighbour on each side, in the same order as the bits of Side. */
+const BlockPosition kSideOffsets[kSideCount] = {
+  BlockPosition(0, 0, -1),
+  BlockPosition(0, 0, 1),
+  BlockPosition(1, 0, 0),
+  BlockPosition(-1, 0, 0)
+};
+
+/** The orientation of a pane for each neighbour mask.  A lone pane keeps its own orientation. */
+const char* const kPaneOrientationNames[kMaskCount] = {
+  NULL,                   // (none)
+  "North half",           // N
+  "South half",           // S
+  "Running north/south",  // N S
+  "East half",            // E
+  "Northeast corner",     // N E
+  "Southeast corner",     // S E
+  "T facing west",        // N S E
+  "West half",            // W
+  "Northwest corner",     // N W
+  "Southwest corner",     // S W
+  "T facing east",        // N S W
+  "Running east/west",    // E W
+  "T facing south",       // N E W
+  "T facing north",       // S E W
+  "Cross"                 // N S E W
+};
+
+/**
+  * The orientation of a level track for each neighbour mask.  Track can't branch, so junctions take a corner, with
+  * the south and east sides preferred as in the game.  A lone track keeps its own orientation.
+  */
+const char* const kTrackOrientationNames[kMaskCount] = {
+  NULL,                   // (none)
+  "Running north/south",  // N
+  "Running north/south",  // S
+  "Running north/south",  // N S
+  "Running east/west",    // E
+  "Northeast corner",     // N E
+  "Southeast corner",     // S E
+  "Southeast corner",     // N S E
+  "Running east/west",    // W
+  "Northwest corner",     // N W
+  "Southwest corner",     // S W
+  "Southwest corner",     // N S W
+  "Running east/west",    // E W
+  "Northeast corner",     // N E W
+  "Southeast corner",     // S E W
+  "Southeast corner"      // N S E W
+};
+
+/** The orientation of a track that slopes up towards each side. */
+const char* const kAscendingTrackOrientationNames[kSideCount] = {
+  "Ascending north",
+  "Ascending south",
+  "Ascending east",
+  "Ascending west"
+};
+
+/**
+  * The tables above, looked up once.
+  */
+struct OrientationTables {
+  OrientationTables() {
+    for (int mask = 0; mask < kMaskCount; ++mask) {
+      pane[mask] = kPaneOrientationNames[mask] ? BlockOrientation::get(kPaneOrientationNames[mask]) : NULL;
+      track[mask] = kTrackOrientationNames[mask] ? BlockOrientation::get(kTrackOrientationNames[mask]) : NULL;
+    }
+    for (int side = 0; side < kSideCount; ++side) {
+      ascending_track[side] = BlockOrientation::get(kAscendingTrackOrientationNames[side]);
+    }
+    north_south_track = BlockOrientation::get("Running north/south");
+    east_west_track = BlockOrientation::get("Running east/west");
+  }
+
+  const BlockOrientation* pane[kMaskCount];
+  const BlockOrientation* track[kMaskCount];
+  const BlockOrientation* ascending_track[kSideCount];
+  const BlockOrientation* north_south_track;
+  const BlockOrientation* east_west_track;
+};
+
+const OrientationTables& tables() {
+  static OrientationTables s_tables;
+  return s_tables;
+}
+
+}  // namespace
+
+AutoConnector::AutoConnector(const QHash<BlockPosition, BlockInstance>* blocks) : blocks_(blocks) {
+  Q_ASSERT(blocks_);
+}
+
+bool AutoConnector::isTrack(const BlockPosition& position) const {
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_->constFind(position);
+  return iter != blocks_->constEnd() && iter.value().prototype()->geometry() == BlockGeometry::kGeometryTrack;
+}
+
+const BlockOrientation* AutoConnector::paneOrientation(const BlockPosition& position) const {
+  int mask = 0;
+  for (int side = 0; side < kSideCount; ++side) {
+    QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_->constFind(position + kSideOffsets[side]);
+    if (iter == blocks_->constEnd()) {
+      continue;
+    }
+    // Panes join each other and solid, opaque cubes, but not glass, leaves, liquids or anything smaller than a block.
+    const BlockPrototype* neighbor = iter.value().prototype();
+    BlockGeometry::Geometry geometry = neighbor->geometry();
+    if (geometry == BlockGeometry::kGeometryPane ||
+        (geometry == BlockGeometry::kGeometryCube && !neighbor->isTransparent())) {
+      mask |= 1 << side;
+    }
+  }
+  return tables().pane[mask];
+}
+
+const BlockOrientation* AutoConnector::trackOrientation(const BlockPosition& position) const {
+  int mask = 0;
+  int ascending_mask = 0;
+  for (int side = 0; side < kSideCount; ++side) {
+    BlockPosition neighbor = position + kSideOffsets[side];
+    if (isTrack(neighbor + kUp)) {
+      ascending_mask |= 1 << side;
+      mask |= 1 << side;
+    } else if (isTrack(neighbor) || isTrack(neighbor + kDown)) {
+      mask |= 1 << side;
+    }
+  }
+
+  const BlockOrientation* orientation = tables().track[mask];
+  // A straight track slopes up if there is a track above either end.
+  int along = 0;
+  if (orientation == tables().north_south_track) {
+    along = kNorth | kSouth;
+  } else if (orientation == tables().east_west_track) {
+    along = kEast | kWest;
+  }
+  for (int side = 0; side < kSideCount; ++side) {
+    if ((along & ascending_mask & (1 << side)) != 0) {
+      return tables().ascending_track[side];
+    }
+  }
+  return orientation;
+}
+
+const BlockOrientation* AutoConnector::connectedOrientation(const BlockInstance& block) const {
+  BlockGeometry::Geometry geometry = block.prototype()->geometry();
+  if (geometry == BlockGeometry::kGeometryPane) {
+    return paneOrientation(block.position());
+  } else if (geometry == BlockGeometry::kGeometryTrack) {
+    return trackOrientation(block.position());
+  }
+  return NULL;
+}
+
+QHash<BlockPosition, BlockInstance> AutoConnector::reconnect(const QList<BlockPosition>& changed) const {
+  // Anything that joins to a changed block is one of its six neighbours, or for a track, diagonally above or below.
+  QSet<BlockPosition> candidates;
+  foreach (const BlockPosition& position, changed) {
+    candidates.insert(position);
+    candidates.insert(position + kUp);
+    candidates.insert(position + kDown);
+    for (int side = 0; side < kSideCount; ++side) {
+      BlockPosition neighbor = position + kSideOffsets[side];
+      candidates.insert(neighbor);
+      candidates.insert(neighbor + kUp);
+      candidates.insert(neighbor + kDown);
+    }
+  }
+
+  QHash<BlockPosition, BlockInstance> reconnected;
+  foreach (const BlockPosition& position, candidates) {
+    QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_->constFind(position);
+    if (iter == blocks_->constEnd()) {
+      continue;
+    }
+    const BlockInstance& block = iter.value();
+    const BlockOrientation* orientation = connectedOrientation(block);
+    if (orientation && orientation != block.orientation() && block.prototype()->orientations().contains(orientation)) {
+      reconnected.insert(position, BlockInstance(block.prototype(), position, orientation));
+    }
+  }
+  return reconnected;
+}
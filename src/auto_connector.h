@@ -0,0 +1,65 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUTO_CONNECTOR_H
+#define AUTO_CONNECTOR_H
+
+#include <QHash>
+#include <QList>
+
+#include "block_instance.h"
+#include "block_position.h"
+
+class BlockOrientation;
+
+/**
+  * Picks the orientation of panes and tracks from the blocks around them, so that they join up the way they would in
+  * the game without the user having to cycle through orientations by hand.
+  *
+  * Panes join to other panes and to cubes on each of their four sides.  Tracks join to other tracks beside them, or
+  * one level above or below, and slope up towards a track one level above.  Each kind of block has a table, built
+  * once, from the set of sides it joins on (a four-bit mask) to its orientation; a block with nothing to join to keeps
+  * whatever orientation it already has.
+  *
+  * North is towards -z and east towards +x, as in the game.
+  */
+class AutoConnector {
+ public:
+  /**
+    * Creates an AutoConnector for the blocks in \p blocks, which must not change while it is in use.
+    */
+  explicit AutoConnector(const QHash<BlockPosition, BlockInstance>* blocks);
+
+  /**
+    * Works out the panes and tracks at or around \p changed whose orientation should change, and returns them with
+    * their new orientations, keyed by position.
+    */
+  QHash<BlockPosition, BlockInstance> reconnect(const QList<BlockPosition>& changed) const;
+
+ private:
+  /**
+    * Returns the orientation that the pane or track \p block should have, or NULL if it should keep its own.
+    */
+  const BlockOrientation* connectedOrientation(const BlockInstance& block) const;
+
+  const BlockOrientation* paneOrientation(const BlockPosition& position) const;
+  const BlockOrientation* trackOrientation(const BlockPosition& position) const;
+
+  bool isTrack(const BlockPosition& position) const;
+
+  const QHash<BlockPosition, BlockInstance>* blocks_;
+};
+
+#endif // AUTO_CONNECTOR_H
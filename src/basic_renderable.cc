@@ -15,6 +15,7 @@
 
 #include "basic_renderable.h"
 
+#include "block_orientation.h"
 #include "enums.h"
 #include "render_delegate.h"
 
@@ -30,6 +31,74 @@ void BasicRenderable::initialize() {
   TextureCoords texture_coords = createTextureCoords(geometry);
   geometry = moveToOrigin(geometry);
   addGeometry(geometry, texture_coords);
+
+  QVector<const BlockOrientation*> orientations;
+  if (renderDelegate()) {
+    orientations = renderDelegate()->orientations();
+  }
+  orientations << BlockOrientation::noOrientation() << BlockOrientation::paletteOrientation();
+  foreach (const BlockOrientation* orientation, orientations) {
+    if (!quad_tables_.contains(orientation)) {
+      quad_tables_.insert(orientation, buildQuadTable(orientation));
+    }
+  }
+}
+
+BasicRenderable::QuadTable BasicRenderable::buildQuadTable(const BlockOrientation* orientation) const {
+  QuadTable table;
+  table.min_filter = textureMinFilter(orientation);
+  QMatrix4x4 transform = orientationTransform(orientation);
+  table.transformed = !transform.isIdentity();
+  for (int i = 0; i < 16; ++i) {
+    table.transform[i] = transform.constData()[i];
+  }
+  for (int start = 0; start < vertices().size(); start += 4) {
+    int index = start / 4;
+    if (!shouldRenderQuad(index, orientation)) {
+      continue;
+    }
+    QuadEntry entry;
+    for (int i = 0; i < 4; ++i) {
+      entry.indices[i] = static_cast<GLushort>(start + i);
+    }
+    entry.texture_id = textureForQuad(index, orientation).textureId();
+    // Baked geometry names its texture by slot, since texture ids are only good for this run.
+    entry.texture_slot = -1;
+    for (int slot = 0; slot < textureCount() && entry.texture_slot < 0; ++slot) {
+      if (textureId(slot) == entry.texture_id) {
+        entry.texture_slot = slot;
+      }
+    }
+    entry.culling_face = kFrontFace;
+    entry.culled = cullingFaceForQuad(index, orientation, &entry.culling_face);
+    for (int i = 0; i < 4; ++i) {
+      QVector3D position = transform.map(vertices().at(start + i));
+      QVector3D normal = transform.mapVector(normals().at(start + i)).normalized();
+      const QVector2D& tex_coord = textureCoords().at(start + i);
+      SceneCorner& corner = entry.corners[i];
+      corner.position[0] = position.x();
+      corner.position[1] = position.y();
+      corner.position[2] = position.z();
+      corner.normal[0] = normal.x();
+      corner.normal[1] = normal.y();
+      corner.normal[2] = normal.z();
+      corner.tex_coord[0] = tex_coord.x();
+      corner.tex_coord[1] = tex_coord.y();
+    }
+    table.quads.append(entry);
+  }
+  return table;
+}
+
+const BasicRenderable::QuadTable& BasicRenderable::quadTable(const BlockOrientation* orientation,
+                                                             QuadTable* scratch) const {
+  QHash<const BlockOrientation*, QuadTable>::const_iterator table_iter = quad_tables_.constFind(orientation);
+  if (Q_UNLIKELY(table_iter == quad_tables_.constEnd())) {
+    // Not one of the render delegate's orientations, so this has to be worked out from scratch.
+    *scratch = buildQuadTable(orientation);
+    return *scratch;
+  }
+  return table_iter.value();
 }
 
 void BasicRenderable::appendVertex(const QVector3D& vertex,
@@ -50,14 +119,18 @@ void BasicRenderable::addQuad(const QVector3D& a, const QVector3D& b,
   appendVertex(d, norm, tex[kTopLeftCorner]);
 }
 
-void BasicRenderable::applyOrientationTransform(const BlockOrientation* orientation) const {}
+QMatrix4x4 BasicRenderable::orientationTransform(const BlockOrientation* orientation) const {
+  return QMatrix4x4();
+}
 
-bool BasicRenderable::shouldRenderQuad(int index,
-                                       const QVector3D& location,
-                                       const BlockOrientation* orientation) const {
+bool BasicRenderable::shouldRenderQuad(int index, const BlockOrientation* orientation) const {
   return true;
 }
 
+bool BasicRenderable::cullingFaceForQuad(int index, const BlockOrientation* orientation, Face* face) const {
+  return false;
+}
+
 Texture BasicRenderable::textureForQuad(int index, const BlockOrientation* orientation) const {
   return texture(index);
 }
@@ -66,15 +139,20 @@ int BasicRenderable::textureMinFilter(const BlockOrientation* orientation) const
   return GL_LINEAR;
 }
 
-void BasicRenderable::renderAt(const QVector3D& location, const BlockOrientation* orientation) const {
+void BasicRenderable::renderAt(const QVector3D& location, const BlockOrientation* orientation,
+                               BlockOracle* oracle) const {
   if (!isInitialized()) {
     qWarning() << "Tried to render a BasicRenderable without first calling initialize().";
     return;
   }
+  QuadTable scratch;
+  const QuadTable& table = quadTable(orientation, &scratch);
+
   glPushMatrix();
   glTranslatef(location.x(), location.y(), location.z());
-
-  applyOrientationTransform(orientation);
+  if (table.transformed) {
+    glMultMatrixf(table.transform);
+  }
 
   glEnableClientState(GL_VERTEX_ARRAY);
   glEnableClientState(GL_NORMAL_ARRAY);
@@ -82,18 +160,41 @@ void BasicRenderable::renderAt(const QVector3D& location, const BlockOrientation
   glVertexPointer(3, GL_FLOAT, 0, vertices().constData());
   glNormalPointer(GL_FLOAT, 0, normals().constData());
   glTexCoordPointer(2, GL_FLOAT, 0, textureCoords().constData());
-  for (int start = 0; start < vertices().size(); start += 4) {
-    if (!shouldRenderQuad(start / 4, location, orientation)) {
+  RenderDelegate* delegate = renderDelegate();
+  QVector<QuadEntry>::const_iterator quad;
+  for (quad = table.quads.constBegin(); quad != table.quads.constEnd(); ++quad) {
+    if (quad->culled && delegate && !delegate->shouldRenderFace(this, quad->culling_face, location, oracle)) {
       continue;
     }
-    glBindTexture(GL_TEXTURE_2D, textureForQuad(start / 4, orientation).textureId());
+    glBindTexture(GL_TEXTURE_2D, quad->texture_id);
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, textureMinFilter(orientation));
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, table.min_filter);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    GLushort indices[4] = { start, start + 1, start + 2, start + 3 };
-    glDrawElements(GL_QUADS, 4, GL_UNSIGNED_SHORT, indices);
+    glDrawElements(GL_QUADS, 4, GL_UNSIGNED_SHORT, quad->indices);
   }
   glPopMatrix();
 }
+
+void BasicRenderable::appendGeometry(SceneMesh* mesh, const SceneMaterial& material, const QVector3D& location,
+                                     const BlockOrientation* orientation, BlockOracle* oracle) const {
+  if (!isInitialized()) {
+    qWarning() << "Tried to append the geometry of a BasicRenderable without first calling initialize().";
+    return;
+  }
+  QuadTable scratch;
+  const QuadTable& table = quadTable(orientation, &scratch);
+
+  SceneMaterial quad_material = material;
+  quad_material.min_filter = table.min_filter;
+  RenderDelegate* delegate = renderDelegate();
+  QVector<QuadEntry>::const_iterator quad;
+  for (quad = table.quads.constBegin(); quad != table.quads.constEnd(); ++quad) {
+    if (quad->culled && delegate && !delegate->shouldRenderFace(this, quad->culling_face, location, oracle)) {
+      continue;
+    }
+    quad_material.texture_slot = quad->texture_slot;
+    mesh->appendQuad(quad_material, quad->corners, location);
+  }
+}
@@ -16,11 +16,15 @@
 #ifndef BASIC_RENDERABLE_H
 #define BASIC_RENDERABLE_H
 
+#include <QHash>
+#include <QMatrix4x4>
 #include <QVector>
 #include <QVector2D>
 #include <QVector3D>
 
+#include "enums.h"
 #include "renderable.h"
+#include "scene_mesh.h"
 
 /**
   * An abstract subclass of Renderable that provides some basic functionality and a template for initialization.
@@ -34,9 +38,15 @@
   * 4. The geometry is converted into a set of quads using addQuad.
   *
   * Once this setup has finished, the geometry can be drawn by BasicRenderable's generic renderAt() implementation.
-  * To customize the rendering, you can reimplement applyOrientationTransform() (to apply OpenGL matrix transformations
-  * for orientation support), shouldRenderQuad() (to perform face culling, for example) and/or textureForQuad().  All
-  * three of these methods have default implementations, so you do not need to override them unless you want to.
+  * To customize the rendering, you can reimplement orientationTransform() (to rotate the geometry for orientation
+  * support), shouldRenderQuad() (to hide quads in some orientations), cullingFaceForQuad() (to skip
+  * quads hidden by neighbouring blocks), textureForQuad() and/or textureMinFilter().  All of these methods have
+  * default implementations, so you do not need to override them unless you want to.
+  *
+  * These methods are only called from initialize(), which asks them about every quad in every orientation of the
+  * render delegate and records the answers in a table.  renderAt() and appendGeometry() then only have to look up the
+  * table for the orientation they are given, so the textures and render delegate must be set before initialize() is
+  * called.
   *
   * You can also reimplement renderAt yourself and use the vertices(), normals(), and textureCoords() accessors to get
   * direct access to the raw geometry.
@@ -62,13 +72,20 @@ class BasicRenderable : public Renderable {
   virtual void initialize();
 
   /**
-    * @copydoc Renderable::renderAt(const QVector3D&, const BlockOrientation*) const
+    * @copydoc Renderable::renderAt(const QVector3D&, const BlockOrientation*, BlockOracle*) const
     * BasicRenderable implements renderAt in a generic manner and calls various other methods while rendering to
     * obtain information it needs.  Generally, you should not need to override this, but if you do, you can call
     * vertices(), normals(), and textureCoords() to get the raw rendering data.
     */
-  virtual void renderAt(const QVector3D& location, const BlockOrientation* orientation) const;
+  virtual void renderAt(const QVector3D& location, const BlockOrientation* orientation, BlockOracle* oracle) const;
 
+  /**
+    * @copydoc Renderable::appendGeometry()
+    * BasicRenderable appends the quads from the same table renderAt() draws from, already transformed for
+    * \p orientation.
+    */
+  virtual void appendGeometry(SceneMesh* mesh, const SceneMaterial& material, const QVector3D& location,
+                              const BlockOrientation* orientation, BlockOracle* oracle) const;
 
  protected:
   /**
@@ -114,18 +131,24 @@ class BasicRenderable : public Renderable {
   virtual void addGeometry(const Geometry& geometry, const TextureCoords& texture_coords) = 0;
 
   /**
-    * Applies any desired OpenGL coordinate transformations (glRotate(), glTranslate(), etc.) to account for the given
-    * orientation.  You do not need to push a matrix before applying these transforms; they will be applied at the
-    * correct time and in the correct context automatically.  The default implementation does nothing.
+    * Returns the transformation (rotation, translation, etc.) to apply to the geometry to account for the given
+    * orientation.  The block is centered on the origin when the transformation is applied.  The default
+    * implementation returns the identity matrix.
     */
-  virtual void applyOrientationTransform(const BlockOrientation* orientation) const;
+  virtual QMatrix4x4 orientationTransform(const BlockOrientation* orientation) const;
 
   /**
-    * Returns true if the quad at \p index should be rendered at \p location with \p orientation.  Subclasses can check
-    * with the render delegate to obtain adjacency information and return true or false as necessary.  The default
+    * Returns true if the quad at \p index should ever be rendered for a block in \p orientation.  The default
     * implementation always returns true.
     */
-  virtual bool shouldRenderQuad(int index, const QVector3D& location, const BlockOrientation* orientation) const;
+  virtual bool shouldRenderQuad(int index, const BlockOrientation* orientation) const;
+
+  /**
+    * Returns true if the quad at \p index should be skipped when the render delegate says that \p face of the block is
+    * hidden, and sets \p face to the face (in the default orientation) to ask about.  The default implementation
+    * returns false, so that quads are never culled.
+    */
+  virtual bool cullingFaceForQuad(int index, const BlockOrientation* orientation, Face* face) const;
 
   /**
     * Returns the texture that should be used to draw the quad at \p index for a block in \p orientation.  By default,
@@ -190,10 +213,43 @@ class BasicRenderable : public Renderable {
   }
 
  private:
+  /**
+    * What renderAt() needs to draw one quad in a particular orientation.
+    */
+  struct QuadEntry {
+    GLushort indices[4];
+    GLuint texture_id;
+    int texture_slot;
+    bool culled;
+    Face culling_face;
+    SceneCorner corners[4];
+  };
+
+  /**
+    * The quads to draw for a block in a particular orientation, in order.
+    */
+  struct QuadTable {
+    QVector<QuadEntry> quads;
+    int min_filter;
+    bool transformed;
+    GLfloat transform[16];
+  };
+
+  /**
+    * Asks the virtual methods above about every quad for a block in \p orientation.
+    */
+  QuadTable buildQuadTable(const BlockOrientation* orientation) const;
+
+  /**
+    * Returns the table for \p orientation, building it into \p scratch if it was not built by initialize().
+    */
+  const QuadTable& quadTable(const BlockOrientation* orientation, QuadTable* scratch) const;
+
   QVector3D size_;
   QVector<QVector3D> vertices_;
   QVector<QVector3D> normals_;
   QVector<QVector2D> tex_coords_;
+  QHash<const BlockOrientation*, QuadTable> quad_tables_;
 };
 
 #endif // BASIC_RENDERABLE_H
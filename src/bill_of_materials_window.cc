@@ -28,6 +28,7 @@ BillOfMaterialsWindow::BillOfMaterialsWindow(Diagram* diagram, QWidget* parent)
   ui.setupUi(this);
   ui.bill_of_materials_text_->setAttribute(Qt::WA_MacSmallSize);
   this->connect(diagram, SIGNAL(diagramChanged(BlockTransaction)), SLOT(updateBillOfMaterials()));
+  this->connect(diagram, SIGNAL(prefabsChanged()), SLOT(updateBillOfMaterials()));
 }
 
 BillOfMaterialsWindow::~BillOfMaterialsWindow() {}
@@ -40,7 +41,13 @@ void BillOfMaterialsWindow::updateBillOfMaterials() {
   if (!isVisible()) {
     return;
   }
+  // Placed prefabs have to be built too.
   QMap<blocktype_t, int> block_counts = diagram_->blockCounts();
+  QMap<blocktype_t, int> placed_counts = diagram_->placedBlockCounts();
+  QMap<blocktype_t, int>::const_iterator iter;
+  for (iter = placed_counts.constBegin(); iter != placed_counts.constEnd(); ++iter) {
+    block_counts[iter.key()] += iter.value();
+  }
   QList<blocktype_t> sorted_types = block_counts.keys();
   qSort(sorted_types);
   ui.bill_of_materials_text_->clear();
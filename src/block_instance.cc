@@ -18,16 +18,18 @@
 
 #include <QDataStream>
 
-BlockInstance::BlockInstance() : is_valid_(false), prototype_(NULL), orientation_(NULL) {}
+BlockInstance::BlockInstance() : prototype_(NULL), orientation_(NULL) {}
 
 BlockInstance::BlockInstance(BlockPrototype* prototype,
                              const BlockPosition& position,
                              const BlockOrientation* orientation)
-    : is_valid_(true), prototype_(prototype), position_(position), orientation_(orientation) {}
+    : prototype_(prototype), position_(position), orientation_(orientation) {
+  Q_ASSERT(prototype != NULL);
+}
 
 
 BlockInstance::BlockInstance(QDataStream* stream, BlockManager* block_manager)
-    : is_valid_(false), prototype_(NULL), orientation_(NULL) {
+    : prototype_(NULL), orientation_(NULL) {
   Q_ASSERT(block_manager != NULL);
   int position_x;
   int position_y;
@@ -40,6 +42,14 @@ BlockInstance::BlockInstance(QDataStream* stream, BlockManager* block_manager)
   char* orientation_chars;
   *stream >> orientation_chars;
 
+  if (stream->status() != QDataStream::Ok || !BlockPosition::isInRange(position_x, position_y, position_z)) {
+    delete[] orientation_chars;
+    if (stream->status() == QDataStream::Ok) {
+      stream->setStatus(QDataStream::ReadCorruptData);
+    }
+    return;
+  }
+
   BlockPosition position(position_x, position_y, position_z);
   blocktype_t type = static_cast<blocktype_t>(type_word);
   BlockPrototype* prototype = block_manager->getPrototype(type);
@@ -47,37 +57,16 @@ BlockInstance::BlockInstance(QDataStream* stream, BlockManager* block_manager)
 
   delete[] orientation_chars;
 
-  is_valid_ = true;
   prototype_ = prototype;
   position_ = position;
   orientation_ = orientation;
 }
 
-BlockInstance::~BlockInstance() {}
-
-BlockInstance::BlockInstance(const BlockInstance& other)
-    : is_valid_(other.isValid()),
-      prototype_(other.prototype()),
-      position_(other.position()),
-      orientation_(other.orientation()) {}
-
-BlockInstance& BlockInstance::operator=(const BlockInstance& other) {
-  is_valid_ = other.isValid();
-  prototype_ = other.prototype();
-  position_ = other.position();
-  orientation_ = other.orientation();
-  return *this;
-}
-
 bool BlockInstance::serialize(QDataStream* stream) const {
   const BlockPosition& pos = position();
-  const QVector3D& vec = pos.cornerVector();
-  int position_x = vec.x();
-  int position_y = vec.y();
-  int position_z = vec.z();
-  *stream << position_x;
-  *stream << position_y;
-  *stream << position_z;
+  *stream << pos.x();
+  *stream << pos.y();
+  *stream << pos.z();
   *stream << static_cast<qint32>(prototype()->type());
   *stream << orientation()->name().toAscii().constData();
   return true;
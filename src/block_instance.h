@@ -21,13 +21,15 @@
 #include "block_prototype.h"
 
 class BlockManager;
+class BlockOracle;
 class QDataStream;
 
 /**
   * Represents a particular instance of a block.  Because there can be many hundreds of thousands of these in any given
   * model, this class is very small and contains only the data that can vary from instance to instance of a particular
   * block type (namely its position and orientation).  Everything else is stored in the BlockPrototype accessible
-  * through the prototype() method.  This makes BlockInstances small and cheap to create and copy.
+  * through the prototype() method.  This makes BlockInstances small and cheap to create and copy: an instance is two
+  * pointers and a packed BlockPosition, and is invalid exactly when it has no prototype.
   */
 class BlockInstance {
  public:
@@ -44,8 +46,9 @@ class BlockInstance {
   /**
     * Constructs a BlockInstance by deserializing it from \p stream using \p block_manager.  If a block can be read
     * from the stream without skipping any bytes, the created BlockInstance will be valid.  Otherwise, the created
-    * BlockInstance will be invalid.  Either way, due to the sequential nature of streams, the stream will be advanced
-    * past the data that was read.
+    * BlockInstance will be invalid; a position outside the range BlockPosition can hold also sets the stream's status
+    * to QDataStream::ReadCorruptData.  Either way, due to the sequential nature of streams, the stream will be
+    * advanced past the data that was read.
     */
   BlockInstance(QDataStream* stream, BlockManager* block_manager);
 
@@ -56,17 +59,8 @@ class BlockInstance {
     */
   BlockInstance();
 
-  ~BlockInstance();
-
-  /**
-    * Copy constructor.  Creates a BlockInstance that is an exact clone of \p other.
-    */
-  BlockInstance(const BlockInstance& other);
-
-  /**
-    * Assignment operator.  Modifies \c this so that it is identical to \p other.
-    */
-  BlockInstance& operator=(const BlockInstance& other);
+  // The implicit destructor, copy constructor and assignment operator are used, so that BlockInstance stays trivially
+  // copyable.
 
   bool serialize(QDataStream* stream) const;
 
@@ -74,7 +68,7 @@ class BlockInstance {
     * Returns \c true if this instance is valid (that is, it was constructed with valid data rather than with the
     * default constructor).
     */
-  inline bool isValid() const { return is_valid_; }
+  inline bool isValid() const { return prototype_ != NULL; }
 
   /**
     * Returns the BlockPrototype for this block.  This will be NULL if the instance is not valid.
@@ -95,21 +89,24 @@ class BlockInstance {
   inline const BlockOrientation* orientation() const { return orientation_; }
 
   /**
-    * Renders this BlockInstance in a 3D context.  Equivalent to `prototype()->renderInstance(*this)`.  The particular
-    * context is determined by the BlockPrototype.  This should only be called from within a QGLWidget::paintGL()
+    * Renders this BlockInstance in a 3D context.  Equivalent to `prototype()->renderInstance(*this, oracle)`.  The
+    * particular context is determined by the BlockPrototype, and \p oracle, which is usually the Diagram the block is
+    * in, is asked about its neighbours.  This should only be called from within a QGLWidget::paintGL()
     * implementation.  If the instance is not valid, this does nothing.
     */
-  inline void render() const {
+  inline void render(BlockOracle* oracle) const {
     if (Q_LIKELY(prototype())) {
-      prototype()->renderInstance(*this);
+      prototype()->renderInstance(*this, oracle);
     }
   }
 
  private:
-  bool is_valid_;
   BlockPrototype* prototype_;
   BlockPosition position_;
   const BlockOrientation* orientation_;
 };
 
+// Lets QList store BlockInstances inline rather than allocating a node for each one, and QVector move them with memcpy.
+Q_DECLARE_TYPEINFO(BlockInstance, Q_MOVABLE_TYPE);
+
 #endif // BLOCK_INSTANCE_H
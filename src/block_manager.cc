@@ -18,8 +18,8 @@
 #include "block_prototype.h"
 #include "block_type.h"
 
-BlockManager::BlockManager(BlockOracle* oracle, QGLWidget* widget)
-    : oracle_(oracle), widget_(widget) {
+BlockManager::BlockManager(QGLWidget* widget)
+    : widget_(widget) {
   // Load textures.
   default_texture_pack_.reset(TexturePack::createDefaultTexturePack());
 }
@@ -33,7 +33,7 @@ BlockPrototype* BlockManager::getPrototype(blocktype_t type) const {
   if (block) {
     return block;
   } else {
-    block = new BlockPrototype(type, default_texture_pack_.data(), oracle_, widget_);
+    block = new BlockPrototype(type, default_texture_pack_.data(), widget_);
     blocks_.insert(type, block);
     return block;
   }
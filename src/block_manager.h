@@ -22,13 +22,15 @@
 #include "block_type.h"
 #include "texture_pack.h"
 
-class BlockOracle;
 class BlockPrototype;
 class TexturePack;
 class QGLWidget;
 
 /**
   * Manages BlockPrototype objects.  To the the prototype for a particular block type, call getPrototype().
+  *
+  * Prototypes don't belong to any one diagram, so every open diagram shares the one BlockManager, and with it the
+  * prototypes, their textures and their sprites.  Opening another diagram only costs its blocks.
   * @warning There should only be one BlockManager in the application.  If you create more than one, you will end up
   * with duplicate prototypes for different block types and lots of things will break.  The BlockManager is owned by
   * the Application.
@@ -36,10 +38,10 @@ class QGLWidget;
 class BlockManager {
  public:
   /**
-    * Constructs a new BlockManager.  Do not create multiple BlockManagers; the canonical instance is owned by
-    * Application.
+    * Constructs a new BlockManager whose textures are created in the GL context of \p widget, which every GLWidget
+    * must share.  Do not create multiple BlockManagers; the canonical instance is owned by Application.
     */
-  BlockManager(BlockOracle* oracle, QGLWidget* widget);
+  explicit BlockManager(QGLWidget* widget);
 
   ~BlockManager();
 
@@ -52,7 +54,6 @@ class BlockManager {
 
  private:
   mutable QHash<blocktype_t, BlockPrototype*> blocks_;
-  BlockOracle* oracle_;
   QGLWidget* widget_;
   QScopedPointer<TexturePack> default_texture_pack_;
 };
@@ -17,6 +17,75 @@
 
 #include <QString>
 
+namespace {
+
+/** The compass directions, in the order that a quarter turn takes each of them to the next. */
+const char* const kDirections[] = { "south", "east", "north", "west" };
+
+/**
+  * Returns the direction that \p direction, which must be lower case, becomes after a quarter turn, or an empty string
+  * if it is not a direction.
+  */
+QString turnedDirection(const QString& direction) {
+  for (int i = 0; i < 4; ++i) {
+    if (direction == kDirections[i]) {
+      return kDirections[(i + 1) % 4];
+    }
+  }
+  return QString();
+}
+
+/**
+  * Returns \p word, which may be a direction ("west") or a corner ("northeast") in any case, after a quarter turn, in
+  * the same case.  Other words are returned unchanged.
+  */
+QString turnedWord(const QString& word) {
+  QString lower = word.toLower();
+  QString turned = turnedDirection(lower);
+  if (turned.isEmpty() && lower.size() > 5) {
+    // A corner is a north/south direction followed by an east/west one, and stays that way round after turning.
+    QString first = turnedDirection(lower.left(5));
+    QString second = turnedDirection(lower.mid(5));
+    if (!first.isEmpty() && !second.isEmpty()) {
+      turned = (first == "north" || first == "south") ? first + second : second + first;
+    }
+  }
+  if (turned.isEmpty()) {
+    return word;
+  }
+  if (word.at(0).isUpper()) {
+    turned[0] = turned.at(0).toUpper();
+  }
+  return turned;
+}
+
+/**
+  * Returns \p name with every direction in it turned a quarter turn.
+  */
+QString turnedName(const QString& name) {
+  QString turned;
+  int pos = 0;
+  while (pos < name.size()) {
+    int end = pos;
+    while (end < name.size() && name.at(end).isLetter()) {
+      ++end;
+    }
+    if (end == pos) {
+      turned += name.at(pos);
+      ++pos;
+    } else {
+      turned += turnedWord(name.mid(pos, end - pos));
+      pos = end;
+    }
+  }
+  // Axes are always written north/south and east/west.
+  turned.replace("south/north", "north/south");
+  turned.replace("west/east", "east/west");
+  return turned;
+}
+
+}  // namespace
+
 QHash<QString, BlockOrientation*> BlockOrientation::s_known_orientations_;
 
 // Static.
@@ -40,4 +109,21 @@ BlockOrientation* BlockOrientation::get(const char* name) {
   return instance;
 }
 
-BlockOrientation::BlockOrientation(const QString& name) : name_(name) {}
+BlockOrientation::BlockOrientation(const QString& name) : name_(name) {
+  rotations_[0] = rotations_[1] = rotations_[2] = NULL;
+}
+
+const BlockOrientation* BlockOrientation::rotated(int quarter_turns) const {
+  int turns = ((quarter_turns % 4) + 4) % 4;
+  if (turns == 0) {
+    return this;
+  }
+  if (!rotations_[turns - 1]) {
+    QString name = name_;
+    for (int i = 0; i < turns; ++i) {
+      name = turnedName(name);
+    }
+    rotations_[turns - 1] = (name == name_) ? this : get(name.toAscii().constData());
+  }
+  return rotations_[turns - 1];
+}
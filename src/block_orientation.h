@@ -74,10 +74,24 @@ class BlockOrientation {
     return name_;
   }
 
+  /**
+    * Returns the orientation that this one becomes when its block is turned \p quarter_turns times about the vertical
+    * axis, each turn taking south to east, east to north, and so on (the direction of glRotatef(90, 0, 1, 0)).  The
+    * compass directions in the name are rotated, so "Facing south" turned once is "Facing east" and "Northeast corner"
+    * is "Northwest corner".  Orientations without a direction in their name are returned unchanged.
+    *
+    * @note The result may not be a valid orientation for a particular block.  Use BlockPrototype::rotatedOrientation()
+    *       to rotate the orientation of a block.
+    */
+  const BlockOrientation* rotated(int quarter_turns) const;
+
  private:
   BlockOrientation(const QString& name);
   static QHash<QString, BlockOrientation*> s_known_orientations_;
   QString name_;
+
+  /** The results of rotated() for one, two and three quarter turns, or NULL until they are first asked for. */
+  mutable const BlockOrientation* rotations_[3];
   Q_DISABLE_COPY(BlockOrientation)
 };
 
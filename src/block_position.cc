@@ -23,76 +23,46 @@ QDebug operator<<(QDebug dbg, const BlockPosition& position) {
 }
 
 uint qHash(const BlockPosition& position) {
-  quint64 hash_seed = static_cast<quint64>(position.x()) +
-                      (static_cast<quint64>(position.y()) << 16) +
-                      (static_cast<quint64>(position.z()) << 32);
-  return qHash(hash_seed);
+  return static_cast<uint>(BlockPosition::mix(position.packed()));
 }
 
-BlockPosition::BlockPosition() : x_(0), y_(0), z_(0), vectors_known_(false) {
-
-}
-
-BlockPosition::BlockPosition(int x, int y, int z)
-    : x_(x), y_(y), z_(z), vectors_known_(false) {
+BlockPosition::BlockPosition() {
+  pack(0, 0, 0);
 }
 
-BlockPosition::BlockPosition(const BlockPosition& other) {
-  x_ = other.x_;
-  y_ = other.y_;
-  z_ = other.z_;
-  vectors_known_ = other.vectors_known_;
-  corner_vector_ = other.corner_vector_;
-  center_vector_ = other.center_vector_;
+BlockPosition::BlockPosition(int x, int y, int z) {
+  pack(x, y, z);
 }
 
 BlockPosition::BlockPosition(const QVector3D& vector) {
   // + 0.25 is to ensure that floating-point errors won't cause, e.g., 1000 to be represented as 999.999999999 and
   // floor()'d down to 999, while still ensuring that 1000.5 gets rounded correctly.
-  x_ = qFloor(vector.x() + 0.25f);
-  y_ = qFloor(vector.y() + 0.25f);
-  z_ = qFloor(vector.z() + 0.25f);
-}
-
-BlockPosition& BlockPosition::operator=(const BlockPosition& other) {
-  x_ = other.x_;
-  y_ = other.y_;
-  z_ = other.z_;
-  vectors_known_ = other.vectors_known_;
-  corner_vector_ = other.corner_vector_;
-  center_vector_ = other.center_vector_;
-  return *this;
-}
-
-bool BlockPosition::operator==(const BlockPosition& other) const {
-  return x_ == other.x_ && y_ == other.y_ && z_ == other.z_;
+  pack(qFloor(vector.x() + 0.25f), qFloor(vector.y() + 0.25f), qFloor(vector.z() + 0.25f));
 }
 
 BlockPosition BlockPosition::operator+(const BlockPosition& other) const {
-  return BlockPosition(x_ + other.x_, y_ + other.y_, z_ + other.z_);
+  return BlockPosition(x() + other.x(), y() + other.y(), z() + other.z());
 }
 
-const QVector3D& BlockPosition::centerVector() const {
-  if (!vectors_known_) {
-    computeVectors();
-  }
-  return center_vector_;
+QVector3D BlockPosition::centerVector() const {
+  return QVector3D(static_cast<qreal>(x()) + 0.5f,
+                   static_cast<qreal>(y()) + 0.5f,
+                   static_cast<qreal>(z()) + 0.5f);
 }
 
-const QVector3D& BlockPosition::cornerVector() const {
-  if (!vectors_known_) {
-    computeVectors();
-  }
-  return corner_vector_;
+QVector3D BlockPosition::cornerVector() const {
+  return QVector3D(static_cast<qreal>(x()),
+                   static_cast<qreal>(y()),
+                   static_cast<qreal>(z()));
 }
 
-void BlockPosition::computeVectors() const {
-  corner_vector_ = QVector3D(static_cast<qreal>(x_),
-                             static_cast<qreal>(y_),
-                             static_cast<qreal>(z_)),
-  center_vector_ = QVector3D(static_cast<qreal>(x_) + 0.5f,
-                             static_cast<qreal>(y_) + 0.5f,
-                             static_cast<qreal>(z_) + 0.5f);
-  vectors_known_ = true;
+void BlockPosition::pack(int x, int y, int z) {
+  Q_ASSERT_X(isInRange(x, y, z), __PRETTY_FUNCTION__, "Coordinate out of range.");
+  // Release builds clamp rather than let an out-of-range coordinate spill into the bits of its neighbour.
+  x = qBound(static_cast<int>(kMinCoordinate), x, static_cast<int>(kMaxCoordinate));
+  y = qBound(static_cast<int>(kMinCoordinate), y, static_cast<int>(kMaxCoordinate));
+  z = qBound(static_cast<int>(kMinCoordinate), z, static_cast<int>(kMaxCoordinate));
+  packed_ = (static_cast<quint64>(x - kMinCoordinate) << kXShift) |
+            (static_cast<quint64>(y - kMinCoordinate) << kYShift) |
+            (static_cast<quint64>(z - kMinCoordinate) << kZShift);
 }
-
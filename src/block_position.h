@@ -23,76 +23,121 @@
   * A lightweight integer-precision position class for blocks.  Because there can only be one block in a given square
   * meter, it is more efficient and convenient to use integers for block coordinates (they hash correctly, can be
   * compared without worrying about roundoff errors, etc).  When the block is rendered, a (real-valued) QVector3D is
-  * required, and this can be generated by calling either cornerVector() or centerVector().  For efficiency, these
-  * vectors are not calculated until they are needed, so creating and copying BlockPositions is fairly cheap.
+  * required, and this can be generated by calling either cornerVector() or centerVector().
+  *
+  * BlockPositions are copied by value through every tool, transaction, signal and hash, so all three coordinates are
+  * packed into a single 64-bit word.  Each coordinate must lie between kMinCoordinate and kMaxCoordinate.  Debug
+  * builds assert this; release builds clamp an out-of-range coordinate to the nearest end of the range, so that it can
+  * never alias a distant position.  Anything read from a file is checked with isInRange() before it gets here.
   */
 class BlockPosition {
  public:
+  /** The smallest value any coordinate of a BlockPosition can have. */
+  static const int kMinCoordinate = -(1 << 20);
+
+  /** The largest value any coordinate of a BlockPosition can have. */
+  static const int kMaxCoordinate = (1 << 20) - 1;
+
+  /**
+    * Returns \c true if \p x, \p y and \p z all lie between kMinCoordinate and kMaxCoordinate, so that they can be
+    * used to construct a BlockPosition.  Anything read from a file should be checked with this first.
+    */
+  static inline bool isInRange(qint64 x, qint64 y, qint64 z) {
+    return x >= kMinCoordinate && x <= kMaxCoordinate && y >= kMinCoordinate && y <= kMaxCoordinate &&
+           z >= kMinCoordinate && z <= kMaxCoordinate;
+  }
+
   BlockPosition();
 
   /** Constructs a BlockPosition with the given x, y, and z coordinates. */
   BlockPosition(int x, int y, int z);
 
-  /**
-   * Copy constructor. If the corner and center vectors have already been computed, they will be copied to the new
-   * instance as well.
-   */
-  BlockPosition(const BlockPosition& other);
-
   /**
     * Constructs a BlockPosition from a QVector3D.  This involves some floating point math, so it is more expensive
     * than the other constructors.
     */
   explicit BlockPosition(const QVector3D& vector);
 
-  /**
-    * Assigns one BlockPosition to another.  As with the copy constructor, this will copy the corner and center vectors
-    * to the new instance if they have been computed.
-    */
-  BlockPosition& operator=(const BlockPosition& other);
-
   /** Equality operator.  Because BlockPosition is integer-valued, this is both fast and always accurate. */
-  bool operator==(const BlockPosition& other) const;
+  inline bool operator==(const BlockPosition& other) const {
+    return packed_ == other.packed_;
+  }
 
   /** Adds two BlockPositions component-wise and returns the result. */
   BlockPosition operator+(const BlockPosition& other) const;
 
   /** Returns the x component of this BlockPosition. */
   inline int x() const {
-    return x_;
+    return unpack(kXShift);
   }
 
   /** Returns the y component of this BlockPosition. */
   inline int y() const {
-    return y_;
+    return unpack(kYShift);
   }
 
-  /** Returns the y component of this BlockPosition. */
+  /** Returns the z component of this BlockPosition. */
   inline int z() const {
-    return z_;
+    return unpack(kZShift);
   }
 
   /** Returns the vector pointing to this BlockPosition's front lower left corner. */
-  const QVector3D& cornerVector() const;
+  QVector3D cornerVector() const;
 
   /** Returns the vector pointing to this BlockPosition's center. */
-  const QVector3D& centerVector() const;
+  QVector3D centerVector() const;
+
+  /**
+    * Returns all three coordinates packed into one word.  Two BlockPositions are equal exactly when their packed
+    * values are.
+    */
+  inline quint64 packed() const {
+    return packed_;
+  }
+
+  /** Returns the BlockPosition whose packed() value is \p packed. */
+  static inline BlockPosition fromPacked(quint64 packed) {
+    BlockPosition position;
+    position.packed_ = packed;
+    return position;
+  }
+
+  /**
+    * Scrambles a packed position so that every bit of it affects every bit of the result (this is the finalizer of
+    * MurmurHash3).  Nearby positions differ only in a few low bits of each coordinate, so hash tables should use this
+    * rather than the packed value itself.
+    */
+  static inline quint64 mix(quint64 packed) {
+    packed ^= packed >> 33;
+    packed *= Q_UINT64_C(0xff51afd7ed558ccd);
+    packed ^= packed >> 33;
+    packed *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+    packed ^= packed >> 33;
+    return packed;
+  }
 
  private:
+  static const int kCoordinateBits = 21;
+  static const int kXShift = 0;
+  static const int kYShift = kCoordinateBits;
+  static const int kZShift = 2 * kCoordinateBits;
+  static const quint64 kCoordinateMask = (Q_UINT64_C(1) << kCoordinateBits) - 1;
+
   /**
-   * Computes the corner and center vectors for this BlockPosition.
-   * This is fairly expensive, so it is called only when needed.
-   */
-  void computeVectors() const;
-
-  int x_;
-  int y_;
-  int z_;
-  mutable bool vectors_known_;
-  mutable QVector3D corner_vector_;
-  mutable QVector3D center_vector_;
+    * Packs \p x, \p y and \p z into packed_.  Each is clamped to the range kMinCoordinate to kMaxCoordinate, and
+    * stored offset by -kMinCoordinate, so that it is never negative.
+    */
+  void pack(int x, int y, int z);
+
+  inline int unpack(int shift) const {
+    return static_cast<int>((packed_ >> shift) & kCoordinateMask) + kMinCoordinate;
+  }
+
+  quint64 packed_;
 };
 
+Q_DECLARE_TYPEINFO(BlockPosition, Q_MOVABLE_TYPE);
+
 /**
   * Allows BlockPositions to be streamed using qDebug().
   */
@@ -100,7 +145,8 @@ QDebug operator<<(QDebug dbg, const BlockPosition& position);
 
 /**
   * Allows BlockPositions to be efficiently stored in a hash table such as QHash.  This hash function is designed such
-  * that two identical BlockPositions will always hash to the same value with no floating-point nonsense.
+  * that two identical BlockPositions will always hash to the same value with no floating-point nonsense.  Containers
+  * that are updated for every block of an edit should use PositionHash instead.
   */
 uint qHash(const BlockPosition& vec);
 
@@ -32,6 +32,7 @@ BlockProperties::BlockProperties()
       is_transparent_(false),
       is_biome_grass_(false),
       is_biome_tree_(false),
+      tint_(QColor()),
       is_valid_(false) {}
 
 BlockProperties::BlockProperties(const QVariantMap& block_data) {
@@ -47,6 +48,8 @@ BlockProperties::BlockProperties(const QVariantMap& block_data) {
       is_biome_grass_ = value.toBool();
     } else if (key == kBlockPropertyKeyBiomeTree) {
       is_biome_tree_ = value.toBool();
+    } else if (key == kBlockPropertyKeyTint) {
+      tint_ = QColor(value.toString());
     } else if (key == kBlockPropertyKeyGeometry) {
       // Convert from string to BlockGeometry enum.
       geometry_ = Enumeration<BlockGeometry, BlockGeometry::Geometry>::fromString(value.toString());
@@ -114,6 +117,10 @@ bool BlockProperties::isBiomeTree() const {
   return is_biome_tree_;
 }
 
+QColor BlockProperties::tint() const {
+  return tint_;
+}
+
 bool BlockProperties::isValid() const {
   return is_valid_;
 }
@@ -16,6 +16,7 @@
 #ifndef BLOCK_PROPERTIES_H
 #define BLOCK_PROPERTIES_H
 
+#include <QColor>
 #include <QPoint>
 #include <QString>
 #include <QStringList>
@@ -61,6 +62,7 @@ class BlockProperties {
         is_transparent_(other.isTransparent()),
         is_biome_grass_(other.isBiomeGrass()),
         is_biome_tree_(other.isBiomeTree()),
+        tint_(other.tint()),
         is_valid_(true) {
   }
 
@@ -74,6 +76,7 @@ class BlockProperties {
     is_transparent_ = other.isTransparent();
     is_biome_grass_ = other.isBiomeGrass();
     is_biome_tree_ = other.isBiomeTree();
+    tint_ = other.tint();
     is_valid_ = true;
     return *this;
   }
@@ -137,6 +140,13 @@ class BlockProperties {
     */
   bool isBiomeTree() const;
 
+  /**
+    * Returns the color that every texture of this block should be multiplied by, or an invalid color if the textures
+    * are used as they are.  This is how blocks whose textures are greyscale in terrain.png, like redstone wire, get
+    * their color.
+    */
+  QColor tint() const;
+
   /**
     * Returns whether this BlockProperties object is valid.  This will be false if it was created with the default
     * constructor and true otherwise.
@@ -153,6 +163,7 @@ private:
   bool is_transparent_;
   bool is_biome_grass_;
   bool is_biome_tree_;
+  QColor tint_;
   bool is_valid_;
 };
 
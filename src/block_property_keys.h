@@ -26,5 +26,6 @@ static const char kBlockPropertyKeyTextures[] = "tileOffsets";
 static const char kBlockPropertyKeyTransparent[] = "isTransparent";
 static const char kBlockPropertyKeyBiomeGrass[] = "isBiomeGrass";
 static const char kBlockPropertyKeyBiomeTree[] = "isBiomeTree";
+static const char kBlockPropertyKeyTint[] = "tint";
 
 #endif // BLOCK_PROPERTY_KEYS_H
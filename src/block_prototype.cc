@@ -38,6 +38,7 @@
 #include "pane_renderable.h"
 #include "rectangular_prism_renderable.h"
 #include "renderable.h"
+#include "scene_mesh.h"
 #include "stairs_renderable.h"
 #include "texture.h"
 #include "texture_pack.h"
@@ -45,6 +46,7 @@
 #include "track_renderable.h"
 
 QMap<blocktype_t, BlockProperties>* BlockPrototype::s_type_mapping = NULL;
+uint BlockPrototype::s_registry_fingerprint = 0;
 
 // Static.
 void BlockPrototype::setupBlockProperties() {
@@ -79,6 +81,7 @@ void BlockPrototype::setupBlockProperties() {
     return;
   }
 
+  f.open(QIODevice::ReadOnly);
   QJson::Parser p;
   bool success = false;
   QVariant root = p.parse(&f, &success);
@@ -92,6 +95,9 @@ void BlockPrototype::setupBlockProperties() {
     return;
   }
 
+  f.seek(0);
+  s_registry_fingerprint = qHash(f.readAll());
+
   s_type_mapping = new QMap<blocktype_t, BlockProperties>();
   QVariantList blocks = root.toList();
   foreach (QVariant block_variant, blocks) {
@@ -119,8 +125,8 @@ const BlockProperties& BlockPrototype::properties() const {
   return properties_;
 }
 
-BlockPrototype::BlockPrototype(blocktype_t type, TexturePack* texture_pack, BlockOracle* oracle, QGLWidget* widget)
-    : type_(type), oracle_(oracle) {
+BlockPrototype::BlockPrototype(blocktype_t type, TexturePack* texture_pack, QGLWidget* widget)
+    : type_(type) {
   if (!s_type_mapping) {
     qWarning() << "You forgot to call setupBlockProperties!";
     s_type_mapping = new QMap<blocktype_t, BlockProperties>();
@@ -183,7 +189,6 @@ BlockPrototype::BlockPrototype(blocktype_t type, TexturePack* texture_pack, Bloc
       renderable_.reset(new RectangularPrismRenderable(QVector3D(1.0f, 1.0f, 1.0f)));
       break;
   }
-  renderable_->initialize();
   renderable_->setRenderDelegate(this);
 
   QPixmap terrain_png = texture_pack->tileSheetNamed("terrain.png");
@@ -198,11 +203,18 @@ BlockPrototype::BlockPrototype(blocktype_t type, TexturePack* texture_pack, Bloc
       Texture t(widget, terrain_png, tiles[i].x(), tiles[i].y(), 16, 16,
                 QColor(0x58, 0x6C, 0x2F, 0xFF), QPainter::CompositionMode_Multiply);
       renderable_->setTexture(static_cast<Face>(i), t);
+    } else if (properties_.tint().isValid()) {
+      Texture t(widget, terrain_png, tiles[i].x(), tiles[i].y(), 16, 16,
+                properties_.tint(), QPainter::CompositionMode_Multiply);
+      renderable_->setTexture(static_cast<Face>(i), t);
     } else {
       Texture t(widget, terrain_png, tiles[i].x(), tiles[i].y(), 16, 16);
       renderable_->setTexture(static_cast<Face>(i), t);
     }
   }
+  // The renderable works out how to draw each orientation up front, so it needs its textures first.
+  renderable_->initialize();
+
   QPoint sprite_offset = properties_.spriteOffset();
   if (!properties_.isValid() || sprite_offset.x() < 0 || sprite_offset.y() < 0) {
     sprite_texture_ = Texture(widget, ":/null_sprite.png", 0, 0, 16, 16);
@@ -212,6 +224,9 @@ BlockPrototype::BlockPrototype(blocktype_t type, TexturePack* texture_pack, Bloc
   } else if (properties_.isBiomeTree()) {
     sprite_texture_ = Texture(widget, terrain_png, sprite_offset.x(), sprite_offset.y(), 16, 16,
                               QColor(0x58, 0x6C, 0x2F, 0xFF), QPainter::CompositionMode_Multiply);
+  } else if (properties_.tint().isValid()) {
+    sprite_texture_ = Texture(widget, terrain_png, sprite_offset.x(), sprite_offset.y(), 16, 16,
+                              properties_.tint(), QPainter::CompositionMode_Multiply);
   } else {
     sprite_texture_ = Texture(widget, terrain_png, sprite_offset.x(), sprite_offset.y(), 16, 16);
   }
@@ -238,17 +253,43 @@ QVector<const BlockOrientation*> BlockPrototype::orientations() const {
   return orientations;
 }
 
-void BlockPrototype::renderInstance(const BlockInstance& instance) const {
-  if (oracle_ && oracle_->levelsAreVertical()) {
+const BlockOrientation* BlockPrototype::rotatedOrientation(const BlockOrientation* orientation,
+                                                          int quarter_turns) const {
+  const BlockOrientation* rotated = orientation->rotated(quarter_turns);
+  if (rotated != orientation && properties().validOrientations().contains(rotated)) {
+    return rotated;
+  }
+  return orientation;
+}
+
+bool BlockPrototype::isPlainCube() const {
+  return geometry() == BlockGeometry::kGeometryCube && !isTransparent() && orientations().size() <= 1;
+}
+
+void BlockPrototype::renderInstance(const BlockInstance& instance, BlockOracle* oracle) const {
+  if (oracle && oracle->levelsAreVertical()) {
     BlockPosition pos(instance.position().x(), -instance.position().z(), -instance.position().y());
-    renderable_->renderAt(pos.centerVector(), instance.orientation());
+    renderable_->renderAt(pos.centerVector(), instance.orientation(), oracle);
   } else {
-    renderable_->renderAt(instance.position().centerVector(), instance.orientation());
+    renderable_->renderAt(instance.position().centerVector(), instance.orientation(), oracle);
+  }
+}
+
+void BlockPrototype::appendInstanceGeometry(const BlockInstance& instance, BlockOracle* oracle, SceneMesh* mesh) const {
+  SceneMaterial material;
+  material.type = type();
+  material.transparent = isTransparent();
+  if (oracle && oracle->levelsAreVertical()) {
+    BlockPosition pos(instance.position().x(), -instance.position().z(), -instance.position().y());
+    renderable_->appendGeometry(mesh, material, pos.centerVector(), instance.orientation(), oracle);
+  } else {
+    renderable_->appendGeometry(mesh, material, instance.position().centerVector(), instance.orientation(), oracle);
   }
 }
 
 // TODO(phoenix): This doesn't look like it belongs here.  Shouldn't the Renderable be responsible for this?
-bool BlockPrototype::shouldRenderFace(const Renderable* renderable, Face face, const QVector3D& location) const {
+bool BlockPrototype::shouldRenderFace(const Renderable* renderable, Face face, const QVector3D& location,
+                                      BlockOracle* oracle) const {
   Q_UNUSED(renderable);
 
   BlockGeometry::Geometry geometry = properties().geometry();
@@ -256,19 +297,24 @@ bool BlockPrototype::shouldRenderFace(const Renderable* renderable, Face face, c
     return true;
   }
 
-  if (oracle_ && oracle_->levelsAreVertical()) {
+  if (!oracle) {
+    return true;
+  }
+
+  if (oracle->levelsAreVertical()) {
     // We don't yet support face culling for vertical orientation.
     // TODO(phoenix): Figure out what changes are necessary to get this working.
     return true;
   }
 
-  BlockPrototype* other = neighboringBlockForFace(face, location);
+  BlockPrototype* other = neighboringBlockForFace(face, location, oracle);
   return (other->type() == kBlockTypeAir ||
           other->properties().geometry() != BlockGeometry::kGeometryCube ||
           (other->properties().isTransparent() && other->type() != type()));
 }
 
-BlockPrototype* BlockPrototype::neighboringBlockForFace(Face face, const QVector3D& location) const {
+BlockPrototype* BlockPrototype::neighboringBlockForFace(Face face, const QVector3D& location,
+                                                       BlockOracle* oracle) const {
   static QVector3D front = QVector3D(0, 0, 1);
   static QVector3D back = QVector3D(0, 0, -1);
   static QVector3D left = QVector3D(-1, 0, 0);
@@ -276,27 +322,25 @@ BlockPrototype* BlockPrototype::neighboringBlockForFace(Face face, const QVector
   static QVector3D top = QVector3D(0, 1, 0);
   static QVector3D bottom = QVector3D(0, -1, 0);
 
-  if (!oracle_) {
+  if (!oracle) {
     return NULL;
   }
 
+  QVector3D offset;
   if (face == kFrontFace) {
-    return oracle_->blockAt(BlockPosition(location + front), BlockOracle::kPhysicalOrEphemeralBlocks).prototype();
-  }
-  if (face == kBackFace) {
-    return oracle_->blockAt(BlockPosition(location + back), BlockOracle::kPhysicalOrEphemeralBlocks).prototype();
-  }
-  if (face == kLeftFace) {
-    return oracle_->blockAt(BlockPosition(location + left), BlockOracle::kPhysicalOrEphemeralBlocks).prototype();
-  }
-  if (face == kRightFace) {
-    return oracle_->blockAt(BlockPosition(location + right), BlockOracle::kPhysicalOrEphemeralBlocks).prototype();
-  }
-  if (face == kTopFace) {
-    return oracle_->blockAt(BlockPosition(location + top), BlockOracle::kPhysicalOrEphemeralBlocks).prototype();
-  }
-  if (face == kBottomFace) {
-    return oracle_->blockAt(BlockPosition(location + bottom), BlockOracle::kPhysicalOrEphemeralBlocks).prototype();
+    offset = front;
+  } else if (face == kBackFace) {
+    offset = back;
+  } else if (face == kLeftFace) {
+    offset = left;
+  } else if (face == kRightFace) {
+    offset = right;
+  } else if (face == kTopFace) {
+    offset = top;
+  } else if (face == kBottomFace) {
+    offset = bottom;
+  } else {
+    return NULL;
   }
-  return NULL;
+  return oracle->blockAt(BlockPosition(location + offset), BlockOracle::kPhysicalOrEphemeralBlocks).prototype();
 }
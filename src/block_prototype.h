@@ -57,20 +57,32 @@ class BlockPrototype : public RenderDelegate {
     */
   static BlockTypeIterator blockIterator();
 
+  /**
+    * Returns a hash of the block definitions read by setupBlockProperties().  Anything derived from the way blocks
+    * look, such as cached scene geometry, is stale if this changes.
+    */
+  static uint registryFingerprint() {
+    return s_registry_fingerprint;
+  }
+
   /**
     * Constructs a BlockPrototype.
     *
     * @warning Because there should only ever be one BlockPrototype per block type per render destination, you should
     * never call this constructor directly.  Instead, call BlockManager::getPrototype.
     *
+    * Prototypes don't belong to any one diagram, so every open diagram can share them, along with their textures and
+    * sprites.  The diagram a block is in is passed to renderInstance() instead.
+    *
     * @param type The type of block this is a prototype for.
     * @param texture_pack The TexturePack that will be used to create textures for the block.
-    * @param oracle The BlockOracle the prototype will use to determine neighboring face information.
-    * @param widget The QGLWidget into which blocks of this type will be rendered.
+    * @param widget The QGLWidget into which blocks of this type will be rendered.  Its GL context must be shared with
+    *     every context the blocks are rendered into.
     */
-  explicit BlockPrototype(blocktype_t type, TexturePack* texture_pack, BlockOracle* oracle, QGLWidget* widget);
+  explicit BlockPrototype(blocktype_t type, TexturePack* texture_pack, QGLWidget* widget);
 
-  virtual bool shouldRenderFace(const Renderable* renderable, Face face, const QVector3D& location) const;
+  virtual bool shouldRenderFace(const Renderable* renderable, Face face, const QVector3D& location,
+                                BlockOracle* oracle) const;
 
   /**
     * Returns the sprite pixmap that should be used to represent this kind of block in a 2D context.
@@ -111,6 +123,20 @@ class BlockPrototype : public RenderDelegate {
     */
   virtual QVector<const BlockOrientation*> orientations() const;
 
+  /**
+    * Returns the orientation a block of this type in \p orientation has after being turned \p quarter_turns times
+    * about the vertical axis (see BlockOrientation::rotated()), or \p orientation itself if this block has no such
+    * orientation, as for blocks that look the same from every side.
+    */
+  const BlockOrientation* rotatedOrientation(const BlockOrientation* orientation, int quarter_turns) const;
+
+  /**
+    * Returns the shape of this block.
+    */
+  BlockGeometry::Geometry geometry() const {
+    return properties().geometry();
+  }
+
   /**
     * Returns whether this block is "transparent" in the Minecraft sense.  Transparent blocks may or may not be
     * visibly translucent, but they permit the passage of light, do not hide blocks behind them, and will not suffocate
@@ -121,14 +147,35 @@ class BlockPrototype : public RenderDelegate {
     return properties().isTransparent();
   }
 
+  /**
+    * Returns \c true if this block is an opaque cube with no orientations, such as dirt or stone.  These are the blocks
+    * that look the same from every side, and the same on the map as in the block picker.
+    */
+  bool isPlainCube() const;
+
   /**
     * Renders an instance of this block into the render destination with which the prototype was constructed.  The
     * position and orientation for the block are read from the instance. This should only be called from within a
     * QGLWidget::paintGL() implementation.
     *
     * @param instance The BlockInstance to render.
+    * @param oracle The BlockOracle holding the blocks around \p instance, which is used to leave out the faces that
+    *     they hide.  If it is NULL, every face is rendered.
     */
-  void renderInstance(const BlockInstance& instance) const;
+  void renderInstance(const BlockInstance& instance, BlockOracle* oracle) const;
+
+  /**
+    * Appends the geometry renderInstance() would draw for \p instance to \p mesh instead of drawing it.  The
+    * parameters have the same meaning as for renderInstance().
+    */
+  void appendInstanceGeometry(const BlockInstance& instance, BlockOracle* oracle, SceneMesh* mesh) const;
+
+  /**
+    * Returns the GL texture id for the texture of this block in \p slot, as named by SceneMaterial::texture_slot.
+    */
+  GLuint textureId(int slot) const {
+    return renderable_->textureId(slot);
+  }
 
  private:
   /**
@@ -136,13 +183,14 @@ class BlockPrototype : public RenderDelegate {
     * a static of non-POD type.  It is allocated and populated in setupBlockProperties().
     */
   static QMap<blocktype_t, BlockProperties>* s_type_mapping;
+  static uint s_registry_fingerprint;
 
   /**
-    * Returns the prototype of the block that would be adjacent to the \p face Face of a block of this type that is
-    * located at \p location.
+    * Returns the prototype of the block in \p oracle that would be adjacent to the \p face Face of a block of this
+    * type that is located at \p location.
     * @return The prototype of the adjacent block, or \c NULL if no block is adjacent to that face.
     */
-  BlockPrototype* neighboringBlockForFace(Face face, const QVector3D& location) const;
+  BlockPrototype* neighboringBlockForFace(Face face, const QVector3D& location, BlockOracle* oracle) const;
 
   /**
     * Returns the BlockProperties object for this prototype.  This is private because much of the information is only
@@ -153,7 +201,6 @@ class BlockPrototype : public RenderDelegate {
   Texture sprite_texture_;
   BlockProperties properties_;
   blocktype_t type_;
-  BlockOracle* oracle_;
   QScopedPointer<Renderable> renderable_;
   QScopedPointer<SpriteEngine> sprite_engine_;
 };
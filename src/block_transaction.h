@@ -17,12 +17,11 @@
 #define BLOCK_TRANSACTION_H
 
 #include <QList>
-#include <QSet>
 
 #include "block_type.h"
+#include "position_hash.h"
 
 class BlockInstance;
-class BlockPosition;
 
 /**
   * Represents an atomic operation on the world that involves adding, removing, and replacing blocks.
@@ -156,8 +155,8 @@ class BlockTransaction {
   }
 
  private:
-  QSet<BlockPosition> old_positions_;
-  QSet<BlockPosition> new_positions_;
+  PositionSet old_positions_;
+  PositionSet new_positions_;
   QList<BlockInstance> old_blocks_;
   QList<BlockInstance> new_blocks_;
 };
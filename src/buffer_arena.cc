@@ -0,0 +1,114 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "buffer_arena.h"
+
+BufferArena::BufferArena(int element_size)
+    : buffer_(QGLBuffer::VertexBuffer),
+      element_size_(element_size),
+      capacity_(0),
+      used_(0) {
+}
+
+bool BufferArena::reset(int capacity) {
+  if (!buffer_.isCreated()) {
+    buffer_.setUsagePattern(QGLBuffer::DynamicDraw);
+    if (!buffer_.create()) {
+      qWarning() << "Could not create a vertex buffer.";
+      return false;
+    }
+  }
+  buffer_.bind();
+  buffer_.allocate(capacity * element_size_);
+  buffer_.release();
+  capacity_ = capacity;
+  used_ = 0;
+  free_ranges_.clear();
+  if (capacity > 0) {
+    free_ranges_.insert(0, capacity);
+  }
+  return true;
+}
+
+void BufferArena::destroy() {
+  buffer_.destroy();
+  capacity_ = 0;
+  used_ = 0;
+  free_ranges_.clear();
+}
+
+int BufferArena::allocate(int count) {
+  QMap<int, int>::iterator iter;
+  for (iter = free_ranges_.begin(); iter != free_ranges_.end(); ++iter) {
+    if (iter.value() < count) {
+      continue;
+    }
+    int first = iter.key();
+    int remaining = iter.value() - count;
+    free_ranges_.erase(iter);
+    if (remaining > 0) {
+      free_ranges_.insert(first + count, remaining);
+    }
+    used_ += count;
+    return first;
+  }
+  return -1;
+}
+
+void BufferArena::free(int first, int count) {
+  Q_ASSERT(first >= 0 && first + count <= capacity_);
+  used_ -= count;
+  QMap<int, int>::iterator next = free_ranges_.lowerBound(first);
+  Q_ASSERT_X(next == free_ranges_.end() || next.key() >= first + count, __PRETTY_FUNCTION__, "Range already free.");
+  // Merge with the free range after this one...
+  if (next != free_ranges_.end() && next.key() == first + count) {
+    count += next.value();
+    next = free_ranges_.erase(next);
+  }
+  // ...and the one before it.
+  if (next != free_ranges_.begin()) {
+    QMap<int, int>::iterator previous = next;
+    --previous;
+    if (previous.key() + previous.value() == first) {
+      previous.value() += count;
+      return;
+    }
+  }
+  free_ranges_.insert(first, count);
+}
+
+void BufferArena::write(int first, const void* data, int count) {
+  buffer_.write(first * element_size_, data, count * element_size_);
+}
+
+void BufferArena::bind() {
+  buffer_.bind();
+}
+
+void BufferArena::release() {
+  buffer_.release();
+}
+
+float BufferArena::fragmentation() const {
+  int free_total = capacity_ - used_;
+  if (free_total <= 0) {
+    return 0.0f;
+  }
+  int largest = 0;
+  foreach (int length, free_ranges_) {
+    largest = qMax(largest, length);
+  }
+  return 1.0f - static_cast<float>(largest) / free_total;
+}
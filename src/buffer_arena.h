@@ -0,0 +1,113 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BUFFER_ARENA_H
+#define BUFFER_ARENA_H
+
+#include <QGLBuffer>
+#include <QMap>
+
+/**
+  * A single large GL vertex buffer whose storage is handed out in ranges of elements, so that many small pieces of
+  * geometry can share one buffer (and one bind) instead of each having a buffer of its own.
+  *
+  * Free ranges are kept in a list ordered by offset, allocated first fit, and merged with their neighbours when they
+  * are freed.  The arena never moves anything by itself: when allocate() fails, or fragmentation() gets too high, the
+  * owner should reset() the arena and write everything again, packed together.
+  *
+  * All methods that touch the buffer must be called with the GL context current.
+  */
+class BufferArena {
+ public:
+  /**
+    * Constructs an arena of elements of \p element_size bytes.  The buffer is not created until reset() is called.
+    */
+  explicit BufferArena(int element_size);
+
+  /**
+    * Throws away every allocation and gives the buffer room for \p capacity elements.  Creates the buffer if needed.
+    * @return \c false if the buffer could not be created.
+    */
+  bool reset(int capacity);
+
+  /**
+    * Deletes the buffer.
+    */
+  void destroy();
+
+  /**
+    * Reserves \p count consecutive elements.
+    * @return The index of the first element, or -1 if there is no free range that large.
+    */
+  int allocate(int count);
+
+  /**
+    * Returns the \p count elements starting at \p first, which must have been allocated together, to the arena.
+    */
+  void free(int first, int count);
+
+  /**
+    * Copies \p count elements from \p data to the buffer, starting at element \p first.  The buffer must be bound.
+    */
+  void write(int first, const void* data, int count);
+
+  /**
+    * Binds the buffer, so that vertex array pointers are offsets into it.
+    */
+  void bind();
+
+  /**
+    * Unbinds the buffer.
+    */
+  void release();
+
+  /**
+    * Returns the number of elements the buffer has room for.
+    */
+  int capacity() const {
+    return capacity_;
+  }
+
+  /**
+    * Returns the number of elements that have been allocated.
+    */
+  int used() const {
+    return used_;
+  }
+
+  /**
+    * Returns the size of an element, in bytes.
+    */
+  int elementSize() const {
+    return element_size_;
+  }
+
+  /**
+    * Returns how much of the free space is unusable for a single large allocation, from 0 (all of it is one range)
+    * to nearly 1 (it is scattered in tiny ranges).
+    */
+  float fragmentation() const;
+
+ private:
+  QGLBuffer buffer_;
+  int element_size_;
+  int capacity_;
+  int used_;
+
+  /** The free ranges, as a map from the index of their first element to their length. */
+  QMap<int, int> free_ranges_;
+};
+
+#endif // BUFFER_ARENA_H
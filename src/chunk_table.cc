@@ -0,0 +1,222 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chunk_table.h"
+
+#include <QDataStream>
+
+#include "block_manager.h"
+#include "block_orientation.h"
+#include "block_prototype.h"
+#include "block_transaction.h"
+
+namespace {
+
+const int kCellsPerChunk = ChunkTable::kChunkSize * ChunkTable::kChunkSize * ChunkTable::kChunkSize;
+
+/**
+  * Divides \p value by kChunkSize, rounding towards negative infinity.
+  */
+int chunkIndex(int value) {
+  return (value >= 0 ? value : value - ChunkTable::kChunkSize + 1) / ChunkTable::kChunkSize;
+}
+
+/**
+  * Returns the index of the cell that \p position occupies within its chunk.
+  */
+int cellIndex(const BlockPosition& position) {
+  const int mask = ChunkTable::kChunkSize - 1;
+  return (((position.z() & mask) * ChunkTable::kChunkSize) + (position.y() & mask)) * ChunkTable::kChunkSize +
+         (position.x() & mask);
+}
+
+/**
+  * Returns an FNV-1a hash of \p cells.
+  */
+uint hashCells(const QVector<quint16>& cells) {
+  uint hash = 2166136261u;
+  const quint16* data = cells.constData();
+  for (int i = 0; i < cells.size(); ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+}  // namespace
+
+ChunkTable::ChunkTable() {
+}
+
+ChunkTable::ChunkTable(const QHash<BlockPosition, BlockInstance>& blocks) {
+  // Split the blocks into chunks of palette indices.
+  QHash<PaletteEntry, int> palette_indices;
+  QHash<BlockPosition, Cells> chunks;
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = blocks.constBegin(); iter != blocks.constEnd(); ++iter) {
+    const BlockPosition& position = iter.key();
+    PaletteEntry entry(iter.value().prototype(), iter.value().orientation());
+    QHash<PaletteEntry, int>::const_iterator palette_iter = palette_indices.constFind(entry);
+    int palette_index;
+    if (palette_iter == palette_indices.constEnd()) {
+      Q_ASSERT(palette_.size() < 0xffff);
+      palette_index = palette_.size();
+      palette_indices.insert(entry, palette_index);
+      palette_.append(entry);
+    } else {
+      palette_index = palette_iter.value();
+    }
+    Cells& cells = chunks[BlockPosition(chunkIndex(position.x()), chunkIndex(position.y()), chunkIndex(position.z()))];
+    if (cells.isEmpty()) {
+      cells.fill(0, kCellsPerChunk);
+    }
+    cells[cellIndex(position)] = palette_index + 1;
+  }
+
+  // Intern the chunks, so that identical chunks share one copy of their cells.
+  QHash<uint, QList<int> > unique_chunks_by_hash;
+  QHash<BlockPosition, Cells>::const_iterator chunk_iter;
+  for (chunk_iter = chunks.constBegin(); chunk_iter != chunks.constEnd(); ++chunk_iter) {
+    const Cells& cells = chunk_iter.value();
+    QList<int>& candidates = unique_chunks_by_hash[hashCells(cells)];
+    int unique_index = -1;
+    foreach (int candidate, candidates) {
+      if (unique_chunks_[candidate] == cells) {
+        unique_index = candidate;
+        break;
+      }
+    }
+    if (unique_index < 0) {
+      unique_index = unique_chunks_.size();
+      unique_chunks_.append(cells);
+      candidates.append(unique_index);
+    }
+    placements_.append(qMakePair(chunk_iter.key(), unique_index));
+  }
+}
+
+void ChunkTable::write(QDataStream* stream) const {
+  *stream << static_cast<qint32>(palette_.size());
+  foreach (const PaletteEntry& entry, palette_) {
+    *stream << static_cast<qint32>(entry.first->type());
+    *stream << entry.second->name().toAscii().constData();
+  }
+
+  // Each unique chunk is written as runs of identical cells, since most chunks are largely empty or solid.
+  *stream << static_cast<qint32>(unique_chunks_.size());
+  foreach (const Cells& cells, unique_chunks_) {
+    QVector< QPair<quint16, quint16> > runs;
+    for (int i = 0; i < kCellsPerChunk; ) {
+      int run_end = i + 1;
+      while (run_end < kCellsPerChunk && cells[run_end] == cells[i]) {
+        ++run_end;
+      }
+      runs.append(qMakePair(static_cast<quint16>(run_end - i), cells[i]));
+      i = run_end;
+    }
+    *stream << static_cast<qint32>(runs.size());
+    for (int i = 0; i < runs.size(); ++i) {
+      *stream << runs[i].first << runs[i].second;
+    }
+  }
+
+  *stream << static_cast<qint32>(placements_.size());
+  for (int i = 0; i < placements_.size(); ++i) {
+    const BlockPosition& chunk_position = placements_[i].first;
+    *stream << static_cast<qint32>(chunk_position.x()) << static_cast<qint32>(chunk_position.y())
+            << static_cast<qint32>(chunk_position.z()) << static_cast<qint32>(placements_[i].second);
+  }
+}
+
+bool ChunkTable::read(QDataStream* stream, BlockManager* block_mgr) {
+  Q_ASSERT(block_mgr);
+  palette_.clear();
+  unique_chunks_.clear();
+  placements_.clear();
+
+  qint32 palette_size;
+  *stream >> palette_size;
+  for (int i = 0; i < palette_size && stream->status() == QDataStream::Ok; ++i) {
+    qint32 type_word;
+    char* orientation_chars;
+    *stream >> type_word;
+    *stream >> orientation_chars;
+    palette_.append(PaletteEntry(block_mgr->getPrototype(static_cast<blocktype_t>(type_word)),
+                                 BlockOrientation::get(orientation_chars)));
+    delete[] orientation_chars;
+  }
+
+  qint32 unique_chunk_count;
+  *stream >> unique_chunk_count;
+  for (int i = 0; i < unique_chunk_count && stream->status() == QDataStream::Ok; ++i) {
+    Cells cells;
+    cells.reserve(kCellsPerChunk);
+    qint32 run_count;
+    *stream >> run_count;
+    for (int j = 0; j < run_count && stream->status() == QDataStream::Ok; ++j) {
+      quint16 length;
+      quint16 value;
+      *stream >> length >> value;
+      if (value > palette_.size() || cells.size() + length > kCellsPerChunk) {
+        return false;
+      }
+      for (int k = 0; k < length; ++k) {
+        cells.append(value);
+      }
+    }
+    if (cells.size() != kCellsPerChunk) {
+      return false;
+    }
+    unique_chunks_.append(cells);
+  }
+
+  qint32 placement_count;
+  *stream >> placement_count;
+  for (int i = 0; i < placement_count && stream->status() == QDataStream::Ok; ++i) {
+    qint32 x, y, z, unique_index;
+    *stream >> x >> y >> z >> unique_index;
+    // Every cell of the chunk, not just its first, must be a valid BlockPosition.
+    if (unique_index < 0 || unique_index >= unique_chunks_.size() ||
+        !BlockPosition::isInRange(static_cast<qint64>(x) * kChunkSize, static_cast<qint64>(y) * kChunkSize,
+                                  static_cast<qint64>(z) * kChunkSize) ||
+        !BlockPosition::isInRange(static_cast<qint64>(x) * kChunkSize + kChunkSize - 1,
+                                  static_cast<qint64>(y) * kChunkSize + kChunkSize - 1,
+                                  static_cast<qint64>(z) * kChunkSize + kChunkSize - 1)) {
+      stream->setStatus(QDataStream::ReadCorruptData);
+      return false;
+    }
+    placements_.append(qMakePair(BlockPosition(x, y, z), static_cast<int>(unique_index)));
+  }
+  return stream->status() == QDataStream::Ok;
+}
+
+void ChunkTable::addBlocks(BlockTransaction* transaction) const {
+  Q_ASSERT(transaction);
+  for (int i = 0; i < placements_.size(); ++i) {
+    const BlockPosition& chunk_position = placements_[i].first;
+    const Cells& cells = unique_chunks_[placements_[i].second];
+    int base_x = chunk_position.x() * kChunkSize;
+    int base_y = chunk_position.y() * kChunkSize;
+    int base_z = chunk_position.z() * kChunkSize;
+    for (int cell = 0; cell < kCellsPerChunk; ++cell) {
+      if (cells[cell] == 0) {
+        continue;
+      }
+      const PaletteEntry& entry = palette_[cells[cell] - 1];
+      BlockPosition position(base_x + cell % kChunkSize, base_y + (cell / kChunkSize) % kChunkSize,
+                             base_z + cell / (kChunkSize * kChunkSize));
+      transaction->setBlock(BlockInstance(entry.first, position, entry.second));
+    }
+  }
+}
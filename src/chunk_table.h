@@ -0,0 +1,104 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHUNK_TABLE_H
+#define CHUNK_TABLE_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+#include "block_instance.h"
+#include "block_position.h"
+#include "block_type.h"
+
+class BlockManager;
+class BlockTransaction;
+class QDataStream;
+
+/**
+  * Content-addressed storage for the blocks of a diagram, split into chunks of kChunkSize blocks on a side.
+  *
+  * Each chunk is reduced to a list of cells, each holding either nothing or an index into a palette of distinct block
+  * type and orientation pairs.  Chunks are interned by a hash of their cells, so every chunk with the same contents
+  * (every copy of the same house, tower or wall segment in a city, say) is written to a file only once.
+  *
+  * Diagram uses a ChunkTable to save and load its blocks.  The table only exists while the file is being written or
+  * read; the diagram itself keeps every block separately.
+  */
+class ChunkTable {
+ public:
+  /** The edge length, in blocks, of each chunk. */
+  static const int kChunkSize = 16;
+
+  /**
+    * Creates an empty ChunkTable.
+    */
+  ChunkTable();
+
+  /**
+    * Creates a ChunkTable holding every block in \p blocks.
+    */
+  explicit ChunkTable(const QHash<BlockPosition, BlockInstance>& blocks);
+
+  /**
+    * Returns the number of non-empty chunks in the table.
+    */
+  int chunkCount() const {
+    return placements_.size();
+  }
+
+  /**
+    * Returns the number of distinct chunks in the table, i.e., the number of copies that are actually stored.
+    */
+  int uniqueChunkCount() const {
+    return unique_chunks_.size();
+  }
+
+  /**
+    * Writes the table to \p stream.
+    */
+  void write(QDataStream* stream) const;
+
+  /**
+    * Replaces the contents of the table with a table read from \p stream, which must have been written by write().
+    * @return \c false if the stream was truncated or inconsistent.
+    */
+  bool read(QDataStream* stream, BlockManager* block_mgr);
+
+  /**
+    * Records the addition of every block in the table in \p transaction, using BlockTransaction::setBlock().
+    */
+  void addBlocks(BlockTransaction* transaction) const;
+
+ private:
+  /** A distinct block type and orientation. */
+  typedef QPair<BlockPrototype*, const BlockOrientation*> PaletteEntry;
+
+  /**
+    * The cells of one chunk, at index (z * kChunkSize + y) * kChunkSize + x.  0 is an empty cell; anything else is an
+    * index into palette_, plus one.
+    */
+  typedef QVector<quint16> Cells;
+
+  QVector<PaletteEntry> palette_;
+  QVector<Cells> unique_chunks_;
+
+  /** Each non-empty chunk's position (in chunk coordinates) and index into unique_chunks_. */
+  QList< QPair<BlockPosition, int> > placements_;
+};
+
+#endif // CHUNK_TABLE_H
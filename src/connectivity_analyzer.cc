@@ -0,0 +1,333 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "connectivity_analyzer.h"
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include "occupancy_mask.h"
+
+namespace {
+
+const int kChunkSize = OccupancyMask::kChunkSize;
+const int kRowsPerChunk = kChunkSize * kChunkSize;
+const int kRowsPerWord = 64 / kChunkSize;
+const quint64 kRowMask = (Q_UINT64_C(1) << kChunkSize) - 1;
+
+typedef QPair<int, int> LabelPair;
+
+/**
+  * A run of consecutive blocks along x within one row of a chunk.
+  */
+struct Run {
+  int x_begin;
+  int x_end;
+  int label;
+};
+
+/**
+  * The runs of one chunk and the component labels given to them.  Labels are numbered from 0 within each chunk.
+  */
+struct ChunkLabels {
+  BlockPosition chunk;
+
+  /** The runs of the chunk, in row order and then in order of x within each row. */
+  QVector<Run> runs;
+
+  /** The runs of row r are runs[row_starts[r]] up to (but not including) runs[row_starts[r + 1]]. */
+  QVector<int> row_starts;
+
+  /** The lowest level occupied by each label. */
+  QVector<int> lowest_levels;
+};
+
+/**
+  * A disjoint-set forest with path halving.  Each set is represented by its lowest member.
+  */
+class UnionFind {
+ public:
+  explicit UnionFind(int size = 0) : parents_(size) {
+    for (int i = 0; i < size; ++i) {
+      parents_[i] = i;
+    }
+  }
+
+  int add() {
+    parents_.append(parents_.size());
+    return parents_.size() - 1;
+  }
+
+  int find(int i) {
+    while (parents_[i] != i) {
+      parents_[i] = parents_[parents_[i]];
+      i = parents_[i];
+    }
+    return i;
+  }
+
+  void merge(const LabelPair& labels) {
+    int first = find(labels.first);
+    int second = find(labels.second);
+    if (first < second) {
+      parents_[second] = first;
+    } else if (second < first) {
+      parents_[first] = second;
+    }
+  }
+
+ private:
+  QVector<int> parents_;
+};
+
+/**
+  * Appends to \p pairs the labels (plus \p first_offset and \p second_offset respectively) of every pair of runs in
+  * \p first and \p second that overlap along x.  Both ranges must be sorted by x.
+  */
+void findOverlappingRuns(const Run* first, const Run* first_end, int first_offset,
+                         const Run* second, const Run* second_end, int second_offset, QVector<LabelPair>* pairs) {
+  while (first != first_end && second != second_end) {
+    if (first->x_begin < second->x_end && second->x_begin < first->x_end) {
+      pairs->append(LabelPair(first->label + first_offset, second->label + second_offset));
+    }
+    if (first->x_end < second->x_end) {
+      ++first;
+    } else {
+      ++second;
+    }
+  }
+}
+
+/**
+  * Labels the components within one chunk.  Used as a QtConcurrent map functor.
+  */
+class ChunkLabeler {
+ public:
+  typedef ChunkLabels result_type;
+
+  explicit ChunkLabeler(const OccupancyMask* blocks) : blocks_(blocks) {}
+
+  ChunkLabels operator()(const BlockPosition& chunk) const {
+    const quint64* words = blocks_->chunkWords(chunk);
+    ChunkLabels result;
+    result.chunk = chunk;
+    result.row_starts.resize(kRowsPerChunk + 1);
+
+    // First pass: split every row into runs, giving each a label of its own, and union it with the runs it touches in
+    // the row below (y - 1) and the row behind (z - 1).
+    UnionFind provisional;
+    QVector<LabelPair> touching;
+    for (int row = 0; row < kRowsPerChunk; ++row) {
+      result.row_starts[row] = result.runs.size();
+      quint64 bits = (words[row / kRowsPerWord] >> ((row % kRowsPerWord) * kChunkSize)) & kRowMask;
+      int x = 0;
+      while (bits) {
+        while (!(bits & 1)) {
+          bits >>= 1;
+          ++x;
+        }
+        Run run = { x, x, provisional.add() };
+        while (bits & 1) {
+          bits >>= 1;
+          ++run.x_end;
+        }
+        x = run.x_end;
+        result.runs.append(run);
+      }
+
+      touching.clear();
+      const Run* runs = result.runs.constData();
+      const Run* row_begin = runs + result.row_starts[row];
+      const Run* row_end = runs + result.runs.size();
+      if (row % kChunkSize > 0) {
+        findOverlappingRuns(row_begin, row_end, 0, runs + result.row_starts[row - 1], row_begin, 0, &touching);
+      }
+      if (row >= kChunkSize) {
+        findOverlappingRuns(row_begin, row_end, 0, runs + result.row_starts[row - kChunkSize],
+                            runs + result.row_starts[row - kChunkSize + 1], 0, &touching);
+      }
+      foreach (const LabelPair& pair, touching) {
+        provisional.merge(pair);
+      }
+    }
+    result.row_starts[kRowsPerChunk] = result.runs.size();
+
+    // Second pass: replace every label with its root, renumbered so that the labels in use are consecutive.
+    QHash<int, int> final_labels;
+    for (int row = 0; row < kRowsPerChunk; ++row) {
+      int level = chunk.y() * kChunkSize + row % kChunkSize;
+      for (int i = result.row_starts[row]; i < result.row_starts[row + 1]; ++i) {
+        int root = provisional.find(result.runs[i].label);
+        QHash<int, int>::const_iterator iter = final_labels.constFind(root);
+        int label;
+        if (iter == final_labels.constEnd()) {
+          label = final_labels.size();
+          final_labels.insert(root, label);
+          result.lowest_levels.append(level);
+        } else {
+          label = iter.value();
+          result.lowest_levels[label] = qMin(result.lowest_levels[label], level);
+        }
+        result.runs[i].label = label;
+      }
+    }
+    return result;
+  }
+
+ private:
+  const OccupancyMask* blocks_;
+};
+
+/**
+  * Finds the pairs of labels that touch across the borders a chunk shares with its neighbours in +x, +y and +z, as
+  * global labels.  Used as a QtConcurrent map functor.
+  */
+class BorderScanner {
+ public:
+  typedef QVector<LabelPair> result_type;
+
+  BorderScanner(const QList<ChunkLabels>* chunks, const QHash<BlockPosition, int>* chunk_indices,
+                const QVector<int>* label_offsets)
+      : chunks_(chunks), chunk_indices_(chunk_indices), label_offsets_(label_offsets) {}
+
+  QVector<LabelPair> operator()(int index) const {
+    QVector<LabelPair> pairs;
+    const ChunkLabels& chunk = chunks_->at(index);
+    int offset = label_offsets_->at(index);
+
+    // Across +x, only the last run of each row and the first run of the same row next door can touch.
+    const ChunkLabels* east = neighbour(chunk, BlockPosition(1, 0, 0));
+    if (east) {
+      int east_offset = label_offsets_->at(chunk_indices_->value(east->chunk));
+      for (int row = 0; row < kRowsPerChunk; ++row) {
+        int last = chunk.row_starts[row + 1] - 1;
+        int first = east->row_starts[row];
+        if (last >= chunk.row_starts[row] && first < east->row_starts[row + 1] &&
+            chunk.runs[last].x_end == kChunkSize && east->runs[first].x_begin == 0) {
+          pairs.append(LabelPair(chunk.runs[last].label + offset, east->runs[first].label + east_offset));
+        }
+      }
+    }
+
+    // Across +y, the top row of each slice touches the bottom row of the same slice above.
+    const ChunkLabels* above = neighbour(chunk, BlockPosition(0, 1, 0));
+    if (above) {
+      int above_offset = label_offsets_->at(chunk_indices_->value(above->chunk));
+      for (int z = 0; z < kChunkSize; ++z) {
+        int top = z * kChunkSize + kChunkSize - 1;
+        int bottom = z * kChunkSize;
+        findOverlappingRuns(rowBegin(chunk, top), rowBegin(chunk, top + 1), offset,
+                            rowBegin(*above, bottom), rowBegin(*above, bottom + 1), above_offset, &pairs);
+      }
+    }
+
+    // Across +z, the last slice touches the first slice of the chunk to the south.
+    const ChunkLabels* south = neighbour(chunk, BlockPosition(0, 0, 1));
+    if (south) {
+      int south_offset = label_offsets_->at(chunk_indices_->value(south->chunk));
+      for (int y = 0; y < kChunkSize; ++y) {
+        int back = kRowsPerChunk - kChunkSize + y;
+        findOverlappingRuns(rowBegin(chunk, back), rowBegin(chunk, back + 1), offset,
+                            rowBegin(*south, y), rowBegin(*south, y + 1), south_offset, &pairs);
+      }
+    }
+    return pairs;
+  }
+
+ private:
+  const ChunkLabels* neighbour(const ChunkLabels& chunk, const BlockPosition& direction) const {
+    QHash<BlockPosition, int>::const_iterator iter = chunk_indices_->constFind(chunk.chunk + direction);
+    return iter == chunk_indices_->constEnd() ? NULL : &chunks_->at(iter.value());
+  }
+
+  static const Run* rowBegin(const ChunkLabels& chunk, int row) {
+    return chunk.runs.constData() + chunk.row_starts[row];
+  }
+
+  const QList<ChunkLabels>* chunks_;
+  const QHash<BlockPosition, int>* chunk_indices_;
+  const QVector<int>* label_offsets_;
+};
+
+}  // namespace
+
+ConnectivityAnalyzer::ConnectivityAnalyzer(const OccupancyMask* blocks)
+    : blocks_(blocks) {
+}
+
+int ConnectivityAnalyzer::findFloatingBlocks(int ground_level, OccupancyMask* floating) const {
+  Q_ASSERT(floating);
+  QList<ChunkLabels> chunks = QtConcurrent::blockingMapped< QList<ChunkLabels> >(blocks_->chunkPositions(),
+                                                                                  ChunkLabeler(blocks_));
+
+  // Give each chunk its own range of global labels.
+  QHash<BlockPosition, int> chunk_indices;
+  QVector<int> label_offsets(chunks.size());
+  QList<int> indices;
+  int label_count = 0;
+  for (int i = 0; i < chunks.size(); ++i) {
+    chunk_indices.insert(chunks[i].chunk, i);
+    label_offsets[i] = label_count;
+    label_count += chunks[i].lowest_levels.size();
+    indices.append(i);
+  }
+
+  QList< QVector<LabelPair> > border_pairs = QtConcurrent::blockingMapped< QList< QVector<LabelPair> > >(
+      indices, BorderScanner(&chunks, &chunk_indices, &label_offsets));
+  UnionFind components(label_count);
+  foreach (const QVector<LabelPair>& pairs, border_pairs) {
+    foreach (const LabelPair& pair, pairs) {
+      components.merge(pair);
+    }
+  }
+
+  QVector<bool> grounded(label_count, false);
+  for (int i = 0; i < chunks.size(); ++i) {
+    const QVector<int>& lowest_levels = chunks[i].lowest_levels;
+    for (int label = 0; label < lowest_levels.size(); ++label) {
+      if (lowest_levels[label] <= ground_level) {
+        grounded[components.find(label_offsets[i] + label)] = true;
+      }
+    }
+  }
+
+  int floating_count = 0;
+  for (int label = 0; label < label_count; ++label) {
+    if (components.find(label) == label && !grounded[label]) {
+      ++floating_count;
+    }
+  }
+  if (floating_count == 0) {
+    return 0;
+  }
+
+  for (int i = 0; i < chunks.size(); ++i) {
+    const ChunkLabels& chunk = chunks[i];
+    BlockPosition base(chunk.chunk.x() * kChunkSize, chunk.chunk.y() * kChunkSize, chunk.chunk.z() * kChunkSize);
+    for (int row = 0; row < kRowsPerChunk; ++row) {
+      for (int j = chunk.row_starts[row]; j < chunk.row_starts[row + 1]; ++j) {
+        const Run& run = chunk.runs[j];
+        if (!grounded[components.find(label_offsets[i] + run.label)]) {
+          floating->insertRun(base.x() + run.x_begin, base.x() + run.x_end, base.y() + row % kChunkSize,
+                              base.z() + row / kChunkSize);
+        }
+      }
+    }
+  }
+  return floating_count;
+}
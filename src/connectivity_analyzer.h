@@ -0,0 +1,50 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONNECTIVITY_ANALYZER_H
+#define CONNECTIVITY_ANALYZER_H
+
+class OccupancyMask;
+
+/**
+  * Finds the parts of a structure that aren't connected to the ground, i.e., the parts that would fall (or could not be
+  * built) in survival mode.
+  *
+  * Blocks are grouped into 6-connected components.  Each chunk of the mask is labelled on its own, as a separate task
+  * on the global thread pool, with the classic two-pass union-find: the first pass gives every run of blocks along x a
+  * provisional label and unions it with the runs it touches in the rows below and behind it, and the second pass
+  * replaces each label with its root.  The chunk borders are then scanned in parallel for runs that touch across the
+  * border, and the labels on either side are merged in a single union-find over the whole mask.  Working in runs
+  * rather than single blocks keeps both the labels and the merging small, so even diagrams with millions of blocks
+  * are analyzed in about a second.
+  */
+class ConnectivityAnalyzer {
+ public:
+  /**
+    * Creates a ConnectivityAnalyzer for the blocks in \p blocks.
+    */
+  explicit ConnectivityAnalyzer(const OccupancyMask* blocks);
+
+  /**
+    * Adds to \p floating every block that belongs to a component with no block on \p ground_level or below it.
+    * @return The number of such components.
+    */
+  int findFloatingBlocks(int ground_level, OccupancyMask* floating) const;
+
+ private:
+  const OccupancyMask* blocks_;
+};
+
+#endif // CONNECTIVITY_ANALYZER_H
@@ -0,0 +1,77 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "convert_template_dialog.h"
+
+#include "block_manager.h"
+#include "block_prototype.h"
+
+ConvertTemplateDialog::ConvertTemplateDialog(BlockManager* block_mgr, QWidget* parent)
+    : QDialog(parent), block_mgr_(block_mgr) {
+  ui.setupUi(this);
+
+  // Solid, unoriented cubes are the only blocks that look the same from above as in the picker, so only those are
+  // checked to begin with.
+  BlockTypeIterator iter = BlockPrototype::blockIterator();
+  while (iter.hasNext()) {
+    BlockPrototype* prototype = block_mgr->getPrototype(iter.next());
+    QListWidgetItem* item = new QListWidgetItem(QIcon(prototype->sprite()), prototype->name(), ui.palette_list_);
+    item->setData(Qt::UserRole, prototype->type());
+    item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
+    item->setCheckState(prototype->isPlainCube() ? Qt::Checked : Qt::Unchecked);
+  }
+
+  connect(ui.select_all_button_, SIGNAL(clicked()), SLOT(selectAll()));
+  connect(ui.select_none_button_, SIGNAL(clicked()), SLOT(selectNone()));
+  connect(ui.palette_list_, SIGNAL(itemChanged(QListWidgetItem*)), SLOT(updateButtons()));
+  updateButtons();
+}
+
+QList<BlockPrototype*> ConvertTemplateDialog::palette() const {
+  QList<BlockPrototype*> prototypes;
+  for (int i = 0; i < ui.palette_list_->count(); ++i) {
+    QListWidgetItem* item = ui.palette_list_->item(i);
+    if (item->checkState() == Qt::Checked) {
+      prototypes.append(block_mgr_->getPrototype(item->data(Qt::UserRole).toInt()));
+    }
+  }
+  return prototypes;
+}
+
+int ConvertTemplateDialog::cellSize() const {
+  return ui.cell_size_spin_->value();
+}
+
+bool ConvertTemplateDialog::dither() const {
+  return ui.dither_check_->isChecked();
+}
+
+void ConvertTemplateDialog::selectAll() {
+  setAllChecked(true);
+}
+
+void ConvertTemplateDialog::selectNone() {
+  setAllChecked(false);
+}
+
+void ConvertTemplateDialog::setAllChecked(bool checked) {
+  for (int i = 0; i < ui.palette_list_->count(); ++i) {
+    ui.palette_list_->item(i)->setCheckState(checked ? Qt::Checked : Qt::Unchecked);
+  }
+}
+
+void ConvertTemplateDialog::updateButtons() {
+  ui.button_box_->button(QDialogButtonBox::Ok)->setEnabled(!palette().isEmpty());
+}
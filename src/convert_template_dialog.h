@@ -0,0 +1,63 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERT_TEMPLATE_DIALOG_H
+#define CONVERT_TEMPLATE_DIALOG_H
+
+#include "ui_convert_template_dialog.h"
+
+#include <QList>
+
+class BlockManager;
+class BlockPrototype;
+
+/**
+  * Dialog that asks for the options for turning the template image into blocks: which blocks to use, how many pixels
+  * make up a block, and whether to dither.
+  */
+class ConvertTemplateDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit ConvertTemplateDialog(BlockManager* block_mgr, QWidget* parent = NULL);
+
+  /**
+    * Returns the blocks that are checked in the palette list.
+    */
+  QList<BlockPrototype*> palette() const;
+
+  /**
+    * Returns the width and height, in pixels, of the square of the template image that each block stands for.
+    */
+  int cellSize() const;
+
+  /**
+    * Returns \c true if the user asked for dithering.
+    */
+  bool dither() const;
+
+ private slots:
+  void selectAll();
+  void selectNone();
+  void updateButtons();
+
+ private:
+  void setAllChecked(bool checked);
+
+  Ui::ConvertTemplateDialog ui;
+  BlockManager* block_mgr_;
+};
+
+#endif // CONVERT_TEMPLATE_DIALOG_H
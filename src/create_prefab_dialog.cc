@@ -0,0 +1,50 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "create_prefab_dialog.h"
+
+CreatePrefabDialog::CreatePrefabDialog(QWidget* parent)
+    : QDialog(parent) {
+  ui.setupUi(this);
+}
+
+void CreatePrefabDialog::setBounds(const BlockPosition& min, const BlockPosition& max) {
+  ui.min_x_spin_->setValue(min.x());
+  ui.min_y_spin_->setValue(min.y());
+  ui.min_z_spin_->setValue(min.z());
+  ui.max_x_spin_->setValue(max.x());
+  ui.max_y_spin_->setValue(max.y());
+  ui.max_z_spin_->setValue(max.z());
+}
+
+QString CreatePrefabDialog::name() const {
+  return ui.name_edit_->text().trimmed();
+}
+
+BlockPosition CreatePrefabDialog::minCorner() const {
+  return BlockPosition(qMin(ui.min_x_spin_->value(), ui.max_x_spin_->value()),
+                       qMin(ui.min_y_spin_->value(), ui.max_y_spin_->value()),
+                       qMin(ui.min_z_spin_->value(), ui.max_z_spin_->value()));
+}
+
+BlockPosition CreatePrefabDialog::maxCorner() const {
+  return BlockPosition(qMax(ui.min_x_spin_->value(), ui.max_x_spin_->value()),
+                       qMax(ui.min_y_spin_->value(), ui.max_y_spin_->value()),
+                       qMax(ui.min_z_spin_->value(), ui.max_z_spin_->value()));
+}
+
+bool CreatePrefabDialog::replaceWithPlacement() const {
+  return ui.replace_check_->isChecked();
+}
@@ -0,0 +1,51 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CREATE_PREFAB_DIALOG_H
+#define CREATE_PREFAB_DIALOG_H
+
+#include "ui_create_prefab_dialog.h"
+
+#include "block_position.h"
+
+/**
+  * Dialog that asks the user for the name of a new prefab and the box of blocks to make it from.  The dialog only
+  * collects the parameters; MainWindow makes the Prefab.
+  */
+class CreatePrefabDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit CreatePrefabDialog(QWidget* parent = NULL);
+
+  /**
+    * Sets the box shown in the dialog when it opens.
+    */
+  void setBounds(const BlockPosition& min, const BlockPosition& max);
+
+  QString name() const;
+  BlockPosition minCorner() const;
+  BlockPosition maxCorner() const;
+
+  /**
+    * Returns \c true if the blocks in the box should be removed and a placement of the prefab put in their place.
+    */
+  bool replaceWithPlacement() const;
+
+ private:
+  Ui::CreatePrefabDialog ui;
+};
+
+#endif // CREATE_PREFAB_DIALOG_H
@@ -15,19 +15,36 @@
 
 #include "diagram.h"
 
+#include <climits>
+
 #include <QDataStream>
 #include <QPair>
 
+#include "auto_connector.h"
 #include "block_manager.h"
 #include "block_orientation.h"
 #include "block_transaction.h"
+#include "chunk_table.h"
+#include "flow_solver.h"
 #include "line_tool.h"
+#include "occupancy_mask.h"
 
 /**
   * The current version of the MCModeler file format.  This must be increased whenever a backwards-incompatible change
   * is made.  The nybbles roughly correspond to major, minor, and maintenance version numbers.
   */
-static const quint32 kCurrentFileFormatVersion = 0x130;
+static const quint32 kCurrentFileFormatVersion = 0x150;
+
+/**
+  * The last version of the file format that had no prefabs.  Files in this format can still be read.
+  */
+static const quint32 kPrefablessFileFormatVersion = 0x140;
+
+/**
+  * The last version of the file format that stored each block separately instead of in a ChunkTable.  Files in this
+  * format can still be read.
+  */
+static const quint32 kUnchunkedFileFormatVersion = 0x130;
 
 /**
   * The number of bytes we are holding reserved for future expansion.  These will all be set to zero when writing out
@@ -37,6 +54,8 @@ static const int kNumReservedBytes = 256;
 
 /**
   * An RAII class that automatically calls Diagram::commit() on a diagram with its transaction when it is destroyed.
+  * The transaction is committed with kCommitExactly: it holds blocks read from a file or copied from elsewhere in the
+  * diagram, whose orientations are already right and mustn't be derived again.
   */
 class ScopedTransactionCommitter {
  public:
@@ -51,13 +70,53 @@ class ScopedTransactionCommitter {
       : diagram_(diagram),
         transaction_(transaction) {}
   ~ScopedTransactionCommitter() {
-    diagram_->commit(transaction_);
+    diagram_->commit(transaction_, Diagram::kCommitExactly);
   }
  private:
   Diagram* diagram_;
   const BlockTransaction& transaction_;
 };
 
+namespace {
+
+/** The edge length, in blocks, of the cells that placements are indexed by.  See Diagram::indexPlacements(). */
+const int kPlacementCellSize = 16;
+
+/**
+  * Divides \p value by kPlacementCellSize, rounding towards negative infinity.
+  */
+int placementCell(int value) {
+  return (value >= 0 ? value : value - kPlacementCellSize + 1) / kPlacementCellSize;
+}
+
+BlockPosition placementCellOf(const BlockPosition& position) {
+  return BlockPosition(placementCell(position.x()), placementCell(position.y()), placementCell(position.z()));
+}
+
+/**
+  * Looks blocks up in a single prefab, in the prefab's own coordinates, so that its faces are culled against its own
+  * blocks when it is rendered.
+  */
+class PrefabOracle : public BlockOracle {
+ public:
+  PrefabOracle(const Prefab* prefab, BlockPrototype* air) : prefab_(prefab), air_(air) {}
+
+  virtual BlockInstance blockAt(const BlockPosition& position, BlockOracle::Mode mode = kPhysicalBlocksOnly) {
+    Q_UNUSED(mode);
+    return prefab_->blocks().value(position, BlockInstance(air_, position, BlockOrientation::noOrientation()));
+  }
+
+  virtual bool levelsAreVertical() const {
+    return false;
+  }
+
+ private:
+  const Prefab* prefab_;
+  BlockPrototype* air_;
+};
+
+}  // namespace
+
 Diagram::Diagram(QObject* parent) : QObject(parent), block_mgr_(NULL) {
 }
 
@@ -84,7 +143,8 @@ void Diagram::load(QDataStream* stream) {
     error_dialog->exec();
     return;
   }
-  if (version != kCurrentFileFormatVersion) {
+  if (version != kCurrentFileFormatVersion && version != kPrefablessFileFormatVersion &&
+      version != kUnchunkedFileFormatVersion) {
     QMessageBox* error_dialog = new QMessageBox();
     error_dialog->setAttribute(Qt::WA_DeleteOnClose, true);
     error_dialog->setWindowTitle(qAppName());
@@ -125,13 +185,73 @@ void Diagram::load(QDataStream* stream) {
     transaction.clearBlock(block);
   }
 
-  while (!stream->atEnd()) {
-    BlockInstance new_block(stream, blockManager());
-    transaction.setBlock(new_block);
+  if (version <= kUnchunkedFileFormatVersion) {
+    setPrefabs(QList<Prefab>(), QList<PrefabPlacement>());
+    while (!stream->atEnd()) {
+      BlockInstance new_block(stream, blockManager());
+      if (!new_block.isValid()) {
+        qWarning() << "The diagram's blocks are truncated or corrupt; loading what could be read.";
+        break;
+      }
+      transaction.setBlock(new_block);
+    }
+    return;
+  }
+
+  ChunkTable chunks;
+  if (!chunks.read(stream, blockManager())) {
+    qWarning() << "The diagram's chunk table is truncated or corrupt; loading what could be read.";
   }
+  chunks.addBlocks(&transaction);
+
+  QList<Prefab> prefabs;
+  QList<PrefabPlacement> placements;
+  if (version > kPrefablessFileFormatVersion) {
+    qint32 prefab_count;
+    *stream >> prefab_count;
+    for (int i = 0; i < prefab_count && stream->status() == QDataStream::Ok; ++i) {
+      QString name;
+      *stream >> name;
+      ChunkTable prefab_chunks;
+      if (!prefab_chunks.read(stream, blockManager())) {
+        break;
+      }
+      BlockTransaction prefab_blocks;
+      prefab_chunks.addBlocks(&prefab_blocks);
+      prefabs.append(Prefab(name, prefab_blocks.new_blocks()));
+    }
+    qint32 placement_count;
+    *stream >> placement_count;
+    for (int i = 0; i < placement_count && stream->status() == QDataStream::Ok; ++i) {
+      qint32 prefab, x, y, z;
+      qint8 rotation;
+      *stream >> prefab >> x >> y >> z >> rotation;
+      if (stream->status() != QDataStream::Ok || prefab < 0 || prefab >= prefabs.size() || rotation < 0 ||
+          rotation > 3) {
+        stream->setStatus(QDataStream::ReadCorruptData);
+        break;
+      }
+      // The whole placed prefab, not just its corner, has to fit inside the range BlockPosition can hold.
+      const BlockPosition& size = prefabs[prefab].size();
+      int width = (rotation % 2 == 1) ? size.z() : size.x();
+      int depth = (rotation % 2 == 1) ? size.x() : size.z();
+      if (!BlockPosition::isInRange(x, y, z) ||
+          !BlockPosition::isInRange(static_cast<qint64>(x) + qMax(width, 1) - 1,
+                                    static_cast<qint64>(y) + qMax(size.y(), 1) - 1,
+                                    static_cast<qint64>(z) + qMax(depth, 1) - 1)) {
+        stream->setStatus(QDataStream::ReadCorruptData);
+        break;
+      }
+      placements.append(PrefabPlacement(prefab, BlockPosition(x, y, z), rotation));
+    }
+    if (stream->status() != QDataStream::Ok) {
+      qWarning() << "The diagram's prefabs are truncated or corrupt; loading what could be read.";
+    }
+  }
+  setPrefabs(prefabs, placements);
 }
 
-void Diagram::save(QDataStream* stream) {
+void Diagram::save(QDataStream* stream, int* chunk_count, int* unique_chunk_count) {
   stream->setVersion(QDataStream::Qt_4_7);
   stream->setFloatingPointPrecision(QDataStream::SinglePrecision);
 
@@ -142,10 +262,31 @@ void Diagram::save(QDataStream* stream) {
   stream->writeRawData(reserved, kNumReservedBytes);
   delete[] reserved;
   *stream << static_cast<qint32>(blockCount());
-  QHash<BlockPosition, BlockInstance>::const_iterator iter;
-  for (iter = block_map_.constBegin(); iter != block_map_.constEnd(); ++iter) {
-    const BlockInstance& instance = iter.value();
-    instance.serialize(stream);
+  ChunkTable chunks(block_map_);
+  chunks.write(stream);
+  int chunks_saved = chunks.chunkCount();
+  int chunks_written = chunks.uniqueChunkCount();
+
+  *stream << static_cast<qint32>(prefabs_.size());
+  foreach (const Prefab& prefab, prefabs_) {
+    *stream << prefab.name();
+    ChunkTable prefab_chunks(prefab.blocks());
+    prefab_chunks.write(stream);
+    chunks_saved += prefab_chunks.chunkCount();
+    chunks_written += prefab_chunks.uniqueChunkCount();
+  }
+  *stream << static_cast<qint32>(placements_.size());
+  foreach (const PrefabPlacement& placement, placements_) {
+    *stream << static_cast<qint32>(placement.prefab) << static_cast<qint32>(placement.offset.x())
+            << static_cast<qint32>(placement.offset.y()) << static_cast<qint32>(placement.offset.z())
+            << static_cast<qint8>(placement.rotation);
+  }
+
+  if (chunk_count) {
+    *chunk_count = chunks_saved;
+  }
+  if (unique_chunk_count) {
+    *unique_chunk_count = chunks_written;
   }
 }
 
@@ -179,17 +320,83 @@ void Diagram::removeBlockInternal(const BlockPosition& position) {
   level_map.remove(position);
 }
 
-void Diagram::commit(const BlockTransaction& transaction) {
+BlockTransaction Diagram::commit(const BlockTransaction& requested, CommitMode mode) {
+  // Tools see the blocks of placed prefabs through blockAt(), so they may ask to remove or replace one.  Those blocks
+  // aren't the diagram's to remove, and recording their removal would turn them into real blocks on undo, so drop it:
+  // replacing one puts a real block in front of it instead.
+  BlockTransaction transaction = requested;
+  if (!placements_.isEmpty()) {
+    BlockTransaction physical;
+    bool dropped = false;
+    foreach (const BlockInstance& old_block, requested.old_blocks()) {
+      if (block_map_.contains(old_block.position())) {
+        physical.clearBlock(old_block);
+      } else {
+        dropped = true;
+      }
+    }
+    if (dropped) {
+      foreach (const BlockInstance& new_block, requested.new_blocks()) {
+        physical.setBlock(new_block);
+      }
+      transaction = physical;
+    }
+  }
+
   ephemeral_blocks_.clear();
   ephemeral_block_removals_.clear();
   foreach (const BlockInstance& old_block, transaction.old_blocks()) {
     removeBlockInternal(old_block.position());
+    simulated_blocks_.remove(old_block.position());
   }
   foreach (const BlockInstance& new_block, transaction.new_blocks()) {
     addBlockInternal(new_block);
+    simulated_blocks_.remove(new_block.position());
   }
-  emit ephemeralBlocksChanged(transaction);
-  emit diagramChanged(transaction);
+
+  QHash<BlockPosition, BlockInstance> reconnected;
+  if (mode == kAutoConnect) {
+    QList<BlockPosition> changed;
+    foreach (const BlockInstance& old_block, transaction.old_blocks()) {
+      changed.append(old_block.position());
+    }
+    foreach (const BlockInstance& new_block, transaction.new_blocks()) {
+      changed.append(new_block.position());
+    }
+    reconnected = AutoConnector(&block_map_).reconnect(changed);
+  }
+  if (reconnected.isEmpty()) {
+    emit ephemeralBlocksChanged(transaction);
+    emit diagramChanged(transaction);
+    return transaction;
+  }
+
+  // Fold the new orientations into the transaction: blocks that it added get their new orientation directly, and
+  // neighbours that it didn't touch are replaced.
+  BlockTransaction applied;
+  foreach (const BlockInstance& old_block, transaction.old_blocks()) {
+    applied.clearBlock(old_block);
+  }
+  foreach (const BlockInstance& new_block, transaction.new_blocks()) {
+    QHash<BlockPosition, BlockInstance>::iterator iter = reconnected.find(new_block.position());
+    if (iter == reconnected.end()) {
+      applied.setBlock(new_block);
+    } else {
+      applied.setBlock(iter.value());
+      reconnected.erase(iter);
+    }
+  }
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = reconnected.constBegin(); iter != reconnected.constEnd(); ++iter) {
+    applied.replaceBlock(block_map_.value(iter.key()), iter.value());
+    simulated_blocks_.remove(iter.key());
+  }
+  foreach (const BlockInstance& new_block, applied.new_blocks()) {
+    addBlockInternal(new_block);
+  }
+  emit ephemeralBlocksChanged(applied);
+  emit diagramChanged(applied);
+  return applied;
 }
 
 void Diagram::commitEphemeral(const BlockTransaction& transaction) {
@@ -204,6 +411,73 @@ void Diagram::commitEphemeral(const BlockTransaction& transaction) {
   emit ephemeralBlocksChanged(transaction);
 }
 
+void Diagram::showSimulatedBlocks(const BlockTransaction& transaction) {
+  foreach (const BlockInstance& new_block, transaction.new_blocks()) {
+    const BlockPosition& position = new_block.position();
+    QHash<BlockPosition, BlockInstance>::const_iterator iter = block_map_.constFind(position);
+    if (iter == block_map_.constEnd()) {
+      continue;
+    }
+    if (iter.value().prototype() == new_block.prototype() && iter.value().orientation() == new_block.orientation()) {
+      simulated_blocks_.remove(position);
+    } else {
+      simulated_blocks_.insert(position, new_block);
+    }
+  }
+  emit simulatedBlocksChanged(transaction);
+}
+
+void Diagram::clearSimulatedBlocks() {
+  if (simulated_blocks_.isEmpty()) {
+    return;
+  }
+  BlockTransaction transaction;
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = simulated_blocks_.constBegin(); iter != simulated_blocks_.constEnd(); ++iter) {
+    transaction.replaceBlock(iter.value(), block_map_.value(iter.key()));
+  }
+  simulated_blocks_.clear();
+  emit simulatedBlocksChanged(transaction);
+}
+
+const BlockInstance& Diagram::displayedBlock(const BlockInstance& block) const {
+  if (simulated_blocks_.isEmpty()) {
+    return block;
+  }
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = simulated_blocks_.constFind(block.position());
+  return iter == simulated_blocks_.constEnd() ? block : iter.value();
+}
+
+void Diagram::setHighlightedBlocks(const OccupancyMask& mask, const QColor& color) {
+  highlights_.clear();
+  highlights_.append(BlockHighlight(mask, color));
+  emit highlightedBlocksChanged();
+}
+
+void Diagram::setHighlights(const QList<BlockHighlight>& highlights) {
+  highlights_ = highlights;
+  emit highlightedBlocksChanged();
+}
+
+void Diagram::clearHighlightedBlocks() {
+  if (highlights_.isEmpty()) {
+    return;
+  }
+  highlights_.clear();
+  emit highlightedBlocksChanged();
+}
+
+QList<BlockInstance> Diagram::findBlocks(const QSet<blocktype_t>& types) const {
+  QList<BlockInstance> blocks;
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = block_map_.constBegin(); iter != block_map_.constEnd(); ++iter) {
+    if (types.contains(iter.value().prototype()->type())) {
+      blocks.append(iter.value());
+    }
+  }
+  return blocks;
+}
+
 void Diagram::copyLevel(int source_level, int dest_level) {
   QHash<BlockPosition, BlockInstance>& source_level_map = block_list_[source_level];
   QHash<BlockPosition, BlockInstance>& dest_level_map = block_list_[dest_level];
@@ -219,10 +493,9 @@ void Diagram::copyLevel(int source_level, int dest_level) {
   // Add all blocks in the source level to the dest level, adjusting their altitudes.
   foreach (const BlockPosition& source_position, source_level_map.keys()) {
     BlockPosition dest_position = source_position + BlockPosition(0, dest_level - source_level, 0);
-    BlockInstance invalid_instance(NULL, BlockPosition(0, 0, 0), NULL);
-    BlockInstance source_instance = source_level_map.value(source_position, invalid_instance);
-    // The value() call should never return invalid_instance, since we got the key from the map
-    // just before we called value() with it.
+    BlockInstance source_instance = source_level_map.value(source_position, BlockInstance());
+    // The value() call should never fall back to the invalid BlockInstance(), since we got the key from the map just
+    // before we called value() with it.
     Q_ASSERT(source_instance.prototype());
     BlockInstance dest_instance(source_instance.prototype(), dest_position, source_instance.orientation());
     // Since we already cleared the dest level, we can safely call setBlock instead of replaceBlock
@@ -231,6 +504,193 @@ void Diagram::copyLevel(int source_level, int dest_level) {
   }
 }
 
+int Diagram::replaceBlocks(BlockPrototype* source, BlockPrototype* dest, int min_level, int max_level,
+                           bool preserve_orientation, BlockTransaction* transaction) const {
+  Q_ASSERT(source);
+  Q_ASSERT(dest);
+  Q_ASSERT(transaction);
+  if (source == dest && preserve_orientation) {
+    return 0;
+  }
+
+  // Work out where each orientation of the source type ends up up front, so the per-block loop below is just a lookup.
+  QVector<const BlockOrientation*> dest_orientations = dest->orientations();
+  QHash<const BlockOrientation*, const BlockOrientation*> orientation_map;
+  foreach (const BlockOrientation* orientation, source->orientations()) {
+    if (preserve_orientation && dest_orientations.contains(orientation)) {
+      orientation_map.insert(orientation, orientation);
+    } else {
+      orientation_map.insert(orientation, dest->defaultOrientation());
+    }
+  }
+
+  int replaced_count = 0;
+  QHash< int, QHash<BlockPosition, BlockInstance> >::const_iterator level_iter;
+  for (level_iter = block_list_.constBegin(); level_iter != block_list_.constEnd(); ++level_iter) {
+    if (level_iter.key() < min_level || level_iter.key() > max_level) {
+      continue;
+    }
+    const QHash<BlockPosition, BlockInstance>& level_map = level_iter.value();
+    QHash<BlockPosition, BlockInstance>::const_iterator iter;
+    for (iter = level_map.constBegin(); iter != level_map.constEnd(); ++iter) {
+      const BlockInstance& old_block = iter.value();
+      if (old_block.prototype() != source) {
+        continue;
+      }
+      const BlockOrientation* orientation = orientation_map.value(old_block.orientation(), dest->defaultOrientation());
+      if (dest == source && orientation == old_block.orientation()) {
+        continue;
+      }
+      transaction->replaceBlock(old_block, BlockInstance(dest, old_block.position(), orientation));
+      ++replaced_count;
+    }
+  }
+  return replaced_count;
+}
+
+namespace {
+
+/**
+  * Records the removal of every block in each run, looking the old blocks up directly in a Diagram's block map.
+  */
+class ClearMaskedRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  ClearMaskedRunVisitor(const QHash<BlockPosition, BlockInstance>* block_map, BlockTransaction* transaction)
+      : block_map_(block_map), transaction_(transaction), count_(0) {}
+
+  virtual void visitRun(int x_begin, int x_end, int y, int z) {
+    for (int x = x_begin; x < x_end; ++x) {
+      QHash<BlockPosition, BlockInstance>::const_iterator iter = block_map_->constFind(BlockPosition(x, y, z));
+      if (iter != block_map_->constEnd()) {
+        transaction_->clearBlock(iter.value());
+        ++count_;
+      }
+    }
+  }
+
+  int count() const {
+    return count_;
+  }
+
+ private:
+  const QHash<BlockPosition, BlockInstance>* block_map_;
+  BlockTransaction* transaction_;
+  int count_;
+};
+
+/**
+  * Records the addition of a block of one type in every block of each run, which must all be empty.
+  */
+class FillMaskedRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  FillMaskedRunVisitor(BlockPrototype* prototype, const BlockOrientation* orientation, BlockTransaction* transaction)
+      : prototype_(prototype), orientation_(orientation), transaction_(transaction) {}
+
+  virtual void visitRun(int x_begin, int x_end, int y, int z) {
+    for (int x = x_begin; x < x_end; ++x) {
+      transaction_->setBlock(BlockInstance(prototype_, BlockPosition(x, y, z), orientation_));
+    }
+  }
+
+ private:
+  BlockPrototype* prototype_;
+  const BlockOrientation* orientation_;
+  BlockTransaction* transaction_;
+};
+
+}  // namespace
+
+OccupancyMask Diagram::occupancyMask() const {
+  OccupancyMask mask;
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = block_map_.constBegin(); iter != block_map_.constEnd(); ++iter) {
+    mask.insert(iter.key());
+  }
+  return mask;
+}
+
+OccupancyMask Diagram::occupancyMask(int min_level, int max_level) const {
+  OccupancyMask mask;
+  QHash< int, QHash<BlockPosition, BlockInstance> >::const_iterator level_iter;
+  for (level_iter = block_list_.constBegin(); level_iter != block_list_.constEnd(); ++level_iter) {
+    if (level_iter.key() < min_level || level_iter.key() > max_level) {
+      continue;
+    }
+    const QHash<BlockPosition, BlockInstance>& level_map = level_iter.value();
+    QHash<BlockPosition, BlockInstance>::const_iterator iter;
+    for (iter = level_map.constBegin(); iter != level_map.constEnd(); ++iter) {
+      mask.insert(iter.key());
+    }
+  }
+  return mask;
+}
+
+int Diagram::clearMasked(const OccupancyMask& mask, BlockTransaction* transaction) const {
+  Q_ASSERT(transaction);
+  ClearMaskedRunVisitor visitor(&block_map_, transaction);
+  mask.visitRuns(&visitor);
+  return visitor.count();
+}
+
+void Diagram::fillMasked(const OccupancyMask& mask, BlockPrototype* prototype, const BlockOrientation* orientation,
+                         BlockTransaction* transaction) const {
+  Q_ASSERT(prototype);
+  Q_ASSERT(transaction);
+  FillMaskedRunVisitor visitor(prototype, orientation, transaction);
+  mask.visitRuns(&visitor);
+}
+
+int Diagram::hollowOut(int shell_thickness, int min_level, int max_level, BlockTransaction* transaction) const {
+  Q_ASSERT(shell_thickness > 0);
+  Q_ASSERT(transaction);
+  OccupancyMask solid;
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = block_map_.constBegin(); iter != block_map_.constEnd(); ++iter) {
+    if (iter.value().prototype()->isPlainCube()) {
+      solid.insert(iter.key());
+    }
+  }
+  // Placed prefabs hide the blocks behind them just as well, though only the diagram's own blocks are removed.
+  foreach (const BlockInstance& block, placedBlocks()) {
+    if (block.prototype()->isPlainCube()) {
+      solid.insert(block.position());
+    }
+  }
+
+  // Each erosion peels off the blocks touching open air, so after shell_thickness of them only the blocks further
+  // than that from the nearest air are left.
+  for (int i = 0; i < shell_thickness && !solid.isEmpty(); ++i) {
+    solid = solid.eroded();
+  }
+  solid.intersect(occupancyMask(min_level, max_level));
+  return clearMasked(solid, transaction);
+}
+
+int Diagram::lowestLevel() const {
+  bool found = false;
+  int lowest = 0;
+  QHash< int, QHash<BlockPosition, BlockInstance> >::const_iterator level_iter;
+  for (level_iter = block_list_.constBegin(); level_iter != block_list_.constEnd(); ++level_iter) {
+    if (!level_iter.value().isEmpty() && (!found || level_iter.key() < lowest)) {
+      lowest = level_iter.key();
+      found = true;
+    }
+  }
+  return lowest;
+}
+
+int Diagram::solveFlow(BlockTransaction* transaction) const {
+  Q_ASSERT(transaction);
+  FlowSolver solver(&block_map_, blockManager(), lowestLevel(), placements_.isEmpty() ? NULL : this);
+  return solver.solveAll(transaction);
+}
+
+int Diagram::updateFlow(const QList<BlockPosition>& changed, BlockTransaction* transaction) const {
+  Q_ASSERT(transaction);
+  FlowSolver solver(&block_map_, blockManager(), lowestLevel(), placements_.isEmpty() ? NULL : this);
+  return solver.solveAround(changed, transaction);
+}
+
 BlockInstance Diagram::blockAt(const BlockPosition& position, BlockOracle::Mode mode) {
   BlockInstance default_value(blockManager()->getPrototype(kBlockTypeAir), position, BlockOrientation::noOrientation());
   if (mode == kPhysicalOrEphemeralBlocks) {
@@ -240,7 +700,152 @@ BlockInstance Diagram::blockAt(const BlockPosition& position, BlockOracle::Mode
       return ephemeral_blocks_.value(position, default_value);
     }
   }
-  return block_map_.value(position, default_value);
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = block_map_.constFind(position);
+  if (iter != block_map_.constEnd()) {
+    return iter.value();
+  }
+  if (!placements_.isEmpty()) {
+    BlockInstance placed = placedBlockAt(position);
+    if (placed.isValid()) {
+      return placed;
+    }
+  }
+  return default_value;
+}
+
+BlockInstance Diagram::placedBlockAt(const BlockPosition& position) const {
+  PositionHash< QVector<int> >::const_iterator cell = placement_cells_.constFind(placementCellOf(position));
+  if (cell == placement_cells_.constEnd()) {
+    return BlockInstance();
+  }
+  // The indices are in ascending order, so the first placement still wins where placements overlap.
+  foreach (int placement_index, cell.value()) {
+    const PrefabPlacement& placement = placements_.at(placement_index);
+    const Prefab& prefab = prefabs_.at(placement.prefab);
+    const BlockInstance* block = prefab.blockPlacedAt(position, placement);
+    if (block) {
+      return prefab.placedBlock(*block, placement);
+    }
+  }
+  return BlockInstance();
+}
+
+int Diagram::findPrefab(const QString& name) const {
+  for (int i = 0; i < prefabs_.size(); ++i) {
+    if (prefabs_.at(i).name() == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void Diagram::setPrefabs(const QList<Prefab>& prefabs, const QList<PrefabPlacement>& placements) {
+  prefabs_ = prefabs;
+  placements_ = placements;
+  indexPlacements();
+  emit prefabsChanged();
+}
+
+void Diagram::indexPlacements() {
+  placement_cells_.clear();
+  for (int i = 0; i < placements_.size(); ++i) {
+    BlockPosition min, max;
+    prefabs_.at(placements_.at(i).prefab).placedBounds(placements_.at(i), &min, &max);
+    BlockPosition min_cell = placementCellOf(min);
+    BlockPosition max_cell = placementCellOf(max);
+    for (int z = min_cell.z(); z <= max_cell.z(); ++z) {
+      for (int y = min_cell.y(); y <= max_cell.y(); ++y) {
+        for (int x = min_cell.x(); x <= max_cell.x(); ++x) {
+          placement_cells_[BlockPosition(x, y, z)].append(i);
+        }
+      }
+    }
+  }
+}
+
+QList<BlockInstance> Diagram::blocksBetween(const BlockPosition& min, const BlockPosition& max) const {
+  QList<BlockInstance> blocks;
+  QHash< int, QHash<BlockPosition, BlockInstance> >::const_iterator level_iter;
+  for (level_iter = block_list_.constBegin(); level_iter != block_list_.constEnd(); ++level_iter) {
+    if (level_iter.key() < min.y() || level_iter.key() > max.y()) {
+      continue;
+    }
+    const QHash<BlockPosition, BlockInstance>& level_map = level_iter.value();
+    QHash<BlockPosition, BlockInstance>::const_iterator iter;
+    for (iter = level_map.constBegin(); iter != level_map.constEnd(); ++iter) {
+      const BlockPosition& position = iter.key();
+      if (position.x() >= min.x() && position.x() <= max.x() && position.z() >= min.z() && position.z() <= max.z()) {
+        blocks.append(iter.value());
+      }
+    }
+  }
+  return blocks;
+}
+
+QList<BlockInstance> Diagram::placedBlocks() const {
+  QList<BlockInstance> blocks;
+  if (!placements_.isEmpty()) {
+    appendPlacedBlocks(INT_MIN, INT_MAX, &blocks);
+  }
+  return blocks;
+}
+
+QList<BlockInstance> Diagram::placedBlocks(int level_index) const {
+  QList<BlockInstance> blocks;
+  if (!placements_.isEmpty()) {
+    appendPlacedBlocks(level_index, level_index, &blocks);
+  }
+  return blocks;
+}
+
+OccupancyMask Diagram::placedOccupancyMask() const {
+  OccupancyMask mask;
+  foreach (const BlockInstance& block, placedBlocks()) {
+    mask.insert(block.position());
+  }
+  return mask;
+}
+
+QMap<blocktype_t, int> Diagram::placedBlockCounts() const {
+  QMap<blocktype_t, int> map;
+  foreach (const BlockInstance& block, placedBlocks()) {
+    ++map[block.prototype()->type()];
+  }
+  return map;
+}
+
+void Diagram::appendPlacedBlocks(int min_level, int max_level, QList<BlockInstance>* blocks) const {
+  QSet<BlockPosition> covered;
+  foreach (const PrefabPlacement& placement, placements_) {
+    const Prefab& prefab = prefabs_.at(placement.prefab);
+    BlockPosition min, max;
+    prefab.placedBounds(placement, &min, &max);
+    if (max.y() < min_level || min.y() > max_level) {
+      continue;
+    }
+    QHash<BlockPosition, BlockInstance>::const_iterator iter;
+    for (iter = prefab.blocks().constBegin(); iter != prefab.blocks().constEnd(); ++iter) {
+      int level = placement.offset.y() + iter.key().y();
+      if (level < min_level || level > max_level) {
+        continue;
+      }
+      BlockInstance placed = prefab.placedBlock(iter.value(), placement);
+      if (!block_map_.contains(placed.position()) && !covered.contains(placed.position())) {
+        covered.insert(placed.position());
+        blocks->append(placed);
+      }
+    }
+  }
+}
+
+int Diagram::bakePrefabs(BlockTransaction* transaction) const {
+  Q_ASSERT(transaction);
+  QList<BlockInstance> blocks = placedBlocks();
+  foreach (const BlockInstance& block, blocks) {
+    // placedBlocks() leaves out the positions the diagram has blocks at, so there is nothing to replace.
+    transaction->setBlock(block);
+  }
+  return blocks.size();
 }
 
 bool Diagram::levelsAreVertical() const {
@@ -254,50 +859,59 @@ QHash<BlockPosition, BlockInstance> Diagram::level(int level_index) {
   return block_list_.value(level_index);
 }
 
-// TODO(phoenix): This probably shouldn't be in the model.  Move it somewhere else?
-void Diagram::render() {
-  QVector<const BlockInstance*> transparent_blocks;
+QList<BlockInstance> Diagram::displayedBlocks() const {
+  QList<BlockInstance> blocks;
+  blocks.reserve(block_map_.size() + ephemeral_blocks_.size());
   QHash<BlockPosition, BlockInstance>::const_iterator iter;
-
-  // Try to give the compiler as much opportunity to optimize this branch out as possible.
-  bool need_to_consider_ephemeral_removals = (ephemeral_block_removals_.size() > 0);
-  if (Q_UNLIKELY(need_to_consider_ephemeral_removals)) {
-    // Slow path: ephemeral removals to consider.
-    for (iter = block_map_.constBegin(); iter != block_map_.constEnd(); ++iter) {
-      if (ephemeral_block_removals_.contains(iter.key())) {
-        continue;
-      }
-      const BlockInstance& b = iter.value();
-      if (b.prototype()->isTransparent()) {
-        transparent_blocks.append(&b);
-      } else {
-        b.render();
-      }
+  for (iter = block_map_.constBegin(); iter != block_map_.constEnd(); ++iter) {
+    if (ephemeral_block_removals_.isEmpty() || !ephemeral_block_removals_.contains(iter.key())) {
+      blocks.append(displayedBlock(iter.value()));
     }
-  } else {
-    // Fast path: no ephemeral removals.
-    for (iter = block_map_.constBegin(); iter != block_map_.constEnd(); ++iter) {
-      const BlockInstance& b = iter.value();
-      if (b.prototype()->isTransparent()) {
-        transparent_blocks.append(&b);
-      } else {
-        b.render();
+  }
+  PositionHash<BlockInstance>::const_iterator ephemeral_iter;
+  for (ephemeral_iter = ephemeral_blocks_.constBegin();
+       ephemeral_iter != ephemeral_blocks_.constEnd();
+       ++ephemeral_iter) {
+    blocks.append(ephemeral_iter.value());
+  }
+  return blocks;
+}
+
+QList<BlockInstance> Diagram::displayedBlocksBetween(const BlockPosition& min, const BlockPosition& max) const {
+  QList<BlockInstance> blocks;
+  QList<BlockInstance> ephemeral;
+  for (int x = min.x(); x <= max.x(); ++x) {
+    for (int y = min.y(); y <= max.y(); ++y) {
+      for (int z = min.z(); z <= max.z(); ++z) {
+        BlockPosition position(x, y, z);
+        QHash<BlockPosition, BlockInstance>::const_iterator iter = block_map_.constFind(position);
+        if (iter != block_map_.constEnd() && !ephemeral_block_removals_.contains(position)) {
+          blocks.append(displayedBlock(iter.value()));
+        }
+        PositionHash<BlockInstance>::const_iterator ephemeral_iter = ephemeral_blocks_.constFind(position);
+        if (ephemeral_iter != ephemeral_blocks_.constEnd()) {
+          ephemeral.append(ephemeral_iter.value());
+        }
       }
     }
   }
+  return blocks + ephemeral;
+}
 
-  for (iter = ephemeral_blocks_.constBegin(); iter != ephemeral_blocks_.constEnd(); ++iter) {
+void Diagram::renderPrefab(int prefab) const {
+  PrefabOracle oracle(&prefabs_.at(prefab), blockManager()->getPrototype(kBlockTypeAir));
+  QVector<const BlockInstance*> transparent_blocks;
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = prefabs_.at(prefab).blocks().constBegin(); iter != prefabs_.at(prefab).blocks().constEnd(); ++iter) {
     const BlockInstance& b = iter.value();
-    b.render();
+    if (b.prototype()->isTransparent()) {
+      transparent_blocks.append(&b);
+    } else {
+      b.render(&oracle);
+    }
   }
-
-  // Render transparent blocks last.
-  QVector<const BlockInstance*>::const_iterator transparent_iter;
-  for (transparent_iter = transparent_blocks.constBegin();
-       transparent_iter != transparent_blocks.constEnd();
-       ++transparent_iter ) {
-    const BlockInstance* b = *transparent_iter;
-    b->render();
+  foreach (const BlockInstance* b, transparent_blocks) {
+    b->render(&oracle);
   }
 }
 
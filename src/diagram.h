@@ -16,8 +16,12 @@
 #ifndef DIAGRAM_H
 #define DIAGRAM_H
 
+#include <QColor>
+#include <QHash>
+#include <QList>
 #include <QMap>
 #include <QObject>
+#include <QSet>
 #include <QVector>
 #include <QVector3D>
 
@@ -26,11 +30,25 @@
 #include "block_position.h"
 #include "block_prototype.h"
 #include "block_type.h"
+#include "occupancy_mask.h"
+#include "position_hash.h"
+#include "prefab.h"
 
 class BlockManager;
 class BlockOrientation;
 class BlockTransaction;
 
+/**
+  * A set of blocks for the views to highlight, and the colour to highlight them in.  See Diagram::setHighlights().
+  */
+struct BlockHighlight {
+  BlockHighlight() {}
+  BlockHighlight(const OccupancyMask& blocks, const QColor& color) : blocks(blocks), color(color) {}
+
+  OccupancyMask blocks;
+  QColor color;
+};
+
 /**
   * Represents a diagram containing block data for the world.
   *
@@ -46,10 +64,19 @@ class BlockTransaction;
   * Diagram treats the world as horizontal slices, each corresponding to a level in the LevelWidget.  You can get a
   * map of a given level by calling the level() method.  You can also look up the block at a particular 3D location by
   * calling the blockAt() method.
+  *
+  * Besides its own blocks, the diagram holds a library of prefabs and the places they have been put (see Prefab).
+  * blockAt() sees the blocks of placed prefabs wherever the diagram has no block of its own, but the other methods,
+  * and commit(), deal only with the diagram's own blocks.
   */
 class Diagram : public QObject, public BlockOracle {
   Q_OBJECT
  public:
+  enum CommitMode {
+    kAutoConnect,
+    kCommitExactly
+  };
+
   Diagram(QObject* parent = NULL);
 
   /**
@@ -73,16 +100,32 @@ class Diagram : public QObject, public BlockOracle {
   virtual bool levelsAreVertical() const;
 
   /**
-    * Tells all blocks in the diagram to render themselves.
-    * @todo This probably does not belong in the Diagram class, but it's unclear where it should go instead.
+    * Tells all blocks in the prefab at index \p prefab in prefabs() to render themselves, in the prefab's own
+    * coordinates.  Faces are culled against the prefab's own blocks rather than the diagram's, so the result can be
+    * drawn once for every placement of the prefab.
     */
-  void render();
+  void renderPrefab(int prefab) const;
+
+  /**
+    * Returns every block the 3D preview draws: the diagram's own blocks as displayedBlock() shows them, less ephemeral
+    * removals, followed by the ephemeral blocks.  Placed prefabs are left out; see renderPrefab().
+    */
+  QList<BlockInstance> displayedBlocks() const;
+
+  /**
+    * Like displayedBlocks(), but only the blocks in the box from \p min to \p max (inclusive).
+    */
+  QList<BlockInstance> displayedBlocksBetween(const BlockPosition& min, const BlockPosition& max) const;
 
   /**
     * Saves all blocks in the diagram out to \p stream.  The save format is versioned, so incompatible changes should
     * probably occasion a change to the version number.
+    *
+    * Blocks are written in chunks, and a chunk identical to one already written is stored only once.  If they are not
+    * NULL, \p chunk_count and \p unique_chunk_count are set to the number of chunks saved and the number of those
+    * whose cells were actually written, counting the diagram's own blocks and every prefab's.
     */
-  void save(QDataStream* stream);
+  void save(QDataStream* stream, int* chunk_count = NULL, int* unique_chunk_count = NULL);
 
   /**
     * Populates the diagram with blocks deserialized from \p stream.
@@ -96,9 +139,78 @@ class Diagram : public QObject, public BlockOracle {
   void copyLevel(int source_level, int dest_level);
 
   /**
-    * Applies \p transaction to the diagram.  This is the method to call to make changes to the diagram.
+    * Populates \p transaction with the replacement of every block of type \p source on levels \p min_level through
+    * \p max_level (inclusive) with a block of type \p dest.  The transaction is not committed, so the caller can put
+    * it on the undo stack.  Passing the air prototype as \p dest erases the matching blocks instead.
+    *
+    * Orientations are remapped once per source orientation rather than once per block: if \p preserve_orientation is
+    * \c true and \p dest supports the orientation of a replaced block, the orientation is kept; otherwise the new
+    * block gets the default orientation of \p dest.
+    * @return The number of blocks that will be replaced.
+    */
+  int replaceBlocks(BlockPrototype* source, BlockPrototype* dest, int min_level, int max_level,
+                    bool preserve_orientation, BlockTransaction* transaction) const;
+
+  /**
+    * Returns a mask of every block in the diagram.
+    */
+  OccupancyMask occupancyMask() const;
+
+  /**
+    * Returns a mask of every block on levels \p min_level through \p max_level (inclusive).
+    */
+  OccupancyMask occupancyMask(int min_level, int max_level) const;
+
+  /**
+    * Populates \p transaction with the removal of every block in \p mask.  Positions in \p mask that are already empty
+    * are ignored.
+    * @return The number of blocks that will be removed.
+    */
+  int clearMasked(const OccupancyMask& mask, BlockTransaction* transaction) const;
+
+  /**
+    * Populates \p transaction with the removal of every block on levels \p min_level through \p max_level (inclusive)
+    * that is more than \p shell_thickness blocks from open air, i.e., from the nearest position that does not hold a
+    * plain opaque cube.  Such blocks have no exposed faces and can't be seen from outside the diagram, so removing them
+    * hollows the structure out while leaving a shell \p shell_thickness blocks thick.  Blocks outside the level range
+    * still count as cover for the blocks next to them.
+    * @return The number of blocks that will be removed.
+    */
+  int hollowOut(int shell_thickness, int min_level, int max_level, BlockTransaction* transaction) const;
+
+  /**
+    * Populates \p transaction with the addition of a block of type \p prototype at every position in \p mask.
+    * @warning Every position in \p mask must currently be empty, since the blocks are added with
+    *    BlockTransaction::setBlock() rather than looked up and replaced.  Subtract occupancyMask() from \p mask first
+    *    if you are not sure.
+    */
+  void fillMasked(const OccupancyMask& mask, BlockPrototype* prototype, const BlockOrientation* orientation,
+                  BlockTransaction* transaction) const;
+
+  /**
+    * Populates \p transaction with the changes needed to make every flowing water and lava block agree with the
+    * source blocks that feed it.  See FlowSolver.
+    * @return The number of blocks that will change.
+    */
+  int solveFlow(BlockTransaction* transaction) const;
+
+  /**
+    * Like solveFlow(), but only for the bodies of liquid at or next to \p changed, which should be the positions of
+    * the blocks changed by the last committed transaction.
     */
-  void commit(const BlockTransaction& transaction);
+  int updateFlow(const QList<BlockPosition>& changed, BlockTransaction* transaction) const;
+
+  /**
+    * Applies \p requested to the diagram.  This is the method to call to make changes to the diagram.  Removals of
+    * blocks that belong to placed prefabs rather than to the diagram are left out.
+    *
+    * Unless \p mode is kCommitExactly, the panes and tracks at and around the changed blocks are then given the
+    * orientations that join them to their neighbours (see AutoConnector), and those changes are folded into the
+    * transaction that is broadcast.
+    * @return The transaction that was actually applied.  Committing it, or its reverse, with kCommitExactly replays
+    *         or undoes the whole change.
+    */
+  BlockTransaction commit(const BlockTransaction& requested, CommitMode mode = kAutoConnect);
 
   /**
     * Applies \p transaction to the diagram ephemerally.  Ephemeral commits will be temporarily reflected in the UI, but
@@ -108,6 +220,127 @@ class Diagram : public QObject, public BlockOracle {
     */
   void commitEphemeral(const BlockTransaction& transaction);
 
+  /**
+    * Shows the new blocks of \p transaction in place of the diagram's own blocks at the same positions, without
+    * changing the model or the undo history.  The old blocks of \p transaction should be what was shown there before.
+    * The simulated blocks stay until they are replaced, cleared with clearSimulatedBlocks(), or their positions are
+    * committed to.  RedstoneSimulator uses this to show power states.
+    */
+  void showSimulatedBlocks(const BlockTransaction& transaction);
+
+  /**
+    * Removes every simulated block, so that the views show the diagram's own blocks again.
+    */
+  void clearSimulatedBlocks();
+
+  /**
+    * Returns the block that the views should show for \p block, which must be a block in the diagram: the simulated
+    * block at its position if there is one, or \p block itself.
+    */
+  const BlockInstance& displayedBlock(const BlockInstance& block) const;
+
+  /**
+    * Highlights the blocks in \p mask in the views in \p color, replacing any previous highlights.  Highlights are
+    * purely visual and are kept until they are replaced or cleared, even if the blocks under them change.
+    */
+  void setHighlightedBlocks(const OccupancyMask& mask, const QColor& color);
+
+  /**
+    * Shows each of \p highlights in the views, replacing any previous highlights.  Where highlights overlap, the last
+    * one is drawn on top.
+    */
+  void setHighlights(const QList<BlockHighlight>& highlights);
+
+  /**
+    * Removes every highlight.
+    */
+  void clearHighlightedBlocks();
+
+  /**
+    * Returns the highlights that are currently shown.
+    */
+  const QList<BlockHighlight>& highlights() const {
+    return highlights_;
+  }
+
+  /**
+    * Returns the prefabs in the diagram's library.  Placements refer to them by index.
+    */
+  const QList<Prefab>& prefabs() const {
+    return prefabs_;
+  }
+
+  /**
+    * Returns every placement of a prefab in the diagram.
+    */
+  const QList<PrefabPlacement>& placements() const {
+    return placements_;
+  }
+
+  /**
+    * Returns the index in prefabs() of the prefab called \p name, or -1 if there is none.
+    */
+  int findPrefab(const QString& name) const;
+
+  /**
+    * Replaces the diagram's prefabs and placements with \p prefabs and \p placements, and emits prefabsChanged().
+    * Every placement must refer to one of \p prefabs.  This doesn't go through a BlockTransaction; see
+    * PrefabUndoCommand for the undoable way to call it.
+    */
+  void setPrefabs(const QList<Prefab>& prefabs, const QList<PrefabPlacement>& placements);
+
+  /**
+    * Returns the diagram's own blocks in the box from \p min to \p max (inclusive), for making a Prefab from.
+    */
+  QList<BlockInstance> blocksBetween(const BlockPosition& min, const BlockPosition& max) const;
+
+  /**
+    * Returns the blocks of every placed prefab, moved into place, except where the diagram has a block of its own.
+    * Where placements overlap, the first one wins.
+    */
+  QList<BlockInstance> placedBlocks() const;
+
+  /**
+    * Like placedBlocks(), but only the blocks on the level \p level_index.
+    */
+  QList<BlockInstance> placedBlocks(int level_index) const;
+
+  /**
+    * Returns the block of a placed prefab at \p position, or an invalid block if there is none.  Unlike blockAt(),
+    * this ignores the diagram's own blocks.
+    */
+  BlockInstance placedBlockAt(const BlockPosition& position) const;
+
+  /**
+    * Returns a mask of the positions of placedBlocks().
+    */
+  OccupancyMask placedOccupancyMask() const;
+
+  /**
+    * Returns a dictionary of counts for every block type in placedBlocks().
+    */
+  QMap<blocktype_t, int> placedBlockCounts() const;
+
+  /**
+    * Populates \p transaction with the addition of the blocks of every placed prefab as ordinary blocks of the
+    * diagram.  The placements themselves are not removed; commit the transaction along with an empty list of
+    * placements (see PrefabUndoCommand) to flatten them.
+    * @return The number of blocks that will be added.
+    */
+  int bakePrefabs(BlockTransaction* transaction) const;
+
+  /**
+    * Returns every block in the diagram, keyed on its position.  This doesn't include the blocks of placed prefabs.
+    */
+  const QHash<BlockPosition, BlockInstance>& blocks() const {
+    return block_map_;
+  }
+
+  /**
+    * Returns every block in the diagram whose type is in \p types.
+    */
+  QList<BlockInstance> findBlocks(const QSet<blocktype_t>& types) const;
+
   /**
     * Returns the number of blocks in the diagram.
     */
@@ -137,6 +370,22 @@ class Diagram : public QObject, public BlockOracle {
     */
   void ephemeralBlocksChanged(const BlockTransaction& transaction);
 
+  /**
+    * Emitted when the diagram's simulated blocks change.
+    * @param transaction A transaction from the blocks that were shown to the blocks that are shown now.
+    */
+  void simulatedBlocksChanged(const BlockTransaction& transaction);
+
+  /**
+    * Emitted when the highlighted blocks change.
+    */
+  void highlightedBlocksChanged();
+
+  /**
+    * Emitted when the prefabs or their placements change.
+    */
+  void prefabsChanged();
+
  private:
   /**
     * Returns the block manager, or NULL if it's not set.  This method exists mainly to fire an assert if it is called
@@ -145,6 +394,11 @@ class Diagram : public QObject, public BlockOracle {
     */
   BlockManager* blockManager() const;
 
+  /**
+    * Returns the lowest level that has any blocks on it, or 0 if the diagram is empty.
+    */
+  int lowestLevel() const;
+
   /**
     * Directly adds a block to the diagram, replacing whatever block was there.  This should only be called from
     * commit() unless you know what you're doing, since it will neither fire diagramChanged() nor create a
@@ -171,6 +425,17 @@ class Diagram : public QObject, public BlockOracle {
     */
   void ephemerallyRemoveBlockInternal(const BlockInstance& block);
 
+  /**
+    * Appends the blocks of every placed prefab on levels \p min_level through \p max_level (inclusive) to \p blocks,
+    * except where the diagram has a block of its own.
+    */
+  void appendPlacedBlocks(int min_level, int max_level, QList<BlockInstance>* blocks) const;
+
+  /**
+    * Rebuilds placement_cells_ from placements_.
+    */
+  void indexPlacements();
+
   /**
     * A map of all blocks in the diagram, regardless of level.  Used mainly for rendering.
     */
@@ -185,8 +450,31 @@ class Diagram : public QObject, public BlockOracle {
   /**
     * A map of the ephemeral blocks in the diagram.
     */
-  QHash<BlockPosition, BlockInstance> ephemeral_blocks_;
-  QHash<BlockPosition, BlockInstance> ephemeral_block_removals_;
+  PositionHash<BlockInstance> ephemeral_blocks_;
+  PositionHash<BlockInstance> ephemeral_block_removals_;
+
+  /**
+    * A map of the simulated blocks in the diagram.  See showSimulatedBlocks().
+    */
+  QHash<BlockPosition, BlockInstance> simulated_blocks_;
+
+  /**
+    * The highlights shown in the views.  See setHighlights().
+    */
+  QList<BlockHighlight> highlights_;
+
+  /**
+    * The prefab library and the placements of its prefabs.  See setPrefabs().
+    */
+  QList<Prefab> prefabs_;
+  QList<PrefabPlacement> placements_;
+
+  /**
+    * For each cube of 16 blocks on a side that a placed prefab's bounds overlap, keyed on the cube's position divided
+    * by 16, the indices into placements_ of the placements that overlap it.  This lets placedBlockAt() look only at
+    * the placements that could cover a position.
+    */
+  PositionHash< QVector<int> > placement_cells_;
 
   /**
     * The block manager set using setBlockManager.  Can technically be NULL, but shouldn't be by the time any other
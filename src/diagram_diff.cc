@@ -0,0 +1,274 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "diagram_diff.h"
+
+#include <QList>
+#include <QSet>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <string.h>
+
+#include "block_transaction.h"
+#include "diagram.h"
+
+namespace {
+
+const int kCellsPerChunk = DiagramDiff::kChunkSize * DiagramDiff::kChunkSize * DiagramDiff::kChunkSize;
+
+/**
+  * The blocks of one chunk of a diagram, in no particular order, and a hash of them that doesn't depend on the order.
+  */
+struct ChunkContents {
+  ChunkContents() : hash(0) {}
+
+  quint64 hash;
+  QVector<const BlockInstance*> blocks;
+};
+
+typedef QHash<BlockPosition, ChunkContents> ChunkIndex;
+
+/**
+  * Divides \p value by kChunkSize, rounding towards negative infinity.
+  */
+int chunkIndex(int value) {
+  return (value >= 0 ? value : value - DiagramDiff::kChunkSize + 1) / DiagramDiff::kChunkSize;
+}
+
+/**
+  * Returns the index of the cell that \p position occupies within its chunk.
+  */
+int cellIndex(const BlockPosition& position) {
+  const int mask = DiagramDiff::kChunkSize - 1;
+  return (((position.z() & mask) * DiagramDiff::kChunkSize) + (position.y() & mask)) * DiagramDiff::kChunkSize +
+         (position.x() & mask);
+}
+
+/**
+  * Scrambles the bits of \p value so that nearby values give unrelated results.
+  */
+quint64 mixBits(quint64 value) {
+  value ^= value >> 33;
+  value *= Q_UINT64_C(0xff51afd7ed558ccd);
+  value ^= value >> 33;
+  value *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+  value ^= value >> 33;
+  return value;
+}
+
+bool isSameBlock(const BlockInstance& first, const BlockInstance& second) {
+  return first.prototype() == second.prototype() && first.orientation() == second.orientation();
+}
+
+/**
+  * Splits the blocks in \p blocks into chunks.  Each chunk's hash is the sum of a hash of each of its blocks, so that
+  * it can be built up in whatever order the blocks come out of the diagram.
+  */
+ChunkIndex indexChunks(const QHash<BlockPosition, BlockInstance>& blocks) {
+  ChunkIndex chunks;
+  QHash<BlockPosition, BlockInstance>::const_iterator iter;
+  for (iter = blocks.constBegin(); iter != blocks.constEnd(); ++iter) {
+    const BlockPosition& position = iter.key();
+    const BlockInstance& block = iter.value();
+    ChunkContents& chunk =
+        chunks[BlockPosition(chunkIndex(position.x()), chunkIndex(position.y()), chunkIndex(position.z()))];
+    quint64 key = (static_cast<quint64>(static_cast<quint32>(block.prototype()->type())) << 32) |
+                  static_cast<quint64>(cellIndex(position));
+    chunk.hash += mixBits(key ^ mixBits(reinterpret_cast<quintptr>(block.orientation())));
+    chunk.blocks.append(&block);
+  }
+  return chunks;
+}
+
+/**
+  * Compares one chunk cell by cell.  Used as a QtConcurrent map functor.
+  */
+class ChunkComparer {
+ public:
+  typedef QVector<DiagramDiff::Change> result_type;
+
+  ChunkComparer(const ChunkIndex* before, const ChunkIndex* after) : before_(before), after_(after) {}
+
+  QVector<DiagramDiff::Change> operator()(const BlockPosition& chunk_position) const {
+    const BlockInstance* before_cells[kCellsPerChunk];
+    const BlockInstance* after_cells[kCellsPerChunk];
+    fillCells(before_, chunk_position, before_cells);
+    fillCells(after_, chunk_position, after_cells);
+
+    QVector<DiagramDiff::Change> changes;
+    for (int i = 0; i < kCellsPerChunk; ++i) {
+      const BlockInstance* before = before_cells[i];
+      const BlockInstance* after = after_cells[i];
+      if (before == after || (before && after && isSameBlock(*before, *after))) {
+        continue;
+      }
+      DiagramDiff::Change change;
+      if (before) {
+        change.before = *before;
+      }
+      if (after) {
+        change.after = *after;
+      }
+      changes.append(change);
+    }
+    return changes;
+  }
+
+ private:
+  static void fillCells(const ChunkIndex* chunks, const BlockPosition& chunk_position,
+                        const BlockInstance** cells) {
+    memset(cells, 0, kCellsPerChunk * sizeof(cells[0]));
+    ChunkIndex::const_iterator iter = chunks->constFind(chunk_position);
+    if (iter == chunks->constEnd()) {
+      return;
+    }
+    foreach (const BlockInstance* block, iter.value().blocks) {
+      cells[cellIndex(block->position())] = block;
+    }
+  }
+
+  const ChunkIndex* before_;
+  const ChunkIndex* after_;
+};
+
+}  // namespace
+
+DiagramDiff::DiagramDiff(const Diagram* before, const Diagram* after, int* identical_chunk_count, int* chunk_count)
+    : before_(before), after_(after) {
+  ChunkIndex before_chunks = indexChunks(before->blocks());
+  ChunkIndex after_chunks = indexChunks(after->blocks());
+
+  QSet<BlockPosition> chunk_positions = QSet<BlockPosition>::fromList(before_chunks.keys());
+  chunk_positions.unite(QSet<BlockPosition>::fromList(after_chunks.keys()));
+  QList<BlockPosition> differing_chunks;
+  foreach (const BlockPosition& chunk_position, chunk_positions) {
+    ChunkIndex::const_iterator before_iter = before_chunks.constFind(chunk_position);
+    ChunkIndex::const_iterator after_iter = after_chunks.constFind(chunk_position);
+    if (before_iter != before_chunks.constEnd() && after_iter != after_chunks.constEnd() &&
+        before_iter.value().hash == after_iter.value().hash &&
+        before_iter.value().blocks.size() == after_iter.value().blocks.size()) {
+      continue;
+    }
+    differing_chunks.append(chunk_position);
+  }
+  if (identical_chunk_count) {
+    *identical_chunk_count = chunk_positions.size() - differing_chunks.size();
+  }
+  if (chunk_count) {
+    *chunk_count = chunk_positions.size();
+  }
+
+  QList< QVector<Change> > chunk_changes = QtConcurrent::blockingMapped< QList< QVector<Change> > >(
+      differing_chunks, ChunkComparer(&before_chunks, &after_chunks));
+  foreach (const QVector<Change>& changes, chunk_changes) {
+    foreach (const Change& change, changes) {
+      addChange(change.before.isValid() ? change.before.position() : change.after.position(), change);
+    }
+  }
+}
+
+void DiagramDiff::update(const BlockTransaction& transaction) {
+  QList<BlockPosition> positions;
+  foreach (const BlockInstance& old_block, transaction.old_blocks()) {
+    positions.append(old_block.position());
+  }
+  foreach (const BlockInstance& new_block, transaction.new_blocks()) {
+    positions.append(new_block.position());
+  }
+  OccupancyMask touched;
+  foreach (const BlockPosition& position, positions) {
+    touched.insert(position);
+    changes_.remove(position);
+  }
+  added_blocks_.subtract(touched);
+  removed_blocks_.subtract(touched);
+  changed_blocks_.subtract(touched);
+
+  const QHash<BlockPosition, BlockInstance>& before_blocks = before_->blocks();
+  const QHash<BlockPosition, BlockInstance>& after_blocks = after_->blocks();
+  foreach (const BlockPosition& position, positions) {
+    QHash<BlockPosition, BlockInstance>::const_iterator before_iter = before_blocks.constFind(position);
+    QHash<BlockPosition, BlockInstance>::const_iterator after_iter = after_blocks.constFind(position);
+    bool has_before = before_iter != before_blocks.constEnd();
+    bool has_after = after_iter != after_blocks.constEnd();
+    if (has_before == has_after && (!has_before || isSameBlock(before_iter.value(), after_iter.value()))) {
+      continue;
+    }
+    Change change;
+    if (has_before) {
+      change.before = before_iter.value();
+    }
+    if (has_after) {
+      change.after = after_iter.value();
+    }
+    addChange(position, change);
+  }
+}
+
+void DiagramDiff::addChange(const BlockPosition& position, const Change& change) {
+  changes_.insert(position, change);
+  if (!change.before.isValid()) {
+    added_blocks_.insert(position);
+  } else if (!change.after.isValid()) {
+    removed_blocks_.insert(position);
+  } else {
+    changed_blocks_.insert(position);
+  }
+}
+
+void DiagramDiff::apply(BlockTransaction* transaction) const {
+  Q_ASSERT(transaction);
+  QHash<BlockPosition, Change>::const_iterator iter;
+  for (iter = changes_.constBegin(); iter != changes_.constEnd(); ++iter) {
+    if (iter.value().before.isValid()) {
+      transaction->clearBlock(iter.value().before);
+    }
+    if (iter.value().after.isValid()) {
+      transaction->setBlock(iter.value().after);
+    }
+  }
+}
+
+int DiagramDiff::merge(const DiagramDiff& ours, const DiagramDiff& theirs, BlockTransaction* transaction,
+                       OccupancyMask* conflicts) {
+  Q_ASSERT(transaction);
+  Q_ASSERT(conflicts);
+  int merged_count = 0;
+  QHash<BlockPosition, Change>::const_iterator iter;
+  for (iter = theirs.changes_.constBegin(); iter != theirs.changes_.constEnd(); ++iter) {
+    const Change& their_change = iter.value();
+    QHash<BlockPosition, Change>::const_iterator our_iter = ours.changes_.constFind(iter.key());
+    if (our_iter != ours.changes_.constEnd()) {
+      // Both sides changed this position.  That's only a conflict if they ended up in different places.
+      const BlockInstance& our_block = our_iter.value().after;
+      const BlockInstance& their_block = their_change.after;
+      if (our_block.isValid() != their_block.isValid() ||
+          (our_block.isValid() && !isSameBlock(our_block, their_block))) {
+        conflicts->insert(iter.key());
+      }
+      continue;
+    }
+
+    // We left this position alone, so it still holds the common ancestor's block, which is their_change.before.
+    if (their_change.before.isValid()) {
+      transaction->clearBlock(their_change.before);
+    }
+    if (their_change.after.isValid()) {
+      transaction->setBlock(their_change.after);
+    }
+    ++merged_count;
+  }
+  return merged_count;
+}
@@ -0,0 +1,122 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DIAGRAM_DIFF_H
+#define DIAGRAM_DIFF_H
+
+#include <QHash>
+
+#include "block_instance.h"
+#include "block_position.h"
+#include "occupancy_mask.h"
+
+class BlockTransaction;
+class Diagram;
+
+/**
+  * The differences between two diagrams, block by block.
+  *
+  * Both diagrams are split into chunks of kChunkSize blocks on a side, and each chunk is given a hash of its contents
+  * that doesn't depend on the order its blocks are visited in, so the whole split takes a single pass over each
+  * diagram.  Chunks with the same hash and block count on both sides are taken to be identical and skipped; the rest
+  * are compared cell by cell, each chunk as a separate task on the global thread pool.  Since edits tend to be
+  * clustered, most chunks of two versions of the same design are skipped outright.
+  */
+class DiagramDiff {
+ public:
+  /** The edge length, in blocks, of the chunks that are hashed and compared. */
+  static const int kChunkSize = 16;
+
+  /**
+    * The blocks at one position before and after.  An invalid BlockInstance stands for an empty position.
+    */
+  struct Change {
+    BlockInstance before;
+    BlockInstance after;
+  };
+
+  /**
+    * Compares \p before with \p after.  Neither diagram may change while the DiagramDiff is being constructed, and
+    * \p before may not change for as long as update() is used.  If they are not NULL, \p identical_chunk_count and
+    * \p chunk_count are set to the number of chunks that were skipped because they were identical on both sides, and
+    * the number of non-empty chunks on either side.
+    */
+  DiagramDiff(const Diagram* before, const Diagram* after, int* identical_chunk_count = NULL, int* chunk_count = NULL);
+
+  /**
+    * Brings the differences up to date after \p transaction has been committed to the \e after diagram.  Only the
+    * positions that \p transaction touched are compared again, so the cost depends on the size of the edit rather
+    * than the size of the diagrams.
+    */
+  void update(const BlockTransaction& transaction);
+
+  /**
+    * Returns the changes, keyed on position.
+    */
+  const QHash<BlockPosition, Change>& changes() const {
+    return changes_;
+  }
+
+  /**
+    * Returns the positions that are empty before and filled after.
+    */
+  const OccupancyMask& addedBlocks() const {
+    return added_blocks_;
+  }
+
+  /**
+    * Returns the positions that are filled before and empty after.
+    */
+  const OccupancyMask& removedBlocks() const {
+    return removed_blocks_;
+  }
+
+  /**
+    * Returns the positions whose block type or orientation differs between before and after.
+    */
+  const OccupancyMask& changedBlocks() const {
+    return changed_blocks_;
+  }
+
+  /**
+    * Populates \p transaction with the changes that turn the \e before diagram into the \e after diagram.
+    */
+  void apply(BlockTransaction* transaction) const;
+
+  /**
+    * Performs a three-way merge.  \p ours and \p theirs must both start from the same \e before diagram (the common
+    * ancestor), and \p ours must end at the diagram that \p transaction will be committed to.  Every change in
+    * \p theirs at a position that \p ours left alone is added to \p transaction.  Positions that both sides changed,
+    * to different blocks, are conflicts: the block from \p ours is kept and the position is added to \p conflicts.
+    * @return The number of blocks that will be changed by \p transaction.
+    */
+  static int merge(const DiagramDiff& ours, const DiagramDiff& theirs, BlockTransaction* transaction,
+                   OccupancyMask* conflicts);
+
+ private:
+  /**
+    * Records \p change at \p position in changes_ and the masks.
+    */
+  void addChange(const BlockPosition& position, const Change& change);
+
+  const Diagram* before_;
+  const Diagram* after_;
+  QHash<BlockPosition, Change> changes_;
+  OccupancyMask added_blocks_;
+  OccupancyMask removed_blocks_;
+  OccupancyMask changed_blocks_;
+};
+
+#endif // DIAGRAM_DIFF_H
@@ -0,0 +1,636 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "expression.h"
+
+#include <QChar>
+
+#include <qmath.h>
+
+#include "macros.h"
+
+namespace {
+
+enum TokenType {
+  kEndToken,
+  kNumberToken,
+  kIdentifierToken,
+  kOperatorToken
+};
+
+struct Token {
+  TokenType type;
+  QString text;
+  float value;
+  int position;
+};
+
+/**
+  * Operators, longest first so that "<=" is matched before "<".
+  */
+const char* const kOperators[] = {
+  "&&", "||", "<=", ">=", "==", "!=",
+  "+", "-", "*", "/", "%", "^", "<", ">", "!", "(", ")", ",", ";", "="
+};
+
+}  // namespace
+
+/**
+  * A recursive descent parser that emits bytecode for an Expression as it goes.
+  */
+class Expression::Parser {
+ public:
+  Parser(const QString& source, Expression* expression)
+      : source_(source), expression_(expression), index_(0), depth_(0), failed_(false) {}
+
+  bool parse(QString* error) {
+    tokenize();
+    if (!failed_) {
+      parseProgram();
+    }
+    if (failed_ && error) {
+      *error = error_;
+    }
+    return !failed_;
+  }
+
+ private:
+  struct Function {
+    const char* name;
+    int arity;
+    Opcode opcode;
+  };
+
+  static const Function kFunctions[];
+
+  void tokenize() {
+    int i = 0;
+    while (i < source_.size()) {
+      QChar c = source_.at(i);
+      if (c.isSpace()) {
+        ++i;
+        continue;
+      }
+      Token token;
+      token.position = i;
+      token.value = 0;
+      if (c.isDigit() || (c == '.' && i + 1 < source_.size() && source_.at(i + 1).isDigit())) {
+        int start = i;
+        while (i < source_.size() && (source_.at(i).isDigit() || source_.at(i) == '.')) {
+          ++i;
+        }
+        if (i < source_.size() && (source_.at(i) == 'e' || source_.at(i) == 'E')) {
+          ++i;
+          if (i < source_.size() && (source_.at(i) == '+' || source_.at(i) == '-')) {
+            ++i;
+          }
+          while (i < source_.size() && source_.at(i).isDigit()) {
+            ++i;
+          }
+        }
+        bool ok;
+        token.type = kNumberToken;
+        token.text = source_.mid(start, i - start);
+        token.value = token.text.toFloat(&ok);
+        if (!ok) {
+          fail(QString("\"%1\" is not a valid number").arg(token.text), start);
+          return;
+        }
+      } else if (c.isLetter() || c == '_') {
+        int start = i;
+        while (i < source_.size() && (source_.at(i).isLetterOrNumber() || source_.at(i) == '_')) {
+          ++i;
+        }
+        token.type = kIdentifierToken;
+        token.text = source_.mid(start, i - start);
+      } else {
+        token.type = kOperatorToken;
+        for (int op = 0; op < arraysize(kOperators); ++op) {
+          QString candidate(kOperators[op]);
+          if (source_.mid(i, candidate.size()) == candidate) {
+            token.text = candidate;
+            break;
+          }
+        }
+        if (token.text.isEmpty()) {
+          fail(QString("Unexpected character '%1'").arg(c), i);
+          return;
+        }
+        i += token.text.size();
+      }
+      tokens_.append(token);
+    }
+    Token end;
+    end.type = kEndToken;
+    end.value = 0;
+    end.position = source_.size();
+    tokens_.append(end);
+  }
+
+  const Token& current() const {
+    return tokens_.at(index_);
+  }
+
+  const Token& lookahead() const {
+    return tokens_.at(qMin(index_ + 1, tokens_.size() - 1));
+  }
+
+  bool isOperator(const Token& token, const char* op) const {
+    return token.type == kOperatorToken && token.text == op;
+  }
+
+  bool accept(const char* op) {
+    if (isOperator(current(), op)) {
+      ++index_;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(const char* op) {
+    if (!accept(op)) {
+      fail(QString("Expected \"%1\"").arg(op), current().position);
+    }
+  }
+
+  void fail(const QString& message, int position) {
+    if (!failed_) {
+      failed_ = true;
+      error_ = QString("%1 at column %2.").arg(message).arg(position + 1);
+    }
+  }
+
+  /**
+    * Appends an instruction that changes the stack depth by \p stack_effect.
+    */
+  void append(Opcode opcode, int operand, int stack_effect) {
+    Instruction instruction;
+    instruction.opcode = opcode;
+    instruction.operand = operand;
+    expression_->program_.append(instruction);
+    depth_ += stack_effect;
+    expression_->max_stack_depth_ = qMax(expression_->max_stack_depth_, depth_);
+  }
+
+  void parseProgram() {
+    while (!failed_ && current().type == kIdentifierToken && isOperator(lookahead(), "=")) {
+      QString name = current().text;
+      int position = current().position;
+      index_ += 2;
+      if (name == "x" || name == "y" || name == "z" || name == "pi") {
+        fail(QString("Cannot assign to \"%1\"").arg(name), position);
+        return;
+      }
+      parseOr();
+      int slot = expression_->variables_.indexOf(name);
+      if (slot < 0) {
+        slot = expression_->variables_.size();
+        expression_->variables_.append(name);
+      }
+      append(kStoreVariable, slot, -1);
+      expect(";");
+    }
+    if (failed_) {
+      return;
+    }
+    if (current().type == kEndToken) {
+      fail("Expected an expression", current().position);
+      return;
+    }
+    parseOr();
+    accept(";");
+    if (!failed_ && current().type != kEndToken) {
+      fail(QString("Unexpected \"%1\"").arg(current().text), current().position);
+    }
+  }
+
+  void parseOr() {
+    parseAnd();
+    while (!failed_ && accept("||")) {
+      parseAnd();
+      append(kOr, 0, -1);
+    }
+  }
+
+  void parseAnd() {
+    parseComparison();
+    while (!failed_ && accept("&&")) {
+      parseComparison();
+      append(kAnd, 0, -1);
+    }
+  }
+
+  void parseComparison() {
+    parseSum();
+    while (!failed_) {
+      Opcode opcode;
+      if (accept("<")) {
+        opcode = kLess;
+      } else if (accept("<=")) {
+        opcode = kLessOrEqual;
+      } else if (accept(">")) {
+        opcode = kGreater;
+      } else if (accept(">=")) {
+        opcode = kGreaterOrEqual;
+      } else if (accept("==")) {
+        opcode = kEqual;
+      } else if (accept("!=")) {
+        opcode = kNotEqual;
+      } else {
+        return;
+      }
+      parseSum();
+      append(opcode, 0, -1);
+    }
+  }
+
+  void parseSum() {
+    parseProduct();
+    while (!failed_) {
+      Opcode opcode;
+      if (accept("+")) {
+        opcode = kAdd;
+      } else if (accept("-")) {
+        opcode = kSubtract;
+      } else {
+        return;
+      }
+      parseProduct();
+      append(opcode, 0, -1);
+    }
+  }
+
+  void parseProduct() {
+    parseUnary();
+    while (!failed_) {
+      Opcode opcode;
+      if (accept("*")) {
+        opcode = kMultiply;
+      } else if (accept("/")) {
+        opcode = kDivide;
+      } else if (accept("%")) {
+        opcode = kModulo;
+      } else {
+        return;
+      }
+      parseUnary();
+      append(opcode, 0, -1);
+    }
+  }
+
+  void parseUnary() {
+    if (accept("-")) {
+      parseUnary();
+      append(kNegate, 0, 0);
+    } else if (accept("!")) {
+      parseUnary();
+      append(kNot, 0, 0);
+    } else {
+      parsePower();
+    }
+  }
+
+  void parsePower() {
+    parsePrimary();
+    if (!failed_ && accept("^")) {
+      // Right-associative, and binds tighter than unary minus on its left: -2^2 is -(2^2).
+      parseUnary();
+      append(kPower, 0, -1);
+    }
+  }
+
+  void parsePrimary() {
+    if (failed_) {
+      return;
+    }
+    const Token token = current();
+    if (token.type == kNumberToken) {
+      ++index_;
+      append(kPushConstant, expression_->constants_.size(), 1);
+      expression_->constants_.append(token.value);
+    } else if (token.type == kIdentifierToken) {
+      ++index_;
+      if (accept("(")) {
+        parseCall(token);
+      } else if (token.text == "pi") {
+        append(kPushConstant, expression_->constants_.size(), 1);
+        expression_->constants_.append(static_cast<float>(M_PI));
+      } else {
+        int slot = expression_->variables_.indexOf(token.text);
+        if (slot < 0) {
+          fail(QString("Unknown variable \"%1\"").arg(token.text), token.position);
+          return;
+        }
+        append(kLoadVariable, slot, 1);
+      }
+    } else if (accept("(")) {
+      parseOr();
+      expect(")");
+    } else if (token.type == kEndToken) {
+      fail("Unexpected end of expression", token.position);
+    } else {
+      fail(QString("Unexpected \"%1\"").arg(token.text), token.position);
+    }
+  }
+
+  void parseCall(const Token& name) {
+    const Function* function = NULL;
+    for (int i = 0; kFunctions[i].name; ++i) {
+      if (name.text == kFunctions[i].name) {
+        function = &kFunctions[i];
+        break;
+      }
+    }
+    if (!function) {
+      fail(QString("Unknown function \"%1\"").arg(name.text), name.position);
+      return;
+    }
+    int arguments = 0;
+    if (!isOperator(current(), ")")) {
+      do {
+        parseOr();
+        ++arguments;
+      } while (!failed_ && accept(","));
+    }
+    expect(")");
+    if (!failed_ && arguments != function->arity) {
+      fail(QString("%1() takes %2 argument(s)").arg(name.text).arg(function->arity), name.position);
+      return;
+    }
+    append(function->opcode, 0, 1 - function->arity);
+  }
+
+  QString source_;
+  Expression* expression_;
+  QVector<Token> tokens_;
+  int index_;
+  int depth_;
+  bool failed_;
+  QString error_;
+};
+
+const Expression::Parser::Function Expression::Parser::kFunctions[] = {
+  { "abs", 1, Expression::kAbs },
+  { "sqrt", 1, Expression::kSqrt },
+  { "floor", 1, Expression::kFloor },
+  { "ceil", 1, Expression::kCeil },
+  { "round", 1, Expression::kRound },
+  { "sin", 1, Expression::kSin },
+  { "cos", 1, Expression::kCos },
+  { "tan", 1, Expression::kTan },
+  { "atan2", 2, Expression::kAtan2 },
+  { "min", 2, Expression::kMin },
+  { "max", 2, Expression::kMax },
+  { "pow", 2, Expression::kPower },
+  { NULL, 0, Expression::kAdd }
+};
+
+Expression::Expression() : max_stack_depth_(0) {}
+
+bool Expression::compile(const QString& source, QString* error) {
+  program_.clear();
+  constants_.clear();
+  variables_.clear();
+  variables_ << "x" << "y" << "z";
+  max_stack_depth_ = 0;
+  Parser parser(source, this);
+  if (!parser.parse(error)) {
+    program_.clear();
+    return false;
+  }
+  return true;
+}
+
+float Expression::evaluate(float x, float y, float z) const {
+  float result;
+  evaluateRow(x, y, z, 1, &result);
+  return result;
+}
+
+void Expression::evaluateRow(float x, float y, float z, int count, float* results) const {
+  if (!isValid()) {
+    for (int i = 0; i < count; ++i) {
+      results[i] = 0;
+    }
+    return;
+  }
+  QVector<float> scratch((variables_.size() + max_stack_depth_) * kBatchSize);
+  for (int offset = 0; offset < count; offset += kBatchSize) {
+    evaluateBatch(x + offset, y, z, qMin(kBatchSize, count - offset), scratch.data(), results + offset);
+  }
+}
+
+void Expression::evaluateBatch(float x, float y, float z, int count, float* scratch, float* results) const {
+  float* variables = scratch;
+  float* stack = scratch + variables_.size() * kBatchSize;
+  for (int i = 0; i < count; ++i) {
+    variables[i] = x + i;
+    variables[kBatchSize + i] = y;
+    variables[2 * kBatchSize + i] = z;
+  }
+
+  // Each instruction is applied to the whole batch before moving on.  "a" is the second entry from the top of the
+  // stack and "b" the top entry; binary operations leave their result in "a".
+  int depth = 0;
+  for (int pc = 0; pc < program_.size(); ++pc) {
+    const Instruction& instruction = program_.at(pc);
+    float* b = stack + (depth - 1) * kBatchSize;
+    float* a = b - kBatchSize;
+    switch (instruction.opcode) {
+      case kPushConstant: {
+        float* top = stack + depth * kBatchSize;
+        float value = constants_.at(instruction.operand);
+        for (int i = 0; i < count; ++i) {
+          top[i] = value;
+        }
+        ++depth;
+        break;
+      }
+      case kLoadVariable: {
+        float* top = stack + depth * kBatchSize;
+        const float* variable = variables + instruction.operand * kBatchSize;
+        for (int i = 0; i < count; ++i) {
+          top[i] = variable[i];
+        }
+        ++depth;
+        break;
+      }
+      case kStoreVariable: {
+        float* variable = variables + instruction.operand * kBatchSize;
+        for (int i = 0; i < count; ++i) {
+          variable[i] = b[i];
+        }
+        --depth;
+        break;
+      }
+      case kAdd:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] + b[i];
+        }
+        --depth;
+        break;
+      case kSubtract:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] - b[i];
+        }
+        --depth;
+        break;
+      case kMultiply:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] * b[i];
+        }
+        --depth;
+        break;
+      case kDivide:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] / b[i];
+        }
+        --depth;
+        break;
+      case kModulo:
+        for (int i = 0; i < count; ++i) {
+          a[i] = fmodf(a[i], b[i]);
+        }
+        --depth;
+        break;
+      case kPower:
+        for (int i = 0; i < count; ++i) {
+          a[i] = powf(a[i], b[i]);
+        }
+        --depth;
+        break;
+      case kLess:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] < b[i] ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kLessOrEqual:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] <= b[i] ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kGreater:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] > b[i] ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kGreaterOrEqual:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] >= b[i] ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kEqual:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] == b[i] ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kNotEqual:
+        for (int i = 0; i < count; ++i) {
+          a[i] = a[i] != b[i] ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kAnd:
+        for (int i = 0; i < count; ++i) {
+          a[i] = (a[i] != 0 && b[i] != 0) ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kOr:
+        for (int i = 0; i < count; ++i) {
+          a[i] = (a[i] != 0 || b[i] != 0) ? 1.0f : 0.0f;
+        }
+        --depth;
+        break;
+      case kAtan2:
+        for (int i = 0; i < count; ++i) {
+          a[i] = atan2f(a[i], b[i]);
+        }
+        --depth;
+        break;
+      case kMin:
+        for (int i = 0; i < count; ++i) {
+          a[i] = qMin(a[i], b[i]);
+        }
+        --depth;
+        break;
+      case kMax:
+        for (int i = 0; i < count; ++i) {
+          a[i] = qMax(a[i], b[i]);
+        }
+        --depth;
+        break;
+      case kNegate:
+        for (int i = 0; i < count; ++i) {
+          b[i] = -b[i];
+        }
+        break;
+      case kNot:
+        for (int i = 0; i < count; ++i) {
+          b[i] = b[i] == 0 ? 1.0f : 0.0f;
+        }
+        break;
+      case kAbs:
+        for (int i = 0; i < count; ++i) {
+          b[i] = fabsf(b[i]);
+        }
+        break;
+      case kSqrt:
+        for (int i = 0; i < count; ++i) {
+          b[i] = sqrtf(b[i]);
+        }
+        break;
+      case kFloor:
+        for (int i = 0; i < count; ++i) {
+          b[i] = floorf(b[i]);
+        }
+        break;
+      case kCeil:
+        for (int i = 0; i < count; ++i) {
+          b[i] = ceilf(b[i]);
+        }
+        break;
+      case kRound:
+        for (int i = 0; i < count; ++i) {
+          b[i] = floorf(b[i] + 0.5f);
+        }
+        break;
+      case kSin:
+        for (int i = 0; i < count; ++i) {
+          b[i] = sinf(b[i]);
+        }
+        break;
+      case kCos:
+        for (int i = 0; i < count; ++i) {
+          b[i] = cosf(b[i]);
+        }
+        break;
+      case kTan:
+        for (int i = 0; i < count; ++i) {
+          b[i] = tanf(b[i]);
+        }
+        break;
+    }
+  }
+  Q_ASSERT(depth == 1);
+  for (int i = 0; i < count; ++i) {
+    results[i] = stack[i];
+  }
+}
@@ -0,0 +1,129 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+  * A small arithmetic language for describing volumes, compiled to bytecode for a stack machine.
+  *
+  * A program is a sequence of zero or more assignments followed by a single expression, for example:
+  *
+  * @code
+  * r = 12; h = 6;
+  * x*x + z*z < r*r && y < h
+  * @endcode
+  *
+  * The variables \c x, \c y and \c z are predefined, and \c pi is a constant.  The usual arithmetic (\c + \c - \c * \c /
+  * \c % and \c ^ for powers), comparison (\c < \c <= \c > \c >= \c == \c !=) and logical (\c && \c || \c !) operators
+  * are supported, along with the functions \c abs, \c sqrt, \c floor, \c ceil, \c round, \c sin, \c cos, \c tan,
+  * \c atan2, \c min, \c max and \c pow.  Comparisons and logical operators produce 1 for true and 0 for false, and any
+  * nonzero value counts as true.
+  *
+  * The program is evaluated a whole row of points at a time (see evaluateRow()): each instruction runs over a batch of
+  * kBatchSize values before moving on to the next, which keeps the interpreter overhead per point low and gives the
+  * compiler simple loops to vectorize.  A compiled Expression is immutable, so one instance can be shared between
+  * threads.
+  */
+class Expression {
+ public:
+  /** The number of points each instruction processes at once in evaluateRow(). */
+  static const int kBatchSize = 64;
+
+  Expression();
+
+  /**
+    * Compiles \p source, replacing any previously compiled program.
+    * @return \c true on success.  On failure, returns \c false and, if \p error is not \c NULL, sets it to a message
+    *     describing the problem.
+    */
+  bool compile(const QString& source, QString* error = NULL);
+
+  /**
+    * Returns \c true if the last call to compile() succeeded.
+    */
+  bool isValid() const {
+    return !program_.isEmpty();
+  }
+
+  /**
+    * Evaluates the expression at a single point.
+    */
+  float evaluate(float x, float y, float z) const;
+
+  /**
+    * Evaluates the expression at the \p count points (x + i, y, z) for i in [0, count) and writes the results to
+    * \p results.
+    */
+  void evaluateRow(float x, float y, float z, int count, float* results) const;
+
+ private:
+  enum Opcode {
+    kPushConstant,
+    kLoadVariable,
+    kStoreVariable,
+    kAdd,
+    kSubtract,
+    kMultiply,
+    kDivide,
+    kModulo,
+    kPower,
+    kNegate,
+    kNot,
+    kLess,
+    kLessOrEqual,
+    kGreater,
+    kGreaterOrEqual,
+    kEqual,
+    kNotEqual,
+    kAnd,
+    kOr,
+    kAbs,
+    kSqrt,
+    kFloor,
+    kCeil,
+    kRound,
+    kSin,
+    kCos,
+    kTan,
+    kAtan2,
+    kMin,
+    kMax
+  };
+
+  struct Instruction {
+    Opcode opcode;
+    int operand;
+  };
+
+  class Parser;
+  friend class Parser;
+
+  /**
+    * Runs the program over \p count (at most kBatchSize) points, using \p scratch as stack and variable storage.
+    */
+  void evaluateBatch(float x, float y, float z, int count, float* scratch, float* results) const;
+
+  QVector<Instruction> program_;
+  QVector<float> constants_;
+  QStringList variables_;
+  int max_stack_depth_;
+};
+
+#endif // EXPRESSION_H
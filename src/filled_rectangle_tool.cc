@@ -19,6 +19,8 @@
 #include "block_oracle.h"
 #include "block_prototype.h"
 #include "block_transaction.h"
+#include "shape.h"
+#include "shape_rasterizer.h"
 
 FilledRectangleTool::FilledRectangleTool(BlockOracle* oracle) : oracle_(oracle) {}
 
@@ -50,11 +52,7 @@ void FilledRectangleTool::draw(BlockPrototype* prototype,
                     positionAtIndex(0).y(),
                     qMax(positionAtIndex(0).z(), positionAtIndex(1).z()));
 
-  for (int x = start.x(); x <= end.x(); ++x) {
-    for (int z = start.z(); z <= end.z(); ++z) {
-      BlockPosition pos(x, start.y(), z);
-      BlockInstance new_block(prototype, pos, orientation);
-      transaction->replaceBlock(oracle_->blockAt(pos), new_block);
-    }
-  }
+  QVector3D half_extents((end.x() - start.x() + 1) / 2.0, 0.5, (end.z() - start.z() + 1) / 2.0);
+  BoxShape box((start.centerVector() + end.centerVector()) / 2.0, half_extents);
+  ShapeRasterizer(oracle_).fill(box, prototype, orientation, transaction);
 }
@@ -45,7 +45,7 @@ void FloodFillTool::draw(BlockPrototype* prototype, const BlockOrientation* orie
   BlockPosition start_pos = positionAtIndex(0);
   BlockInstance start_block = oracle_->blockAt(start_pos);
   const blocktype_t source_type = start_block.prototype()->type();
-  QSet<BlockPosition> filled_blocks;
+  PositionSet filled_blocks;
   fillBlocksRecurse(start_pos, source_type, prototype, orientation, start_pos, 1, &filled_blocks, transaction);
 }
 
@@ -55,7 +55,7 @@ void FloodFillTool::fillBlocksRecurse(const BlockPosition& pos,
                                       const BlockOrientation* dest_orientation,
                                       const BlockPosition& start_pos,
                                       int depth,
-                                      QSet<BlockPosition>* filled_blocks,
+                                      PositionSet* filled_blocks,
                                       BlockTransaction* transaction) {
   if (filled_blocks->contains(pos)) {
     // We've already filled this block.
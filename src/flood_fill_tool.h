@@ -17,6 +17,7 @@
 #define FLOOD_FILL_TOOL_H
 
 #include "block_type.h"
+#include "position_hash.h"
 #include "tool.h"
 
 class BlockOracle;
@@ -49,7 +50,7 @@ class FloodFillTool : public Tool {
                          const BlockOrientation* dest_orientation,
                          const BlockPosition& start_pos,
                          int depth,
-                         QSet<BlockPosition>* filled_blocks,
+                         PositionSet* filled_blocks,
                          BlockTransaction* transaction);
 
   BlockOracle* oracle_;
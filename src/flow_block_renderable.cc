@@ -27,33 +27,42 @@ FlowBlockRenderable::~FlowBlockRenderable() {
 }
 
 void FlowBlockRenderable::initialize() {
-}
+  Renderable::initialize();
+  Q_ASSERT(renderDelegate() != NULL);
+  QVector<const BlockOrientation*> orientations = renderDelegate()->orientations();
+  int len = orientations.size();
+  for (int i = 0; i < len; ++i) {
+    QVector3D size(1.0, 1.0, 1.0);
+    // Block height varies between 15/16 and 1/16 in steps depending on the number of orientations.
+    size.setY(1.0 - static_cast<qreal>(i + 1) / static_cast<qreal>(len + 1));
+    RectangularPrismRenderable* renderable = new RectangularPrismRenderable(size);
+    renderable->setRenderDelegate(renderDelegate());
 
-void FlowBlockRenderable::renderAt(const QVector3D& location, const BlockOrientation* orientation) const {
-  if (renderables_.isEmpty()) {
-    // First time we have been rendered, so set up our delegate renderables.
-    Q_ASSERT(renderDelegate() != NULL);
-    QVector<const BlockOrientation*> orientations = renderDelegate()->orientations();
-    int len = orientations.size();
-    for (int i = 0; i < len; ++i) {
-      QVector3D size(1.0, 1.0, 1.0);
-      // Block height varies between 15/16 and 1/16 in steps depending on the number of orientations.
-      size.setY(1.0 - static_cast<qreal>(i + 1) / static_cast<qreal>(len + 1));
-      RectangularPrismRenderable* renderable = new RectangularPrismRenderable(size);
-      renderable->initialize();
-      renderable->setRenderDelegate(renderDelegate());
-
-      // This assumes contiguous texture ids, which we know to be true for us in particular.
-      for (int tex_id = 0; tex_id < textureCount(); ++tex_id) {
-        renderable->setTexture(tex_id, texture(tex_id));
-      }
-
-      renderables_.insert(renderDelegate()->orientations().at(i), renderable);
+    // This assumes contiguous texture ids, which we know to be true for us in particular.
+    for (int tex_id = 0; tex_id < textureCount(); ++tex_id) {
+      renderable->setTexture(tex_id, texture(tex_id));
     }
+    renderable->initialize();
+
+    renderables_.insert(orientations.at(i), renderable);
   }
+}
+
+void FlowBlockRenderable::renderAt(const QVector3D& location, const BlockOrientation* orientation,
+                                   BlockOracle* oracle) const {
+  Renderable* delegate_renderable = renderables_.value(orientation, NULL);
+  if (delegate_renderable) {
+    delegate_renderable->renderAt(location, orientation, oracle);
+  } else {
+    qWarning() << __PRETTY_FUNCTION__ << "No delegate renderable found for orientation" << orientation->name();
+  }
+}
+
+void FlowBlockRenderable::appendGeometry(SceneMesh* mesh, const SceneMaterial& material, const QVector3D& location,
+                                         const BlockOrientation* orientation, BlockOracle* oracle) const {
   Renderable* delegate_renderable = renderables_.value(orientation, NULL);
   if (delegate_renderable) {
-    delegate_renderable->renderAt(location, orientation);
+    delegate_renderable->appendGeometry(mesh, material, location, orientation, oracle);
   } else {
     qWarning() << __PRETTY_FUNCTION__ << "No delegate renderable found for orientation" << orientation->name();
   }
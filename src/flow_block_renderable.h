@@ -28,10 +28,12 @@ class FlowBlockRenderable : public Renderable {
   virtual ~FlowBlockRenderable();
 
   virtual void initialize();
-  virtual void renderAt(const QVector3D& location, const BlockOrientation* orientation) const;
+  virtual void renderAt(const QVector3D& location, const BlockOrientation* orientation, BlockOracle* oracle) const;
+  virtual void appendGeometry(SceneMesh* mesh, const SceneMaterial& material, const QVector3D& location,
+                              const BlockOrientation* orientation, BlockOracle* oracle) const;
 
  private:
-  mutable QHash<const BlockOrientation*, RectangularPrismRenderable*> renderables_;
+  QHash<const BlockOrientation*, RectangularPrismRenderable*> renderables_;
 };
 
 #endif // FLOW_BLOCK_RENDERABLE_H
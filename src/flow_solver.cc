@@ -0,0 +1,245 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow_solver.h"
+
+#include <QVector>
+
+#include "block_manager.h"
+#include "block_orientation.h"
+#include "block_prototype.h"
+#include "block_transaction.h"
+#include "diagram.h"
+
+namespace {
+
+const blocktype_t kWaterSourceType = 0x08;
+const blocktype_t kWaterFlowType = 0xF0008;
+const blocktype_t kLavaSourceType = 0x0A;
+const blocktype_t kLavaFlowType = 0xE000A;
+
+const BlockPosition kBelow(0, -1, 0);
+
+/** The four horizontal neighbours, followed by the two vertical ones. */
+const BlockPosition kNeighbors[] = {
+  BlockPosition(1, 0, 0),
+  BlockPosition(-1, 0, 0),
+  BlockPosition(0, 0, 1),
+  BlockPosition(0, 0, -1),
+  BlockPosition(0, 1, 0),
+  BlockPosition(0, -1, 0)
+};
+const int kHorizontalNeighborCount = 4;
+const int kNeighborCount = 6;
+
+}  // namespace
+
+FlowSolver::FlowSolver(const QHash<BlockPosition, BlockInstance>* blocks, BlockManager* block_mgr, int floor_level,
+                       const Diagram* placements)
+    : blocks_(blocks), placements_(placements), block_mgr_(block_mgr), floor_level_(floor_level) {
+  Q_ASSERT(blocks_);
+  Q_ASSERT(block_mgr_);
+  blocktype_t types[][2] = { { kWaterSourceType, kWaterFlowType }, { kLavaSourceType, kLavaFlowType } };
+  for (int i = 0; i < 2; ++i) {
+    Liquid liquid;
+    liquid.source = block_mgr_->getPrototype(types[i][0]);
+    liquid.flow = block_mgr_->getPrototype(types[i][1]);
+    liquid.max_distance = liquid.flow->orientations().size();
+    liquids_.append(liquid);
+  }
+}
+
+bool FlowSolver::isLiquid(const Liquid& liquid, const BlockPosition& position) const {
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_->constFind(position);
+  return iter != blocks_->constEnd() &&
+         (iter.value().prototype() == liquid.source || iter.value().prototype() == liquid.flow);
+}
+
+bool FlowSolver::isSource(const Liquid& liquid, const BlockPosition& position) const {
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_->constFind(position);
+  return iter != blocks_->constEnd() && iter.value().prototype() == liquid.source;
+}
+
+bool FlowSolver::isFlow(const Liquid& liquid, const BlockPosition& position) const {
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_->constFind(position);
+  return iter != blocks_->constEnd() && iter.value().prototype() == liquid.flow;
+}
+
+bool FlowSolver::canFlowInto(const Liquid& liquid, const BlockPosition& position) const {
+  // Existing flow of the same liquid is about to be worked out again, so it counts as empty.
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_->constFind(position);
+  if (iter != blocks_->constEnd()) {
+    return iter.value().prototype() == liquid.flow;
+  }
+  return !placements_ || !placements_->placedBlockAt(position).isValid();
+}
+
+void FlowSolver::addBody(const Liquid& liquid, const BlockPosition& start, Region* region) const {
+  if (region->blocks.contains(start) || !isLiquid(liquid, start)) {
+    return;
+  }
+  QList<BlockPosition> stack;
+  stack.append(start);
+  region->blocks.insert(start);
+  while (!stack.isEmpty()) {
+    BlockPosition position = stack.takeLast();
+    if (isSource(liquid, position)) {
+      region->sources.append(position);
+    }
+    for (int i = 0; i < kNeighborCount; ++i) {
+      BlockPosition neighbor = position + kNeighbors[i];
+      if (!region->blocks.contains(neighbor) && isLiquid(liquid, neighbor)) {
+        region->blocks.insert(neighbor);
+        stack.append(neighbor);
+      }
+    }
+  }
+}
+
+void FlowSolver::spread(const Liquid& liquid, const Region& region, QHash<BlockPosition, int>* distances,
+                        QList<BlockPosition>* outside) const {
+  // buckets[d] holds the blocks waiting to spread at distance d.  A block can be queued more than once if its
+  // distance improves, so stale entries are skipped when they come up.
+  QVector< QList<BlockPosition> > buckets(liquid.max_distance + 1);
+  foreach (const BlockPosition& source, region.sources) {
+    distances->insert(source, 0);
+    buckets[0].append(source);
+  }
+
+  int distance = 0;
+  while (distance <= liquid.max_distance) {
+    if (buckets[distance].isEmpty()) {
+      ++distance;
+      continue;
+    }
+    BlockPosition position = buckets[distance].takeLast();
+    if (distances->value(position) != distance) {
+      continue;
+    }
+
+    QList<BlockPosition> targets;
+    int target_distance = 0;
+    BlockPosition below = position + kBelow;
+    if (below.y() >= floor_level_ && canFlowInto(liquid, below)) {
+      targets.append(below);
+      target_distance = 0;
+    } else if (distance < liquid.max_distance && (isSource(liquid, position) || !isSource(liquid, below))) {
+      for (int i = 0; i < kHorizontalNeighborCount; ++i) {
+        BlockPosition neighbor = position + kNeighbors[i];
+        if (canFlowInto(liquid, neighbor)) {
+          targets.append(neighbor);
+        }
+      }
+      target_distance = distance + 1;
+    }
+
+    foreach (const BlockPosition& target, targets) {
+      QHash<BlockPosition, int>::iterator iter = distances->find(target);
+      if (iter == distances->end()) {
+        distances->insert(target, target_distance);
+        if (isFlow(liquid, target) && !region.blocks.contains(target)) {
+          outside->append(target);
+        }
+      } else if (target_distance < iter.value()) {
+        iter.value() = target_distance;
+      } else {
+        continue;
+      }
+      buckets[target_distance].append(target);
+      distance = qMin(distance, target_distance);
+    }
+  }
+}
+
+int FlowSolver::solve(const Liquid& liquid, Region* region, BlockTransaction* transaction) {
+  if (region->blocks.isEmpty()) {
+    return 0;
+  }
+
+  // A block's distance is the distance it would take from the liquid that reaches it first.
+  QHash<BlockPosition, int> distances;
+  while (true) {
+    QList<BlockPosition> outside;
+    distances.clear();
+    spread(liquid, *region, &distances, &outside);
+    if (outside.isEmpty()) {
+      break;
+    }
+    // The flow ran into another body, whose own sources may be closer; solve the two together.
+    foreach (const BlockPosition& position, outside) {
+      addBody(liquid, position, region);
+    }
+  }
+
+  int changed = 0;
+  foreach (const BlockPosition& position, region->blocks) {
+    if (!distances.contains(position) && isFlow(liquid, position)) {
+      transaction->clearBlock(blocks_->value(position));
+      ++changed;
+    }
+  }
+  QVector<const BlockOrientation*> orientations = liquid.flow->orientations();
+  QHash<BlockPosition, int>::const_iterator iter;
+  for (iter = distances.constBegin(); iter != distances.constEnd(); ++iter) {
+    if (isSource(liquid, iter.key())) {
+      continue;
+    }
+    // Falling liquid has a distance of 0 but is drawn as the fullest kind of flow.
+    const BlockOrientation* orientation = orientations.at(qMax(iter.value(), 1) - 1);
+    QHash<BlockPosition, BlockInstance>::const_iterator old_block = blocks_->constFind(iter.key());
+    if (old_block == blocks_->constEnd()) {
+      transaction->setBlock(BlockInstance(liquid.flow, iter.key(), orientation));
+    } else if (old_block.value().orientation() != orientation) {
+      transaction->replaceBlock(old_block.value(), BlockInstance(liquid.flow, iter.key(), orientation));
+    } else {
+      continue;
+    }
+    ++changed;
+  }
+  return changed;
+}
+
+int FlowSolver::solveAll(BlockTransaction* transaction) {
+  int changed = 0;
+  foreach (const Liquid& liquid, liquids_) {
+    Region region;
+    QHash<BlockPosition, BlockInstance>::const_iterator iter;
+    for (iter = blocks_->constBegin(); iter != blocks_->constEnd(); ++iter) {
+      if (iter.value().prototype() == liquid.source) {
+        region.sources.append(iter.key());
+        region.blocks.insert(iter.key());
+      } else if (iter.value().prototype() == liquid.flow) {
+        region.blocks.insert(iter.key());
+      }
+    }
+    changed += solve(liquid, &region, transaction);
+  }
+  return changed;
+}
+
+int FlowSolver::solveAround(const QList<BlockPosition>& changed, BlockTransaction* transaction) {
+  int changed_count = 0;
+  foreach (const Liquid& liquid, liquids_) {
+    Region region;
+    foreach (const BlockPosition& position, changed) {
+      addBody(liquid, position, &region);
+      for (int i = 0; i < kNeighborCount; ++i) {
+        addBody(liquid, position + kNeighbors[i], &region);
+      }
+    }
+    changed_count += solve(liquid, &region, transaction);
+  }
+  return changed_count;
+}
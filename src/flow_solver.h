@@ -0,0 +1,122 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_SOLVER_H
+#define FLOW_SOLVER_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+
+#include "block_instance.h"
+#include "block_position.h"
+
+class BlockManager;
+class BlockPrototype;
+class BlockTransaction;
+class Diagram;
+
+/**
+  * Works out where water and lava flow from their source blocks, and at which of the "N blocks from source"
+  * orientations each flow block should be, following Minecraft's spreading rules:
+  *
+  *   * Liquid that has air (or flowing liquid of its own kind) below it falls straight down, and does not spread
+  *     sideways.  A falling column is as strong as a source: where it lands, it spreads from there afresh.
+  *   * Otherwise it spreads to the four horizontal neighbours, one block further from the source each time, until it
+  *     reaches the last flow orientation (seven blocks for water, three for lava).  Flowing liquid that rests on a
+  *     source of its own kind does not spread.
+  *   * Every flow block takes the shortest distance over all of the sources that reach it.
+  *
+  * Unlike Minecraft, flows spread evenly in every direction instead of only towards the nearest drop, and water and
+  * lava pass each other by.  Nothing falls below \p floor_level, which is treated as the bottom of the world.
+  *
+  * Because falling resets the distance, this is a label-correcting breadth-first search over a bucket queue rather
+  * than a plain one, but each block is still only revisited when its distance improves.
+  *
+  * Only the bodies of liquid (connected groups of source and flow blocks) that need it are solved again: solveAround()
+  * starts from the blocks around a change, gathers the bodies they touch, and pulls in any other body that the new
+  * flow runs into, so the cost of an edit depends on the size of the liquid it touches and not of the whole diagram.
+  */
+class FlowSolver {
+ public:
+  /**
+    * Creates a FlowSolver for the blocks in \p blocks, which must not change while the solver is in use.  If
+    * \p placements is given, the blocks of the prefabs placed in it are walls that liquid doesn't flow into.  Placed
+    * liquid isn't a source either, since the solver can't change placed blocks.
+    */
+  FlowSolver(const QHash<BlockPosition, BlockInstance>* blocks, BlockManager* block_mgr, int floor_level,
+             const Diagram* placements = NULL);
+
+  /**
+    * Records in \p transaction the changes needed to bring every body of liquid in the diagram up to date.
+    * @return The number of blocks changed.
+    */
+  int solveAll(BlockTransaction* transaction);
+
+  /**
+    * Records in \p transaction the changes needed to bring up to date the bodies of liquid at or next to any of
+    * \p changed, which should be the positions that the last edit touched.
+    * @return The number of blocks changed.
+    */
+  int solveAround(const QList<BlockPosition>& changed, BlockTransaction* transaction);
+
+ private:
+  /**
+    * The blocks of one kind of liquid.
+    */
+  struct Liquid {
+    BlockPrototype* source;
+    BlockPrototype* flow;
+    int max_distance;
+  };
+
+  /**
+    * A set of bodies of one liquid that are being solved again.
+    */
+  struct Region {
+    QSet<BlockPosition> blocks;
+    QList<BlockPosition> sources;
+  };
+
+  bool isLiquid(const Liquid& liquid, const BlockPosition& position) const;
+  bool isSource(const Liquid& liquid, const BlockPosition& position) const;
+  bool isFlow(const Liquid& liquid, const BlockPosition& position) const;
+  bool canFlowInto(const Liquid& liquid, const BlockPosition& position) const;
+
+  /**
+    * Adds the body of \p liquid that contains \p start to \p region.
+    */
+  void addBody(const Liquid& liquid, const BlockPosition& start, Region* region) const;
+
+  /**
+    * Spreads \p liquid from the sources in \p region, filling \p distances.  Existing flow blocks that the new flow
+    * reaches but that are not yet in \p region are added to \p outside.
+    */
+  void spread(const Liquid& liquid, const Region& region, QHash<BlockPosition, int>* distances,
+              QList<BlockPosition>* outside) const;
+
+  /**
+    * Solves \p region again, adding bodies as the flow runs into them, and records the differences.
+    */
+  int solve(const Liquid& liquid, Region* region, BlockTransaction* transaction);
+
+  const QHash<BlockPosition, BlockInstance>* blocks_;
+  const Diagram* placements_;
+  BlockManager* block_mgr_;
+  int floor_level_;
+  QList<Liquid> liquids_;
+};
+
+#endif // FLOW_SOLVER_H
@@ -0,0 +1,199 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "generate_terrain_dialog.h"
+
+#include <QFileDialog>
+#include <QTime>
+#include <QtGui/QApplication>
+
+#include "block_manager.h"
+#include "block_position.h"
+#include "block_prototype.h"
+#include "diagram.h"
+#include "terrain_generator.h"
+
+namespace {
+
+const blocktype_t kDefaultSurfaceType = 2;     // Grass
+const blocktype_t kDefaultSubsurfaceType = 3;  // Dirt
+const blocktype_t kDefaultBaseType = 1;        // Stone
+
+}  // namespace
+
+GenerateTerrainDialog::GenerateTerrainDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent)
+    : QDialog(parent), diagram_(diagram), block_mgr_(block_mgr), is_dirty_(true) {
+  ui.setupUi(this);
+  ui.status_label_->setAttribute(Qt::WA_MacSmallSize, true);
+
+  populateBlockTypeCombo(ui.surface_combo_, kDefaultSurfaceType);
+  populateBlockTypeCombo(ui.subsurface_combo_, kDefaultSubsurfaceType);
+  populateBlockTypeCombo(ui.base_combo_, kDefaultBaseType);
+
+  connect(ui.preview_button_, SIGNAL(clicked()), SLOT(preview()));
+  connect(ui.browse_button_, SIGNAL(clicked()), SLOT(browseForHeightmap()));
+  connect(ui.image_radio_, SIGNAL(toggled(bool)), SLOT(updateSource()));
+  connect(ui.pixels_per_block_spin_, SIGNAL(valueChanged(int)), SLOT(updateHeightmapArea()));
+  connect(ui.min_x_spin_, SIGNAL(valueChanged(int)), SLOT(updateHeightmapArea()));
+  connect(ui.min_z_spin_, SIGNAL(valueChanged(int)), SLOT(updateHeightmapArea()));
+  connect(ui.caves_check_, SIGNAL(toggled(bool)), SLOT(markDirty()));
+  connect(ui.caves_check_, SIGNAL(toggled(bool)), SLOT(updateSource()));
+  QList<QComboBox*> combo_boxes;
+  combo_boxes << ui.surface_combo_ << ui.subsurface_combo_ << ui.base_combo_;
+  foreach (QComboBox* combo_box, combo_boxes) {
+    connect(combo_box, SIGNAL(currentIndexChanged(int)), SLOT(markDirty()));
+  }
+  QList<QSpinBox*> spin_boxes;
+  spin_boxes << ui.min_x_spin_ << ui.min_z_spin_ << ui.max_x_spin_ << ui.max_z_spin_
+             << ui.seed_spin_ << ui.bottom_spin_ << ui.height_spin_ << ui.variation_spin_
+             << ui.feature_size_spin_ << ui.octaves_spin_ << ui.subsurface_depth_spin_
+             << ui.pixels_per_block_spin_;
+  foreach (QSpinBox* spin_box, spin_boxes) {
+    connect(spin_box, SIGNAL(valueChanged(int)), SLOT(markDirty()));
+  }
+  updateSource();
+}
+
+void GenerateTerrainDialog::populateBlockTypeCombo(QComboBox* combo, blocktype_t default_type) {
+  BlockTypeIterator iter = BlockPrototype::blockIterator();
+  while (iter.hasNext()) {
+    BlockPrototype* prototype = block_mgr_->getPrototype(iter.next());
+    combo->addItem(QIcon(prototype->sprite()), prototype->name(), prototype->type());
+  }
+  combo->setCurrentIndex(qMax(combo->findData(default_type), 0));
+}
+
+BlockPrototype* GenerateTerrainDialog::selectedPrototype(QComboBox* combo) const {
+  return block_mgr_->getPrototype(combo->itemData(combo->currentIndex()).toInt());
+}
+
+void GenerateTerrainDialog::setLevel(int level) {
+  ui.height_spin_->setValue(level);
+  ui.bottom_spin_->setValue(level - 2 * ui.variation_spin_->value());
+}
+
+void GenerateTerrainDialog::markDirty() {
+  is_dirty_ = true;
+}
+
+void GenerateTerrainDialog::browseForHeightmap() {
+  QString filename = QFileDialog::getOpenFileName(this, "Import Heightmap", QString(),
+                                                  "Heightmaps (*.png *.jpg *.bmp *.tif *.raw *.r16)");
+  if (filename.isEmpty()) {
+    return;
+  }
+
+  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  QString error;
+  bool loaded = heightmap_.load(filename, &error);
+  QApplication::restoreOverrideCursor();
+  if (!loaded) {
+    ui.status_label_->setText(error);
+    ui.image_path_edit_->clear();
+    return;
+  }
+
+  ui.image_path_edit_->setText(filename);
+  ui.status_label_->setText(QString("Heightmap is %1 x %2 pixels.").arg(heightmap_.width()).arg(heightmap_.depth()));
+  ui.image_radio_->setChecked(true);
+  updateHeightmapArea();
+  markDirty();
+}
+
+void GenerateTerrainDialog::updateSource() {
+  bool from_image = ui.image_radio_->isChecked();
+  ui.seed_spin_->setEnabled(!from_image || ui.caves_check_->isChecked());
+  ui.feature_size_spin_->setEnabled(!from_image);
+  ui.octaves_spin_->setEnabled(!from_image);
+  ui.pixels_per_block_spin_->setEnabled(from_image);
+  ui.max_x_spin_->setEnabled(!from_image);
+  ui.max_z_spin_->setEnabled(!from_image);
+  updateHeightmapArea();
+  markDirty();
+}
+
+void GenerateTerrainDialog::updateHeightmapArea() {
+  if (!ui.image_radio_->isChecked() || !heightmap_.isLoaded()) {
+    return;
+  }
+  // One column per square of pixels, rounding up so that the edge of the heightmap is never lost.
+  int pixels_per_block = ui.pixels_per_block_spin_->value();
+  int width = (heightmap_.width() + pixels_per_block - 1) / pixels_per_block;
+  int depth = (heightmap_.depth() + pixels_per_block - 1) / pixels_per_block;
+  ui.max_x_spin_->setValue(ui.min_x_spin_->value() + width - 1);
+  ui.max_z_spin_->setValue(ui.min_z_spin_->value() + depth - 1);
+}
+
+bool GenerateTerrainDialog::generate() {
+  if (!is_dirty_) {
+    return true;
+  }
+
+  NoiseHeightField noise_heights(ui.seed_spin_->value(), ui.height_spin_->value(), ui.variation_spin_->value(),
+                                 ui.feature_size_spin_->value(), ui.octaves_spin_->value());
+  const HeightField* heights = &noise_heights;
+  if (ui.image_radio_->isChecked()) {
+    if (!heightmap_.isLoaded()) {
+      ui.status_label_->setText("Choose a heightmap first.");
+      return false;
+    }
+    heightmap_.setPlacement(BlockPosition(ui.min_x_spin_->value(), 0, ui.min_z_spin_->value()),
+                            ui.pixels_per_block_spin_->value(),
+                            ui.height_spin_->value() - ui.variation_spin_->value(),
+                            ui.height_spin_->value() + ui.variation_spin_->value());
+    heights = &heightmap_;
+  }
+  TerrainGenerator::Layers layers;
+  layers.surface = selectedPrototype(ui.surface_combo_);
+  layers.subsurface = selectedPrototype(ui.subsurface_combo_);
+  layers.base = selectedPrototype(ui.base_combo_);
+  layers.subsurface_depth = ui.subsurface_depth_spin_->value();
+  BlockPosition min_corner(ui.min_x_spin_->value(), ui.bottom_spin_->value(), ui.min_z_spin_->value());
+  BlockPosition max_corner(ui.max_x_spin_->value(), ui.height_spin_->value() + ui.variation_spin_->value(),
+                           ui.max_z_spin_->value());
+  TerrainGenerator generator(heights, layers, min_corner, max_corner);
+  if (ui.caves_check_->isChecked()) {
+    generator.enableCaves(ui.seed_spin_->value());
+  }
+
+  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  QTime timer;
+  timer.start();
+  transaction_ = BlockTransaction();
+  int changed = generator.generate(diagram_, &transaction_);
+  QApplication::restoreOverrideCursor();
+
+  ui.status_label_->setText(QString("%1 blocks changed in %2 ms.").arg(changed).arg(timer.elapsed()));
+  is_dirty_ = false;
+  return true;
+}
+
+void GenerateTerrainDialog::preview() {
+  if (generate()) {
+    diagram_->commitEphemeral(transaction_);
+  }
+}
+
+void GenerateTerrainDialog::accept() {
+  if (generate()) {
+    QDialog::accept();
+  }
+}
+
+void GenerateTerrainDialog::reject() {
+  // Take down the preview, if there is one.
+  diagram_->commitEphemeral(BlockTransaction());
+  QDialog::reject();
+}
@@ -0,0 +1,93 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GENERATE_TERRAIN_DIALOG_H
+#define GENERATE_TERRAIN_DIALOG_H
+
+#include "ui_generate_terrain_dialog.h"
+
+#include "block_transaction.h"
+#include "image_height_field.h"
+
+class BlockManager;
+class BlockPrototype;
+class Diagram;
+
+/**
+  * Dialog that fills an area with layered blocks using a TerrainGenerator.  The heights come either from seeded noise
+  * or from a heightmap file, in which case the height range maps black to the lowest height and white to the highest.
+  *
+  * Pressing Preview shows the result as ephemeral blocks.  When the dialog is accepted, transaction() returns the
+  * changes to make; the dialog never commits them itself, so that the caller can put them on the undo stack.
+  */
+class GenerateTerrainDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit GenerateTerrainDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent = NULL);
+
+  /**
+    * Sets the average height of the terrain to \p level, and puts the bottom of the terrain a little way below it.
+    */
+  void setLevel(int level);
+
+  /**
+    * Returns the transaction produced by the last generation.
+    */
+  const BlockTransaction& transaction() const {
+    return transaction_;
+  }
+
+ public slots:
+  virtual void accept();
+  virtual void reject();
+
+  /**
+    * Asks the user for a heightmap file and, if one is loaded successfully, switches to building terrain from it.
+    */
+  void browseForHeightmap();
+
+ private slots:
+  void preview();
+  void markDirty();
+  void updateSource();
+  void updateHeightmapArea();
+
+ private:
+  /**
+    * Regenerates transaction_ if anything has changed since the last time.
+    * @return \c false if there is nothing to generate from.
+    */
+  bool generate();
+
+  /**
+    * Fills \p combo with every block type and selects \p default_type.
+    */
+  void populateBlockTypeCombo(QComboBox* combo, blocktype_t default_type);
+
+  /**
+    * Returns the prototype selected in \p combo.
+    */
+  BlockPrototype* selectedPrototype(QComboBox* combo) const;
+
+  Ui::GenerateTerrainDialog ui;
+  Diagram* diagram_;
+  BlockManager* block_mgr_;
+  BlockTransaction transaction_;
+  ImageHeightField heightmap_;
+  bool is_dirty_;
+};
+
+#endif // GENERATE_TERRAIN_DIALOG_H
@@ -0,0 +1,151 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "generate_volume_dialog.h"
+
+#include <QTime>
+#include <QtGui/QApplication>
+
+#include "block_manager.h"
+#include "block_prototype.h"
+#include "diagram.h"
+#include "expression.h"
+#include "occupancy_mask.h"
+#include "volume_generator.h"
+
+GenerateVolumeDialog::GenerateVolumeDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent)
+    : QDialog(parent), diagram_(diagram), block_mgr_(block_mgr), is_dirty_(true) {
+  ui.setupUi(this);
+  ui.status_label_->setAttribute(Qt::WA_MacSmallSize, true);
+
+  ui.operation_combo_->addItem("Add blocks", kUnion);
+  ui.operation_combo_->addItem("Carve out", kSubtract);
+  ui.operation_combo_->addItem("Keep only inside", kIntersect);
+
+  BlockTypeIterator iter = BlockPrototype::blockIterator();
+  while (iter.hasNext()) {
+    BlockPrototype* prototype = block_mgr->getPrototype(iter.next());
+    ui.block_type_combo_->addItem(QIcon(prototype->sprite()), prototype->name(), prototype->type());
+  }
+  ui.block_type_combo_->setCurrentIndex(0);
+
+  connect(ui.preview_button_, SIGNAL(clicked()), SLOT(preview()));
+  connect(ui.expression_edit_, SIGNAL(textChanged()), SLOT(markDirty()));
+  connect(ui.block_type_combo_, SIGNAL(currentIndexChanged(int)), SLOT(markDirty()));
+  connect(ui.operation_combo_, SIGNAL(currentIndexChanged(int)), SLOT(markDirty()));
+  connect(ui.operation_combo_, SIGNAL(currentIndexChanged(int)), SLOT(updateBlockTypeCombo()));
+  QList<QSpinBox*> spin_boxes;
+  spin_boxes << ui.origin_x_spin_ << ui.origin_y_spin_ << ui.origin_z_spin_
+             << ui.min_x_spin_ << ui.min_y_spin_ << ui.min_z_spin_
+             << ui.max_x_spin_ << ui.max_y_spin_ << ui.max_z_spin_;
+  foreach (QSpinBox* spin_box, spin_boxes) {
+    connect(spin_box, SIGNAL(valueChanged(int)), SLOT(markDirty()));
+  }
+}
+
+void GenerateVolumeDialog::setOrigin(const BlockPosition& origin) {
+  ui.origin_x_spin_->setValue(origin.x());
+  ui.origin_y_spin_->setValue(origin.y());
+  ui.origin_z_spin_->setValue(origin.z());
+}
+
+void GenerateVolumeDialog::markDirty() {
+  is_dirty_ = true;
+}
+
+void GenerateVolumeDialog::updateBlockTypeCombo() {
+  int operation = ui.operation_combo_->itemData(ui.operation_combo_->currentIndex()).toInt();
+  ui.block_type_combo_->setEnabled(operation == kUnion);
+}
+
+bool GenerateVolumeDialog::generate() {
+  if (!is_dirty_) {
+    return true;
+  }
+
+  Expression expression;
+  QString error;
+  if (!expression.compile(ui.expression_edit_->toPlainText(), &error)) {
+    ui.status_label_->setText(error);
+    return false;
+  }
+
+  BlockPosition origin(ui.origin_x_spin_->value(), ui.origin_y_spin_->value(), ui.origin_z_spin_->value());
+  BlockPosition min_corner = origin + BlockPosition(ui.min_x_spin_->value(), ui.min_y_spin_->value(),
+                                                    ui.min_z_spin_->value());
+  BlockPosition max_corner = origin + BlockPosition(ui.max_x_spin_->value(), ui.max_y_spin_->value(),
+                                                    ui.max_z_spin_->value());
+  VolumeGenerator generator(expression, origin, min_corner, max_corner);
+
+  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  QTime timer;
+  timer.start();
+  OccupancyMask volume;
+  MaskRunVisitor visitor(&volume);
+  generator.generate(&visitor);
+
+  // Work out exactly which blocks change with whole-word mask operations, so that only those blocks are ever looked
+  // up in the diagram or recorded in the transaction.
+  transaction_ = BlockTransaction();
+  int changed = 0;
+  int min_level = qMin(min_corner.y(), max_corner.y());
+  int max_level = qMax(min_corner.y(), max_corner.y());
+  switch (ui.operation_combo_->itemData(ui.operation_combo_->currentIndex()).toInt()) {
+    case kUnion: {
+      volume.subtract(diagram_->occupancyMask(min_level, max_level));
+      blocktype_t type = ui.block_type_combo_->itemData(ui.block_type_combo_->currentIndex()).toInt();
+      BlockPrototype* prototype = block_mgr_->getPrototype(type);
+      diagram_->fillMasked(volume, prototype, prototype->defaultOrientation(), &transaction_);
+      changed = transaction_.new_blocks().size();
+      break;
+    }
+
+    case kSubtract:
+      volume.intersect(diagram_->occupancyMask(min_level, max_level));
+      changed = diagram_->clearMasked(volume, &transaction_);
+      break;
+
+    case kIntersect: {
+      OccupancyMask outside = diagram_->occupancyMask();
+      outside.subtract(volume);
+      changed = diagram_->clearMasked(outside, &transaction_);
+      break;
+    }
+  }
+  QApplication::restoreOverrideCursor();
+
+  ui.status_label_->setText(QString("%1 blocks changed in %2 ms (the volume covers %3 blocks).")
+                            .arg(changed).arg(timer.elapsed()).arg(generator.cellCount()));
+  is_dirty_ = false;
+  return true;
+}
+
+void GenerateVolumeDialog::preview() {
+  if (generate()) {
+    diagram_->commitEphemeral(transaction_);
+  }
+}
+
+void GenerateVolumeDialog::accept() {
+  if (generate()) {
+    QDialog::accept();
+  }
+}
+
+void GenerateVolumeDialog::reject() {
+  // Take down the preview, if there is one.
+  diagram_->commitEphemeral(BlockTransaction());
+  QDialog::reject();
+}
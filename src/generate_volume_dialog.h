@@ -0,0 +1,81 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GENERATE_VOLUME_DIALOG_H
+#define GENERATE_VOLUME_DIALOG_H
+
+#include "ui_generate_volume_dialog.h"
+
+#include "block_position.h"
+#include "block_transaction.h"
+
+class BlockManager;
+class Diagram;
+
+/**
+  * Dialog that combines the diagram with the volume of a box in which an Expression typed by the user is true.  The
+  * volume can be added to the diagram, carved out of it, or used to trim away everything outside it.
+  *
+  * Pressing Preview shows the result as ephemeral blocks.  When the dialog is accepted, transaction() returns the
+  * changes to make; the dialog never commits them itself, so that the caller can put them on the undo stack.
+  */
+class GenerateVolumeDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  enum Operation {
+    kUnion,      // Fill the empty blocks inside the volume.
+    kSubtract,   // Remove the blocks inside the volume.
+    kIntersect   // Remove the blocks outside the volume, on every level.
+  };
+
+  explicit GenerateVolumeDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent = NULL);
+
+  /**
+    * Sets the position that the expression sees as x = y = z = 0.
+    */
+  void setOrigin(const BlockPosition& origin);
+
+  /**
+    * Returns the transaction produced by the last successful generation.
+    */
+  const BlockTransaction& transaction() const {
+    return transaction_;
+  }
+
+ public slots:
+  virtual void accept();
+  virtual void reject();
+
+ private slots:
+  void preview();
+  void markDirty();
+  void updateBlockTypeCombo();
+
+ private:
+  /**
+    * Compiles the expression and regenerates transaction_ if anything has changed since the last time.
+    * @return \c false if the expression could not be compiled.
+    */
+  bool generate();
+
+  Ui::GenerateVolumeDialog ui;
+  Diagram* diagram_;
+  BlockManager* block_mgr_;
+  BlockTransaction transaction_;
+  bool is_dirty_;
+};
+
+#endif // GENERATE_VOLUME_DIALOG_H
@@ -15,14 +15,33 @@
 
 #include "gl_preview_window.h"
 
+#include <QSettings>
+
+#include "application.h"
 #include "gl_widget.h"
+#include "render_quality.h"
 
 GLPreviewWindow::GLPreviewWindow(QWidget* parent)
     : QMainWindow(parent) {
   ui.setupUi(this);
 
+  ui.quality_combo_box_->setAttribute(Qt::WA_MacSmallSize);
+  ui.adaptive_resolution_check_box_->setAttribute(Qt::WA_MacSmallSize);
   ui.frame_rate_check_box_->setAttribute(Qt::WA_MacSmallSize);
+  ui.status_bar_->addPermanentWidget(ui.quality_combo_box_);
+  ui.status_bar_->addPermanentWidget(ui.adaptive_resolution_check_box_);
   ui.status_bar_->addPermanentWidget(ui.frame_rate_check_box_);
+
+  // Setting a widget to the value it already has doesn't signal the GLWidget, so tell it directly as well.
+  QSettings* settings = Application::instance()->settings();
+  int preset = RenderQuality::savedPreset();
+  bool adaptive_resolution = settings->value("AdaptiveResolution", false).toBool();
+  ui.quality_combo_box_->setCurrentIndex(preset);
+  ui.adaptive_resolution_check_box_->setChecked(adaptive_resolution);
+  ui.gl_widget_->setQualityPreset(preset);
+  ui.gl_widget_->enableAdaptiveResolution(adaptive_resolution);
+  connect(ui.quality_combo_box_, SIGNAL(currentIndexChanged(int)), SLOT(saveRenderSettings()));
+  connect(ui.adaptive_resolution_check_box_, SIGNAL(toggled(bool)), SLOT(saveRenderSettings()));
 }
 
 void GLPreviewWindow::setDiagram(Diagram* diagram) {
@@ -36,3 +55,9 @@ void GLPreviewWindow::setBlockManager(BlockManager* block_mgr) {
 GLWidget* GLPreviewWindow::glWidget() const {
   return ui.gl_widget_;
 }
+
+void GLPreviewWindow::saveRenderSettings() {
+  QSettings* settings = Application::instance()->settings();
+  RenderQuality::savePreset(static_cast<RenderQuality::Preset>(ui.quality_combo_box_->currentIndex()));
+  settings->setValue("AdaptiveResolution", ui.adaptive_resolution_check_box_->isChecked());
+}
@@ -34,6 +34,12 @@ class GLPreviewWindow : public QMainWindow {
 
   GLWidget* glWidget() const;
 
+ private slots:
+  /**
+    * Remembers the render quality settings chosen in the status bar for the next time the application runs.
+    */
+  void saveRenderSettings();
+
  private:
   Ui::GLPreviewWindow ui;
 };
@@ -23,6 +23,7 @@
 #include "block_manager.h"
 #include "diagram.h"
 #include "matrix.h"
+#include "occupancy_mask.h"
 #include "skybox_renderable.h"
 #include "texture.h"
 
@@ -36,13 +37,69 @@
 
 #define DEG_TO_RAD(x) ((x) * M_PI / 180.0f)
 
+namespace {
+
+/** How far the highlight boxes stand off the faces of the blocks they cover, so they aren't hidden by them. */
+const float kHighlightMargin = 0.02f;
+
+/** The time, in milliseconds, adaptive resolution tries to draw each frame in. */
+const float kTargetFrameTime = 1000.0f / 30.0f;
+
+/** How much of each new frame time goes into the average that adaptive resolution goes by. */
+const float kFrameTimeSmoothing = 0.1f;
+
+/** How far adaptive resolution lowers or raises the resolution scale at a time, and how far it lowers it at most. */
+const float kResolutionScaleStep = 0.05f;
+const float kMinResolutionScale = 0.5f;
+
+/**
+  * Draws a translucent box around every run of highlighted blocks.
+  */
+class HighlightRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  virtual void visitRun(int x_begin, int x_end, int y, int z) {
+    GLfloat x0 = x_begin - kHighlightMargin;
+    GLfloat x1 = x_end + kHighlightMargin;
+    GLfloat y0 = y - kHighlightMargin;
+    GLfloat y1 = y + 1 + kHighlightMargin;
+    GLfloat z0 = z - kHighlightMargin;
+    GLfloat z1 = z + 1 + kHighlightMargin;
+    glVertex3f(x0, y0, z0); glVertex3f(x1, y0, z0); glVertex3f(x1, y1, z0); glVertex3f(x0, y1, z0);
+    glVertex3f(x0, y0, z1); glVertex3f(x0, y1, z1); glVertex3f(x1, y1, z1); glVertex3f(x1, y0, z1);
+    glVertex3f(x0, y0, z0); glVertex3f(x0, y1, z0); glVertex3f(x0, y1, z1); glVertex3f(x0, y0, z1);
+    glVertex3f(x1, y0, z0); glVertex3f(x1, y0, z1); glVertex3f(x1, y1, z1); glVertex3f(x1, y1, z0);
+    glVertex3f(x0, y0, z0); glVertex3f(x0, y0, z1); glVertex3f(x1, y0, z1); glVertex3f(x1, y0, z0);
+    glVertex3f(x0, y1, z0); glVertex3f(x1, y1, z0); glVertex3f(x1, y1, z1); glVertex3f(x0, y1, z1);
+  }
+};
+
+/**
+  * Returns the format a new GLWidget asks for.  Sample buffers are only requested when the saved quality preset
+  * multisamples, so that a preview opened at low quality doesn't pay for a multisampled framebuffer it never uses.
+  */
+QGLFormat initialFormat() {
+  QGLFormat format;
+  format.setSampleBuffers(RenderQuality::preset(RenderQuality::savedPreset()).multisampling);
+  return format;
+}
+
+}  // namespace
+
+QGLWidget* GLWidget::s_shared_context_widget_ = NULL;
+
 GLWidget::GLWidget(QWidget* parent)
-    : QGLWidget(QGLFormat(QGL::SampleBuffers), parent),
+    : QGLWidget(initialFormat(), parent, s_shared_context_widget_),
       diagram_(NULL),
       block_mgr_(NULL),
       frame_rate_enabled_(false),
       frame_rate_(-1.0f),
-      scene_dirty_(true) {
+      quality_(RenderQuality::preset(RenderQuality::kHighQuality)),
+      quality_dirty_(true),
+      adaptive_resolution_enabled_(false),
+      resolution_scale_(1.0f),
+      average_frame_time_(kTargetFrameTime),
+      scene_dirty_(true),
+      prefabs_dirty_(true) {
   setFocusPolicy(Qt::WheelFocus);
   QGLFormat f = format();
   f.setSwapInterval(1);
@@ -54,16 +111,42 @@ GLWidget::GLWidget(QWidget* parent)
 }
 
 GLWidget::~GLWidget() {
+  makeCurrent();
+  foreach (GLuint display_list, prefab_display_lists_) {
+    glDeleteLists(display_list, 1);
+  }
+  scene_geometry_.releaseBuffers();
+  scaled_frame_.reset();
 }
 
 void GLWidget::setDiagram(Diagram* diagram) {
   diagram_ = diagram;
-  connect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), SLOT(setSceneDirty()));
-  connect(diagram_, SIGNAL(ephemeralBlocksChanged(BlockTransaction)), SLOT(setSceneDirty()));
+  scene_geometry_.setDiagram(diagram);
+  connect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), SLOT(setBlocksDirty(BlockTransaction)));
+  connect(diagram_, SIGNAL(ephemeralBlocksChanged(BlockTransaction)), SLOT(setEphemeralBlocksDirty(BlockTransaction)));
+  connect(diagram_, SIGNAL(simulatedBlocksChanged(BlockTransaction)), SLOT(setBlocksDirty(BlockTransaction)));
+  connect(diagram_, SIGNAL(highlightedBlocksChanged()), SLOT(setSceneDirty()));
+  connect(diagram_, SIGNAL(prefabsChanged()), SLOT(setPrefabsDirty()));
+}
+
+// Static.
+void GLWidget::setSharedContextWidget(QGLWidget* widget) {
+  s_shared_context_widget_ = widget;
 }
 
 void GLWidget::setBlockManager(BlockManager* block_mgr) {
   block_mgr_ = block_mgr;
+  scene_geometry_.setBlockManager(block_mgr);
+}
+
+bool GLWidget::loadGeometryCache(const QString& path) {
+  return scene_geometry_.load(path);
+}
+
+bool GLWidget::saveGeometryCache(const QString& path) {
+  makeCurrent();
+  scene_geometry_.update();
+  return scene_geometry_.save(path);
 }
 
 QSize GLWidget::minimumSizeHint() const {
@@ -81,6 +164,45 @@ void GLWidget::setSceneDirty(bool dirty) {
   }
 }
 
+void GLWidget::setPrefabsDirty() {
+  prefabs_dirty_ = true;
+  // Placed prefabs hide the faces of the diagram's blocks next to them.
+  scene_geometry_.invalidateAll();
+  setSceneDirty();
+}
+
+void GLWidget::setBlocksDirty(const BlockTransaction& transaction) {
+  scene_geometry_.invalidate(transaction);
+  // Not updateGL(): a commit sends several signals, and the geometry should only be rebuilt once for all of them.
+  update();
+}
+
+void GLWidget::setEphemeralBlocksDirty(const BlockTransaction& transaction) {
+  scene_geometry_.invalidateEphemeral(transaction);
+  update();
+}
+
+void GLWidget::setQualityPreset(int preset) {
+  quality_ = RenderQuality::preset(static_cast<RenderQuality::Preset>(preset));
+  // The GL state is only set in paintGL(), since the context may not exist yet.
+  quality_dirty_ = true;
+  update();
+}
+
+void GLWidget::enableAdaptiveResolution(bool enable) {
+  if (enable == adaptive_resolution_enabled_) {
+    return;
+  }
+  adaptive_resolution_enabled_ = enable;
+  resolution_scale_ = 1.0f;
+  average_frame_time_ = kTargetFrameTime;
+  if (!enable) {
+    makeCurrent();
+    scaled_frame_.reset();
+  }
+  update();
+}
+
 void GLWidget::initializeGL() {
   qglClearColor(QColor(128, 192, 255));
 
@@ -91,9 +213,6 @@ void GLWidget::initializeGL() {
   glEnable(GL_TEXTURE_2D);
   glShadeModel(GL_SMOOTH);
 
-  glEnable(GL_MULTISAMPLE_ARB);
-  glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE_ARB);
-
   glAlphaFunc(GL_GREATER, 0.01);
   glEnable(GL_ALPHA_TEST);
 
@@ -104,8 +223,8 @@ void GLWidget::initializeGL() {
   glFogf(GL_FOG_MODE, GL_LINEAR);
   static GLfloat fog_color[] = { 0.5f, 0.75f, 1.0f, 1.0f };
   glFogfv(GL_FOG_COLOR, fog_color);
-  glFogf(GL_FOG_START, 50);
-  glFogf(GL_FOG_END, 100);
+  // Multisampling and the fog distance are set by applyQuality().
+  quality_dirty_ = true;
 
   GLfloat global_ambient[] = { 0.0f, 0.0f, 0.0f, 1.0f };
   glLightModelfv(GL_LIGHT_MODEL_AMBIENT, global_ambient);
@@ -129,7 +248,6 @@ void GLWidget::initializeGL() {
   glEndList();
 
   skybox_.reset(new SkyboxRenderable(QVector3D(10.0f, 10.0f, 10.0f)));
-  skybox_->initialize();
   Texture skybox_up = Texture(this, ":/skybox_up.png");
   Texture skybox_out = Texture(this, ":/skybox_east.png");
   Texture skybox_down = Texture(this, ":/skybox_down.png");
@@ -139,6 +257,7 @@ void GLWidget::initializeGL() {
   skybox_->setTexture(kBackFace, skybox_out);
   skybox_->setTexture(kTopFace, skybox_up);
   skybox_->setTexture(kBottomFace, skybox_down);
+  skybox_->initialize();
 
   camera_.translate(QVector3D(0.5, 1, 5));
 }
@@ -152,17 +271,38 @@ void GLWidget::drawSkybox() {
   glDisable(GL_FOG);
   glDisable(GL_DEPTH_TEST);
   glDisable(GL_CULL_FACE);
-  skybox_->renderAt(QVector3D(0, 0, 0), BlockOrientation::noOrientation());
+  skybox_->renderAt(QVector3D(0, 0, 0), BlockOrientation::noOrientation(), NULL);
   glPopAttrib();
   glPopMatrix();
 }
 
+void GLWidget::updatePrefabs() {
+  foreach (GLuint display_list, prefab_display_lists_) {
+    glDeleteLists(display_list, 1);
+  }
+  prefab_display_lists_.clear();
+  // Each prefab is built once, here, however many times it's placed.  This has to happen before the scene's display
+  // list is started, since display lists can call each other but can't be compiled inside each other.
+  for (int i = 0; i < diagram_->prefabs().size(); ++i) {
+    GLuint display_list = glGenLists(1);
+    glNewList(display_list, GL_COMPILE);
+    diagram_->renderPrefab(i);
+    glEndList();
+    prefab_display_lists_.append(display_list);
+  }
+}
+
 void GLWidget::updateScene() {
   if (!diagram_) {
     return;
   }
 
-  glNewList(scene_display_list_, GL_COMPILE_AND_EXECUTE);
+  if (prefabs_dirty_) {
+    updatePrefabs();
+    prefabs_dirty_ = false;
+  }
+
+  glNewList(scene_display_list_, GL_COMPILE);
   // Draw the ground plane.
   glPushAttrib(GL_LIGHTING_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT);
   glDisable(GL_CULL_FACE);
@@ -181,13 +321,132 @@ void GLWidget::updateScene() {
   glPopMatrix();
   glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
   glPopAttrib();
+  glEndList();
 
-  diagram_->render();
-
+  glNewList(scene_display_list_ + 1, GL_COMPILE);
+  drawPlacedPrefabs();
+  drawHighlightedBlocks();
   glEndList();
 }
 
+void GLWidget::drawPlacedPrefabs() {
+  foreach (const PrefabPlacement& placement, diagram_->placements()) {
+    QVector3D translation = diagram_->prefabs().at(placement.prefab).placementTranslation(placement);
+    glPushMatrix();
+    glTranslatef(translation.x(), translation.y(), translation.z());
+    glRotatef(90.0f * placement.rotation, 0.0f, 1.0f, 0.0f);
+    glCallList(prefab_display_lists_.at(placement.prefab));
+    glPopMatrix();
+  }
+}
+
+void GLWidget::drawHighlightedBlocks() {
+  const QList<BlockHighlight>& highlights = diagram_->highlights();
+  if (highlights.isEmpty()) {
+    return;
+  }
+  glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_TEXTURE_2D);
+  glDisable(GL_CULL_FACE);
+  glDepthMask(GL_FALSE);
+  foreach (const BlockHighlight& highlight, highlights) {
+    glColor4f(highlight.color.redF(), highlight.color.greenF(), highlight.color.blueF(), 0.4f);
+    glBegin(GL_QUADS);
+    HighlightRunVisitor visitor;
+    highlight.blocks.visitRuns(&visitor);
+    glEnd();
+  }
+  glPopAttrib();
+}
+
+void GLWidget::applyQuality() {
+  if (quality_.multisampling) {
+    glEnable(GL_MULTISAMPLE_ARB);
+  } else {
+    glDisable(GL_MULTISAMPLE_ARB);
+  }
+  if (quality_.alpha_to_coverage) {
+    glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE_ARB);
+  } else {
+    glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE_ARB);
+  }
+  glFogf(GL_FOG_START, quality_.draw_distance / 2);
+  glFogf(GL_FOG_END, quality_.draw_distance);
+  applyProjection(width(), height());
+}
+
+void GLWidget::bindScaledFrame() {
+  QSize size(qMax(1, qRound(width() * resolution_scale_)), qMax(1, qRound(height() * resolution_scale_)));
+  if (!scaled_frame_ || scaled_frame_->size() != size) {
+    scaled_frame_.reset(new QGLFramebufferObject(size, QGLFramebufferObject::Depth));
+  }
+  scaled_frame_->bind();
+  glViewport(0, 0, size.width(), size.height());
+}
+
+void GLWidget::drawScaledFrame() {
+  glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_FOG);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_BLEND);
+  glDisable(GL_ALPHA_TEST);
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, scaled_frame_->texture());
+  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+  glBegin(GL_QUADS);
+  glTexCoord2f(0, 0); glVertex2f(-1, -1);
+  glTexCoord2f(1, 0); glVertex2f(1, -1);
+  glTexCoord2f(1, 1); glVertex2f(1, 1);
+  glTexCoord2f(0, 1); glVertex2f(-1, 1);
+  glEnd();
+  glPopMatrix();
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopAttrib();
+}
+
+void GLWidget::adjustResolutionScale(int frame_time) {
+  average_frame_time_ += (frame_time - average_frame_time_) * kFrameTimeSmoothing;
+  float scale = resolution_scale_;
+  // Leave a wide band in which the scale stays put, so it doesn't flicker back and forth.
+  if (average_frame_time_ > kTargetFrameTime * 1.1f) {
+    scale -= kResolutionScaleStep;
+  } else if (average_frame_time_ < kTargetFrameTime * 0.7f) {
+    scale += kResolutionScaleStep;
+  }
+  scale = qBound(kMinResolutionScale, scale, 1.0f);
+  if (!qFuzzyCompare(scale, resolution_scale_)) {
+    resolution_scale_ = scale;
+    // Give the new scale a few frames to show in the average before judging it.
+    average_frame_time_ = kTargetFrameTime;
+  }
+}
+
 void GLWidget::paintGL() {
+  QTime frame_time;
+  frame_time.start();
+
+  if (quality_dirty_) {
+    applyQuality();
+    quality_dirty_ = false;
+  }
+  const bool scaled = adaptive_resolution_enabled_ && QGLFramebufferObject::hasOpenGLFramebufferObjects();
+  if (scaled) {
+    bindScaledFrame();
+  }
+
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   applyPressedKeys();
@@ -234,22 +493,48 @@ void GLWidget::paintGL() {
   if (scene_dirty_) {
     updateScene();
     scene_dirty_ = false;
-  } else {
-    glCallList(scene_display_list_);
+  }
+  if (scene_geometry_.isDirty()) {
+    scene_geometry_.update();
+  }
+  glCallList(scene_display_list_);
+  scene_geometry_.draw(camera_.eyePosition(), quality_.draw_distance);
+  glCallList(scene_display_list_ + 1);
+
+  if (scaled) {
+    scaled_frame_->release();
+    glViewport(0, 0, width(), height());
+    drawScaledFrame();
+    // Otherwise the time would only say how long it took to queue up the frame, not to draw it.
+    glFinish();
+    adjustResolutionScale(frame_time.elapsed());
   }
 
   // Handle frame stats.
+  const BufferArena& arena = scene_geometry_.arena();
+  QString arena_stats = QString("arena %1 of %2 KB used, %3% fragmented")
+      .arg(arena.used() * arena.elementSize() / 1024)
+      .arg(arena.capacity() * arena.elementSize() / 1024)
+      .arg(qRound(arena.fragmentation() * 100.0f));
+  if (scaled) {
+    arena_stats += QString(", drawn at %1% resolution").arg(qRound(resolution_scale_ * 100.0f));
+  }
   if (diagram_) {
-    emit frameStatsChanged(QString("%1 blocks").arg(diagram_->blockCount()));
+    emit frameStatsChanged(QString("%1 blocks, %2").arg(diagram_->blockCount()).arg(arena_stats));
   } else {
-    emit frameStatsChanged(QString("0 blocks"));
+    emit frameStatsChanged(QString("0 blocks, %1").arg(arena_stats));
   }
 }
 
 void GLWidget::resizeGL(int width, int height) {
+  applyProjection(width, height);
+  glViewport(0, 0, width, height);
+}
+
+void GLWidget::applyProjection(int width, int height) {
   const float aspect = float(width) / float(height);
   const float near_clip = 0.01;
-  const float far_clip = 100;
+  const float far_clip = quality_.draw_distance;
 
   const float tan30 = tanf(DEG_TO_RAD(30));
 
@@ -263,7 +548,6 @@ void GLWidget::resizeGL(int width, int height) {
   glLoadIdentity();
   glFrustum(left, right, bottom, top, near_clip, far_clip);
   glMatrixMode(GL_MODELVIEW);
-  glViewport(0, 0, width, height);
 }
 
 void GLWidget::mousePressEvent(QMouseEvent* event) {
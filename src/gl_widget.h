@@ -19,13 +19,18 @@
 #include <QGLWidget>
 #include <QSet>
 #include <QTime>
+#include <QVector>
 
 #include "frame_timer.h"
 #include "matrix.h"
 #include "mouselook_cam.h"
+#include "render_quality.h"
+#include "scene_geometry.h"
 
 class Diagram;
 class BlockPrototype;
+class QGLFramebufferObject;
+class BlockTransaction;
 class BlockManager;
 class Renderable;
 
@@ -49,10 +54,56 @@ class GLWidget : public QGLWidget {
   void setDiagram(Diagram* diagram);
   void setBlockManager(BlockManager* block_mgr);
 
+  /**
+    * Sets the widget whose GL context every GLWidget created afterwards shares, so that they can all use the textures
+    * created by the BlockManager.  Application sets this at startup, before any GLWidget is created.
+    */
+  static void setSharedContextWidget(QGLWidget* widget);
+
+  /**
+    * Reads the geometry cache saved for a diagram from \p path, so that loading the diagram afterwards only has to
+    * build the geometry of the regions that have changed since.  See SceneGeometry.
+    * @return \c false if there was no usable cache at \p path.
+    */
+  bool loadGeometryCache(const QString& path);
+
+  /**
+    * Brings the geometry of the diagram up to date and saves it to \p path.
+    * @return \c false if the file could not be written.
+    */
+  bool saveGeometryCache(const QString& path);
+
  public slots:
   void enableFrameRate(bool enable);
   void setSceneDirty(bool dirty = true);
 
+  /**
+    * Marks the geometry of every prefab as out of date, so that it's built again before the scene is next drawn.
+    */
+  void setPrefabsDirty();
+
+  /**
+    * Marks the geometry of the blocks in \p transaction as out of date.
+    */
+  void setBlocksDirty(const BlockTransaction& transaction);
+
+  /**
+    * Marks the geometry of the ephemeral blocks in \p transaction, and of those shown before, as out of date.
+    */
+  void setEphemeralBlocksDirty(const BlockTransaction& transaction);
+
+  /**
+    * Draws with the settings of \p preset, a RenderQuality::Preset, from the next frame on.
+    */
+  void setQualityPreset(int preset);
+
+  /**
+    * Enables or disables adaptive resolution.  When enabled, the scene is drawn into an offscreen framebuffer smaller
+    * than the widget and scaled up to fill it, and the scale is lowered or raised after every frame to keep drawing
+    * at about 30 frames per second.  The offscreen framebuffer isn't multisampled.
+    */
+  void enableAdaptiveResolution(bool enable);
+
  signals:
   void frameRateChanged(const QString& frame_rate);
   void frameStatsChanged(const QString& frame_stats);
@@ -68,7 +119,15 @@ class GLWidget : public QGLWidget {
 
  private:
   void applyPressedKeys();
+  void applyQuality();
+  void applyProjection(int width, int height);
+  void adjustResolutionScale(int frame_time);
+  void bindScaledFrame();
+  void drawScaledFrame();
   void drawSkybox();
+  void drawHighlightedBlocks();
+  void drawPlacedPrefabs();
+  void updatePrefabs();
   void updateScene();
 
  private:
@@ -79,7 +138,15 @@ class GLWidget : public QGLWidget {
 
   QPoint lastPos;
   GLuint ground_plane_display_list_;
+
+  /// Two consecutive display lists: the ground, drawn before the blocks, and the prefabs and highlights, drawn after.
   GLuint scene_display_list_;
+
+  /// The geometry of the diagram's own blocks.
+  SceneGeometry scene_geometry_;
+
+  /// One display list per prefab in the diagram, each drawing the prefab in its own coordinates.  See updatePrefabs().
+  QVector<GLuint> prefab_display_lists_;
   QSet<int> pressed_keys_;
   QTime time_since_last_frame_;
   QQueue<float> frame_rate_queue_;
@@ -89,7 +156,25 @@ class GLWidget : public QGLWidget {
 
   MouselookCam camera_;
 
+  RenderQuality quality_;
+  bool quality_dirty_;
+
+  bool adaptive_resolution_enabled_;
+
+  /// The size of the offscreen framebuffer relative to the widget, when adaptive resolution is enabled.
+  float resolution_scale_;
+
+  /// The time, in milliseconds, recent frames have taken to draw, smoothed out.
+  float average_frame_time_;
+
+  /// The offscreen framebuffer drawn into when adaptive resolution is enabled.  See bindScaledFrame().
+  QScopedPointer<QGLFramebufferObject> scaled_frame_;
+
   bool scene_dirty_;
+  bool prefabs_dirty_;
+
+  /// The widget set with setSharedContextWidget().
+  static QGLWidget* s_shared_context_widget_;
 
   BlockPrototype* grass_;
   BlockPrototype* sand_;
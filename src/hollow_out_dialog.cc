@@ -0,0 +1,38 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hollow_out_dialog.h"
+
+HollowOutDialog::HollowOutDialog(QWidget* parent)
+    : QDialog(parent) {
+  ui.setupUi(this);
+}
+
+void HollowOutDialog::setLevelRange(int min_level, int max_level) {
+  ui.min_level_spin_->setValue(min_level);
+  ui.max_level_spin_->setValue(max_level);
+}
+
+int HollowOutDialog::shellThickness() const {
+  return ui.shell_thickness_spin_->value();
+}
+
+int HollowOutDialog::minLevel() const {
+  return qMin(ui.min_level_spin_->value(), ui.max_level_spin_->value());
+}
+
+int HollowOutDialog::maxLevel() const {
+  return qMax(ui.min_level_spin_->value(), ui.max_level_spin_->value());
+}
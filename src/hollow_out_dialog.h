@@ -0,0 +1,44 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOLLOW_OUT_DIALOG_H
+#define HOLLOW_OUT_DIALOG_H
+
+#include "ui_hollow_out_dialog.h"
+
+/**
+  * Dialog that asks the user how thick a shell to leave and on which levels to hollow out the diagram.  The dialog
+  * only collects the parameters; the blocks to remove are worked out by Diagram::hollowOut().
+  */
+class HollowOutDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit HollowOutDialog(QWidget* parent = NULL);
+
+  /**
+    * Sets the range of levels shown in the dialog when it opens.
+    */
+  void setLevelRange(int min_level, int max_level);
+
+  int shellThickness() const;
+  int minLevel() const;
+  int maxLevel() const;
+
+ private:
+  Ui::HollowOutDialog ui;
+};
+
+#endif // HOLLOW_OUT_DIALOG_H
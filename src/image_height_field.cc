@@ -0,0 +1,167 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "image_height_field.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QList>
+#include <QtConcurrentMap>
+#include <QtEndian>
+#include <qmath.h>
+
+namespace {
+
+/** Returned for columns off the edge of the heightmap, so low that the column is empty. */
+const int kNoColumn = -(1 << 24);
+
+/**
+  * Converts one row of a 32-bit image to 16-bit samples.  Used as a QtConcurrent map functor.
+  */
+class ImageRowDecoder {
+ public:
+  ImageRowDecoder(const QImage* image, quint16* samples) : image_(image), samples_(samples) {}
+
+  void operator()(int row) const {
+    const QRgb* pixels = reinterpret_cast<const QRgb*>(image_->scanLine(row));
+    quint16* samples = samples_ + row * image_->width();
+    for (int i = 0; i < image_->width(); ++i) {
+      // 8-bit grey values scale exactly onto 16 bits by repeating the byte.
+      samples[i] = static_cast<quint16>(qGray(pixels[i]) * 257);
+    }
+  }
+
+ private:
+  const QImage* image_;
+  quint16* samples_;
+};
+
+/**
+  * Converts one row of a little-endian 16-bit raw file to samples.  Used as a QtConcurrent map functor.
+  */
+class RawRowDecoder {
+ public:
+  RawRowDecoder(const uchar* data, int width, quint16* samples) : data_(data), width_(width), samples_(samples) {}
+
+  void operator()(int row) const {
+    const uchar* source = data_ + row * width_ * 2;
+    quint16* samples = samples_ + row * width_;
+    for (int i = 0; i < width_; ++i) {
+      samples[i] = qFromLittleEndian<quint16>(source + i * 2);
+    }
+  }
+
+ private:
+  const uchar* data_;
+  int width_;
+  quint16* samples_;
+};
+
+}  // namespace
+
+ImageHeightField::ImageHeightField()
+    : width_(0), depth_(0), pixels_per_block_(1), min_height_(0), max_height_(0) {
+}
+
+bool ImageHeightField::load(const QString& filename, QString* error) {
+  samples_.clear();
+  width_ = 0;
+  depth_ = 0;
+
+  QString suffix = QFileInfo(filename).suffix().toLower();
+  if (suffix == "raw" || suffix == "r16") {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+      if (error) {
+        *error = file.errorString();
+      }
+      return false;
+    }
+    int side = qFloor(qSqrt(file.size() / 2.0) + 0.5);
+    if (side == 0 || static_cast<qint64>(side) * side * 2 != file.size()) {
+      if (error) {
+        *error = "Raw heightmaps must be square, with two bytes per pixel.";
+      }
+      return false;
+    }
+    // Map the file rather than reading it, so that it never has to be held in memory twice.
+    const uchar* data = file.map(0, file.size());
+    if (!data) {
+      if (error) {
+        *error = file.errorString();
+      }
+      return false;
+    }
+    samples_.resize(side * side);
+    QList<int> rows;
+    for (int row = 0; row < side; ++row) {
+      rows.append(row);
+    }
+    QtConcurrent::blockingMap(rows, RawRowDecoder(data, side, samples_.data()));
+    width_ = side;
+    depth_ = side;
+    return true;
+  }
+
+  QImage image(filename);
+  if (image.isNull()) {
+    if (error) {
+      *error = "The heightmap could not be read.";
+    }
+    return false;
+  }
+  if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32) {
+    image = image.convertToFormat(QImage::Format_RGB32);
+  }
+  samples_.resize(image.width() * image.height());
+  QList<int> rows;
+  for (int row = 0; row < image.height(); ++row) {
+    rows.append(row);
+  }
+  QtConcurrent::blockingMap(rows, ImageRowDecoder(&image, samples_.data()));
+  width_ = image.width();
+  depth_ = image.height();
+  return true;
+}
+
+void ImageHeightField::setPlacement(const BlockPosition& corner, int pixels_per_block, int min_height,
+                                    int max_height) {
+  corner_ = corner;
+  pixels_per_block_ = qMax(pixels_per_block, 1);
+  min_height_ = min_height;
+  max_height_ = max_height;
+}
+
+void ImageHeightField::heightRow(int x, int z, int count, int* heights) const {
+  int pixel_z = (z - corner_.z()) * pixels_per_block_;
+  if (pixel_z < 0 || pixel_z >= depth_) {
+    for (int i = 0; i < count; ++i) {
+      heights[i] = kNoColumn;
+    }
+    return;
+  }
+  const quint16* row = samples_.constData() + pixel_z * width_;
+  // A 16-bit sample times a range of more than 32767 blocks doesn't fit in an int.
+  qint64 range = static_cast<qint64>(max_height_) - min_height_;
+  for (int i = 0; i < count; ++i) {
+    int pixel_x = (x + i - corner_.x()) * pixels_per_block_;
+    if (pixel_x < 0 || pixel_x >= width_) {
+      heights[i] = kNoColumn;
+    } else {
+      heights[i] = min_height_ + static_cast<int>((row[pixel_x] * range + 32767) / 65535);
+    }
+  }
+}
@@ -0,0 +1,86 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_HEIGHT_FIELD_H
+#define IMAGE_HEIGHT_FIELD_H
+
+#include <QString>
+#include <QVector>
+
+#include "block_position.h"
+#include "terrain_generator.h"
+
+/**
+  * A HeightField read from a heightmap file, with one terrain column per pixel (or per square of pixels).
+  *
+  * Greyscale images in any format QImage understands are supported, as are headerless 16-bit little-endian raw files
+  * (.raw or .r16), which must be square.  Either way the heightmap is decoded once, a row per task on the global thread
+  * pool, into 16 bits per pixel, so a 4096 x 4096 heightmap takes 32 MB however it was stored.
+  */
+class ImageHeightField : public HeightField {
+ public:
+  ImageHeightField();
+
+  /**
+    * Loads the heightmap in \p filename, replacing any heightmap loaded previously.
+    * @param error If not NULL and the file could not be loaded, receives a description of what went wrong.
+    * @return \c true if the file was loaded successfully.
+    */
+  bool load(const QString& filename, QString* error = NULL);
+
+  /**
+    * Returns \c true if a heightmap has been loaded.
+    */
+  bool isLoaded() const {
+    return width_ > 0;
+  }
+
+  /**
+    * Returns the width of the heightmap, in pixels.
+    */
+  int width() const {
+    return width_;
+  }
+
+  /**
+    * Returns the depth of the heightmap (its height as an image), in pixels.
+    */
+  int depth() const {
+    return depth_;
+  }
+
+  /**
+    * Positions the heightmap in the world.
+    * @param corner The column at which the top left pixel of the heightmap goes.  Only x and z are used.
+    * @param pixels_per_block The number of pixels along each side of the square of pixels that makes up each column.
+    *                         Only the top left pixel of each square is used.
+    * @param min_height The height of black pixels.
+    * @param max_height The height of white pixels.
+    */
+  void setPlacement(const BlockPosition& corner, int pixels_per_block, int min_height, int max_height);
+
+  virtual void heightRow(int x, int z, int count, int* heights) const;
+
+ private:
+  QVector<quint16> samples_;
+  int width_;
+  int depth_;
+  BlockPosition corner_;
+  int pixels_per_block_;
+  int min_height_;
+  int max_height_;
+};
+
+#endif // IMAGE_HEIGHT_FIELD_H
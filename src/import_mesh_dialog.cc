@@ -0,0 +1,215 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "import_mesh_dialog.h"
+
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QTime>
+#include <QtGui/QApplication>
+
+#include "block_instance.h"
+#include "block_manager.h"
+#include "block_position.h"
+#include "block_prototype.h"
+#include "diagram.h"
+#include "mesh_voxelizer.h"
+#include "occupancy_mask.h"
+#include "palette_matcher.h"
+#include "shape_rasterizer.h"
+#include "template_converter.h"
+
+namespace {
+
+const blocktype_t kDefaultBlockType = 1;  // Stone
+
+/**
+  * Fills each block with the palette block closest to the colour the voxelizer found for it, or with a default block
+  * if it has no colour (because it is inside the mesh, or its triangle had none).
+  */
+class ColorRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  ColorRunVisitor(BlockOracle* oracle, const QHash<BlockPosition, QRgb>* colors, const QList<BlockPrototype*>& palette,
+                  BlockPrototype* default_prototype, BlockTransaction* transaction)
+      : oracle_(oracle), colors_(colors), palette_(palette),
+        matcher_(TemplateConverter::paletteColors(palette)), default_prototype_(default_prototype),
+        transaction_(transaction) {}
+
+  virtual void visitRun(int x_begin, int x_end, int y, int z) {
+    for (int x = x_begin; x < x_end; ++x) {
+      BlockPosition pos(x, y, z);
+      BlockPrototype* prototype = default_prototype_;
+      QHash<BlockPosition, QRgb>::const_iterator color = colors_->constFind(pos);
+      if (color != colors_->constEnd()) {
+        prototype = palette_[matcher_.nearest(color.value())];
+      }
+      transaction_->replaceBlock(oracle_->blockAt(pos), BlockInstance(prototype, pos, prototype->defaultOrientation()));
+    }
+  }
+
+ private:
+  BlockOracle* oracle_;
+  const QHash<BlockPosition, QRgb>* colors_;
+  QList<BlockPrototype*> palette_;
+  PaletteMatcher matcher_;
+  BlockPrototype* default_prototype_;
+  BlockTransaction* transaction_;
+};
+
+}  // namespace
+
+ImportMeshDialog::ImportMeshDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent)
+    : QDialog(parent), diagram_(diagram), block_mgr_(block_mgr), is_dirty_(true) {
+  ui.setupUi(this);
+  ui.status_label_->setAttribute(Qt::WA_MacSmallSize, true);
+
+  ui.mode_combo_->addItem("Surface only", MeshVoxelizer::kSurface);
+  ui.mode_combo_->addItem("Solid", MeshVoxelizer::kSolid);
+  BlockTypeIterator iter = BlockPrototype::blockIterator();
+  while (iter.hasNext()) {
+    BlockPrototype* prototype = block_mgr_->getPrototype(iter.next());
+    ui.block_type_combo_->addItem(QIcon(prototype->sprite()), prototype->name(), prototype->type());
+  }
+  ui.block_type_combo_->setCurrentIndex(qMax(ui.block_type_combo_->findData(kDefaultBlockType), 0));
+  ui.color_check_->setEnabled(false);
+
+  connect(ui.preview_button_, SIGNAL(clicked()), SLOT(preview()));
+  connect(ui.browse_button_, SIGNAL(clicked()), SLOT(browseForMesh()));
+  connect(ui.size_spin_, SIGNAL(valueChanged(int)), SLOT(markDirty()));
+  connect(ui.bottom_spin_, SIGNAL(valueChanged(int)), SLOT(markDirty()));
+  connect(ui.mode_combo_, SIGNAL(currentIndexChanged(int)), SLOT(markDirty()));
+  connect(ui.block_type_combo_, SIGNAL(currentIndexChanged(int)), SLOT(markDirty()));
+  connect(ui.color_check_, SIGNAL(toggled(bool)), SLOT(markDirty()));
+  connect(ui.z_up_check_, SIGNAL(toggled(bool)), SLOT(markDirty()));
+}
+
+BlockPrototype* ImportMeshDialog::selectedPrototype() const {
+  return block_mgr_->getPrototype(ui.block_type_combo_->itemData(ui.block_type_combo_->currentIndex()).toInt());
+}
+
+void ImportMeshDialog::setLevel(int level) {
+  ui.bottom_spin_->setValue(level);
+}
+
+void ImportMeshDialog::markDirty() {
+  is_dirty_ = true;
+}
+
+void ImportMeshDialog::browseForMesh() {
+  QString filename = QFileDialog::getOpenFileName(this, "Import Mesh", QString(), "Meshes (*.obj *.stl)");
+  if (filename.isEmpty()) {
+    return;
+  }
+
+  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  QString error;
+  bool loaded = mesh_.load(filename, &error);
+  QApplication::restoreOverrideCursor();
+  if (!loaded) {
+    ui.status_label_->setText(error);
+    ui.mesh_path_edit_->clear();
+    return;
+  }
+
+  ui.mesh_path_edit_->setText(filename);
+  ui.status_label_->setText(QString("%1 triangles.").arg(mesh_.triangles().size()));
+  // STL files are almost always exported from CAD packages, which put z up; OBJ files usually follow OpenGL.
+  ui.z_up_check_->setChecked(QFileInfo(filename).suffix().toLower() == "stl");
+  ui.color_check_->setEnabled(mesh_.hasColors());
+  ui.color_check_->setChecked(mesh_.hasColors());
+  markDirty();
+}
+
+bool ImportMeshDialog::generate() {
+  if (!is_dirty_) {
+    return true;
+  }
+  if (mesh_.triangles().isEmpty()) {
+    ui.status_label_->setText("Choose a mesh first.");
+    return false;
+  }
+
+  QVector3D min, max;
+  mesh_.bounds(&min, &max);
+  bool z_up = ui.z_up_check_->isChecked();
+  if (z_up) {
+    // The same rotation as MeshVoxelizer applies: (x, y, z) becomes (x, z, -y).
+    QVector3D rotated_min(min.x(), min.z(), -max.y());
+    QVector3D rotated_max(max.x(), max.z(), -min.y());
+    min = rotated_min;
+    max = rotated_max;
+  }
+  QVector3D extent = max - min;
+  float longest = qMax(extent.x(), qMax(extent.y(), extent.z()));
+  float scale = longest > 0.0f ? ui.size_spin_->value() / longest : 1.0f;
+  QVector3D offset(-0.5f * (min.x() + max.x()) * scale,
+                   ui.bottom_spin_->value() - min.y() * scale,
+                   -0.5f * (min.z() + max.z()) * scale);
+
+  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  QTime timer;
+  timer.start();
+  MeshVoxelizer voxelizer(&mesh_, scale, offset, z_up);
+  MeshVoxelizer::Mode mode =
+      static_cast<MeshVoxelizer::Mode>(ui.mode_combo_->itemData(ui.mode_combo_->currentIndex()).toInt());
+  bool by_color = ui.color_check_->isEnabled() && ui.color_check_->isChecked();
+  OccupancyMask mask;
+  QHash<BlockPosition, QRgb> colors;
+  voxelizer.voxelize(mode, &mask, by_color ? &colors : NULL);
+
+  transaction_ = BlockTransaction();
+  QList<BlockPrototype*> palette;
+  if (by_color) {
+    BlockTypeIterator iter = BlockPrototype::blockIterator();
+    while (iter.hasNext()) {
+      BlockPrototype* prototype = block_mgr_->getPrototype(iter.next());
+      if (prototype->isPlainCube()) {
+        palette.append(prototype);
+      }
+    }
+  }
+  if (palette.isEmpty()) {
+    BlockPrototype* prototype = selectedPrototype();
+    FillRunVisitor visitor(diagram_, prototype, prototype->defaultOrientation(), &transaction_);
+    mask.visitRuns(&visitor);
+  } else {
+    ColorRunVisitor visitor(diagram_, &colors, palette, selectedPrototype(), &transaction_);
+    mask.visitRuns(&visitor);
+  }
+  QApplication::restoreOverrideCursor();
+
+  ui.status_label_->setText(QString("%1 blocks from %2 triangles in %3 ms.")
+                            .arg(transaction_.new_blocks().size()).arg(mesh_.triangles().size()).arg(timer.elapsed()));
+  is_dirty_ = false;
+  return true;
+}
+
+void ImportMeshDialog::preview() {
+  if (generate()) {
+    diagram_->commitEphemeral(transaction_);
+  }
+}
+
+void ImportMeshDialog::accept() {
+  if (generate()) {
+    QDialog::accept();
+  }
+}
+
+void ImportMeshDialog::reject() {
+  // Take down the preview, if there is one.
+  diagram_->commitEphemeral(BlockTransaction());
+  QDialog::reject();
+}
@@ -0,0 +1,88 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMPORT_MESH_DIALOG_H
+#define IMPORT_MESH_DIALOG_H
+
+#include "ui_import_mesh_dialog.h"
+
+#include "block_transaction.h"
+#include "triangle_mesh.h"
+
+class BlockManager;
+class BlockPrototype;
+class Diagram;
+
+/**
+  * Dialog that turns an OBJ or STL mesh into blocks with a MeshVoxelizer.  The mesh is scaled so that its longest side
+  * spans the chosen number of blocks, centred on the origin, and stood on the chosen level.  Either only the blocks
+  * that the surface passes through are filled, or the whole inside as well.  If the mesh has colours, the surface can
+  * be built from whichever plain cube blocks match them best.
+  *
+  * Pressing Preview shows the result as ephemeral blocks.  When the dialog is accepted, transaction() returns the
+  * changes to make; the dialog never commits them itself, so that the caller can put them on the undo stack.
+  */
+class ImportMeshDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit ImportMeshDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent = NULL);
+
+  /**
+    * Stands the mesh on \p level.
+    */
+  void setLevel(int level);
+
+  /**
+    * Returns the transaction produced by the last voxelization.
+    */
+  const BlockTransaction& transaction() const {
+    return transaction_;
+  }
+
+ public slots:
+  virtual void accept();
+  virtual void reject();
+
+  /**
+    * Asks the user for a mesh file and loads it.
+    */
+  void browseForMesh();
+
+ private slots:
+  void preview();
+  void markDirty();
+
+ private:
+  /**
+    * Revoxelizes the mesh into transaction_ if anything has changed since the last time.
+    * @return \c false if no mesh has been loaded.
+    */
+  bool generate();
+
+  /**
+    * Returns the prototype selected in the block type combo box.
+    */
+  BlockPrototype* selectedPrototype() const;
+
+  Ui::ImportMeshDialog ui;
+  Diagram* diagram_;
+  BlockManager* block_mgr_;
+  BlockTransaction transaction_;
+  TriangleMesh mesh_;
+  bool is_dirty_;
+};
+
+#endif // IMPORT_MESH_DIALOG_H
@@ -20,7 +20,9 @@
 #include "block_orientation.h"
 #include "enums.h"
 
-LadderRenderable::LadderRenderable() : RectangularPrismRenderable(QVector3D(1.0f, 1.0f, 0.03125f), kTextureClip) {
+// Ladders are too thin for a neighbouring block to hide them.
+LadderRenderable::LadderRenderable()
+    : RectangularPrismRenderable(QVector3D(1.0f, 1.0f, 0.03125f), kTextureClip, kDoNotCullFaces) {
 }
 
 LadderRenderable::Geometry LadderRenderable::moveToOrigin(const LadderRenderable::Geometry& geometry) {
@@ -39,8 +41,7 @@ Texture LadderRenderable::textureForQuad(int index, const BlockOrientation* orie
   return texture(0);
 }
 
-bool LadderRenderable::shouldRenderQuad(int index, const QVector3D& location,
-                                        const BlockOrientation* orientation) const {
+bool LadderRenderable::shouldRenderQuad(int index, const BlockOrientation* orientation) const {
   // Ladders only have one face, the front one.
   return index == kFrontFace;
 }
@@ -22,8 +22,10 @@
 #include "eraser_tool.h"
 #include "line_tool.h"
 #include "macros.h"
+#include "occupancy_mask.h"
 #include "pencil_tool.h"
 #include "rectangle_tool.h"
+#include "template_converter.h"
 
 #include "undo_command.h"
 
@@ -35,6 +37,29 @@ static const int kCanvasHeight = 10000;
 
 static const int kGhostLevelOffsets[] = {-1, 0};
 
+namespace {
+
+/**
+  * Collects the scene rectangles covered by the runs of highlighted blocks on one level.
+  */
+class LevelHighlightRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  LevelHighlightRunVisitor(int level, QVector<QRectF>* rects) : level_(level), rects_(rects) {}
+
+  virtual void visitRun(int x_begin, int x_end, int y, int z) {
+    if (y == level_) {
+      rects_->append(QRectF((x_begin - 0.5) * kSpriteWidth, (z - 0.5) * kSpriteHeight,
+                            (x_end - x_begin) * kSpriteWidth, kSpriteHeight));
+    }
+  }
+
+ private:
+  int level_;
+  QVector<QRectF>* rects_;
+};
+
+}  // namespace
+
 LevelWidget::LevelWidget(QWidget* parent) :
     QGraphicsView(parent),
     scene_(new QGraphicsScene(this)),
@@ -45,6 +70,7 @@ LevelWidget::LevelWidget(QWidget* parent) :
     last_block_position_(0, 0, 0),
     block_type_(kBlockTypeUnknown),
     copied_level_(-1),
+    flow_simulated_(false),
     selected_tool_(NULL) {
   setScene(scene_);
   setBackgroundBrush(QBrush(QPixmap(":/grid_background.png")));
@@ -72,6 +98,9 @@ void LevelWidget::setDiagram(Diagram* diagram) {
   diagram_ = diagram;
   connect(diagram, SIGNAL(diagramChanged(BlockTransaction)), SLOT(updateLevel(BlockTransaction)));
   connect(diagram, SIGNAL(ephemeralBlocksChanged(BlockTransaction)), SLOT(updateEphemeralBlocks(BlockTransaction)));
+  connect(diagram, SIGNAL(simulatedBlocksChanged(BlockTransaction)), SLOT(updateSimulatedBlocks(BlockTransaction)));
+  connect(diagram, SIGNAL(highlightedBlocksChanged()), SLOT(updateHighlightedBlocks()));
+  connect(diagram, SIGNAL(prefabsChanged()), SLOT(updatePlacedBlocks()));
   setLevel(0);
 }
 
@@ -90,6 +119,10 @@ void LevelWidget::updateLevel(const BlockTransaction& transaction) {
   foreach (const BlockInstance& new_block, transaction.new_blocks()) {
     addBlock(new_block);
   }
+  if (!diagram_->placements().isEmpty()) {
+    // Removing one of the diagram's own blocks may uncover a placed one.
+    updatePlacedBlocks();
+  }
   // QGraphicsScene doesn't notify the view that things have changed until the next event loop
   // cycle.  Qt apparently optimizes mouse moves so that they don't return control to the event loop
   // while the mouse is in motion, which causes the view to freeze.  This hack fixes the problem.
@@ -115,10 +148,57 @@ void LevelWidget::updateEphemeralBlocks(const BlockTransaction& transaction) {
   qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 }
 
+void LevelWidget::updateSimulatedBlocks(const BlockTransaction& transaction) {
+  foreach (const BlockInstance& new_block, transaction.new_blocks()) {
+    QGraphicsPixmapItem* item = qgraphicsitem_cast<QGraphicsPixmapItem*>(itemAtPosition(new_block.position()));
+    if (item) {
+      item->setPixmap(new_block.prototype()->sprite(new_block.orientation()));
+    }
+  }
+}
+
+void LevelWidget::updateHighlightedBlocks() {
+  highlight_rects_.clear();
+  if (diagram_) {
+    foreach (const BlockHighlight& highlight, diagram_->highlights()) {
+      QVector<QRectF> rects;
+      LevelHighlightRunVisitor visitor(level_, &rects);
+      highlight.blocks.visitRuns(&visitor);
+      if (!rects.isEmpty()) {
+        highlight_rects_.append(qMakePair(highlight.color, rects));
+      }
+    }
+  }
+  viewport()->update();
+}
+
+void LevelWidget::updatePlacedBlocks() {
+  foreach (QGraphicsItem* item, placed_items_) {
+    scene()->removeItem(item);
+    delete item;
+  }
+  placed_items_.clear();
+  if (!block_mgr_ || !diagram_) {
+    return;
+  }
+  foreach (const BlockInstance& block, diagram_->placedBlocks(level_)) {
+    const BlockPosition& position = block.position();
+    QGraphicsPixmapItem* item = scene()->addPixmap(block.prototype()->sprite(block.orientation()));
+    item->setOffset(-0.5 * kSpriteWidth, -0.5 * kSpriteHeight);
+    item->setPos(position.x() * kSpriteWidth, position.z() * kSpriteHeight);
+    item->setShapeMode(QGraphicsPixmapItem::BoundingRectShape);
+    item->setData(0, block.prototype()->type());
+    item->setZValue(position.y() - 0.5);  // Stack underneath the diagram's own blocks.
+    item->setOpacity(0.6);
+    placed_items_.append(item);
+  }
+}
+
 void LevelWidget::loadLevel() {
   scene()->clear();
   item_model_.clear();
   ephemeral_items_.clear();
+  placed_items_.clear();
   if (!diagram_) {
     return;
   }
@@ -130,6 +210,8 @@ void LevelWidget::loadLevel() {
     }
   }
   setViewportUpdateMode(previous_mode);
+  updatePlacedBlocks();
+  updateHighlightedBlocks();
 }
 
 bool LevelWidget::event(QEvent* event) {
@@ -196,9 +278,8 @@ void LevelWidget::mousePressEvent(QMouseEvent* event) {
       BlockInstance new_block(prototype, position, orientations.at(orientation_index));
       BlockTransaction transaction;
       transaction.replaceBlock(block, new_block);
-      UndoCommand* command = new UndoCommand(transaction, diagram_);
-      command->setText("Change Block Orientation");
-      undo_stack_.push(command);
+      // The user picked this orientation, so don't let the diagram join the block back up to its neighbours.
+      pushTransaction(transaction, "Change Block Orientation", Diagram::kCommitExactly);
       currentTool()->clear();
       return;
     }
@@ -220,9 +301,7 @@ void LevelWidget::mouseReleaseEvent(QMouseEvent* event) {
     BlockTransaction transaction;
     BlockPrototype* prototype = block_mgr_->getPrototype(block_type_);
     currentTool()->draw(prototype, prototype->defaultOrientation(), &transaction);
-    UndoCommand* command = new UndoCommand(transaction, diagram_);
-    command->setText(currentTool()->actionName());
-    undo_stack_.push(command);
+    pushTransaction(transaction, currentTool()->actionName());
     currentTool()->clear();
   }
 
@@ -265,6 +344,21 @@ void LevelWidget::drawBackground(QPainter* painter, const QRectF& rect) {
 }
 
 void LevelWidget::drawForeground(QPainter* painter, const QRectF& rect) {
+  if (!highlight_rects_.isEmpty()) {
+    painter->save();
+    for (int i = 0; i < highlight_rects_.size(); ++i) {
+      QColor color = highlight_rects_[i].first;
+      painter->setPen(color);
+      color.setAlpha(64);
+      painter->setBrush(color);
+      foreach (const QRectF& highlight_rect, highlight_rects_[i].second) {
+        if (highlight_rect.intersects(rect)) {
+          painter->drawRect(highlight_rect);
+        }
+      }
+    }
+    painter->restore();
+  }
   painter->drawPixmap(3, 3, 11, 11, QPixmap(":/origin.png"));
 }
 
@@ -337,7 +431,9 @@ QGraphicsItem* LevelWidget::addBlock(const BlockInstance& block) {
   }
 
   BlockPrototype* prototype = block.prototype();
-  QGraphicsPixmapItem* item = scene()->addPixmap(prototype->sprite(block.orientation()));
+  const BlockInstance& displayed_block = diagram_->displayedBlock(block);
+  QGraphicsPixmapItem* item =
+      scene()->addPixmap(displayed_block.prototype()->sprite(displayed_block.orientation()));
   item->setOffset(-0.5 * kSpriteWidth, -0.5 * kSpriteHeight);
   item->setPos(position.x() * kSpriteWidth, position.z() * kSpriteHeight);
   item->setShapeMode(QGraphicsPixmapItem::BoundingRectShape);
@@ -402,6 +498,73 @@ void LevelWidget::extrudeDownwards() {
   setLevel(level_ - 1);
 }
 
+void LevelWidget::commitTransaction(const BlockTransaction& transaction, const QString& action_name) {
+  if (transaction.old_blocks().isEmpty() && transaction.new_blocks().isEmpty()) {
+    return;
+  }
+  pushTransaction(transaction, action_name);
+}
+
+void LevelWidget::pushTransaction(const BlockTransaction& transaction, const QString& action_name,
+                                  Diagram::CommitMode mode) {
+  UndoCommand* command = new UndoCommand(transaction, diagram_, mode);
+  command->setText(action_name);
+  if (!flow_simulated_) {
+    undo_stack_.push(command);
+    return;
+  }
+
+  // The flow can only be worked out once the edit has been committed, so the two are pushed as a macro to keep them
+  // a single step on the undo stack.
+  undo_stack_.beginMacro(action_name);
+  undo_stack_.push(command);
+  QList<BlockPosition> changed;
+  foreach (const BlockInstance& block, transaction.old_blocks()) {
+    changed.append(block.position());
+  }
+  foreach (const BlockInstance& block, transaction.new_blocks()) {
+    changed.append(block.position());
+  }
+  BlockTransaction flow;
+  if (diagram_->updateFlow(changed, &flow) > 0) {
+    UndoCommand* flow_command = new UndoCommand(flow, diagram_);
+    flow_command->setText("Update Liquid Flow");
+    undo_stack_.push(flow_command);
+  }
+  undo_stack_.endMacro();
+}
+
+void LevelWidget::setFlowSimulated(bool simulated) {
+  flow_simulated_ = simulated;
+  if (!simulated) {
+    return;
+  }
+  BlockTransaction flow;
+  if (diagram_->solveFlow(&flow) > 0) {
+    UndoCommand* command = new UndoCommand(flow, diagram_);
+    command->setText("Solve Liquid Flow");
+    undo_stack_.push(command);
+  }
+}
+
+void LevelWidget::replaceBlocks(blocktype_t source_type, blocktype_t dest_type, int min_level, int max_level,
+                                bool preserve_orientation) {
+  BlockTransaction transaction;
+  int count = diagram_->replaceBlocks(block_mgr_->getPrototype(source_type), block_mgr_->getPrototype(dest_type),
+                                      min_level, max_level, preserve_orientation, &transaction);
+  if (count == 0) {
+    return;
+  }
+  commitTransaction(transaction, "Replace Blocks");
+}
+
+void LevelWidget::commitPrefabs(const QList<Prefab>& prefabs, const QList<PrefabPlacement>& placements,
+                                const BlockTransaction& transaction, const QString& action_name) {
+  PrefabUndoCommand* command = new PrefabUndoCommand(prefabs, placements, transaction, diagram_);
+  command->setText(action_name);
+  undo_stack_.push(command);
+}
+
 void LevelWidget::setTemplateImage(const QString& filename) {
   if (!filename.isEmpty()) {
     template_image_ = QPixmap(filename);
@@ -413,3 +576,25 @@ void LevelWidget::clearTemplateImage() {
   template_image_ = QPixmap();
   update();
 }
+
+void LevelWidget::convertTemplateImage(const QList<BlockPrototype*>& palette, int cell_size, bool dither) {
+  if (template_image_.isNull() || palette.isEmpty() || cell_size < 1) {
+    return;
+  }
+
+  // drawBackground() centres the template on the origin, and block x is centred on x * kSpriteWidth, so block x covers
+  // the template pixels starting at x * kSpriteWidth - kSpriteWidth / 2 + width / 2.  The same formula with cell_size
+  // in place of the sprite size keeps other cell sizes centred too.  The first block is the one whose cell contains
+  // the image's top left pixel.
+  QImage image = template_image_.toImage();
+  int offset_x = image.width() / 2 - cell_size / 2;
+  int offset_z = image.height() / 2 - cell_size / 2;
+  int first_x = -offset_x >= 0 ? -offset_x / cell_size : -((offset_x + cell_size - 1) / cell_size);
+  int first_z = -offset_z >= 0 ? -offset_z / cell_size : -((offset_z + cell_size - 1) / cell_size);
+  QPoint grid_origin(first_x * cell_size + offset_x, first_z * cell_size + offset_z);
+
+  BlockTransaction transaction;
+  TemplateConverter converter(palette, cell_size, dither);
+  converter.convert(image, grid_origin, BlockPosition(first_x, level_, first_z), diagram_, &transaction);
+  commitTransaction(transaction, "Convert Template to Blocks");
+}
@@ -26,10 +26,13 @@
 
 #include "block_type.h"
 #include "block_position.h"
+#include "diagram.h"
+#include "position_hash.h"
+#include "prefab.h"
 
-class Diagram;
 class BlockInstance;
 class BlockManager;
+class BlockPrototype;
 class BlockTransaction;
 class Tool;
 
@@ -54,6 +57,35 @@ class LevelWidget : public QGraphicsView {
   void setDiagram(Diagram* diagram);
   void setBlockManager(BlockManager* block_mgr);
 
+  /**
+    * Returns the level currently being rendered.
+    */
+  int level() const {
+    return level_;
+  }
+
+  /**
+    * Commits \p transaction to the diagram as a single undoable step labeled \p action_name.  Does nothing if the
+    * transaction is empty.
+    */
+  void commitTransaction(const BlockTransaction& transaction, const QString& action_name);
+
+  /**
+    * Replaces every block of type \p source_type on levels \p min_level through \p max_level (inclusive) with a block
+    * of type \p dest_type, as a single undoable step.  Does nothing if no blocks match.
+    * @sa Diagram::replaceBlocks()
+    */
+  void replaceBlocks(blocktype_t source_type, blocktype_t dest_type, int min_level, int max_level,
+                     bool preserve_orientation);
+
+  /**
+    * Commits \p transaction to the diagram and then gives it \p prefabs and \p placements, as a single undoable step
+    * labeled \p action_name.
+    * @sa Diagram::setPrefabs()
+    */
+  void commitPrefabs(const QList<Prefab>& prefabs, const QList<PrefabPlacement>& placements,
+                     const BlockTransaction& transaction, const QString& action_name);
+
  signals:
   /**
     * Emitted whenever the currently displayed level changes.
@@ -113,6 +145,29 @@ class LevelWidget : public QGraphicsView {
     */
   void clearTemplateImage();
 
+  /**
+    * Returns \c true if a template image is set.
+    */
+  bool hasTemplateImage() const {
+    return !template_image_.isNull();
+  }
+
+  /**
+    * Replaces the blocks on the current level under the template image with the blocks from \p palette that best
+    * match its colours, as a single undoable step.  Each block stands for a square of \p cell_size pixels; with a
+    * \p cell_size equal to the width of a block on screen, the blocks land exactly where the template is drawn.
+    * @sa TemplateConverter
+    */
+  void convertTemplateImage(const QList<BlockPrototype*>& palette, int cell_size, bool dither);
+
+  /**
+    * Turns liquid flow simulation on or off.  While it is on, every edit also brings the flowing water and lava
+    * around it up to date, as part of the same undoable step.  Turning it on solves all of the diagram's liquid at
+    * once, as a separate undoable step.
+    * @sa FlowSolver
+    */
+  void setFlowSimulated(bool simulated);
+
 
  protected:
   /**
@@ -217,6 +272,24 @@ class LevelWidget : public QGraphicsView {
     */
   void updateEphemeralBlocks(const BlockTransaction& transaction);
 
+  /**
+    * Shows the simulated blocks in \p transaction in place of the blocks in the current level.  Called whenever the
+    * Diagram's simulated blocks change.
+    */
+  void updateSimulatedBlocks(const BlockTransaction& transaction);
+
+  /**
+    * Outlines the diagram's highlighted blocks on the current level.  Called whenever the Diagram's highlighted blocks
+    * change.
+    */
+  void updateHighlightedBlocks();
+
+  /**
+    * Shows the blocks of the diagram's placed prefabs on the current level, behind its own blocks.  Called whenever
+    * the Diagram's prefabs change.
+    */
+  void updatePlacedBlocks();
+
  protected:
   virtual void showEvent(QShowEvent* event);
 
@@ -227,8 +300,16 @@ class LevelWidget : public QGraphicsView {
     */
   Tool* currentTool() const;
 
-  QHash<BlockPosition, QGraphicsItem*> item_model_;
+  /**
+    * Pushes \p transaction onto the undo stack, which commits it with \p mode, along with any changes to the liquid
+    * flow that it causes if flow simulation is on.
+    */
+  void pushTransaction(const BlockTransaction& transaction, const QString& action_name,
+                       Diagram::CommitMode mode = Diagram::kAutoConnect);
+
+  PositionHash<QGraphicsItem*> item_model_;
   QVector<QGraphicsItem*> ephemeral_items_;
+  QVector<QGraphicsItem*> placed_items_;
   QGraphicsScene* scene_;
   int level_;
   Diagram* diagram_;
@@ -239,6 +320,10 @@ class LevelWidget : public QGraphicsView {
   blocktype_t block_type_;
   QPixmap template_image_;
   int copied_level_;
+  bool flow_simulated_;
+
+  /// The colour and scene rectangles of each highlight on the current level.  See updateHighlightedBlocks().
+  QList< QPair<QColor, QVector<QRectF> > > highlight_rects_;
 
   /// The tool that is currently selected in the tool picker.
   Tool* selected_tool_;
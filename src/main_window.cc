@@ -16,32 +16,68 @@
 #include "main_window.h"
 
 #include <QtGui/QApplication>
+#include <QtGui/QInputDialog>
+#include <QtGui/QStatusBar>
 
 #include "about_box.h"
+#include "block_instance.h"
 #include "block_manager.h"
 #include "block_picker.h"
 #include "block_prototype.h"
+#include "block_transaction.h"
 #include "block_type.h"
 #include "circle_tool.h"
+#include "connectivity_analyzer.h"
+#include "convert_template_dialog.h"
+#include "create_prefab_dialog.h"
 #include "diagram.h"
+#include "diagram_diff.h"
 #include "eraser_tool.h"
+#include "application.h"
 #include "filled_rectangle_tool.h"
 #include "flood_fill_tool.h"
+#include "generate_terrain_dialog.h"
+#include "generate_volume_dialog.h"
+#include "gl_preview_window.h"
+#include "gl_widget.h"
+#include "hollow_out_dialog.h"
+#include "import_mesh_dialog.h"
 #include "line_tool.h"
+#include "occupancy_mask.h"
 #include "pencil_tool.h"
+#include "place_prefab_dialog.h"
+#include "prefab.h"
 #include "rectangle_tool.h"
+#include "replace_blocks_dialog.h"
+#include "scatter_tool.h"
 #include "sphere_tool.h"
 #include "tool_picker.h"
 #include "tree_tool.h"
 
+namespace {
+
+/**
+  * Returns the path of the file the 3D preview caches the geometry of the diagram at \p filename in.
+  */
+QString geometryCachePath(const QString& filename) {
+  return filename + ".geometry";
+}
+
+}  // namespace
+
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent),
       diagram_(NULL),
       block_mgr_(NULL),
       toolbox_initialized_(false),
       pending_action_(NULL),
-      bill_of_materials_window_(NULL) {
+      ground_level_(0),
+      bill_of_materials_window_(NULL),
+      redstone_simulator_(NULL),
+      preview_window_(NULL),
+      closing_(false) {
   ui.setupUi(this);
+  setAttribute(Qt::WA_DeleteOnClose, true);
 
   move(12, 12);
 #ifdef Q_OS_MACX
@@ -54,11 +90,15 @@ MainWindow::MainWindow(QWidget* parent)
   connect(ui.tool_picker_, SIGNAL(currentToolChanged(Tool*)), ui.level_widget_, SLOT(setSelectedTool(Tool*)));
 }
 
+MainWindow::~MainWindow() {
+}
+
 void MainWindow::setDiagram(Diagram* diagram) {
   diagram_ = diagram;
   ui.level_widget_->setDiagram(diagram);
   bill_of_materials_window_.reset(new BillOfMaterialsWindow(diagram));
   connect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), SLOT(setDocumentModified()));
+  connect(diagram_, SIGNAL(prefabsChanged()), SLOT(placementsChanged()));
 }
 
 void MainWindow::setBlockManager(BlockManager* block_mgr) {
@@ -66,6 +106,10 @@ void MainWindow::setBlockManager(BlockManager* block_mgr) {
   ui.level_widget_->setBlockManager(block_mgr);
 }
 
+void MainWindow::setPreviewWindow(GLPreviewWindow* preview_window) {
+  preview_window_.reset(preview_window);
+}
+
 void MainWindow::setupToolbox() {
   Q_ASSERT(block_mgr_);
   Q_ASSERT(diagram_);
@@ -89,6 +133,7 @@ void MainWindow::setupToolbox() {
   ui.tool_picker_->addTool(new FloodFillTool(diagram_), "Flood Fill", QIcon(":/icons/flood_fill_tool.png"));
   ui.tool_picker_->addTool(new TreeTool(diagram_, block_mgr_), "Tree", QIcon(":/icons/tree_tool.png"));
   ui.tool_picker_->addTool(new SphereTool(diagram_), "Sphere", QIcon(":/icons/sphere_tool.png"));
+  ui.tool_picker_->addTool(new ScatterTool(diagram_, block_mgr_), "Scatter", QIcon(":/icons/scatter_tool.png"));
 }
 
 void MainWindow::setTemplateImage() {
@@ -126,6 +171,10 @@ void MainWindow::about() {
   about_box->show();
 }
 
+void MainWindow::newWindow() {
+  Application::instance()->newDocument();
+}
+
 void MainWindow::open() {
   pending_action_ = ui.action_open_;
   if (isWindowModified()) {
@@ -170,8 +219,19 @@ void MainWindow::saveToFile(const QString& filename) {
       return;
     }
     QDataStream ostream(&file);
-    diagram_->save(&ostream);
+    int chunk_count;
+    int unique_chunk_count;
+    diagram_->save(&ostream, &chunk_count, &unique_chunk_count);
     file.close();
+    if (chunk_count > unique_chunk_count) {
+      QString message("Saved.  %1 of the diagram's %2 chunks repeat another chunk and were stored only once.");
+      statusBar()->showMessage(message.arg(chunk_count - unique_chunk_count).arg(chunk_count), 10000);
+    } else {
+      statusBar()->showMessage("Saved.", 10000);
+    }
+    if (preview_window_) {
+      preview_window_->glWidget()->saveGeometryCache(geometryCachePath(filename));
+    }
     setWindowFilePath(filename);
     setWindowTitle(QFileInfo(filename).fileName() + "[*]");
     setWindowModified(false);
@@ -192,6 +252,10 @@ void MainWindow::openFile(const QString& filename) {
     // TODO(phoenix): Handle unreadable files.
     return;
   }
+  if (preview_window_) {
+    // This has to come first, so that the preview can use the cache when it sees the blocks arrive.
+    preview_window_->glWidget()->loadGeometryCache(geometryCachePath(filename));
+  }
   QDataStream istream(&file);
   diagram_->load(&istream);
   file.close();
@@ -207,8 +271,409 @@ void MainWindow::showBillOfMaterials() {
   bill_of_materials_window_->setVisible(true);
 }
 
+void MainWindow::replaceBlocks() {
+  ReplaceBlocksDialog dialog(diagram_, block_mgr_, this);
+  int level = ui.level_widget_->level();
+  dialog.setLevelRange(level, level);
+  if (dialog.exec() == QDialog::Accepted) {
+    ui.level_widget_->replaceBlocks(dialog.sourceType(), dialog.destType(), dialog.minLevel(), dialog.maxLevel(),
+                                    dialog.preserveOrientation());
+  }
+}
+
+void MainWindow::hollowOut() {
+  HollowOutDialog dialog(this);
+  int level = ui.level_widget_->level();
+  dialog.setLevelRange(level, level);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+
+  BlockTransaction transaction;
+  int removed_count = diagram_->hollowOut(dialog.shellThickness(), dialog.minLevel(), dialog.maxLevel(), &transaction);
+  if (removed_count == 0) {
+    QMessageBox::information(this, "Hollow Out", "There are no hidden blocks to remove on those levels.");
+    return;
+  }
+  int total_count = diagram_->blockCount();
+  ui.level_widget_->commitTransaction(transaction, "Hollow Out");
+
+  // Report the drop in the bill of materials per block type, alongside what's left of each.
+  QMap<blocktype_t, int> removed_counts;
+  foreach (const BlockInstance& block, transaction.old_blocks()) {
+    ++removed_counts[block.prototype()->type()];
+  }
+  QMap<blocktype_t, int> remaining_counts = diagram_->blockCounts();
+  QStringList details;
+  QMap<blocktype_t, int>::const_iterator iter;
+  for (iter = removed_counts.constBegin(); iter != removed_counts.constEnd(); ++iter) {
+    details.append(QString("%1: %2 removed, %3 left").arg(block_mgr_->getPrototype(iter.key())->name())
+                                                        .arg(iter.value())
+                                                        .arg(remaining_counts.value(iter.key())));
+  }
+
+  QMessageBox report(this);
+  report.setIcon(QMessageBox::Information);
+  report.setWindowTitle("Hollow Out");
+  report.setText(QString("Removed %1 hidden blocks (%2% of the diagram).").arg(removed_count)
+                     .arg(100.0 * removed_count / total_count, 0, 'f', 1));
+  report.setDetailedText(details.join("\n"));
+  report.exec();
+}
+
+void MainWindow::createPrefab() {
+  CreatePrefabDialog dialog(this);
+  // Start from the box around the blocks on the current level.
+  int level = ui.level_widget_->level();
+  QHash<BlockPosition, BlockInstance> level_blocks = diagram_->level(level);
+  if (level_blocks.isEmpty()) {
+    dialog.setBounds(BlockPosition(0, level, 0), BlockPosition(0, level, 0));
+  } else {
+    const BlockPosition& first = level_blocks.constBegin().key();
+    int min_x = first.x(), max_x = first.x(), min_z = first.z(), max_z = first.z();
+    foreach (const BlockPosition& position, level_blocks.keys()) {
+      min_x = qMin(min_x, position.x());
+      max_x = qMax(max_x, position.x());
+      min_z = qMin(min_z, position.z());
+      max_z = qMax(max_z, position.z());
+    }
+    dialog.setBounds(BlockPosition(min_x, level, min_z), BlockPosition(max_x, level, max_z));
+  }
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+  if (dialog.name().isEmpty()) {
+    QMessageBox::information(this, "Create Prefab", "The prefab needs a name.");
+    return;
+  }
+  QList<BlockInstance> blocks = diagram_->blocksBetween(dialog.minCorner(), dialog.maxCorner());
+  if (blocks.isEmpty()) {
+    QMessageBox::information(this, "Create Prefab", "There are no blocks in that box to make a prefab from.");
+    return;
+  }
+
+  QList<Prefab> prefabs = diagram_->prefabs();
+  QList<PrefabPlacement> placements = diagram_->placements();
+  int index = diagram_->findPrefab(dialog.name());
+  QString action_name = "Create Prefab";
+  if (index < 0) {
+    index = prefabs.size();
+    prefabs.append(Prefab(dialog.name(), blocks));
+  } else {
+    // Every placement of the prefab picks up the new definition.
+    prefabs[index] = Prefab(dialog.name(), blocks);
+    action_name = "Redefine Prefab";
+  }
+
+  BlockTransaction transaction;
+  if (dialog.replaceWithPlacement()) {
+    // The prefab's corner is the corner of the box around its blocks, which may be inside the box the user gave.
+    BlockPosition corner = blocks.first().position();
+    foreach (const BlockInstance& block, blocks) {
+      const BlockPosition& position = block.position();
+      corner = BlockPosition(qMin(corner.x(), position.x()), qMin(corner.y(), position.y()),
+                             qMin(corner.z(), position.z()));
+      transaction.clearBlock(block);
+    }
+    placements.append(PrefabPlacement(index, corner, 0));
+  }
+  ui.level_widget_->commitPrefabs(prefabs, placements, transaction, action_name);
+}
+
+void MainWindow::placePrefab() {
+  if (diagram_->prefabs().isEmpty()) {
+    QMessageBox::information(this, "Place Prefab", "There are no prefabs to place.  Use Create Prefab to make one.");
+    return;
+  }
+  PlacePrefabDialog dialog(diagram_->prefabs(), this);
+  dialog.setOffset(BlockPosition(0, ui.level_widget_->level(), 0));
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+  QList<PrefabPlacement> placements = diagram_->placements();
+  placements.append(dialog.placement());
+  ui.level_widget_->commitPrefabs(diagram_->prefabs(), placements, BlockTransaction(), "Place Prefab");
+}
+
+void MainWindow::bakePrefabs() {
+  if (diagram_->placements().isEmpty()) {
+    QMessageBox::information(this, "Bake Prefabs", "There are no placed prefabs to bake.");
+    return;
+  }
+  // The prefabs stay in the library so they can be placed again; only the placements become ordinary blocks.
+  BlockTransaction transaction;
+  diagram_->bakePrefabs(&transaction);
+  ui.level_widget_->commitPrefabs(diagram_->prefabs(), QList<PrefabPlacement>(), transaction, "Bake Prefabs");
+}
+
+void MainWindow::generateVolume() {
+  GenerateVolumeDialog dialog(diagram_, block_mgr_, this);
+  dialog.setOrigin(BlockPosition(0, ui.level_widget_->level(), 0));
+  if (dialog.exec() == QDialog::Accepted) {
+    ui.level_widget_->commitTransaction(dialog.transaction(), "Generate Volume");
+  }
+}
+
+void MainWindow::generateTerrain() {
+  GenerateTerrainDialog dialog(diagram_, block_mgr_, this);
+  dialog.setLevel(ui.level_widget_->level());
+  if (dialog.exec() == QDialog::Accepted) {
+    ui.level_widget_->commitTransaction(dialog.transaction(), "Generate Terrain");
+  }
+}
+
+void MainWindow::convertTemplateImage() {
+  if (!ui.level_widget_->hasTemplateImage()) {
+    QMessageBox::information(this, "Convert Template to Blocks",
+                             "There is no template image to convert.  Choose one with Set Template Image first.");
+    return;
+  }
+  ConvertTemplateDialog dialog(block_mgr_, this);
+  if (dialog.exec() == QDialog::Accepted) {
+    ui.level_widget_->convertTemplateImage(dialog.palette(), dialog.cellSize(), dialog.dither());
+  }
+}
+
+void MainWindow::importHeightmap() {
+  GenerateTerrainDialog dialog(diagram_, block_mgr_, this);
+  dialog.setLevel(ui.level_widget_->level());
+  dialog.browseForHeightmap();
+  if (dialog.exec() == QDialog::Accepted) {
+    ui.level_widget_->commitTransaction(dialog.transaction(), "Import Heightmap");
+  }
+}
+
+void MainWindow::importMesh() {
+  ImportMeshDialog dialog(diagram_, block_mgr_, this);
+  dialog.setLevel(ui.level_widget_->level());
+  dialog.browseForMesh();
+  if (dialog.exec() == QDialog::Accepted) {
+    ui.level_widget_->commitTransaction(dialog.transaction(), "Import Mesh");
+  }
+}
+
+void MainWindow::simulateRedstone(bool simulated) {
+  if (simulated && refuseForPlacements(diagram_, "Simulate Redstone")) {
+    ui.action_simulate_redstone_->setChecked(false);
+    return;
+  }
+  if (!redstone_simulator_) {
+    redstone_simulator_.reset(new RedstoneSimulator(diagram_, block_mgr_));
+  }
+  redstone_simulator_->setRunning(simulated);
+}
+
+void MainWindow::showFloatingBlocks(bool shown) {
+  if (!shown) {
+    disconnect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), this, SLOT(updateFloatingBlocks()));
+    diagram_->clearHighlightedBlocks();
+    return;
+  }
+  ui.action_compare_with_file_->setChecked(false);
+
+  bool ok = false;
+  int ground_level = QInputDialog::getInt(this, "Show Floating Blocks", "Blocks are grounded on or below level:",
+                                          ground_level_, -64, 64, 1, &ok);
+  if (!ok) {
+    ui.action_show_floating_blocks_->setChecked(false);
+    return;
+  }
+  ground_level_ = ground_level;
+  int structure_count = highlightFloatingBlocks();
+  // Keep the highlight up to date while the user fixes things.
+  connect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), SLOT(updateFloatingBlocks()));
+
+  if (structure_count == 0) {
+    QMessageBox::information(this, "Show Floating Blocks",
+                             QString("Every block is connected to level %1.").arg(ground_level_));
+  } else {
+    QMessageBox::information(this, "Show Floating Blocks",
+                             QString("Found %1 floating structures (%2 blocks) that aren't connected to level %3.  "
+                                     "They are highlighted in red until Show Floating Blocks is turned off.")
+                                 .arg(structure_count)
+                                 .arg(diagram_->highlights().first().blocks.count())
+                                 .arg(ground_level_));
+  }
+}
+
+void MainWindow::updateFloatingBlocks() {
+  highlightFloatingBlocks();
+}
+
+int MainWindow::highlightFloatingBlocks() {
+  OccupancyMask blocks = diagram_->occupancyMask();
+  blocks.unite(diagram_->placedOccupancyMask());
+  OccupancyMask floating;
+  int structure_count = ConnectivityAnalyzer(&blocks).findFloatingBlocks(ground_level_, &floating);
+  diagram_->setHighlightedBlocks(floating, QColor(255, 0, 0));
+  return structure_count;
+}
+
+void MainWindow::compareWithFile(bool compared) {
+  if (!compared) {
+    disconnect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), this, SLOT(updateComparison(BlockTransaction)));
+    comparison_.reset();
+    comparison_diagram_.reset();
+    diagram_->clearHighlightedBlocks();
+    return;
+  }
+  ui.action_show_floating_blocks_->setChecked(false);
+  if (refuseForPlacements(diagram_, "Compare With File")) {
+    ui.action_compare_with_file_->setChecked(false);
+    return;
+  }
+
+  QString filename = QFileDialog::getOpenFileName(this, "Compare With File", QString(),
+                                                  "MCModeler diagrams (*.mcdiagram)");
+  if (!filename.isEmpty()) {
+    comparison_diagram_.reset(loadDiagram(filename));
+  }
+  if (comparison_diagram_ && refuseForPlacements(comparison_diagram_.data(), "Compare With File")) {
+    comparison_diagram_.reset();
+  }
+  if (!comparison_diagram_) {
+    ui.action_compare_with_file_->setChecked(false);
+    return;
+  }
+
+  int identical_chunk_count;
+  int chunk_count;
+  comparison_.reset(new DiagramDiff(comparison_diagram_.data(), diagram_, &identical_chunk_count, &chunk_count));
+  const DiagramDiff& diff = *comparison_;
+  highlightDifferences(diff);
+  // Keep the highlight up to date as the open diagram is edited.
+  connect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), SLOT(updateComparison(BlockTransaction)));
+
+  QMessageBox::information(this, "Compare With File",
+                           QString("Compared with %1: %2 blocks added (green), %3 removed (red) and %4 changed "
+                                   "(yellow).  %5 of %6 chunks were identical.")
+                               .arg(QFileInfo(filename).fileName())
+                               .arg(diff.addedBlocks().count())
+                               .arg(diff.removedBlocks().count())
+                               .arg(diff.changedBlocks().count())
+                               .arg(identical_chunk_count)
+                               .arg(chunk_count));
+}
+
+void MainWindow::updateComparison(const BlockTransaction& transaction) {
+  if (comparison_) {
+    comparison_->update(transaction);
+    highlightDifferences(*comparison_);
+  }
+}
+
+void MainWindow::placementsChanged() {
+  if (ui.action_show_floating_blocks_->isChecked()) {
+    highlightFloatingBlocks();
+  }
+  if (ui.action_compare_with_file_->isChecked() && refuseForPlacements(diagram_, "Compare With File")) {
+    ui.action_compare_with_file_->setChecked(false);
+  }
+  if (ui.action_simulate_redstone_->isChecked() && refuseForPlacements(diagram_, "Simulate Redstone")) {
+    ui.action_simulate_redstone_->setChecked(false);
+  }
+}
+
+bool MainWindow::refuseForPlacements(const Diagram* diagram, const QString& title) {
+  if (diagram->placements().isEmpty()) {
+    return false;
+  }
+  QMessageBox::information(this, title,
+                           QString("%1 only works on ordinary blocks, and %2 has placed prefabs.  Use Edit > Bake "
+                                   "Prefabs to turn them into ordinary blocks first.")
+                               .arg(title)
+                               .arg(diagram == diagram_ ? "this diagram" : "the other diagram"));
+  return true;
+}
+
+void MainWindow::highlightDifferences(const DiagramDiff& diff) {
+  QList<BlockHighlight> highlights;
+  highlights.append(BlockHighlight(diff.addedBlocks(), QColor(0, 192, 0)));
+  highlights.append(BlockHighlight(diff.removedBlocks(), QColor(255, 0, 0)));
+  highlights.append(BlockHighlight(diff.changedBlocks(), QColor(255, 224, 0)));
+  diagram_->setHighlights(highlights);
+}
+
+void MainWindow::mergeFromFile() {
+  if (refuseForPlacements(diagram_, "Merge From File")) {
+    return;
+  }
+  QString base_filename = QFileDialog::getOpenFileName(this, "Choose the Common Ancestor", QString(),
+                                                       "MCModeler diagrams (*.mcdiagram)");
+  if (base_filename.isEmpty()) {
+    return;
+  }
+  QString other_filename = QFileDialog::getOpenFileName(this, "Choose the Diagram to Merge In", QString(),
+                                                        "MCModeler diagrams (*.mcdiagram)");
+  if (other_filename.isEmpty()) {
+    return;
+  }
+  QScopedPointer<Diagram> base_diagram(loadDiagram(base_filename));
+  QScopedPointer<Diagram> other_diagram(loadDiagram(other_filename));
+  if (!base_diagram || !other_diagram || refuseForPlacements(base_diagram.data(), "Merge From File") ||
+      refuseForPlacements(other_diagram.data(), "Merge From File")) {
+    return;
+  }
+
+  DiagramDiff our_changes(base_diagram.data(), diagram_);
+  DiagramDiff their_changes(base_diagram.data(), other_diagram.data());
+  BlockTransaction transaction;
+  OccupancyMask conflicts;
+  int merged_count = DiagramDiff::merge(our_changes, their_changes, &transaction, &conflicts);
+  if (merged_count > 0) {
+    ui.level_widget_->commitTransaction(transaction, "Merge");
+  }
+
+  if (conflicts.isEmpty()) {
+    QMessageBox::information(this, "Merge From File",
+                             QString("Merged %1 changed blocks from %2.").arg(merged_count)
+                                 .arg(QFileInfo(other_filename).fileName()));
+    return;
+  }
+  ui.action_show_floating_blocks_->setChecked(false);
+  ui.action_compare_with_file_->setChecked(false);
+  diagram_->setHighlightedBlocks(conflicts, QColor(255, 128, 0));
+  QMessageBox::warning(this, "Merge From File",
+                       QString("Merged %1 changed blocks from %2.  %3 blocks were changed differently in both "
+                               "diagrams; your version of them was kept, and they are highlighted in orange.")
+                           .arg(merged_count)
+                           .arg(QFileInfo(other_filename).fileName())
+                           .arg(conflicts.count()));
+}
+
+void MainWindow::clearHighlights() {
+  ui.action_show_floating_blocks_->setChecked(false);
+  ui.action_compare_with_file_->setChecked(false);
+  diagram_->clearHighlightedBlocks();
+}
+
+Diagram* MainWindow::loadDiagram(const QString& filename) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    QMessageBox::warning(this, qAppName(),
+                         QString("%1 could not be opened.").arg(QFileInfo(filename).fileName()));
+    return NULL;
+  }
+  Diagram* diagram = new Diagram();
+  diagram->setBlockManager(block_mgr_);
+  QDataStream istream(&file);
+  diagram->load(&istream);
+  file.close();
+  return diagram;
+}
+
 void MainWindow::quit() {
-  pending_action_ = ui.action_quit_;
+  // Each diagram asks to be saved in turn, and the application quits once the last one is closed.
+  foreach (QWidget* widget, QApplication::topLevelWidgets()) {
+    MainWindow* main_window = qobject_cast<MainWindow*>(widget);
+    if (main_window && !main_window->closing_) {
+      main_window->closeDocument();
+    }
+  }
+}
+
+void MainWindow::closeDocument() {
+  pending_action_ = ui.action_close_;
   if (isWindowModified()) {
     maybeSave();
   } else {
@@ -217,7 +682,17 @@ void MainWindow::quit() {
 }
 
 void MainWindow::closeEvent(QCloseEvent* event) {
-  quit();
+  if (closing_) {
+    if (preview_window_) {
+      preview_window_->close();
+    }
+    if (bill_of_materials_window_) {
+      bill_of_materials_window_->close();
+    }
+    event->accept();
+    return;
+  }
+  closeDocument();
   event->ignore();
 }
 
@@ -229,8 +704,9 @@ bool MainWindow::event(QEvent* event) {
 }
 
 void MainWindow::performPendingAction() {
-  if (pending_action_ == ui.action_quit_) {
-    qApp->quit();
+  if (pending_action_ == ui.action_close_) {
+    closing_ = true;
+    close();
   } else if (pending_action_ == ui.action_open_) {
     doOpen();
   }
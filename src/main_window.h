@@ -18,10 +18,14 @@
 
 #include "ui_main_window.h"
 
-class Diagram;
 class BlockManager;
+class BlockTransaction;
+class Diagram;
+class DiagramDiff;
+class GLPreviewWindow;
 
 #include "bill_of_materials_window.h"
+#include "redstone_simulator.h"
 
 /**
   * The main window of the application.  This is where the BlockPicker and LevelWidget live.
@@ -31,13 +35,28 @@ class MainWindow : public QMainWindow {
 
  public:
   explicit MainWindow(QWidget* parent = NULL);
+  virtual ~MainWindow();
 
   void setDiagram(Diagram* diagram);
   void setBlockManager(BlockManager* block_mgr);
 
+  /**
+    * Sets the window showing the 3D preview of this window's diagram.  The main window takes ownership of it, and
+    * closes it along with itself.
+    */
+  void setPreviewWindow(GLPreviewWindow* preview_window);
+
+ public slots:
+  /**
+    * Closes this window and its diagram, asking to save any changes first.  When the last diagram is closed, the
+    * application quits.
+    */
+  void closeDocument();
+
  private slots:
   void about();
 
+  void newWindow();
   void open();
   void save();
   void saveAs();
@@ -53,6 +72,25 @@ class MainWindow : public QMainWindow {
 
   void showBillOfMaterials();
 
+  void replaceBlocks();
+  void hollowOut();
+  void createPrefab();
+  void placePrefab();
+  void bakePrefabs();
+  void generateVolume();
+  void generateTerrain();
+  void importHeightmap();
+  void convertTemplateImage();
+  void importMesh();
+  void simulateRedstone(bool simulated);
+  void showFloatingBlocks(bool shown);
+  void updateFloatingBlocks();
+  void compareWithFile(bool compared);
+  void updateComparison(const BlockTransaction& transaction);
+  void placementsChanged();
+  void mergeFromFile();
+  void clearHighlights();
+
  protected:
   virtual void closeEvent(QCloseEvent* event);
   virtual bool event(QEvent* event);
@@ -64,12 +102,49 @@ class MainWindow : public QMainWindow {
   void maybeSave();
   void performPendingAction();
 
+  /**
+    * Highlights the blocks that aren't connected to ground_level_.
+    * @return The number of separate floating structures.
+    */
+  int highlightFloatingBlocks();
+
+  /**
+    * Highlights the blocks that \p diff adds, removes and changes in green, red and yellow respectively.
+    */
+  void highlightDifferences(const DiagramDiff& diff);
+
+  /**
+    * Tells the user that \p title can't be used while \p diagram has placed prefabs, if it has any.  Comparing,
+    * merging and simulating redstone only work on a diagram's own blocks, since they change or show changes to blocks
+    * one at a time, and the blocks of placed prefabs can't be changed that way.
+    * @return \c true if \p diagram has placed prefabs.
+    */
+  bool refuseForPlacements(const Diagram* diagram, const QString& title);
+
+  /**
+    * Loads the diagram in \p filename into a new Diagram, which the caller owns.
+    * @return The new Diagram, or NULL if the file couldn't be read.
+    */
+  Diagram* loadDiagram(const QString& filename);
+
   Ui::MainWindow ui;
   Diagram* diagram_;
   BlockManager* block_mgr_;
   bool toolbox_initialized_;
   QAction* pending_action_;
+  int ground_level_;
   QScopedPointer<BillOfMaterialsWindow> bill_of_materials_window_;
+  QScopedPointer<RedstoneSimulator> redstone_simulator_;
+  QScopedPointer<GLPreviewWindow> preview_window_;
+
+  /// Set once the user has agreed to close the window, so that closeEvent() lets it close.
+  bool closing_;
+
+  /// The diagram being compared against while Compare With File is on.
+  QScopedPointer<Diagram> comparison_diagram_;
+
+  /// The differences between comparison_diagram_ and diagram_, kept up to date as diagram_ is edited.
+  QScopedPointer<DiagramDiff> comparison_;
 };
 
 #endif // MAIN_WINDOW_H
@@ -0,0 +1,329 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mesh_voxelizer.h"
+
+#include <QList>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <qmath.h>
+#include <string.h>
+
+#include "occupancy_mask.h"
+#include "triangle_mesh.h"
+
+namespace {
+
+/**
+  * Rays are cast a tiny, irrational-looking distance off the centre of each row of blocks, so that they almost never
+  * pass exactly through a vertex or along an edge shared by two triangles, which would count one crossing twice.
+  */
+const float kRayNudgeY = 1.4142e-4f;
+const float kRayNudgeZ = 1.7321e-4f;
+
+typedef QHash<BlockPosition, QVector<int> > TriangleBins;
+
+struct SurfaceVoxel {
+  int x;
+  int y;
+  int z;
+  QRgb color;
+};
+
+struct Run {
+  int x_begin;
+  int x_end;
+  int y;
+  int z;
+};
+
+inline int chunkIndex(float value) {
+  return qFloor(value / MeshVoxelizer::kChunkSize);
+}
+
+inline void subtract(const float* a, const float* b, float* result) {
+  result[0] = a[0] - b[0];
+  result[1] = a[1] - b[1];
+  result[2] = a[2] - b[2];
+}
+
+inline void cross(const float* a, const float* b, float* result) {
+  result[0] = a[1] * b[2] - a[2] * b[1];
+  result[1] = a[2] * b[0] - a[0] * b[2];
+  result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+inline float dot(const float* a, const float* b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/**
+  * Returns \c true if the triangle (\p a, \p b, \p c) touches the cube centred on \p center with half-width \p half.
+  * This is the separating axis test of Akenine-Moller: the two are disjoint if and only if they can be separated along
+  * one of the box's three axes, the triangle's normal, or the cross product of a box axis with a triangle edge.
+  */
+bool triangleOverlapsBox(const float* center, float half, const float* a, const float* b, const float* c) {
+  float v[3][3];
+  subtract(a, center, v[0]);
+  subtract(b, center, v[1]);
+  subtract(c, center, v[2]);
+
+  // The box's own axes.
+  for (int axis = 0; axis < 3; ++axis) {
+    if (qMin(v[0][axis], qMin(v[1][axis], v[2][axis])) > half ||
+        qMax(v[0][axis], qMax(v[1][axis], v[2][axis])) < -half) {
+      return false;
+    }
+  }
+
+  // The nine edge/axis cross products.
+  float edges[3][3];
+  subtract(v[1], v[0], edges[0]);
+  subtract(v[2], v[1], edges[1]);
+  subtract(v[0], v[2], edges[2]);
+  for (int edge = 0; edge < 3; ++edge) {
+    for (int axis = 0; axis < 3; ++axis) {
+      float unit[3] = { 0.0f, 0.0f, 0.0f };
+      unit[axis] = 1.0f;
+      float separator[3];
+      cross(edges[edge], unit, separator);
+      float p0 = dot(separator, v[0]);
+      float p1 = dot(separator, v[1]);
+      float p2 = dot(separator, v[2]);
+      float radius = half * (qAbs(separator[0]) + qAbs(separator[1]) + qAbs(separator[2]));
+      if (qMin(p0, qMin(p1, p2)) > radius || qMax(p0, qMax(p1, p2)) < -radius) {
+        return false;
+      }
+    }
+  }
+
+  // The triangle's plane.  The box corner furthest along the normal must be on or past the plane, and the nearest
+  // corner on or before it.
+  float normal[3];
+  cross(edges[0], edges[1], normal);
+  float nearest[3];
+  float furthest[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    nearest[axis] = (normal[axis] > 0.0f ? -half : half) - v[0][axis];
+    furthest[axis] = (normal[axis] > 0.0f ? half : -half) - v[0][axis];
+  }
+  return dot(normal, nearest) <= 0.0f && dot(normal, furthest) >= 0.0f;
+}
+
+/**
+  * Finds the surface blocks in one chunk.  Used as a QtConcurrent map functor.
+  */
+class SurfaceChunkVoxelizer {
+ public:
+  typedef QVector<SurfaceVoxel> result_type;
+
+  SurfaceChunkVoxelizer(const QVector<float>* positions, const TriangleMesh* mesh, const TriangleBins* bins)
+      : positions_(positions), mesh_(mesh), bins_(bins) {}
+
+  QVector<SurfaceVoxel> operator()(const BlockPosition& chunk) const {
+    const int size = MeshVoxelizer::kChunkSize;
+    const QVector<int>& triangles = bins_->constFind(chunk).value();
+    int base[3] = { chunk.x() * size, chunk.y() * size, chunk.z() * size };
+
+    // Blocks already found in this chunk, so that each is reported once, with the colour of the first triangle found.
+    quint64 seen[size * size * size / 64];
+    memset(seen, 0, sizeof(seen));
+
+    QVector<SurfaceVoxel> voxels;
+    foreach (int triangle_index, triangles) {
+      const TriangleMesh::Triangle& triangle = mesh_->triangles().at(triangle_index);
+      const float* corners[3];
+      for (int corner = 0; corner < 3; ++corner) {
+        corners[corner] = positions_->constData() + 3 * triangle.vertices[corner];
+      }
+      int low[3];
+      int high[3];
+      for (int axis = 0; axis < 3; ++axis) {
+        float min = qMin(corners[0][axis], qMin(corners[1][axis], corners[2][axis]));
+        float max = qMax(corners[0][axis], qMax(corners[1][axis], corners[2][axis]));
+        low[axis] = qMax(qFloor(min), base[axis]);
+        high[axis] = qMin(qFloor(max), base[axis] + size - 1);
+      }
+      for (int z = low[2]; z <= high[2]; ++z) {
+        for (int y = low[1]; y <= high[1]; ++y) {
+          for (int x = low[0]; x <= high[0]; ++x) {
+            int bit = ((z - base[2]) * size + (y - base[1])) * size + (x - base[0]);
+            if (seen[bit / 64] & (Q_UINT64_C(1) << (bit % 64))) {
+              continue;
+            }
+            float center[3] = { x + 0.5f, y + 0.5f, z + 0.5f };
+            if (triangleOverlapsBox(center, 0.5f, corners[0], corners[1], corners[2])) {
+              seen[bit / 64] |= Q_UINT64_C(1) << (bit % 64);
+              SurfaceVoxel voxel = { x, y, z, triangle.color };
+              voxels.append(voxel);
+            }
+          }
+        }
+      }
+    }
+    return voxels;
+  }
+
+ private:
+  const QVector<float>* positions_;
+  const TriangleMesh* mesh_;
+  const TriangleBins* bins_;
+};
+
+/**
+  * Fills the inside of the mesh along one bundle of kChunkSize x kChunkSize rows.  Used as a QtConcurrent map functor.
+  */
+class ScanlineFiller {
+ public:
+  typedef QVector<Run> result_type;
+
+  ScanlineFiller(const QVector<float>* positions, const TriangleMesh* mesh, const TriangleBins* bins)
+      : positions_(positions), mesh_(mesh), bins_(bins) {}
+
+  QVector<Run> operator()(const BlockPosition& bundle) const {
+    const int size = MeshVoxelizer::kChunkSize;
+    const QVector<int>& triangles = bins_->constFind(bundle).value();
+    int base_y = bundle.y() * size;
+    int base_z = bundle.z() * size;
+
+    // The x coordinate of every crossing of every row in the bundle.
+    QVector< QVector<float> > crossings(size * size);
+    foreach (int triangle_index, triangles) {
+      const TriangleMesh::Triangle& triangle = mesh_->triangles().at(triangle_index);
+      const float* a = positions_->constData() + 3 * triangle.vertices[0];
+      const float* b = positions_->constData() + 3 * triangle.vertices[1];
+      const float* c = positions_->constData() + 3 * triangle.vertices[2];
+      float uy = b[1] - a[1];
+      float uz = b[2] - a[2];
+      float vy = c[1] - a[1];
+      float vz = c[2] - a[2];
+      float determinant = uy * vz - vy * uz;
+      if (qAbs(determinant) < 1e-12f) {
+        continue;  // Edge-on to the rays.
+      }
+      int low_y = qMax(qCeil(qMin(a[1], qMin(b[1], c[1])) - 0.5f - kRayNudgeY), base_y);
+      int high_y = qMin(qFloor(qMax(a[1], qMax(b[1], c[1])) - 0.5f - kRayNudgeY), base_y + size - 1);
+      int low_z = qMax(qCeil(qMin(a[2], qMin(b[2], c[2])) - 0.5f - kRayNudgeZ), base_z);
+      int high_z = qMin(qFloor(qMax(a[2], qMax(b[2], c[2])) - 0.5f - kRayNudgeZ), base_z + size - 1);
+      for (int z = low_z; z <= high_z; ++z) {
+        float qz = z + 0.5f + kRayNudgeZ - a[2];
+        for (int y = low_y; y <= high_y; ++y) {
+          float qy = y + 0.5f + kRayNudgeY - a[1];
+          float w1 = (qy * vz - vy * qz) / determinant;
+          float w2 = (uy * qz - qy * uz) / determinant;
+          if (w1 < 0.0f || w2 < 0.0f || w1 + w2 > 1.0f) {
+            continue;
+          }
+          crossings[(z - base_z) * size + (y - base_y)].append(a[0] + w1 * (b[0] - a[0]) + w2 * (c[0] - a[0]));
+        }
+      }
+    }
+
+    QVector<Run> runs;
+    for (int i = 0; i < crossings.size(); ++i) {
+      QVector<float>& row = crossings[i];
+      qSort(row);
+      // Blocks whose centres lie between an entry and the following exit are inside.  An odd crossing left over at the
+      // end means the mesh has a hole, and is ignored.
+      for (int j = 0; j + 1 < row.size(); j += 2) {
+        Run run = { qCeil(row[j] - 0.5f), qCeil(row[j + 1] - 0.5f), base_y + i % size, base_z + i / size };
+        if (run.x_end > run.x_begin) {
+          runs.append(run);
+        }
+      }
+    }
+    return runs;
+  }
+
+ private:
+  const QVector<float>* positions_;
+  const TriangleMesh* mesh_;
+  const TriangleBins* bins_;
+};
+
+}  // namespace
+
+MeshVoxelizer::MeshVoxelizer(const TriangleMesh* mesh, float scale, const QVector3D& offset, bool z_up)
+    : mesh_(mesh), scale_(scale), offset_(offset), z_up_(z_up) {
+  Q_ASSERT(mesh_);
+}
+
+void MeshVoxelizer::voxelize(Mode mode, OccupancyMask* mask, QHash<BlockPosition, QRgb>* colors) const {
+  Q_ASSERT(mask);
+
+  // Move every vertex into block coordinates up front, packed as plain floats for the inner loops.
+  const QVector<QVector3D>& vertices = mesh_->vertices();
+  QVector<float> positions(vertices.size() * 3);
+  for (int i = 0; i < vertices.size(); ++i) {
+    QVector3D vertex = vertices[i];
+    if (z_up_) {
+      vertex = QVector3D(vertex.x(), vertex.z(), -vertex.y());
+    }
+    vertex = vertex * scale_ + offset_;
+    positions[3 * i] = vertex.x();
+    positions[3 * i + 1] = vertex.y();
+    positions[3 * i + 2] = vertex.z();
+  }
+
+  // Sort the triangles into the chunks their bounding boxes touch, and into bundles of rows by their y and z extents.
+  TriangleBins chunk_bins;
+  TriangleBins bundle_bins;
+  const QVector<TriangleMesh::Triangle>& triangles = mesh_->triangles();
+  for (int t = 0; t < triangles.size(); ++t) {
+    int low[3];
+    int high[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      float min = positions[3 * triangles[t].vertices[0] + axis];
+      float max = min;
+      for (int corner = 1; corner < 3; ++corner) {
+        min = qMin(min, positions[3 * triangles[t].vertices[corner] + axis]);
+        max = qMax(max, positions[3 * triangles[t].vertices[corner] + axis]);
+      }
+      low[axis] = chunkIndex(min);
+      high[axis] = chunkIndex(max);
+    }
+    for (int z = low[2]; z <= high[2]; ++z) {
+      for (int y = low[1]; y <= high[1]; ++y) {
+        for (int x = low[0]; x <= high[0]; ++x) {
+          chunk_bins[BlockPosition(x, y, z)].append(t);
+        }
+        if (mode == kSolid) {
+          bundle_bins[BlockPosition(0, y, z)].append(t);
+        }
+      }
+    }
+  }
+
+  QList< QVector<SurfaceVoxel> > chunk_voxels = QtConcurrent::blockingMapped< QList< QVector<SurfaceVoxel> > >(
+      chunk_bins.keys(), SurfaceChunkVoxelizer(&positions, mesh_, &chunk_bins));
+  foreach (const QVector<SurfaceVoxel>& voxels, chunk_voxels) {
+    foreach (const SurfaceVoxel& voxel, voxels) {
+      mask->insertRun(voxel.x, voxel.x + 1, voxel.y, voxel.z);
+      if (colors && qAlpha(voxel.color) != 0) {
+        colors->insert(BlockPosition(voxel.x, voxel.y, voxel.z), voxel.color);
+      }
+    }
+  }
+
+  if (mode == kSolid) {
+    QList< QVector<Run> > bundle_runs = QtConcurrent::blockingMapped< QList< QVector<Run> > >(
+        bundle_bins.keys(), ScanlineFiller(&positions, mesh_, &bundle_bins));
+    foreach (const QVector<Run>& runs, bundle_runs) {
+      foreach (const Run& run, runs) {
+        mask->insertRun(run.x_begin, run.x_end, run.y, run.z);
+      }
+    }
+  }
+}
@@ -0,0 +1,71 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MESH_VOXELIZER_H
+#define MESH_VOXELIZER_H
+
+#include <QColor>
+#include <QHash>
+#include <QVector3D>
+
+#include "block_position.h"
+
+class OccupancyMask;
+class TriangleMesh;
+
+/**
+  * Turns a TriangleMesh into blocks.
+  *
+  * The surface is found by testing every block that a triangle's bounding box touches against the triangle itself
+  * with an exact triangle/box overlap test, so that every block the surface passes through is included, however thin
+  * the triangle.  For solid voxelization, the inside is found by casting a ray along x through the centre of every row
+  * of blocks and filling between alternate crossings of the surface, which works for any closed mesh.
+  *
+  * Triangles are sorted into the chunks (cubes of kChunkSize blocks) that their bounding boxes touch, and each chunk is
+  * voxelized as a separate task on the global thread pool; likewise the rows of the solid fill are cast in square
+  * bundles of kChunkSize by kChunkSize.
+  */
+class MeshVoxelizer {
+ public:
+  /** The edge length, in blocks, of the chunks that are voxelized on each thread. */
+  static const int kChunkSize = 16;
+
+  enum Mode {
+    kSurface,
+    kSolid
+  };
+
+  /**
+    * Creates a MeshVoxelizer.  Each vertex v of \p mesh lands at v * \p scale + \p offset in block coordinates, after
+    * rotating the mesh so that its z axis points up if \p z_up is \c true.  The block at (x, y, z) spans x to x + 1
+    * and so on.
+    */
+  MeshVoxelizer(const TriangleMesh* mesh, float scale, const QVector3D& offset, bool z_up);
+
+  /**
+    * Adds the blocks covered by the mesh to \p mask.
+    * @param colors If not NULL, receives the colour of the triangle that put each surface block in the mask, for
+    *               triangles that have a colour.
+    */
+  void voxelize(Mode mode, OccupancyMask* mask, QHash<BlockPosition, QRgb>* colors) const;
+
+ private:
+  const TriangleMesh* mesh_;
+  float scale_;
+  QVector3D offset_;
+  bool z_up_;
+};
+
+#endif // MESH_VOXELIZER_H
@@ -50,6 +50,16 @@ void MouselookCam::apply() {
   glLoadMatrixf(cameraMatrix().data());
 }
 
+QVector3D MouselookCam::eyePosition() {
+  // The camera matrix takes world coordinates to eye coordinates, so the eye is where it takes the origin from:
+  // -R^T * t, where R is the rotation and t the translation.
+  Matrix m = cameraMatrix();
+  const GLfloat* d = m.data();
+  return QVector3D(-(d[0] * d[12] + d[1] * d[13] + d[2] * d[14]),
+                   -(d[4] * d[12] + d[5] * d[13] + d[6] * d[14]),
+                   -(d[8] * d[12] + d[9] * d[13] + d[10] * d[14]));
+}
+
 QString MouselookCam::debugMatrix() {
   Matrix m = cameraMatrix();
   static const int field_width = 6;
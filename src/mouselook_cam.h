@@ -37,6 +37,11 @@ class MouselookCam : public CameraInterface {
   virtual void applyRotation();
   virtual void apply();
 
+  /**
+    * Returns where the camera is, in world coordinates.
+    */
+  QVector3D eyePosition();
+
   QString debugMatrix();
  private:
   Matrix cameraMatrix();
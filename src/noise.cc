@@ -0,0 +1,141 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "noise.h"
+
+#include <qmath.h>
+
+namespace {
+
+/**
+  * Scrambles the bits of \p value so that nearby inputs give unrelated outputs.
+  */
+inline quint32 mix(quint32 value) {
+  value ^= value >> 16;
+  value *= 0x7feb352dU;
+  value ^= value >> 15;
+  value *= 0x846ca68bU;
+  value ^= value >> 16;
+  return value;
+}
+
+/**
+  * Maps the low 24 bits of \p hash onto [-1, 1].
+  */
+inline float toUnit(quint32 hash) {
+  return static_cast<float>(hash & 0xffffff) * (2.0f / 16777215.0f) - 1.0f;
+}
+
+/**
+  * The smoothstep curve, which gives the interpolated noise a continuous first derivative at the lattice points.
+  */
+inline float fade(float t) {
+  return t * t * (3.0f - 2.0f * t);
+}
+
+inline float lerp(float a, float b, float t) {
+  return a + (b - a) * t;
+}
+
+}  // namespace
+
+ValueNoise::ValueNoise(quint32 seed) : seed_(mix(seed + 0x9e3779b9U)) {
+}
+
+float ValueNoise::lattice(int x, int z) const {
+  return toUnit(mix(seed_ ^ mix(static_cast<quint32>(x) * 0x27d4eb2dU ^ mix(static_cast<quint32>(z)))));
+}
+
+float ValueNoise::lattice(int x, int y, int z) const {
+  return toUnit(mix(seed_ ^ mix(static_cast<quint32>(x) * 0x27d4eb2dU ^
+                                mix(static_cast<quint32>(y) * 0x165667b1U ^ mix(static_cast<quint32>(z))))));
+}
+
+float ValueNoise::sample(float x, float z) const {
+  int x0 = qFloor(x);
+  int z0 = qFloor(z);
+  float u = fade(x - x0);
+  float v = fade(z - z0);
+  return lerp(lerp(lattice(x0, z0), lattice(x0 + 1, z0), u),
+              lerp(lattice(x0, z0 + 1), lattice(x0 + 1, z0 + 1), u),
+              v);
+}
+
+float ValueNoise::sample(float x, float y, float z) const {
+  int x0 = qFloor(x);
+  int y0 = qFloor(y);
+  int z0 = qFloor(z);
+  float u = fade(x - x0);
+  float v = fade(y - y0);
+  float w = fade(z - z0);
+  float front = lerp(lerp(lattice(x0, y0, z0), lattice(x0 + 1, y0, z0), u),
+                    lerp(lattice(x0, y0 + 1, z0), lattice(x0 + 1, y0 + 1, z0), u),
+                    v);
+  float back = lerp(lerp(lattice(x0, y0, z0 + 1), lattice(x0 + 1, y0, z0 + 1), u),
+                   lerp(lattice(x0, y0 + 1, z0 + 1), lattice(x0 + 1, y0 + 1, z0 + 1), u),
+                   v);
+  return lerp(front, back, w);
+}
+
+void ValueNoise::fractalRow(float x, float z, float step, int count, int octaves, float persistence,
+                            float* results) const {
+  for (int i = 0; i < count; ++i) {
+    results[i] = 0.0f;
+  }
+  float frequency = 1.0f;
+  float amplitude = 1.0f;
+  float total_amplitude = 0.0f;
+  for (int octave = 0; octave < octaves; ++octave) {
+    float octave_z = z * frequency;
+    for (int i = 0; i < count; ++i) {
+      results[i] += amplitude * sample((x + i * step) * frequency, octave_z);
+    }
+    total_amplitude += amplitude;
+    frequency *= 2.0f;
+    amplitude *= persistence;
+  }
+  if (total_amplitude > 0.0f) {
+    float scale = 1.0f / total_amplitude;
+    for (int i = 0; i < count; ++i) {
+      results[i] *= scale;
+    }
+  }
+}
+
+void ValueNoise::fractalRow(float x, float y, float z, float step, int count, int octaves, float persistence,
+                            float* results) const {
+  for (int i = 0; i < count; ++i) {
+    results[i] = 0.0f;
+  }
+  float frequency = 1.0f;
+  float amplitude = 1.0f;
+  float total_amplitude = 0.0f;
+  for (int octave = 0; octave < octaves; ++octave) {
+    float octave_y = y * frequency;
+    float octave_z = z * frequency;
+    for (int i = 0; i < count; ++i) {
+      results[i] += amplitude * sample((x + i * step) * frequency, octave_y, octave_z);
+    }
+    total_amplitude += amplitude;
+    frequency *= 2.0f;
+    amplitude *= persistence;
+  }
+  if (total_amplitude > 0.0f) {
+    float scale = 1.0f / total_amplitude;
+    for (int i = 0; i < count; ++i) {
+      results[i] *= scale;
+    }
+  }
+}
@@ -0,0 +1,67 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <QtGlobal>
+
+/**
+  * Deterministic value noise in two and three dimensions.
+  *
+  * Every integer lattice point gets a pseudo-random value in [-1, 1] derived only from its coordinates and the seed,
+  * and values between lattice points are smoothly interpolated.  The same seed therefore always produces the same
+  * noise on every machine and every run, and any region can be evaluated independently of any other, which makes it
+  * safe to evaluate from several threads at once.
+  *
+  * The fractal*() methods sum several octaves of noise, each at twice the frequency and \p persistence times the
+  * amplitude of the last, and normalize the result back into [-1, 1].  The *Row() variants evaluate a whole row of
+  * samples at once, one octave at a time, so that the inner loops run over plain float arrays.
+  */
+class ValueNoise {
+ public:
+  explicit ValueNoise(quint32 seed);
+
+  /**
+    * Returns the noise value at (\p x, \p z).
+    */
+  float sample(float x, float z) const;
+
+  /**
+    * Returns the noise value at (\p x, \p y, \p z).
+    */
+  float sample(float x, float y, float z) const;
+
+  /**
+    * Evaluates fractal noise at \p count points starting at (\p x, \p z) and stepping \p step along x, writing the
+    * results to \p results.
+    */
+  void fractalRow(float x, float z, float step, int count, int octaves, float persistence, float* results) const;
+
+  /**
+    * Evaluates fractal noise at \p count points starting at (\p x, \p y, \p z) and stepping \p step along x, writing
+    * the results to \p results.
+    */
+  void fractalRow(float x, float y, float z, float step, int count, int octaves, float persistence,
+                  float* results) const;
+
+ private:
+  float lattice(int x, int z) const;
+  float lattice(int x, int y, int z) const;
+
+  quint32 seed_;
+};
+
+#endif // NOISE_H
@@ -0,0 +1,268 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "occupancy_mask.h"
+
+#include <string.h>
+
+namespace {
+
+const int kRowsPerWord = 64 / OccupancyMask::kChunkSize;
+const quint64 kRowMask = (Q_UINT64_C(1) << OccupancyMask::kChunkSize) - 1;
+
+/** The number of words that hold one slice of constant z. */
+const int kWordsPerSlice = OccupancyMask::kChunkSize / kRowsPerWord;
+
+/** The bits for x = 0 and x = kChunkSize - 1 in every row of a word. */
+const quint64 kFirstColumnBits = Q_UINT64_C(0x0001000100010001);
+const quint64 kLastColumnBits = Q_UINT64_C(0x8000800080008000);
+
+/**
+  * Divides \p value by kChunkSize, rounding towards negative infinity.
+  */
+int chunkIndex(int value) {
+  return (value >= 0 ? value : value - OccupancyMask::kChunkSize + 1) / OccupancyMask::kChunkSize;
+}
+
+/**
+  * Returns word \p index of \p words, or 0 if \p words is NULL (an empty chunk).
+  */
+quint64 wordAt(const quint64* words, int index) {
+  return words ? words[index] : 0;
+}
+
+/**
+  * Returns the number of set bits in \p word.
+  */
+int popCount(quint64 word) {
+  word = word - ((word >> 1) & Q_UINT64_C(0x5555555555555555));
+  word = (word & Q_UINT64_C(0x3333333333333333)) + ((word >> 2) & Q_UINT64_C(0x3333333333333333));
+  word = (word + (word >> 4)) & Q_UINT64_C(0x0f0f0f0f0f0f0f0f);
+  return static_cast<int>((word * Q_UINT64_C(0x0101010101010101)) >> 56);
+}
+
+}  // namespace
+
+OccupancyMask::OccupancyMask() {
+}
+
+qint64 OccupancyMask::count() const {
+  qint64 total = 0;
+  QHash<BlockPosition, Chunk>::const_iterator iter;
+  for (iter = chunks_.constBegin(); iter != chunks_.constEnd(); ++iter) {
+    const quint64* words = iter.value().words;
+    for (int i = 0; i < kWordsPerChunk; ++i) {
+      total += popCount(words[i]);
+    }
+  }
+  return total;
+}
+
+bool OccupancyMask::contains(const BlockPosition& position) const {
+  BlockPosition chunk_position(chunkIndex(position.x()), chunkIndex(position.y()), chunkIndex(position.z()));
+  QHash<BlockPosition, Chunk>::const_iterator iter = chunks_.constFind(chunk_position);
+  if (iter == chunks_.constEnd()) {
+    return false;
+  }
+  int x = position.x() - chunk_position.x() * kChunkSize;
+  int y = position.y() - chunk_position.y() * kChunkSize;
+  int z = position.z() - chunk_position.z() * kChunkSize;
+  int row = z * kChunkSize + y;
+  return (iter.value().words[row / kRowsPerWord] >> ((row % kRowsPerWord) * kChunkSize + x)) & 1;
+}
+
+OccupancyMask::Chunk& OccupancyMask::chunkFor(const BlockPosition& chunk_position) {
+  QHash<BlockPosition, Chunk>::iterator iter = chunks_.find(chunk_position);
+  if (iter == chunks_.end()) {
+    Chunk empty;
+    memset(empty.words, 0, sizeof(empty.words));
+    iter = chunks_.insert(chunk_position, empty);
+  }
+  return iter.value();
+}
+
+const quint64* OccupancyMask::chunkWords(const BlockPosition& chunk_position) const {
+  QHash<BlockPosition, Chunk>::const_iterator iter = chunks_.constFind(chunk_position);
+  return iter == chunks_.constEnd() ? NULL : iter.value().words;
+}
+
+void OccupancyMask::insert(const BlockPosition& position) {
+  insertRun(position.x(), position.x() + 1, position.y(), position.z());
+}
+
+void OccupancyMask::insertRun(int x_begin, int x_end, int y, int z) {
+  int chunk_y = chunkIndex(y);
+  int chunk_z = chunkIndex(z);
+  int row = (z - chunk_z * kChunkSize) * kChunkSize + (y - chunk_y * kChunkSize);
+  int shift = (row % kRowsPerWord) * kChunkSize;
+  int x = x_begin;
+  while (x < x_end) {
+    int chunk_x = chunkIndex(x);
+    int local_begin = x - chunk_x * kChunkSize;
+    int local_end = qMin(x_end - chunk_x * kChunkSize, kChunkSize);
+    quint64 bits = (kRowMask >> (kChunkSize - (local_end - local_begin))) << local_begin;
+    chunkFor(BlockPosition(chunk_x, chunk_y, chunk_z)).words[row / kRowsPerWord] |= bits << shift;
+    x = (chunk_x + 1) * kChunkSize;
+  }
+}
+
+void OccupancyMask::unite(const OccupancyMask& other) {
+  QHash<BlockPosition, Chunk>::const_iterator iter;
+  for (iter = other.chunks_.constBegin(); iter != other.chunks_.constEnd(); ++iter) {
+    QHash<BlockPosition, Chunk>::iterator mine = chunks_.find(iter.key());
+    if (mine == chunks_.end()) {
+      chunks_.insert(iter.key(), iter.value());
+      continue;
+    }
+    quint64* words = mine.value().words;
+    const quint64* other_words = iter.value().words;
+    for (int i = 0; i < kWordsPerChunk; ++i) {
+      words[i] |= other_words[i];
+    }
+  }
+}
+
+void OccupancyMask::intersect(const OccupancyMask& other) {
+  QHash<BlockPosition, Chunk>::iterator iter = chunks_.begin();
+  while (iter != chunks_.end()) {
+    QHash<BlockPosition, Chunk>::const_iterator theirs = other.chunks_.constFind(iter.key());
+    if (theirs == other.chunks_.constEnd()) {
+      iter = chunks_.erase(iter);
+      continue;
+    }
+    quint64* words = iter.value().words;
+    const quint64* other_words = theirs.value().words;
+    quint64 any = 0;
+    for (int i = 0; i < kWordsPerChunk; ++i) {
+      words[i] &= other_words[i];
+      any |= words[i];
+    }
+    if (any) {
+      ++iter;
+    } else {
+      iter = chunks_.erase(iter);
+    }
+  }
+}
+
+void OccupancyMask::subtract(const OccupancyMask& other) {
+  QHash<BlockPosition, Chunk>::iterator iter = chunks_.begin();
+  while (iter != chunks_.end()) {
+    QHash<BlockPosition, Chunk>::const_iterator theirs = other.chunks_.constFind(iter.key());
+    if (theirs == other.chunks_.constEnd()) {
+      ++iter;
+      continue;
+    }
+    quint64* words = iter.value().words;
+    const quint64* other_words = theirs.value().words;
+    quint64 any = 0;
+    for (int i = 0; i < kWordsPerChunk; ++i) {
+      words[i] &= ~other_words[i];
+      any |= words[i];
+    }
+    if (any) {
+      ++iter;
+    } else {
+      iter = chunks_.erase(iter);
+    }
+  }
+}
+
+OccupancyMask OccupancyMask::eroded() const {
+  OccupancyMask result;
+  QHash<BlockPosition, Chunk>::const_iterator iter;
+  for (iter = chunks_.constBegin(); iter != chunks_.constEnd(); ++iter) {
+    const BlockPosition& key = iter.key();
+    const quint64* words = iter.value().words;
+    const quint64* east = chunkWords(key + BlockPosition(1, 0, 0));
+    const quint64* west = chunkWords(key + BlockPosition(-1, 0, 0));
+    const quint64* above = chunkWords(key + BlockPosition(0, 1, 0));
+    const quint64* below = chunkWords(key + BlockPosition(0, -1, 0));
+    const quint64* south = chunkWords(key + BlockPosition(0, 0, 1));
+    const quint64* north = chunkWords(key + BlockPosition(0, 0, -1));
+
+    Chunk chunk;
+    quint64 any = 0;
+    for (int i = 0; i < kWordsPerChunk; ++i) {
+      quint64 word = words[i];
+      if (!word) {
+        chunk.words[i] = 0;
+        continue;
+      }
+      int z = i / kWordsPerSlice;
+      int quarter = i % kWordsPerSlice;
+
+      // Line each neighbour up with the bit it borders, filling in the bits that come from the next word or chunk.
+      quint64 plus_x = ((word >> 1) & ~kLastColumnBits) |
+                       ((wordAt(east, i) & kFirstColumnBits) << (kChunkSize - 1));
+      quint64 minus_x = ((word << 1) & ~kFirstColumnBits) |
+                        ((wordAt(west, i) & kLastColumnBits) >> (kChunkSize - 1));
+      quint64 next_rows = (quarter + 1 < kWordsPerSlice) ? words[i + 1] : wordAt(above, i - quarter);
+      quint64 plus_y = (word >> kChunkSize) | (next_rows << (64 - kChunkSize));
+      quint64 previous_rows = (quarter > 0) ? words[i - 1] : wordAt(below, i + kWordsPerSlice - 1);
+      quint64 minus_y = (word << kChunkSize) | (previous_rows >> (64 - kChunkSize));
+      quint64 plus_z = (z + 1 < kChunkSize) ? words[i + kWordsPerSlice] : wordAt(south, quarter);
+      quint64 minus_z = (z > 0) ? words[i - kWordsPerSlice] : wordAt(north, i + kWordsPerChunk - kWordsPerSlice);
+
+      chunk.words[i] = word & plus_x & minus_x & plus_y & minus_y & plus_z & minus_z;
+      any |= chunk.words[i];
+    }
+    if (any) {
+      result.chunks_.insert(key, chunk);
+    }
+  }
+  return result;
+}
+
+void OccupancyMask::visitRuns(ShapeRasterizer::RunVisitor* visitor) const {
+  QHash<BlockPosition, Chunk>::const_iterator iter;
+  for (iter = chunks_.constBegin(); iter != chunks_.constEnd(); ++iter) {
+    int base_x = iter.key().x() * kChunkSize;
+    int base_y = iter.key().y() * kChunkSize;
+    int base_z = iter.key().z() * kChunkSize;
+    const quint64* words = iter.value().words;
+    for (int word_index = 0; word_index < kWordsPerChunk; ++word_index) {
+      quint64 word = words[word_index];
+      if (!word) {
+        continue;
+      }
+      for (int lane = 0; lane < kRowsPerWord; ++lane) {
+        quint64 bits = (word >> (lane * kChunkSize)) & kRowMask;
+        int row = word_index * kRowsPerWord + lane;
+        int x = 0;
+        while (bits) {
+          // Skip the zeros, then measure the run of ones.
+          while (!(bits & 1)) {
+            bits >>= 1;
+            ++x;
+          }
+          int run_start = x;
+          while (bits & 1) {
+            bits >>= 1;
+            ++x;
+          }
+          visitor->visitRun(base_x + run_start, base_x + x, base_y + row % kChunkSize, base_z + row / kChunkSize);
+        }
+      }
+    }
+  }
+}
+
+MaskRunVisitor::MaskRunVisitor(OccupancyMask* mask) : mask_(mask) {
+}
+
+void MaskRunVisitor::visitRun(int x_begin, int x_end, int y, int z) {
+  mask_->insertRun(x_begin, x_end, y, z);
+}
@@ -0,0 +1,144 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OCCUPANCY_MASK_H
+#define OCCUPANCY_MASK_H
+
+#include <QHash>
+#include <QList>
+
+#include "block_position.h"
+#include "shape_rasterizer.h"
+
+/**
+  * A set of block positions stored as one bit per block.
+  *
+  * The world is divided into chunks of kChunkSize blocks on a side, and each chunk that contains at least one block
+  * is stored as a bitset of kWordsPerChunk 64-bit words, with each row of constant y and z occupying kChunkSize
+  * consecutive bits.  Chunks that would be empty are never stored.
+  *
+  * The set operations work a whole word (four rows) at a time, so combining two masks costs roughly one instruction
+  * per 64 blocks instead of one hash lookup per block.  This makes it cheap to work out exactly which blocks an
+  * operation affects before touching the Diagram or a BlockTransaction at all.
+  */
+class OccupancyMask {
+ public:
+  /** The edge length, in blocks, of a chunk. */
+  static const int kChunkSize = 16;
+
+  /** The number of 64-bit words needed to hold one chunk. */
+  static const int kWordsPerChunk = kChunkSize * kChunkSize * kChunkSize / 64;
+
+  OccupancyMask();
+
+  /**
+    * Returns \c true if the mask contains no blocks.
+    */
+  bool isEmpty() const {
+    return chunks_.isEmpty();
+  }
+
+  /**
+    * Returns the number of blocks in the mask.
+    */
+  qint64 count() const;
+
+  /**
+    * Returns \c true if the mask contains \p position.
+    */
+  bool contains(const BlockPosition& position) const;
+
+  /**
+    * Adds \p position to the mask.
+    */
+  void insert(const BlockPosition& position);
+
+  /**
+    * Adds the blocks from (\p x_begin, \p y, \p z) up to but not including (\p x_end, \p y, \p z) to the mask.
+    */
+  void insertRun(int x_begin, int x_end, int y, int z);
+
+  /**
+    * Adds every block in \p other to this mask.
+    */
+  void unite(const OccupancyMask& other);
+
+  /**
+    * Removes every block that is not also in \p other from this mask.
+    */
+  void intersect(const OccupancyMask& other);
+
+  /**
+    * Removes every block in \p other from this mask.
+    */
+  void subtract(const OccupancyMask& other);
+
+  /**
+    * Returns the coordinates (block coordinates divided by kChunkSize) of every non-empty chunk in the mask.
+    */
+  QList<BlockPosition> chunkPositions() const {
+    return chunks_.keys();
+  }
+
+  /**
+    * Returns the kWordsPerChunk words of the chunk at \p chunk_position, or NULL if that chunk is empty.  Row
+    * z * kChunkSize + y of the chunk occupies bits (row % 4) * kChunkSize onwards of word row / 4, with x increasing
+    * from the least significant bit.
+    */
+  const quint64* chunkWords(const BlockPosition& chunk_position) const;
+
+  /**
+    * Returns the blocks of this mask whose six neighbours are all in the mask too.  Eroding a mask \e n times leaves
+    * the blocks that are more than \e n steps from the nearest position outside it: a breadth-first distance
+    * transform from every outside position at once, worked out a word at a time.
+    */
+  OccupancyMask eroded() const;
+
+  /**
+    * Reports the blocks in the mask to \p visitor as runs of consecutive blocks along the x axis.  Runs never cross a
+    * chunk boundary.
+    */
+  void visitRuns(ShapeRasterizer::RunVisitor* visitor) const;
+
+ private:
+  struct Chunk {
+    quint64 words[kWordsPerChunk];
+  };
+
+  /**
+    * Returns the chunk containing \p position, creating an empty one if necessary.
+    */
+  Chunk& chunkFor(const BlockPosition& chunk_position);
+
+
+  /**
+    * Map from chunk coordinates (block coordinates divided by kChunkSize) to the bits for that chunk.
+    */
+  QHash<BlockPosition, Chunk> chunks_;
+};
+
+/**
+  * A RunVisitor that adds every run it is given to an OccupancyMask.
+  */
+class MaskRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  explicit MaskRunVisitor(OccupancyMask* mask);
+  virtual void visitRun(int x_begin, int x_end, int y, int z);
+
+ private:
+  OccupancyMask* mask_;
+};
+
+#endif // OCCUPANCY_MASK_H
@@ -0,0 +1,96 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "palette_matcher.h"
+
+#include <qmath.h>
+
+namespace {
+
+/**
+  * Undoes the sRGB gamma curve for one 8-bit channel.
+  */
+float linearize(int channel) {
+  float value = channel / 255.0f;
+  return value <= 0.04045f ? value / 12.92f : static_cast<float>(qPow((value + 0.055f) / 1.055f, 2.4f));
+}
+
+float labCurve(float t) {
+  return t > 0.008856f ? static_cast<float>(qPow(t, 1.0f / 3.0f)) : 7.787f * t + 16.0f / 116.0f;
+}
+
+}  // namespace
+
+// static
+void PaletteMatcher::toLab(QRgb color, float* lab) {
+  float r = linearize(qRed(color));
+  float g = linearize(qGreen(color));
+  float b = linearize(qBlue(color));
+  float x = labCurve((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+  float y = labCurve(0.2126f * r + 0.7152f * g + 0.0722f * b);
+  float z = labCurve((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+  lab[0] = 116.0f * y - 16.0f;
+  lab[1] = 500.0f * (x - y);
+  lab[2] = 200.0f * (y - z);
+}
+
+PaletteMatcher::PaletteMatcher(const QVector<QRgb>& palette) : palette_(palette) {
+  Q_ASSERT(!palette_.isEmpty());
+  palette_l_.resize(palette_.size());
+  palette_a_.resize(palette_.size());
+  palette_b_.resize(palette_.size());
+  for (int i = 0; i < palette_.size(); ++i) {
+    float lab[3];
+    toLab(palette_[i], lab);
+    palette_l_[i] = lab[0];
+    palette_a_[i] = lab[1];
+    palette_b_[i] = lab[2];
+  }
+
+  // Match the centre of each cell of the cube, so that each entry is right for the colours it stands in for on
+  // average rather than just the darkest of them.
+  const int step = 1 << (8 - kLookupBits);
+  lookup_.resize(kLookupSize * kLookupSize * kLookupSize);
+  int index = 0;
+  for (int r = 0; r < kLookupSize; ++r) {
+    for (int g = 0; g < kLookupSize; ++g) {
+      for (int b = 0; b < kLookupSize; ++b) {
+        float lab[3];
+        toLab(qRgb(r * step + step / 2, g * step + step / 2, b * step + step / 2), lab);
+        lookup_[index++] = static_cast<qint16>(search(lab));
+      }
+    }
+  }
+}
+
+int PaletteMatcher::search(const float* lab) const {
+  int count = palette_.size();
+  const float* l = palette_l_.constData();
+  const float* a = palette_a_.constData();
+  const float* b = palette_b_.constData();
+  int best_index = 0;
+  float best_distance = 1e30f;
+  for (int i = 0; i < count; ++i) {
+    float dl = l[i] - lab[0];
+    float da = a[i] - lab[1];
+    float db = b[i] - lab[2];
+    float distance = dl * dl + da * da + db * db;
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_index = i;
+    }
+  }
+  return best_index;
+}
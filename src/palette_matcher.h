@@ -0,0 +1,79 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PALETTE_MATCHER_H
+#define PALETTE_MATCHER_H
+
+#include <QColor>
+#include <QVector>
+
+/**
+  * Finds the perceptually closest colour in a fixed palette for any colour.
+  *
+  * Colours are compared by Euclidean distance in CIE L*a*b*, which tracks how different two colours look far better
+  * than distance in RGB does.  Rather than searching the palette for every colour looked up, the matcher precomputes
+  * the answer for a cube of kLookupSize^3 evenly spaced RGB colours when it is constructed, so nearest() is a single
+  * table lookup.  The precomputation itself stores the palette as separate L, a and b arrays so that the search over
+  * the palette is a straight loop over floats.
+  */
+class PaletteMatcher {
+ public:
+  /** The number of bits of each RGB channel used to index the lookup cube. */
+  static const int kLookupBits = 5;
+
+  /** The number of entries along each edge of the lookup cube. */
+  static const int kLookupSize = 1 << kLookupBits;
+
+  /**
+    * Creates a PaletteMatcher for \p palette, which must not be empty.
+    */
+  explicit PaletteMatcher(const QVector<QRgb>& palette);
+
+  /**
+    * Returns the index in the palette of the colour closest to \p color.  The alpha channel is ignored.
+    */
+  int nearest(QRgb color) const {
+    const int shift = 8 - kLookupBits;
+    return lookup_[((qRed(color) >> shift) << (2 * kLookupBits)) |
+                   ((qGreen(color) >> shift) << kLookupBits) |
+                   (qBlue(color) >> shift)];
+  }
+
+  /**
+    * Returns the colour at \p index in the palette.
+    */
+  QRgb color(int index) const {
+    return palette_[index];
+  }
+
+  /**
+    * Converts \p color from sRGB to CIE L*a*b* (D65 white point), writing L, a and b to \p lab.
+    */
+  static void toLab(QRgb color, float* lab);
+
+ private:
+  /**
+    * Searches the whole palette for the colour closest to \p lab.
+    */
+  int search(const float* lab) const;
+
+  QVector<QRgb> palette_;
+  QVector<float> palette_l_;
+  QVector<float> palette_a_;
+  QVector<float> palette_b_;
+  QVector<qint16> lookup_;
+};
+
+#endif // PALETTE_MATCHER_H
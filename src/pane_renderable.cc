@@ -16,7 +16,9 @@
 #include "pane_renderable.h"
 #include "block_orientation.h"
 
-PaneRenderable::PaneRenderable(const QVector3D& size) : RectangularPrismRenderable(size) {
+// Panes are too thin for a neighbouring block to hide them.
+PaneRenderable::PaneRenderable(const QVector3D& size)
+    : RectangularPrismRenderable(size, kTextureClip, kDoNotCullFaces) {
 }
 
 PaneRenderable::~PaneRenderable() {}
@@ -149,9 +151,7 @@ void PaneRenderable::addGeometry(const PaneRenderable::Geometry& geometry,
   }
 }
 
-bool PaneRenderable::shouldRenderQuad(int index,
-                                      const QVector3D& location,
-                                      const BlockOrientation* orientation) const {
+bool PaneRenderable::shouldRenderQuad(int index, const BlockOrientation* orientation) const {
   if (orientation == BlockOrientation::get("Running north/south") ||
       orientation == BlockOrientation::get("Running east/west")) {
     return index >= kFullWidthFront && index <= kFullWidthLeft;
@@ -190,10 +190,12 @@ bool PaneRenderable::shouldRenderQuad(int index,
   }
 }
 
-void PaneRenderable::applyOrientationTransform(const BlockOrientation* orientation) const {
+QMatrix4x4 PaneRenderable::orientationTransform(const BlockOrientation* orientation) const {
+  QMatrix4x4 transform;
   if (orientation == BlockOrientation::get("Facing east/west")) {
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(90.0f, 0.0f, 1.0f, 0.0f);
   }
+  return transform;
 }
 
 Texture PaneRenderable::textureForQuad(int index, const BlockOrientation* orientation) const {
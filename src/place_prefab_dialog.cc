@@ -0,0 +1,38 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "place_prefab_dialog.h"
+
+PlacePrefabDialog::PlacePrefabDialog(const QList<Prefab>& prefabs, QWidget* parent)
+    : QDialog(parent) {
+  ui.setupUi(this);
+  foreach (const Prefab& prefab, prefabs) {
+    const BlockPosition& size = prefab.size();
+    ui.prefab_combo_->addItem(QString("%1 (%2 x %3 x %4)").arg(prefab.name()).arg(size.x()).arg(size.y())
+                                                           .arg(size.z()));
+  }
+}
+
+void PlacePrefabDialog::setOffset(const BlockPosition& offset) {
+  ui.x_spin_->setValue(offset.x());
+  ui.y_spin_->setValue(offset.y());
+  ui.z_spin_->setValue(offset.z());
+}
+
+PrefabPlacement PlacePrefabDialog::placement() const {
+  return PrefabPlacement(ui.prefab_combo_->currentIndex(),
+                         BlockPosition(ui.x_spin_->value(), ui.y_spin_->value(), ui.z_spin_->value()),
+                         ui.rotation_combo_->currentIndex());
+}
@@ -0,0 +1,46 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PLACE_PREFAB_DIALOG_H
+#define PLACE_PREFAB_DIALOG_H
+
+#include "ui_place_prefab_dialog.h"
+
+#include "prefab.h"
+
+/**
+  * Dialog that asks the user which prefab to place, where, and which way round.
+  */
+class PlacePrefabDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  /**
+    * Creates a dialog offering each of \p prefabs, which are referred to by index in the returned placement.
+    */
+  explicit PlacePrefabDialog(const QList<Prefab>& prefabs, QWidget* parent = NULL);
+
+  /**
+    * Sets the position shown in the dialog when it opens.
+    */
+  void setOffset(const BlockPosition& offset);
+
+  PrefabPlacement placement() const;
+
+ private:
+  Ui::PlacePrefabDialog ui;
+};
+
+#endif // PLACE_PREFAB_DIALOG_H
@@ -0,0 +1,214 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POSITION_HASH_H
+#define POSITION_HASH_H
+
+#include <QList>
+#include <QVector>
+
+#include "block_position.h"
+
+/**
+  * How well a PositionHash's entries are spread over its table, as returned by PositionHash::probeStatistics().  The
+  * probe length of an entry is the number of slots a lookup for it examines, so an entry in its home slot has a probe
+  * length of 1 and every longer probe is the result of a collision.
+  */
+struct PositionHashStatistics {
+  PositionHashStatistics() : size(0), capacity(0), collisions(0), total_probe_length(0), max_probe_length(0) {}
+
+  /** Returns the fraction of the table's slots that hold an entry. */
+  double loadFactor() const {
+    return capacity > 0 ? static_cast<double>(size) / capacity : 0.0;
+  }
+
+  /** Returns the average number of slots a successful lookup examines. */
+  double averageProbeLength() const {
+    return size > 0 ? static_cast<double>(total_probe_length) / size : 0.0;
+  }
+
+  int size;
+  int capacity;
+  /** The number of entries that are not in their home slot. */
+  int collisions;
+  qint64 total_probe_length;
+  int max_probe_length;
+};
+
+/**
+  * A hash table keyed by BlockPosition, for the containers that are hit on every block of every edit.
+  *
+  * Unlike QHash, which allocates a node per entry, PositionHash keeps its keys and values in two flat arrays and
+  * resolves collisions by linear probing.  Since a BlockPosition packs into a single 64-bit word, a lookup is a hash
+  * followed by a scan of consecutive words in the key array, usually within a single cache line.  Removal shifts the
+  * following entries of the probe sequence back rather than leaving tombstones, so lookups stay short after many
+  * removals.
+  *
+  * The interface is the subset of QHash's that the application uses.  As with QHash, the order in which entries are
+  * iterated is arbitrary, and copies are cheap until one of them is modified.  \p T must be default-constructible.
+  */
+template <typename T>
+class PositionHash {
+ public:
+  class const_iterator {
+   public:
+    const_iterator() : hash_(NULL), slot_(0) {}
+
+    BlockPosition key() const;
+    const T& value() const {
+      return hash_->values_[slot_];
+    }
+    const T& operator*() const {
+      return value();
+    }
+
+    const_iterator& operator++();
+    bool operator==(const const_iterator& other) const {
+      return slot_ == other.slot_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return slot_ != other.slot_;
+    }
+
+   private:
+    friend class PositionHash<T>;
+    const_iterator(const PositionHash<T>* hash, int slot) : hash_(hash), slot_(slot) {}
+
+    const PositionHash<T>* hash_;
+    int slot_;
+  };
+
+  PositionHash();
+
+  /** Returns the number of entries in the hash. */
+  int size() const {
+    return size_;
+  }
+
+  /** Returns \c true if the hash has no entries. */
+  bool isEmpty() const {
+    return size_ == 0;
+  }
+
+  /** Removes every entry from the hash and releases its storage. */
+  void clear();
+
+  /** Makes room for at least \p size entries, so that inserting that many does not grow the table again. */
+  void reserve(int size);
+
+  /** Returns \c true if the hash has an entry for \p position. */
+  bool contains(const BlockPosition& position) const {
+    return findSlot(position.packed()) >= 0;
+  }
+
+  /** Returns the value for \p position, or \p default_value if there is none. */
+  T value(const BlockPosition& position, const T& default_value = T()) const;
+
+  /** Sets the value for \p position to \p value, replacing any existing value. */
+  void insert(const BlockPosition& position, const T& value);
+
+  /** Removes the entry for \p position, and returns the number of entries removed (0 or 1). */
+  int remove(const BlockPosition& position);
+
+  /** Returns the value for \p position, inserting a default-constructed one if there is none. */
+  T& operator[](const BlockPosition& position);
+
+  /** Returns the keys of every entry, in arbitrary order. */
+  QList<BlockPosition> keys() const;
+
+  const_iterator constBegin() const;
+  const_iterator constEnd() const {
+    return const_iterator(this, capacity());
+  }
+
+  /** Returns an iterator to the entry for \p position, or constEnd() if there is none. */
+  const_iterator constFind(const BlockPosition& position) const;
+
+  /** Walks the whole table to measure how long its probe sequences are.  This is meant for benchmarks and tests. */
+  PositionHashStatistics probeStatistics() const;
+
+ private:
+  /** A key that no BlockPosition packs to, since packed positions never use the top bit. */
+  static const quint64 kEmptySlot = ~Q_UINT64_C(0);
+
+  /** The smallest table allocated.  Must be a power of two. */
+  static const int kMinimumCapacity = 16;
+
+  int capacity() const {
+    return keys_.size();
+  }
+
+  /** Returns the slot at which a probe for \p key starts.  The capacity must be a nonzero power of two. */
+  int homeSlot(quint64 key) const {
+    return static_cast<int>(BlockPosition::mix(key) & static_cast<quint64>(capacity() - 1));
+  }
+
+  /** Returns the slot holding \p key, or -1 if it is not in the hash. */
+  int findSlot(quint64 key) const;
+
+  /** Returns the slot holding \p key, claiming an empty one (and growing the table if needed) if it isn't there. */
+  int findOrInsertSlot(quint64 key);
+
+  /** Claims an empty slot for \p key, which must not be in the hash already.  The table must have room for it. */
+  int insertSlot(quint64 key);
+
+  /** Moves every entry into a fresh table of \p capacity slots. */
+  void rehash(int capacity);
+
+  QVector<quint64> keys_;
+  QVector<T> values_;
+  int size_;
+};
+
+/**
+  * A set of BlockPositions with the same flat storage as PositionHash.
+  */
+class PositionSet {
+ public:
+  int size() const {
+    return hash_.size();
+  }
+  bool isEmpty() const {
+    return hash_.isEmpty();
+  }
+  void clear() {
+    hash_.clear();
+  }
+  void reserve(int size) {
+    hash_.reserve(size);
+  }
+  bool contains(const BlockPosition& position) const {
+    return hash_.contains(position);
+  }
+  void insert(const BlockPosition& position) {
+    hash_.insert(position, true);
+  }
+  int remove(const BlockPosition& position) {
+    return hash_.remove(position);
+  }
+  QList<BlockPosition> toList() const {
+    return hash_.keys();
+  }
+  PositionHashStatistics probeStatistics() const {
+    return hash_.probeStatistics();
+  }
+
+ private:
+  PositionHash<bool> hash_;
+};
+
+#include "position_hash_impl.h"
+
+#endif // POSITION_HASH_H
@@ -0,0 +1,205 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "position_hash.h"
+
+template <typename T>
+const quint64 PositionHash<T>::kEmptySlot;
+
+template <typename T>
+const int PositionHash<T>::kMinimumCapacity;
+
+template <typename T>
+BlockPosition PositionHash<T>::const_iterator::key() const {
+  return BlockPosition::fromPacked(hash_->keys_[slot_]);
+}
+
+template <typename T>
+typename PositionHash<T>::const_iterator& PositionHash<T>::const_iterator::operator++() {
+  ++slot_;
+  while (slot_ < hash_->capacity() && hash_->keys_[slot_] == kEmptySlot) {
+    ++slot_;
+  }
+  return *this;
+}
+
+template <typename T>
+PositionHash<T>::PositionHash() : size_(0) {}
+
+template <typename T>
+void PositionHash<T>::clear() {
+  keys_.clear();
+  values_.clear();
+  size_ = 0;
+}
+
+template <typename T>
+void PositionHash<T>::reserve(int size) {
+  int capacity = kMinimumCapacity;
+  // Keep the table at most three quarters full.
+  while (capacity / 4 * 3 < size) {
+    capacity *= 2;
+  }
+  if (capacity > this->capacity()) {
+    rehash(capacity);
+  }
+}
+
+template <typename T>
+T PositionHash<T>::value(const BlockPosition& position, const T& default_value) const {
+  int slot = findSlot(position.packed());
+  return slot >= 0 ? values_[slot] : default_value;
+}
+
+template <typename T>
+void PositionHash<T>::insert(const BlockPosition& position, const T& value) {
+  int slot = findOrInsertSlot(position.packed());
+  values_[slot] = value;
+}
+
+template <typename T>
+int PositionHash<T>::remove(const BlockPosition& position) {
+  int slot = findSlot(position.packed());
+  if (slot < 0) {
+    return 0;
+  }
+
+  // Close the gap by moving back any later entry of the probe sequence that would no longer be reachable from its home
+  // slot, so that no lookup ever has to step over a deleted entry.
+  quint64* keys = keys_.data();
+  T* values = values_.data();
+  int mask = capacity() - 1;
+  int gap = slot;
+  int next = (gap + 1) & mask;
+  while (keys[next] != kEmptySlot) {
+    int home = homeSlot(keys[next]);
+    if (((next - home) & mask) >= ((next - gap) & mask)) {
+      keys[gap] = keys[next];
+      values[gap] = values[next];
+      gap = next;
+    }
+    next = (next + 1) & mask;
+  }
+  keys[gap] = kEmptySlot;
+  values[gap] = T();
+  --size_;
+  return 1;
+}
+
+template <typename T>
+T& PositionHash<T>::operator[](const BlockPosition& position) {
+  int slot = findOrInsertSlot(position.packed());
+  return values_[slot];
+}
+
+template <typename T>
+QList<BlockPosition> PositionHash<T>::keys() const {
+  QList<BlockPosition> keys;
+  keys.reserve(size_);
+  for (int slot = 0; slot < capacity(); ++slot) {
+    if (keys_[slot] != kEmptySlot) {
+      keys.append(BlockPosition::fromPacked(keys_[slot]));
+    }
+  }
+  return keys;
+}
+
+template <typename T>
+typename PositionHash<T>::const_iterator PositionHash<T>::constBegin() const {
+  const_iterator iter(this, -1);
+  return ++iter;
+}
+
+template <typename T>
+typename PositionHash<T>::const_iterator PositionHash<T>::constFind(const BlockPosition& position) const {
+  int slot = findSlot(position.packed());
+  return slot >= 0 ? const_iterator(this, slot) : constEnd();
+}
+
+template <typename T>
+PositionHashStatistics PositionHash<T>::probeStatistics() const {
+  PositionHashStatistics statistics;
+  statistics.size = size_;
+  statistics.capacity = capacity();
+  int mask = capacity() - 1;
+  for (int slot = 0; slot < capacity(); ++slot) {
+    if (keys_[slot] == kEmptySlot) {
+      continue;
+    }
+    int probe_length = ((slot - homeSlot(keys_[slot])) & mask) + 1;
+    if (probe_length > 1) {
+      ++statistics.collisions;
+    }
+    statistics.total_probe_length += probe_length;
+    statistics.max_probe_length = qMax(statistics.max_probe_length, probe_length);
+  }
+  return statistics;
+}
+
+template <typename T>
+int PositionHash<T>::findSlot(quint64 key) const {
+  if (size_ == 0) {
+    return -1;
+  }
+  const quint64* keys = keys_.constData();
+  int mask = capacity() - 1;
+  for (int slot = homeSlot(key); ; slot = (slot + 1) & mask) {
+    if (keys[slot] == key) {
+      return slot;
+    } else if (keys[slot] == kEmptySlot) {
+      return -1;
+    }
+  }
+}
+
+template <typename T>
+int PositionHash<T>::findOrInsertSlot(quint64 key) {
+  // Look for the key before growing, so that assigning to an existing entry never rehashes the table.
+  int slot = findSlot(key);
+  if (slot >= 0) {
+    return slot;
+  }
+  if ((size_ + 1) > capacity() / 4 * 3) {
+    rehash(qMax(kMinimumCapacity, capacity() * 2));
+  }
+  return insertSlot(key);
+}
+
+template <typename T>
+int PositionHash<T>::insertSlot(quint64 key) {
+  quint64* keys = keys_.data();
+  int mask = capacity() - 1;
+  int slot = homeSlot(key);
+  while (keys[slot] != kEmptySlot) {
+    slot = (slot + 1) & mask;
+  }
+  keys[slot] = key;
+  ++size_;
+  return slot;
+}
+
+template <typename T>
+void PositionHash<T>::rehash(int capacity) {
+  QVector<quint64> old_keys = keys_;
+  QVector<T> old_values = values_;
+  keys_ = QVector<quint64>(capacity, kEmptySlot);
+  values_ = QVector<T>(capacity);
+  size_ = 0;
+  for (int slot = 0; slot < old_keys.size(); ++slot) {
+    if (old_keys[slot] != kEmptySlot) {
+      values_[insertSlot(old_keys[slot])] = old_values[slot];
+    }
+  }
+}
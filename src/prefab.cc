@@ -0,0 +1,123 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "prefab.h"
+
+Prefab::Prefab() {
+}
+
+Prefab::Prefab(const QString& name, const QList<BlockInstance>& blocks) : name_(name) {
+  if (blocks.isEmpty()) {
+    return;
+  }
+  const BlockPosition& first = blocks.first().position();
+  int min_x = first.x();
+  int min_y = first.y();
+  int min_z = first.z();
+  int max_x = min_x;
+  int max_y = min_y;
+  int max_z = min_z;
+  foreach (const BlockInstance& block, blocks) {
+    const BlockPosition& position = block.position();
+    min_x = qMin(min_x, position.x());
+    min_y = qMin(min_y, position.y());
+    min_z = qMin(min_z, position.z());
+    max_x = qMax(max_x, position.x());
+    max_y = qMax(max_y, position.y());
+    max_z = qMax(max_z, position.z());
+  }
+  foreach (const BlockInstance& block, blocks) {
+    const BlockPosition& position = block.position();
+    BlockPosition local(position.x() - min_x, position.y() - min_y, position.z() - min_z);
+    blocks_.insert(local, BlockInstance(block.prototype(), local, block.orientation()));
+  }
+  size_ = BlockPosition(max_x - min_x + 1, max_y - min_y + 1, max_z - min_z + 1);
+}
+
+void Prefab::placedBounds(const PrefabPlacement& placement, BlockPosition* min, BlockPosition* max) const {
+  bool turned_sideways = (placement.rotation % 2 == 1);
+  int width = turned_sideways ? size_.z() : size_.x();
+  int depth = turned_sideways ? size_.x() : size_.z();
+  *min = placement.offset;
+  *max = placement.offset + BlockPosition(width - 1, size_.y() - 1, depth - 1);
+}
+
+BlockInstance Prefab::placedBlock(const BlockInstance& block, const PrefabPlacement& placement) const {
+  // Each quarter turn takes +z to +x, as glRotatef(90, 0, 1, 0) does, and the result is moved back into the bounding
+  // box of the turned prefab.
+  const BlockPosition& local = block.position();
+  int x = local.x();
+  int z = local.z();
+  switch (placement.rotation) {
+    case 1:
+      x = local.z();
+      z = size_.x() - 1 - local.x();
+      break;
+    case 2:
+      x = size_.x() - 1 - local.x();
+      z = size_.z() - 1 - local.z();
+      break;
+    case 3:
+      x = size_.z() - 1 - local.z();
+      z = local.x();
+      break;
+  }
+  BlockPosition position = placement.offset + BlockPosition(x, local.y(), z);
+  const BlockOrientation* orientation = block.prototype()->rotatedOrientation(block.orientation(), placement.rotation);
+  return BlockInstance(block.prototype(), position, orientation);
+}
+
+const BlockInstance* Prefab::blockPlacedAt(const BlockPosition& position, const PrefabPlacement& placement) const {
+  int dx = position.x() - placement.offset.x();
+  int dz = position.z() - placement.offset.z();
+  int x = dx;
+  int z = dz;
+  switch (placement.rotation) {
+    case 1:
+      x = size_.x() - 1 - dz;
+      z = dx;
+      break;
+    case 2:
+      x = size_.x() - 1 - dx;
+      z = size_.z() - 1 - dz;
+      break;
+    case 3:
+      x = dz;
+      z = size_.z() - 1 - dx;
+      break;
+  }
+  int y = position.y() - placement.offset.y();
+  if (x < 0 || y < 0 || z < 0 || x >= size_.x() || y >= size_.y() || z >= size_.z()) {
+    return NULL;
+  }
+  QHash<BlockPosition, BlockInstance>::const_iterator iter = blocks_.constFind(BlockPosition(x, y, z));
+  return iter == blocks_.constEnd() ? NULL : &iter.value();
+}
+
+QVector3D Prefab::placementTranslation(const PrefabPlacement& placement) const {
+  QVector3D translation = placement.offset.cornerVector();
+  switch (placement.rotation) {
+    case 1:
+      translation += QVector3D(0, 0, size_.x());
+      break;
+    case 2:
+      translation += QVector3D(size_.x(), 0, size_.z());
+      break;
+    case 3:
+      translation += QVector3D(size_.z(), 0, 0);
+      break;
+  }
+  return translation;
+}
@@ -0,0 +1,132 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PREFAB_H
+#define PREFAB_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector3D>
+
+#include "block_instance.h"
+#include "block_position.h"
+
+/**
+  * A placement of a Prefab in a diagram: which prefab, where, and which way round.  See Diagram::placements().
+  */
+struct PrefabPlacement {
+  PrefabPlacement() : prefab(-1), rotation(0) {}
+  PrefabPlacement(int prefab, const BlockPosition& offset, int rotation)
+      : prefab(prefab), offset(offset), rotation(rotation) {}
+
+  bool operator==(const PrefabPlacement& other) const {
+    return prefab == other.prefab && offset == other.offset && rotation == other.rotation;
+  }
+
+  /** The index of the prefab in Diagram::prefabs(). */
+  int prefab;
+
+  /** The position of the corner of the placed prefab with the lowest coordinates. */
+  BlockPosition offset;
+
+  /** The number of quarter turns the prefab is turned about the vertical axis, from 0 to 3. */
+  int rotation;
+};
+
+/**
+  * A reusable group of blocks, such as a house or a lamp post, that can be placed in a diagram any number of times.
+  *
+  * A placement (see PrefabPlacement) is only a reference to the prefab, so a street of a hundred identical houses holds
+  * the blocks of one house, and the 3D view builds the house's geometry once and draws it a hundred times.  Changing
+  * the prefab changes every placement of it.  The blocks of a placement can't be edited directly: they can be seen
+  * through Diagram::blockAt(), but Diagram::bakePrefabs() must turn them into ordinary blocks before they can be
+  * changed.
+  *
+  * The blocks of a prefab are stored relative to the corner of their bounding box with the lowest coordinates, which is
+  * always at the origin.
+  */
+class Prefab {
+ public:
+  /**
+    * Creates an empty prefab.
+    */
+  Prefab();
+
+  /**
+    * Creates a prefab called \p name holding \p blocks, which may be anywhere in the world.  They are moved so that
+    * the corner of their bounding box is at the origin.
+    */
+  Prefab(const QString& name, const QList<BlockInstance>& blocks);
+
+  /**
+    * Returns the name of the prefab.
+    */
+  const QString& name() const {
+    return name_;
+  }
+
+  /**
+    * Returns every block in the prefab, keyed on its position relative to the prefab.
+    */
+  const QHash<BlockPosition, BlockInstance>& blocks() const {
+    return blocks_;
+  }
+
+  /**
+    * Returns \c true if the prefab has no blocks.
+    */
+  bool isEmpty() const {
+    return blocks_.isEmpty();
+  }
+
+  /**
+    * Returns the extent of the prefab along the x, y and z axes (before it is turned) as a position.
+    */
+  const BlockPosition& size() const {
+    return size_;
+  }
+
+  /**
+    * Returns the positions of the corners of the bounding box of the prefab when it is placed at \p placement,
+    * inclusive.
+    */
+  void placedBounds(const PrefabPlacement& placement, BlockPosition* min, BlockPosition* max) const;
+
+  /**
+    * Returns \p block, one of the blocks of the prefab, as it is when the prefab is placed at \p placement: moved into
+    * place and turned, along with its orientation.
+    */
+  BlockInstance placedBlock(const BlockInstance& block, const PrefabPlacement& placement) const;
+
+  /**
+    * Returns the block of the prefab that ends up at \p position when the prefab is placed at \p placement, or NULL
+    * if there is none.  The block is returned as it is stored in the prefab; see placedBlock().
+    */
+  const BlockInstance* blockPlacedAt(const BlockPosition& position, const PrefabPlacement& placement) const;
+
+  /**
+    * Returns the translation to apply before turning the prefab by placement.rotation quarter turns about the
+    * vertical axis with glRotatef() to draw the prefab, as drawn in its own coordinates, at \p placement.
+    */
+  QVector3D placementTranslation(const PrefabPlacement& placement) const;
+
+ private:
+  QString name_;
+  QHash<BlockPosition, BlockInstance> blocks_;
+  BlockPosition size_;
+};
+
+#endif // PREFAB_H
@@ -0,0 +1,73 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "random.h"
+
+#include <qmath.h>
+
+Random::Random(quint64 seed) : state_(mix(seed, 0)) {
+  // xorshift never leaves the all-zero state.
+  if (state_ == 0) {
+    state_ = Q_UINT64_C(0x9e3779b97f4a7c15);
+  }
+}
+
+quint32 Random::next() {
+  state_ ^= state_ >> 12;
+  state_ ^= state_ << 25;
+  state_ ^= state_ >> 27;
+  return static_cast<quint32>((state_ * Q_UINT64_C(0x2545f4914f6cdd1d)) >> 32);
+}
+
+quint64 Random::next64() {
+  quint64 high = next();
+  return (high << 32) | next();
+}
+
+int Random::uniform(int min, int max) {
+  quint32 range = static_cast<quint32>(max - min) + 1;
+  if (range == 0) {
+    return static_cast<int>(next());
+  }
+  return min + static_cast<int>((static_cast<quint64>(next()) * range) >> 32);
+}
+
+double Random::uniformReal() {
+  return next() * (1.0 / 4294967296.0);
+}
+
+double Random::normal() {
+  // Marsaglia's polar method.
+  double u, v, r;
+  do {
+    u = uniformReal() * 2.0 - 1.0;
+    v = uniformReal() * 2.0 - 1.0;
+    r = u * u + v * v;
+  } while (r == 0.0 || r >= 1.0);
+  return u * qSqrt(-2.0 * qLn(r) / r);
+}
+
+int Random::normalInRange(int min, int max) {
+  return qBound(min, qRound(normal() * (max - min) / 2.0 + (min + (max - min) / 2)), max);
+}
+
+// static
+quint64 Random::mix(quint64 seed, quint64 value) {
+  // The finalizer of SplitMix64.
+  quint64 z = seed + (value + 1) * Q_UINT64_C(0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
@@ -0,0 +1,72 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <QtGlobal>
+
+/**
+  * A small, fast pseudo-random number generator (xorshift64*) whose whole state lives in the instance.
+  *
+  * Unlike qrand(), which shares one sequence per thread and is reseeded with qsrand(), every Random produces the same
+  * sequence for the same seed regardless of what any other code does, and separate instances can be used from
+  * separate threads without locking.  Use mix() to derive independent seeds for many instances from one master seed.
+  */
+class Random {
+ public:
+  explicit Random(quint64 seed);
+
+  /**
+    * Returns the next 32 uniformly distributed random bits.
+    */
+  quint32 next();
+
+  /**
+    * Returns the next 64 uniformly distributed random bits.
+    */
+  quint64 next64();
+
+  /**
+    * Returns a number uniformly distributed in [\p min, \p max] (inclusive).
+    */
+  int uniform(int min, int max);
+
+  /**
+    * Returns a number uniformly distributed in [0, 1).
+    */
+  double uniformReal();
+
+  /**
+    * Returns a normally distributed number with a mean of 0 and a standard deviation of 1.
+    */
+  double normal();
+
+  /**
+    * Returns a normally distributed integer in [\p min, \p max] (inclusive), centred on their midpoint (rounded down)
+    * and with a standard deviation of half the range.
+    */
+  int normalInRange(int min, int max);
+
+  /**
+    * Combines \p seed and \p value into a new, well scrambled seed.
+    */
+  static quint64 mix(quint64 seed, quint64 value);
+
+ private:
+  quint64 state_;
+};
+
+#endif // RANDOM_H
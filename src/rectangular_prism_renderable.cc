@@ -162,25 +162,25 @@ RectangularPrismRenderable::TextureCoords RectangularPrismRenderable::createText
   return TextureCoords() << front_tex << back_tex << bottom_tex << right_tex << top_tex << left_tex;
 }
 
-void RectangularPrismRenderable::applyOrientationTransform(const BlockOrientation* orientation) const {
+QMatrix4x4 RectangularPrismRenderable::orientationTransform(const BlockOrientation* orientation) const {
+  QMatrix4x4 transform;
   if (orientation == BlockOrientation::get("Facing north")) {
-    glRotatef(180.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Facing east")) {
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(90.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Facing west")) {
-    glRotatef(-90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(-90.0f, 0.0f, 1.0f, 0.0f);
   }
+  return transform;
 }
 
-bool RectangularPrismRenderable::shouldRenderQuad(int index,
-                                                  const QVector3D& location,
-                                                  const BlockOrientation* orientation) const {
+bool RectangularPrismRenderable::cullingFaceForQuad(int index, const BlockOrientation* orientation, Face* face) const {
   if (culling_ == kDoNotCullFaces) {
-    return true;
+    return false;
   } else {
     // Rectangular prisms have one quad per face, so we can just check the delegate.
-    Face face = mapToDefaultOrientation(static_cast<Face>(index), orientation);
-    return !(renderDelegate() && !renderDelegate()->shouldRenderFace(this, face, location));
+    *face = mapToDefaultOrientation(static_cast<Face>(index), orientation);
+    return true;
   }
 }
 
@@ -64,8 +64,8 @@ class RectangularPrismRenderable : public BasicRenderable {
                                       FaceCulling culling = kCullHiddenFaces);
   virtual ~RectangularPrismRenderable() {}
 
-  virtual void applyOrientationTransform(const BlockOrientation* orientation) const;
-  virtual bool shouldRenderQuad(int index, const QVector3D& location, const BlockOrientation* orientation) const;
+  virtual QMatrix4x4 orientationTransform(const BlockOrientation* orientation) const;
+  virtual bool cullingFaceForQuad(int index, const BlockOrientation* orientation, Face* face) const;
 
  protected:
   TextureSizing sizing() const {
@@ -0,0 +1,679 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "redstone_simulator.h"
+
+#include "block_instance.h"
+#include "block_manager.h"
+#include "block_orientation.h"
+#include "block_prototype.h"
+#include "block_transaction.h"
+#include "diagram.h"
+
+namespace {
+
+const blocktype_t kLeverOffType = 0x45;
+const blocktype_t kLeverOnType = 0x80045;
+const blocktype_t kTorchOffType = 0x4B;
+const blocktype_t kTorchOnType = 0x4C;
+const blocktype_t kRepeaterOffType = 0x5D;
+const blocktype_t kRepeaterOnType = 0x5E;
+const blocktype_t kWireType = 0x37;
+const blocktype_t kPoweredWireType = 0xF0037;
+const blocktype_t kLampOffType = 0x7B;
+const blocktype_t kLampOnType = 0x7C;
+
+const int kMaxPower = 15;
+
+/** The number of game ticks that torches and repeaters take to switch. */
+const int kSwitchDelay = 2;
+
+/** Minecraft runs 20 game ticks per second. */
+const int kTickInterval = 50;
+
+/** Commits that change more blocks than this (like opening a file) rebuild the whole graph. */
+const int kFullRebuildThreshold = 4096;
+
+/** How far from a changed block the graph has to be rebuilt.  See RedstoneSimulator::updateGraph(). */
+const int kRebuildRadius = 2;
+
+const BlockPosition kAbove(0, 1, 0);
+const BlockPosition kBelow(0, -1, 0);
+
+/** North, south, east, west. */
+const BlockPosition kHorizontal[] = {
+  BlockPosition(0, 0, -1),
+  BlockPosition(0, 0, 1),
+  BlockPosition(1, 0, 0),
+  BlockPosition(-1, 0, 0)
+};
+const int kHorizontalCount = 4;
+
+/** Bits for the horizontal directions that lie along each axis. */
+const int kAlongZ = 0x3;
+const int kAlongX = 0xC;
+
+const BlockPosition kNeighbors[] = {
+  BlockPosition(0, 0, -1),
+  BlockPosition(0, 0, 1),
+  BlockPosition(1, 0, 0),
+  BlockPosition(-1, 0, 0),
+  BlockPosition(0, 1, 0),
+  BlockPosition(0, -1, 0)
+};
+const int kNeighborCount = 6;
+
+BlockPosition opposite(const BlockPosition& offset) {
+  return BlockPosition(-offset.x(), -offset.y(), -offset.z());
+}
+
+/**
+  * Returns the offset of the block that a torch or lever with \p orientation is attached to.
+  */
+BlockPosition attachmentOffset(const BlockOrientation* orientation) {
+  if (orientation == BlockOrientation::get("On north wall")) {
+    return BlockPosition(0, 0, -1);
+  } else if (orientation == BlockOrientation::get("On south wall")) {
+    return BlockPosition(0, 0, 1);
+  } else if (orientation == BlockOrientation::get("On east wall")) {
+    return BlockPosition(1, 0, 0);
+  } else if (orientation == BlockOrientation::get("On west wall")) {
+    return BlockPosition(-1, 0, 0);
+  }
+  return kBelow;
+}
+
+/**
+  * Returns the offset of the block that a repeater with \p orientation outputs into.
+  */
+BlockPosition facingOffset(const BlockOrientation* orientation) {
+  if (orientation == BlockOrientation::get("Facing north")) {
+    return BlockPosition(0, 0, -1);
+  } else if (orientation == BlockOrientation::get("Facing east")) {
+    return BlockPosition(1, 0, 0);
+  } else if (orientation == BlockOrientation::get("Facing west")) {
+    return BlockPosition(-1, 0, 0);
+  }
+  return BlockPosition(0, 0, 1);
+}
+
+}  // namespace
+
+RedstoneSimulator::RedstoneSimulator(Diagram* diagram, BlockManager* block_mgr, QObject* parent)
+    : QObject(parent),
+      diagram_(diagram),
+      block_mgr_(block_mgr),
+      tick_(0),
+      next_sequence_(0),
+      component_count_(0) {
+  Q_ASSERT(diagram_);
+  Q_ASSERT(block_mgr_);
+  component_types_ << kLeverOffType << kLeverOnType << kTorchOffType << kTorchOnType << kRepeaterOffType
+                   << kRepeaterOnType << kWireType << kPoweredWireType << kLampOffType << kLampOnType;
+  connect(&timer_, SIGNAL(timeout()), SLOT(step()));
+}
+
+void RedstoneSimulator::setRunning(bool running) {
+  if (running == isRunning()) {
+    return;
+  }
+  if (running) {
+    connect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), SLOT(updateGraph(BlockTransaction)));
+    tick_ = 0;
+    rebuildAll();
+    settle();
+    showChanges();
+    timer_.start(kTickInterval);
+  } else {
+    timer_.stop();
+    disconnect(diagram_, SIGNAL(diagramChanged(BlockTransaction)), this, SLOT(updateGraph(BlockTransaction)));
+    clear();
+    diagram_->clearSimulatedBlocks();
+  }
+}
+
+void RedstoneSimulator::step(int ticks) {
+  for (int i = 0; i < ticks; ++i) {
+    ++tick_;
+    while (!events_.isEmpty() && events_.first().tick <= tick_) {
+      Event event = popEvent();
+      const Node& node = nodes_.at(event.node);
+      if (node.alive && node.serial == event.serial) {
+        setLevel(event.node, event.level);
+      }
+    }
+    settle();
+  }
+  showChanges();
+}
+
+void RedstoneSimulator::updateGraph(const BlockTransaction& transaction) {
+  QSet<BlockPosition> changed;
+  bool adds_components = false;
+  foreach (const BlockInstance& old_block, transaction.old_blocks()) {
+    changed.insert(old_block.position());
+  }
+  foreach (const BlockInstance& new_block, transaction.new_blocks()) {
+    changed.insert(new_block.position());
+    adds_components = adds_components || isComponent(kindOf(new_block));
+  }
+
+  if (changed.size() > kFullRebuildThreshold) {
+    rebuildAll();
+  } else if (component_count_ > 0 || adds_components) {
+    // A node's edges depend only on the blocks next to it, and every edge joins neighbouring blocks, so an edge can
+    // only appear or disappear if its source is within two blocks of a change.
+    QSet<BlockPosition> dirty;
+    foreach (const BlockPosition& position, changed) {
+      for (int dy = -kRebuildRadius; dy <= kRebuildRadius; ++dy) {
+        for (int dz = -kRebuildRadius; dz <= kRebuildRadius; ++dz) {
+          for (int dx = -kRebuildRadius; dx <= kRebuildRadius; ++dx) {
+            dirty.insert(position + BlockPosition(dx, dy, dz));
+          }
+        }
+      }
+    }
+    rebuild(changed, dirty);
+  }
+  settle();
+  showChanges();
+}
+
+int RedstoneSimulator::kindOf(const BlockInstance& block) const {
+  switch (block.prototype()->type()) {
+    case kLeverOffType:
+    case kLeverOnType:
+      return kLever;
+    case kTorchOffType:
+    case kTorchOnType:
+      return kTorch;
+    case kRepeaterOffType:
+    case kRepeaterOnType:
+      return kRepeater;
+    case kWireType:
+    case kPoweredWireType:
+      return kWire;
+    case kLampOffType:
+    case kLampOnType:
+      return kLamp;
+    default:
+      return block.prototype()->isPlainCube() ? kConductor : -1;
+  }
+}
+
+int RedstoneSimulator::kindAt(const BlockPosition& position) const {
+  return kindOf(diagram_->blockAt(position));
+}
+
+int RedstoneSimulator::nodeKindAt(const BlockPosition& position) const {
+  int kind = kindAt(position);
+  if (kind != kConductor) {
+    return kind;
+  }
+  for (int i = 0; i < kNeighborCount; ++i) {
+    if (isComponent(kindAt(position + kNeighbors[i]))) {
+      return kConductor;
+    }
+  }
+  return -1;
+}
+
+int RedstoneSimulator::addNode(const BlockInstance& block, Kind kind) {
+  int index;
+  if (free_nodes_.isEmpty()) {
+    index = nodes_.size();
+    nodes_.append(Node());
+    nodes_[index].serial = 0;
+  } else {
+    index = free_nodes_.last();
+    free_nodes_.pop_back();
+  }
+
+  Node& node = nodes_[index];
+  node.position = block.position();
+  node.kind = kind;
+  node.alive = true;
+  node.queued = false;
+  ++node.serial;
+
+  // Components start out in the state they were placed in.
+  blocktype_t type = block.prototype()->type();
+  bool on = (type == kLeverOnType || type == kTorchOnType || type == kRepeaterOnType || type == kPoweredWireType ||
+             type == kLampOnType);
+  node.level = on ? kMaxPower : 0;
+  node.scheduled_level = node.level;
+  if (kind == kLever || kind == kTorch) {
+    node.direction = attachmentOffset(block.orientation());
+  } else if (kind == kRepeater) {
+    node.direction = facingOffset(block.orientation());
+  } else {
+    node.direction = BlockPosition();
+  }
+
+  node_index_.insert(node.position, index);
+  if (isComponent(kind)) {
+    ++component_count_;
+  }
+  changed_.insert(index);
+  return index;
+}
+
+void RedstoneSimulator::removeNode(int index) {
+  clearOutputs(index);
+  Node& node = nodes_[index];
+  foreach (const Edge& input, node.inputs) {
+    QVector<Edge>& outputs = nodes_[input.node].outputs;
+    for (int i = outputs.size() - 1; i >= 0; --i) {
+      if (outputs.at(i).node == index) {
+        outputs.remove(i);
+      }
+    }
+  }
+  node.inputs.clear();
+  node_index_.remove(node.position);
+  if (isComponent(node.kind)) {
+    --component_count_;
+  }
+  node.alive = false;
+  changed_.remove(index);
+  free_nodes_.append(index);
+}
+
+void RedstoneSimulator::addEdge(int source, int target, Coupling coupling) {
+  QVector<Edge>& outputs = nodes_[source].outputs;
+  for (int i = 0; i < outputs.size(); ++i) {
+    if (outputs.at(i).node == target) {
+      return;
+    }
+  }
+  Edge output = { target, coupling };
+  outputs.append(output);
+  Edge input = { source, coupling };
+  nodes_[target].inputs.append(input);
+  enqueue(target);
+}
+
+void RedstoneSimulator::clearOutputs(int index) {
+  foreach (const Edge& output, nodes_.at(index).outputs) {
+    QVector<Edge>& inputs = nodes_[output.node].inputs;
+    for (int i = inputs.size() - 1; i >= 0; --i) {
+      if (inputs.at(i).node == index) {
+        inputs.remove(i);
+      }
+    }
+    enqueue(output.node);
+  }
+  nodes_[index].outputs.clear();
+}
+
+void RedstoneSimulator::connectOutputs(int index) {
+  const Node& node = nodes_.at(index);
+  switch (node.kind) {
+    case kLever:
+    case kTorch:
+    {
+      BlockPosition attached = node.position + node.direction;
+      for (int i = 0; i < kNeighborCount; ++i) {
+        BlockPosition position = node.position + kNeighbors[i];
+        int target = nodeAt(position);
+        if (target < 0) {
+          continue;
+        }
+        const Node& other = nodes_.at(target);
+        if (position == attached) {
+          // A lever powers the block it is on, but a torch is switched by it instead.
+          if (node.kind == kLever && other.kind == kConductor) {
+            addEdge(index, target, kFullPower);
+          }
+        } else if (other.kind == kConductor) {
+          if (node.kind == kTorch && kNeighbors[i] == kAbove) {
+            addEdge(index, target, kFullPower);
+          }
+        } else if (other.kind == kWire || other.kind == kLamp ||
+                   (other.kind == kRepeater && position + opposite(other.direction) == node.position)) {
+          addEdge(index, target, kFullPower);
+        }
+      }
+      break;
+    }
+    case kRepeater:
+    {
+      int target = nodeAt(node.position + node.direction);
+      if (target >= 0) {
+        const Node& other = nodes_.at(target);
+        if (other.kind == kConductor || other.kind == kWire || other.kind == kLamp ||
+            (other.kind == kRepeater && other.direction == node.direction)) {
+          addEdge(index, target, kFullPower);
+        }
+      }
+      break;
+    }
+    case kWire:
+      connectWire(index);
+      break;
+    case kConductor:
+      for (int i = 0; i < kNeighborCount; ++i) {
+        BlockPosition position = node.position + kNeighbors[i];
+        int target = nodeAt(position);
+        if (target < 0) {
+          continue;
+        }
+        const Node& other = nodes_.at(target);
+        if (other.kind == kWire) {
+          addEdge(index, target, kStrongPower);
+        } else if (other.kind == kLamp ||
+                   (other.kind == kTorch && position + other.direction == node.position) ||
+                   (other.kind == kRepeater && position + opposite(other.direction) == node.position)) {
+          addEdge(index, target, kFullPower);
+        }
+      }
+      break;
+    case kLamp:
+      break;
+  }
+}
+
+void RedstoneSimulator::connectWire(int index) {
+  BlockPosition position = nodes_.at(index).position;
+  QList<BlockPosition> joined;
+  int connections = wireConnections(position, &joined);
+  foreach (const BlockPosition& wire, joined) {
+    addEdge(index, nodeAt(wire), kWirePower);
+  }
+
+  // A wire points along the run it is part of, or every way if it is on its own.
+  int pointed = 0;
+  if (connections == 0) {
+    pointed = kAlongX | kAlongZ;
+  } else if (!(connections & kAlongX)) {
+    pointed = kAlongZ;
+  } else if (!(connections & kAlongZ)) {
+    pointed = kAlongX;
+  }
+
+  for (int i = 0; i <= kHorizontalCount; ++i) {
+    BlockPosition offset = (i < kHorizontalCount) ? kHorizontal[i] : kBelow;
+    int target = nodeAt(position + offset);
+    if (target < 0) {
+      continue;
+    }
+    const Node& other = nodes_.at(target);
+    bool points_here = (i == kHorizontalCount) || (pointed & (1 << i));
+    if (other.kind == kRepeater) {
+      // Repeaters take power from a wire behind them whichever way it points.
+      if (other.position + opposite(other.direction) == position) {
+        addEdge(index, target, kFullPower);
+      }
+    } else if (points_here && other.kind == kConductor) {
+      addEdge(index, target, kWeakPower);
+    } else if (points_here && other.kind == kLamp) {
+      addEdge(index, target, kFullPower);
+    }
+  }
+}
+
+int RedstoneSimulator::wireConnections(const BlockPosition& position, QList<BlockPosition>* joined) const {
+  int connections = 0;
+  bool cut_above = (kindAt(position + kAbove) == kConductor);
+  for (int i = 0; i < kHorizontalCount; ++i) {
+    BlockPosition side = position + kHorizontal[i];
+    BlockInstance block = diagram_->blockAt(side);
+    int kind = kindOf(block);
+    if (kind == kWire) {
+      connections |= 1 << i;
+      joined->append(side);
+    } else if (kind == kLever || kind == kTorch) {
+      connections |= 1 << i;
+    } else if (kind == kRepeater) {
+      BlockPosition facing = facingOffset(block.orientation());
+      if (facing == kHorizontal[i] || facing == opposite(kHorizontal[i])) {
+        connections |= 1 << i;
+      }
+    } else if (kind == kConductor) {
+      // Up a step, unless the block above this wire cuts it.
+      if (!cut_above && kindAt(side + kAbove) == kWire) {
+        connections |= 1 << i;
+        joined->append(side + kAbove);
+      }
+    } else if (kindAt(side + kBelow) == kWire) {
+      // Down a step.
+      connections |= 1 << i;
+      joined->append(side + kBelow);
+    }
+  }
+  return connections;
+}
+
+void RedstoneSimulator::rebuild(const QSet<BlockPosition>& changed, const QSet<BlockPosition>& dirty) {
+  foreach (const BlockPosition& position, dirty) {
+    int index = nodeAt(position);
+    if (index >= 0) {
+      clearOutputs(index);
+    }
+  }
+
+  // Replace the nodes for changed blocks, and add or remove conductors as components come and go next to them.
+  foreach (const BlockPosition& position, dirty) {
+    int kind = nodeKindAt(position);
+    int index = nodeAt(position);
+    if (index >= 0 && (changed.contains(position) || nodes_.at(index).kind != kind)) {
+      removeNode(index);
+      index = -1;
+    }
+    if (index < 0 && kind >= 0) {
+      addNode(diagram_->blockAt(position), static_cast<Kind>(kind));
+    }
+  }
+
+  foreach (const BlockPosition& position, dirty) {
+    int index = nodeAt(position);
+    if (index >= 0) {
+      connectOutputs(index);
+      enqueue(index);
+    }
+  }
+}
+
+void RedstoneSimulator::rebuildAll() {
+  clear();
+  QSet<BlockPosition> dirty;
+  foreach (const BlockInstance& block, diagram_->findBlocks(component_types_)) {
+    dirty.insert(block.position());
+    for (int i = 0; i < kNeighborCount; ++i) {
+      dirty.insert(block.position() + kNeighbors[i]);
+    }
+  }
+  rebuild(QSet<BlockPosition>(), dirty);
+}
+
+void RedstoneSimulator::clear() {
+  nodes_.clear();
+  free_nodes_.clear();
+  node_index_.clear();
+  component_count_ = 0;
+  events_.clear();
+  worklist_.clear();
+  changed_.clear();
+}
+
+void RedstoneSimulator::enqueue(int index) {
+  Node& node = nodes_[index];
+  if (!node.queued) {
+    node.queued = true;
+    worklist_.append(index);
+  }
+}
+
+void RedstoneSimulator::setLevel(int index, int level) {
+  Node& node = nodes_[index];
+  if (node.level == level) {
+    return;
+  }
+  node.level = level;
+  changed_.insert(index);
+  for (int i = 0; i < node.outputs.size(); ++i) {
+    enqueue(node.outputs.at(i).node);
+  }
+}
+
+void RedstoneSimulator::schedule(int index, int level, int delay) {
+  Event event;
+  event.tick = tick_ + delay;
+  event.sequence = next_sequence_++;
+  event.node = index;
+  event.serial = nodes_.at(index).serial;
+  event.level = level;
+  nodes_[index].scheduled_level = level;
+
+  events_.append(event);
+  int child = events_.size() - 1;
+  while (child > 0) {
+    int parent = (child - 1) / 2;
+    if (!(events_.at(child) < events_.at(parent))) {
+      break;
+    }
+    qSwap(events_[child], events_[parent]);
+    child = parent;
+  }
+}
+
+RedstoneSimulator::Event RedstoneSimulator::popEvent() {
+  Event first = events_.first();
+  events_[0] = events_.last();
+  events_.pop_back();
+  int parent = 0;
+  int count = events_.size();
+  while (true) {
+    int smallest = parent;
+    int left = 2 * parent + 1;
+    int right = left + 1;
+    if (left < count && events_.at(left) < events_.at(smallest)) {
+      smallest = left;
+    }
+    if (right < count && events_.at(right) < events_.at(smallest)) {
+      smallest = right;
+    }
+    if (smallest == parent) {
+      break;
+    }
+    qSwap(events_[parent], events_[smallest]);
+    parent = smallest;
+  }
+  return first;
+}
+
+int RedstoneSimulator::inputPower(const Node& node) const {
+  int power = 0;
+  QVector<Edge>::const_iterator iter;
+  for (iter = node.inputs.constBegin(); iter != node.inputs.constEnd(); ++iter) {
+    int level = nodes_.at(iter->node).level;
+    switch (iter->coupling) {
+      case kFullPower:
+        level = (level > 0) ? kMaxPower : 0;
+        break;
+      case kWirePower:
+        level = qMax(level - 1, 0);
+        break;
+      case kWeakPower:
+        level = (level > 0) ? 1 : 0;
+        break;
+      case kStrongPower:
+        level = (level == kMaxPower) ? kMaxPower : 0;
+        break;
+    }
+    power = qMax(power, level);
+  }
+  return power;
+}
+
+void RedstoneSimulator::settle() {
+  // Breadth first, so that power spreading along a wire settles in one pass rather than being lowered step by step.
+  for (int i = 0; i < worklist_.size(); ++i) {
+    int index = worklist_.at(i);
+    Node& node = nodes_[index];
+    node.queued = false;
+    if (!node.alive) {
+      continue;
+    }
+    int power = inputPower(node);
+    switch (node.kind) {
+      case kLever:
+        break;
+      case kTorch:
+      {
+        int level = (power > 0) ? 0 : kMaxPower;
+        if (level != node.scheduled_level) {
+          schedule(index, level, kSwitchDelay);
+        }
+        break;
+      }
+      case kRepeater:
+      {
+        int level = (power > 0) ? kMaxPower : 0;
+        if (level != node.scheduled_level) {
+          schedule(index, level, kSwitchDelay);
+        }
+        break;
+      }
+      case kWire:
+      case kConductor:
+        setLevel(index, power);
+        break;
+      case kLamp:
+        setLevel(index, (power > 0) ? kMaxPower : 0);
+        break;
+    }
+  }
+  worklist_.clear();
+}
+
+BlockPrototype* RedstoneSimulator::displayedPrototype(const Node& node) const {
+  bool on = (node.level > 0);
+  switch (node.kind) {
+    case kTorch:
+      return block_mgr_->getPrototype(on ? kTorchOnType : kTorchOffType);
+    case kRepeater:
+      return block_mgr_->getPrototype(on ? kRepeaterOnType : kRepeaterOffType);
+    case kWire:
+      return block_mgr_->getPrototype(on ? kPoweredWireType : kWireType);
+    case kLamp:
+      return block_mgr_->getPrototype(on ? kLampOnType : kLampOffType);
+    default:
+      return NULL;
+  }
+}
+
+void RedstoneSimulator::showChanges() {
+  if (changed_.isEmpty()) {
+    return;
+  }
+  BlockTransaction transaction;
+  foreach (int index, changed_) {
+    const Node& node = nodes_.at(index);
+    BlockPrototype* prototype = displayedPrototype(node);
+    if (!prototype) {
+      continue;
+    }
+    BlockInstance block = diagram_->blockAt(node.position);
+    const BlockInstance& shown = diagram_->displayedBlock(block);
+    if (shown.prototype() != prototype) {
+      transaction.replaceBlock(shown, BlockInstance(prototype, node.position, block.orientation()));
+    }
+  }
+  changed_.clear();
+  if (!transaction.new_blocks().isEmpty()) {
+    diagram_->showSimulatedBlocks(transaction);
+  }
+}
@@ -0,0 +1,252 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REDSTONE_SIMULATOR_H
+#define REDSTONE_SIMULATOR_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include "block_position.h"
+#include "block_type.h"
+
+class BlockInstance;
+class BlockManager;
+class BlockPrototype;
+class BlockTransaction;
+class Diagram;
+
+/**
+  * Runs the redstone circuits in a Diagram and shows their power states in the views (see
+  * Diagram::showSimulatedBlocks()), without changing the diagram itself.
+  *
+  * The simulator keeps a graph with a node for every lever, redstone torch, repeater, wire, and redstone lamp, and
+  * for every solid block next to one of them.  Each node has a power level from 0 to 15, and the edges between nodes
+  * follow Minecraft's rules closely enough for ordinary circuits:
+  *
+  *   * A thrown lever strongly powers the block it is attached to, and powers the wires, lamps, and repeaters next to
+  *     it.
+  *   * A lit torch strongly powers the block above it, and powers the wires, lamps, and repeaters next to it other than
+  *     the block it is attached to.  A torch goes out when the block it is attached to is powered.
+  *   * A repeater is on when whatever is behind it is powered, and then strongly powers whatever is in front of it.
+  *   * A wire takes full power from levers, torches, repeaters, and strongly powered blocks, and one less than its
+  *     strongest neighbouring wire.  Wires join to each other on the same level and up and down steps that are not
+  *     cut by a solid block.  A powered wire weakly powers the block below it and the blocks that it points into: both
+  *     ends of a straight run, or all four sides of a lone wire.  Weakly powered blocks light lamps and switch torches
+  *     and repeaters, but do not power wires.
+  *   * A lamp is lit when anything next to it powers it.
+  *
+  * Wall-mounted torches and levers are attached to the block on the side that their orientation names, and repeaters
+  * face in the direction that they output.  Torches and repeaters take two game ticks to switch, and everything else
+  * switches in the same tick.
+  *
+  * Time is advanced by an event-driven scheduler: changes to torches and repeaters are queued on a priority queue
+  * keyed by the tick at which they happen, and only the nodes whose inputs changed are evaluated again, so a tick
+  * costs time in proportion to the activity in the circuit and not to its size.  When the diagram changes, only the
+  * part of the graph around the changed blocks is rebuilt.
+  *
+  * Levers are switched by placing the on or off lever block.  The rest of the components take whatever state the
+  * simulation gives them, starting from the state in which they were placed.
+  */
+class RedstoneSimulator : public QObject {
+  Q_OBJECT
+ public:
+  RedstoneSimulator(Diagram* diagram, BlockManager* block_mgr, QObject* parent = NULL);
+
+  /**
+    * Returns \c true if the simulation is running.
+    */
+  bool isRunning() const {
+    return timer_.isActive();
+  }
+
+  /**
+    * Returns the number of game ticks that have been simulated since the simulation was started.
+    */
+  qint64 ticks() const {
+    return tick_;
+  }
+
+ public slots:
+  /**
+    * Starts or stops the simulation.  Starting it builds the graph from the diagram and runs it at Minecraft's rate of
+    * 20 game ticks per second; stopping it removes the power states from the views.
+    */
+  void setRunning(bool running);
+
+  /**
+    * Advances the simulation by \p ticks game ticks and shows the result.
+    */
+  void step(int ticks = 1);
+
+ private slots:
+  /**
+    * Rebuilds the part of the graph around the blocks that \p transaction changed.
+    */
+  void updateGraph(const BlockTransaction& transaction);
+
+ private:
+  enum Kind {
+    kLever,
+    kTorch,
+    kRepeater,
+    kWire,
+    kLamp,
+    kConductor
+  };
+
+  /**
+    * How the power level of the node at one end of an edge reaches the node at the other end.
+    */
+  enum Coupling {
+    kFullPower,    // Any power at all gives full power.
+    kWirePower,    // One less than the source's level.
+    kWeakPower,    // Any power weakly powers a solid block.
+    kStrongPower   // Only a strongly powered block gives power.
+  };
+
+  struct Edge {
+    int node;
+    Coupling coupling;
+  };
+
+  struct Node {
+    BlockPosition position;
+    Kind kind;
+    /** For torches and levers, the offset of the attached block; for repeaters, the direction they face. */
+    BlockPosition direction;
+    int level;
+    /** The level that the last event queued for this node will set, or level if there is none. */
+    int scheduled_level;
+    /** Incremented whenever the slot is reused, so that events for a removed node can be ignored. */
+    quint32 serial;
+    bool alive;
+    bool queued;
+    QVector<Edge> inputs;
+    QVector<Edge> outputs;
+  };
+
+  struct Event {
+    qint64 tick;
+    quint32 sequence;
+    int node;
+    quint32 serial;
+    int level;
+
+    bool operator<(const Event& other) const {
+      return tick < other.tick || (tick == other.tick && sequence < other.sequence);
+    }
+  };
+
+  /**
+    * Returns the kind of node that \p block needs, or -1 if it needs none.  Solid blocks are reported as conductors
+    * whether or not they are next to a component.
+    */
+  int kindOf(const BlockInstance& block) const;
+  int kindAt(const BlockPosition& position) const;
+
+  /**
+    * Returns \c true if \p kind is a component rather than a conductor.
+    */
+  static bool isComponent(int kind) {
+    return kind >= 0 && kind != kConductor;
+  }
+
+  /**
+    * Returns the kind of node needed at \p position, or -1 if none is: like kindOf(), but solid blocks only need a
+    * node when a component is next to them.
+    */
+  int nodeKindAt(const BlockPosition& position) const;
+
+  /**
+    * Returns the node at \p position, or -1 if there is none.
+    */
+  int nodeAt(const BlockPosition& position) const {
+    return node_index_.value(position, -1);
+  }
+
+  int addNode(const BlockInstance& block, Kind kind);
+  void removeNode(int index);
+  void addEdge(int source, int target, Coupling coupling);
+  void clearOutputs(int index);
+
+  /**
+    * Adds the edges out of node \p index to the nodes that already exist around it.
+    */
+  void connectOutputs(int index);
+  void connectWire(int index);
+
+  /**
+    * Returns a bit for each horizontal direction in which the wire at \p position joins something, and appends the
+    * positions of the wires that it joins to \p joined.
+    */
+  int wireConnections(const BlockPosition& position, QList<BlockPosition>* joined) const;
+
+  /**
+    * Brings the nodes at the positions in \p dirty up to date with the diagram and reconnects them.  The nodes at the
+    * positions in \p changed are replaced even if their kind is the same.
+    */
+  void rebuild(const QSet<BlockPosition>& changed, const QSet<BlockPosition>& dirty);
+  void rebuildAll();
+  void clear();
+
+  void enqueue(int index);
+  void setLevel(int index, int level);
+  void schedule(int index, int level, int delay);
+  Event popEvent();
+
+  /**
+    * Returns the strongest power that \p node receives from its inputs.
+    */
+  int inputPower(const Node& node) const;
+
+  /**
+    * Evaluates the queued nodes, and the nodes that they change in turn, until nothing changes in this tick.
+    */
+  void settle();
+
+  /**
+    * Returns the block type that shows the state of \p node, or NULL if it has none to show.
+    */
+  BlockPrototype* displayedPrototype(const Node& node) const;
+
+  /**
+    * Shows the states of the nodes that changed since the last call.
+    */
+  void showChanges();
+
+  Diagram* diagram_;
+  BlockManager* block_mgr_;
+  QTimer timer_;
+  qint64 tick_;
+  quint32 next_sequence_;
+
+  QVector<Node> nodes_;
+  QVector<int> free_nodes_;
+  QHash<BlockPosition, int> node_index_;
+  int component_count_;
+
+  /** A binary heap of pending events, ordered by Event::operator<. */
+  QVector<Event> events_;
+  QVector<int> worklist_;
+  QSet<int> changed_;
+  QSet<blocktype_t> component_types_;
+};
+
+#endif // REDSTONE_SIMULATOR_H
@@ -20,6 +20,7 @@
 
 #include "enums.h"
 
+class BlockOracle;
 class Renderable;
 
 /**
@@ -30,9 +31,11 @@ class RenderDelegate {
   /**
     * Returns whether \p renderable should render a \p face at \p location.  The return value of this method may be
     * affected by, among other things, what blocks are adjacent to the one at \p location and whether that block and/or
-    * adjacent blocks are transparent.
+    * adjacent blocks are transparent.  The adjacent blocks are looked up in \p oracle; if it is NULL, every face is
+    * rendered.
     */
-  virtual bool shouldRenderFace(const Renderable* renderable, Face face, const QVector3D& location) const = 0;
+  virtual bool shouldRenderFace(const Renderable* renderable, Face face, const QVector3D& location,
+                                BlockOracle* oracle) const = 0;
 
   /**
     * Returns a vector of valid orientations for this block.  The default orientation will be the first element in the
@@ -0,0 +1,58 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render_quality.h"
+
+#include <QSettings>
+
+#include "application.h"
+
+// Static.
+RenderQuality RenderQuality::preset(Preset preset) {
+  RenderQuality quality;
+  switch (preset) {
+  case kLowQuality:
+    quality.multisampling = false;
+    quality.alpha_to_coverage = false;
+    quality.draw_distance = 48.0f;
+    break;
+  case kMediumQuality:
+    quality.multisampling = true;
+    quality.alpha_to_coverage = false;
+    quality.draw_distance = 72.0f;
+    break;
+  case kHighQuality:
+  default:
+    quality.multisampling = true;
+    quality.alpha_to_coverage = true;
+    quality.draw_distance = 100.0f;
+    break;
+  }
+  return quality;
+}
+
+// Static.
+RenderQuality::Preset RenderQuality::savedPreset() {
+  int preset = Application::instance()->settings()->value("RenderQuality", kHighQuality).toInt();
+  if (preset < kLowQuality || preset > kHighQuality) {
+    return kHighQuality;
+  }
+  return static_cast<Preset>(preset);
+}
+
+// Static.
+void RenderQuality::savePreset(Preset preset) {
+  Application::instance()->settings()->setValue("RenderQuality", static_cast<int>(preset));
+}
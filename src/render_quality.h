@@ -0,0 +1,58 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RENDER_QUALITY_H
+#define RENDER_QUALITY_H
+
+/**
+  * The settings the 3D preview trades image quality for speed with.  Rather than being chosen one by one, they come
+  * in presets, from the cheapest (kLowQuality) to the best looking (kHighQuality).
+  */
+struct RenderQuality {
+  enum Preset {
+    kLowQuality = 0,
+    kMediumQuality = 1,
+    kHighQuality = 2
+  };
+
+  /**
+    * Returns the settings of \p preset.  kHighQuality is what the preview has always drawn with.
+    */
+  static RenderQuality preset(Preset preset);
+
+  /**
+    * Returns the preset the user last chose, or kHighQuality if they never have.
+    */
+  static Preset savedPreset();
+
+  /**
+    * Remembers \p preset as the user's choice, for savedPreset() to return from then on.
+    */
+  static void savePreset(Preset preset);
+
+  /// Whether edges are multisampled.  A GLWidget only asks for sample buffers if the preset saved when it is created
+  /// multisamples, so a preview only gains or frees its multisampled framebuffer when it is next opened.
+  bool multisampling;
+
+  /// Whether the alpha of textures decides how many samples they cover, which antialiases the edges of leaves,
+  /// glass and the like.  Needs multisampling.
+  bool alpha_to_coverage;
+
+  /// How far from the camera, in blocks, geometry is drawn.  The fog thickens over the far half of this distance,
+  /// so that geometry fades out rather than popping out of view.
+  float draw_distance;
+};
+
+#endif // RENDER_QUALITY_H
@@ -31,6 +31,14 @@ Texture Renderable::texture(int local_id) const {
   }
 }
 
+GLuint Renderable::textureId(int local_id) const {
+  if (local_id >= 0 && local_id < textures_.size()) {
+    return textures_[local_id].textureId();
+  } else {
+    return 0;
+  }
+}
+
 int Renderable::textureCount() const {
   return textures_.size();
 }
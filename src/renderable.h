@@ -24,8 +24,11 @@
 
 #include "texture.h"
 
+class BlockOracle;
 class BlockOrientation;
 class RenderDelegate;
+class SceneMesh;
+struct SceneMaterial;
 
 /**
   * Abstract class representing objects that can be rendered in 3D.  Each BlockPrototype has an associated Renderable,
@@ -42,7 +45,8 @@ class Renderable {
 
   /**
     * Initializes this Renderable.
-    * This must be called before the renderable can be used to draw geometry.
+    * This must be called before the renderable can be used to draw geometry, and after its textures and render
+    * delegate have been set, since subclasses may work out how to draw each orientation here.
     * @remarks The need for an explicit initialize method is regrettable, but it is a consequence of the poor design
     * of the C++ language: it is impossible to safely call virtual methods from a true constructor.
     */
@@ -68,10 +72,24 @@ class Renderable {
 
   /**
     * Renders the textures and geometry this Renderable knows how to draw at the given location and orientation.
-    * This method is implemented differently by each Renderable subclass.
+    * This method is implemented differently by each Renderable subclass.  \p oracle holds the blocks around the one
+    * being rendered, and is passed on to the render delegate to leave out the faces they hide.  It may be NULL.
     * @warning You must call initialize() before calling this method.
     */
-  virtual void renderAt(const QVector3D& location, const BlockOrientation* orientation) const = 0;
+  virtual void renderAt(const QVector3D& location, const BlockOrientation* orientation, BlockOracle* oracle) const = 0;
+
+  /**
+    * Appends the quads that renderAt() would draw at the given location and orientation to \p mesh, drawn with
+    * \p material.  The renderable fills in the texture slot and filter of the material for each quad.
+    * @warning You must call initialize() before calling this method.
+    */
+  virtual void appendGeometry(SceneMesh* mesh, const SceneMaterial& material, const QVector3D& location,
+                              const BlockOrientation* orientation, BlockOracle* oracle) const = 0;
+
+  /**
+    * Returns the GL texture id of the texture with the given local ID, or 0 if there is none.
+    */
+  GLuint textureId(int local_id) const;
 
   /**
     * Returns true if initialize() has been called on this Renderable.
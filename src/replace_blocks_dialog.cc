@@ -0,0 +1,79 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replace_blocks_dialog.h"
+
+#include <QList>
+#include <QMap>
+
+#include "block_manager.h"
+#include "block_prototype.h"
+#include "diagram.h"
+
+ReplaceBlocksDialog::ReplaceBlocksDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent)
+    : QDialog(parent) {
+  ui.setupUi(this);
+
+  QList<blocktype_t> used_types = diagram->blockCounts().keys();
+  foreach (blocktype_t type, used_types) {
+    BlockPrototype* prototype = block_mgr->getPrototype(type);
+    ui.source_type_combo_->addItem(QIcon(prototype->sprite()), prototype->name(), type);
+  }
+
+  ui.dest_type_combo_->addItem("Nothing (erase)", kBlockTypeAir);
+  BlockTypeIterator iter = BlockPrototype::blockIterator();
+  while (iter.hasNext()) {
+    BlockPrototype* prototype = block_mgr->getPrototype(iter.next());
+    ui.dest_type_combo_->addItem(QIcon(prototype->sprite()), prototype->name(), prototype->type());
+  }
+  ui.dest_type_combo_->setCurrentIndex(ui.dest_type_combo_->count() > 1 ? 1 : 0);
+
+  connect(ui.source_type_combo_, SIGNAL(currentIndexChanged(int)), SLOT(updateButtons()));
+  connect(ui.dest_type_combo_, SIGNAL(currentIndexChanged(int)), SLOT(updateButtons()));
+  connect(ui.preserve_orientation_check_, SIGNAL(toggled(bool)), SLOT(updateButtons()));
+  updateButtons();
+}
+
+void ReplaceBlocksDialog::setLevelRange(int min_level, int max_level) {
+  ui.min_level_spin_->setValue(min_level);
+  ui.max_level_spin_->setValue(max_level);
+}
+
+blocktype_t ReplaceBlocksDialog::sourceType() const {
+  return ui.source_type_combo_->itemData(ui.source_type_combo_->currentIndex()).toInt();
+}
+
+blocktype_t ReplaceBlocksDialog::destType() const {
+  return ui.dest_type_combo_->itemData(ui.dest_type_combo_->currentIndex()).toInt();
+}
+
+int ReplaceBlocksDialog::minLevel() const {
+  return qMin(ui.min_level_spin_->value(), ui.max_level_spin_->value());
+}
+
+int ReplaceBlocksDialog::maxLevel() const {
+  return qMax(ui.min_level_spin_->value(), ui.max_level_spin_->value());
+}
+
+bool ReplaceBlocksDialog::preserveOrientation() const {
+  return ui.preserve_orientation_check_->isChecked();
+}
+
+void ReplaceBlocksDialog::updateButtons() {
+  // Replacing a block with itself is only meaningful if it resets the orientation.
+  bool is_valid = ui.source_type_combo_->count() > 0 &&
+                  (sourceType() != destType() || !preserveOrientation());
+  ui.button_box_->button(QDialogButtonBox::Ok)->setEnabled(is_valid);
+}
@@ -0,0 +1,58 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REPLACE_BLOCKS_DIALOG_H
+#define REPLACE_BLOCKS_DIALOG_H
+
+#include "ui_replace_blocks_dialog.h"
+
+#include "block_type.h"
+
+class BlockManager;
+class Diagram;
+
+/**
+  * Dialog that asks the user which block type to replace, what to replace it with, and on which levels.  The dialog
+  * only collects the parameters; the replacement itself is performed by LevelWidget::replaceBlocks().
+  */
+class ReplaceBlocksDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  /**
+    * Creates a ReplaceBlocksDialog.  The source list is populated with the block types that currently appear in
+    * \p diagram, and the destination list with every known block type.
+    */
+  explicit ReplaceBlocksDialog(Diagram* diagram, BlockManager* block_mgr, QWidget* parent = NULL);
+
+  /**
+    * Sets the range of levels shown in the dialog when it opens.
+    */
+  void setLevelRange(int min_level, int max_level);
+
+  blocktype_t sourceType() const;
+  blocktype_t destType() const;
+  int minLevel() const;
+  int maxLevel() const;
+  bool preserveOrientation() const;
+
+ private slots:
+  void updateButtons();
+
+ private:
+  Ui::ReplaceBlocksDialog ui;
+};
+
+#endif // REPLACE_BLOCKS_DIALOG_H
@@ -0,0 +1,223 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scatter_tool.h"
+
+#include <QPointF>
+#include <QSet>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <qmath.h>
+#include <time.h>
+
+#include "block_instance.h"
+#include "block_manager.h"
+#include "block_oracle.h"
+#include "block_prototype.h"
+#include "block_transaction.h"
+#include "tree.h"
+
+namespace {
+
+/** The minimum distance between trees, in blocks.  Neighbouring canopies overlap a little at this spacing. */
+const int kTreeSpacing = 6;
+
+/** The minimum distance between single blocks, in blocks. */
+const int kBlockSpacing = 2;
+
+/** How many candidates to try around each sample before giving up on it, as suggested by Bridson. */
+const int kCandidatesPerSample = 30;
+
+/**
+  * Returns points in the rectangle from (\p min_x, \p min_z) to (\p max_x, \p max_z) that are at least \p spacing
+  * apart, using Bridson's algorithm.  The points are as dense as that allows, but in no particular pattern.
+  */
+QList<QPointF> poissonDiskSamples(float min_x, float min_z, float max_x, float max_z, float spacing, Random* random) {
+  // A background grid with cells small enough that each holds at most one sample makes the distance checks local.
+  float cell_size = spacing / qSqrt(2.0f);
+  int columns = qMax(qCeil((max_x - min_x) / cell_size), 1);
+  int rows = qMax(qCeil((max_z - min_z) / cell_size), 1);
+  QVector<int> grid(columns * rows, -1);
+
+  QList<QPointF> samples;
+  QList<int> active;
+  QPointF first(min_x + random->uniformReal() * (max_x - min_x), min_z + random->uniformReal() * (max_z - min_z));
+  samples.append(first);
+  active.append(0);
+  grid[qMin(static_cast<int>((first.y() - min_z) / cell_size), rows - 1) * columns +
+       qMin(static_cast<int>((first.x() - min_x) / cell_size), columns - 1)] = 0;
+
+  while (!active.isEmpty()) {
+    int active_index = random->uniform(0, active.size() - 1);
+    QPointF center = samples[active[active_index]];
+    bool found = false;
+    for (int attempt = 0; attempt < kCandidatesPerSample && !found; ++attempt) {
+      // A random point in the annulus between spacing and twice the spacing.
+      double angle = random->uniformReal() * 2.0 * M_PI;
+      double radius = spacing * (1.0 + random->uniformReal());
+      QPointF candidate(center.x() + radius * qCos(angle), center.y() + radius * qSin(angle));
+      if (candidate.x() < min_x || candidate.x() >= max_x || candidate.y() < min_z || candidate.y() >= max_z) {
+        continue;
+      }
+      int column = qMin(static_cast<int>((candidate.x() - min_x) / cell_size), columns - 1);
+      int row = qMin(static_cast<int>((candidate.y() - min_z) / cell_size), rows - 1);
+      bool too_close = false;
+      for (int r = qMax(row - 2, 0); r <= qMin(row + 2, rows - 1) && !too_close; ++r) {
+        for (int c = qMax(column - 2, 0); c <= qMin(column + 2, columns - 1) && !too_close; ++c) {
+          int neighbor = grid[r * columns + c];
+          if (neighbor >= 0) {
+            QPointF delta = samples[neighbor] - candidate;
+            too_close = delta.x() * delta.x() + delta.y() * delta.y() < spacing * spacing;
+          }
+        }
+      }
+      if (!too_close) {
+        grid[row * columns + column] = samples.size();
+        active.append(samples.size());
+        samples.append(candidate);
+        found = true;
+      }
+    }
+    if (!found) {
+      active.removeAt(active_index);
+    }
+  }
+  return samples;
+}
+
+/**
+  * The blocks of one planting.
+  */
+struct Planting {
+  QVector<BlockPosition> trunk;
+  QVector<BlockPosition> leaves;
+};
+
+/**
+  * Grows the tree for one site.  Used as a QtConcurrent map functor over the indices of the sites.
+  */
+class TreeGrower {
+ public:
+  typedef Planting result_type;
+
+  TreeGrower(const QList<BlockPosition>* sites, quint64 seed) : sites_(sites), seed_(seed) {}
+
+  Planting operator()(int index) const {
+    Random random(Random::mix(seed_, index));
+    Tree tree;
+    tree.randomize(&random);
+    Planting planting;
+    tree.grow(sites_->at(index), &planting.trunk, &planting.leaves);
+    return planting;
+  }
+
+ private:
+  const QList<BlockPosition>* sites_;
+  quint64 seed_;
+};
+
+}  // namespace
+
+ScatterTool::ScatterTool(BlockOracle* oracle, BlockManager* block_manager)
+    : oracle_(oracle), block_manager_(block_manager), random_(time(NULL)), seed_(random_.next64()),
+      sites_spacing_(0) {
+}
+
+QString ScatterTool::actionName() const {
+  return "Scatter";
+}
+
+bool ScatterTool::wantsMorePositions() {
+  return countPositions() < 2;
+}
+
+bool ScatterTool::isBrush() const {
+  return false;
+}
+
+void ScatterTool::clear() {
+  Tool::clear();
+  seed_ = random_.next64();
+  sites_.clear();
+  sites_spacing_ = 0;
+}
+
+void ScatterTool::updateSites(const BlockPosition& min, const BlockPosition& max, int spacing) {
+  if (spacing == sites_spacing_ && min == sites_min_ && max == sites_max_) {
+    return;
+  }
+  sites_min_ = min;
+  sites_max_ = max;
+  sites_spacing_ = spacing;
+
+  // Sample in continuous space over the whole rectangle of blocks, then drop each sample into the block it lands in.
+  Random random(seed_);
+  QList<QPointF> samples = poissonDiskSamples(min.x(), min.z(), max.x() + 1, max.z() + 1, spacing, &random);
+  sites_.clear();
+  foreach (const QPointF& sample, samples) {
+    sites_.append(BlockPosition(qFloor(sample.x()), min.y(), qFloor(sample.y())));
+  }
+}
+
+void ScatterTool::draw(BlockPrototype* prototype, const BlockOrientation* orientation, BlockTransaction* transaction) {
+  if (wantsMorePositions()) {
+    return;
+  }
+
+  BlockPosition min(qMin(positionAtIndex(0).x(), positionAtIndex(1).x()),
+                    positionAtIndex(0).y(),
+                    qMin(positionAtIndex(0).z(), positionAtIndex(1).z()));
+  BlockPosition max(qMax(positionAtIndex(0).x(), positionAtIndex(1).x()),
+                    positionAtIndex(0).y(),
+                    qMax(positionAtIndex(0).z(), positionAtIndex(1).z()));
+
+  if (!Tree::isWood(prototype->type())) {
+    updateSites(min, max, kBlockSpacing);
+    foreach (const BlockPosition& site, sites_) {
+      transaction->replaceBlock(oracle_->blockAt(site), BlockInstance(prototype, site, orientation));
+    }
+    return;
+  }
+
+  updateSites(min, max, kTreeSpacing);
+  QList<int> indices;
+  for (int i = 0; i < sites_.size(); ++i) {
+    indices.append(i);
+  }
+  QList<Planting> plantings = QtConcurrent::blockingMapped<QList<Planting> >(indices, TreeGrower(&sites_, seed_));
+
+  QSet<BlockPosition> claimed;
+  foreach (const Planting& planting, plantings) {
+    foreach (const BlockPosition& point, planting.trunk) {
+      transaction->replaceBlock(oracle_->blockAt(point), BlockInstance(prototype, point, orientation));
+      claimed.insert(point);
+    }
+  }
+
+  BlockPrototype* leaf_prototype = block_manager_->getPrototype(Tree::leafTypeFor(prototype->type()));
+  foreach (const Planting& planting, plantings) {
+    foreach (const BlockPosition& point, planting.leaves) {
+      if (claimed.contains(point)) {
+        continue;
+      }
+      claimed.insert(point);
+      // Don't overwrite existing blocks.
+      BlockInstance old_block = oracle_->blockAt(point);
+      if (old_block.prototype()->type() == kBlockTypeAir) {
+        transaction->replaceBlock(old_block, BlockInstance(leaf_prototype, point, orientation));
+      }
+    }
+  }
+}
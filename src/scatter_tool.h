@@ -0,0 +1,66 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCATTER_TOOL_H
+#define SCATTER_TOOL_H
+
+#include <QList>
+
+#include "block_position.h"
+#include "random.h"
+#include "tool.h"
+
+class BlockManager;
+class BlockOracle;
+
+/**
+  * A Tool that scatters plantings over a rectangle between two corners, spaced out evenly but irregularly with
+  * Poisson disk sampling so that no two are closer than a minimum distance.
+  *
+  * If the current block is a kind of wood, each planting is a whole Tree with that wood as its trunk; otherwise it is
+  * a single block, which suits flowers, saplings, mushrooms and the like.  Every planting has its own Random, seeded
+  * from the tool's seed and the planting's index, so trees are grown in parallel on the global thread pool and still
+  * come out exactly the same every time the tool is redrawn.  They are then merged into one transaction in order:
+  * trunks first, so that a trunk always wins over a neighbour's canopy, and then leaves, which fill only the air that
+  * no earlier tree has claimed.
+  */
+class ScatterTool : public Tool {
+ public:
+  ScatterTool(BlockOracle* oracle, BlockManager* block_manager);
+  virtual QString actionName() const;
+  virtual bool wantsMorePositions();
+  virtual bool isBrush() const;
+  virtual void clear();
+  virtual void draw(BlockPrototype* prototype, const BlockOrientation* orientation, BlockTransaction* transaction);
+
+ private:
+  /**
+    * Fills sites_ with Poisson disk samples at least \p spacing apart in the rectangle between \p min and \p max,
+    * unless it already holds them.
+    */
+  void updateSites(const BlockPosition& min, const BlockPosition& max, int spacing);
+
+  BlockOracle* oracle_;
+  BlockManager* block_manager_;
+  Random random_;
+  quint64 seed_;
+
+  QList<BlockPosition> sites_;
+  BlockPosition sites_min_;
+  BlockPosition sites_max_;
+  int sites_spacing_;
+};
+
+#endif // SCATTER_TOOL_H
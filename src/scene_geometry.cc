@@ -0,0 +1,459 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scene_geometry.h"
+
+#include <QDataStream>
+#include <QFile>
+
+#include <cstddef>
+
+#include "block_instance.h"
+#include "block_manager.h"
+#include "block_orientation.h"
+#include "block_prototype.h"
+#include "diagram.h"
+
+namespace {
+
+/** Identifies a sidecar file written by SceneGeometry::save(). */
+const quint32 kFileMagic = 0x4d434753;  // "MCGS"
+
+/** Change this whenever the geometry a block produces, or the way it is saved, changes. */
+const quint32 kFileVersion = 3;
+
+/** The smallest number of vertices the arena is given room for. */
+const int kMinArenaCapacity = 1 << 16;
+
+/** How fragmented the arena may get (see BufferArena::fragmentation()) before it is packed again. */
+const float kMaxArenaFragmentation = 0.5f;
+
+/**
+  * Returns the distance from \p eye to the nearest point that a mesh with origin \p origin can have geometry at.
+  * The first quad of a mesh lies within kOriginGrid blocks of its origin, and the rest within a region of the first.
+  */
+float distanceToBatch(const QVector3D& eye, const BlockPosition& origin) {
+  const float margin = SceneGeometry::kRegionSize + 1;
+  const QVector3D min = origin.cornerVector() - QVector3D(margin, margin, margin);
+  const QVector3D max = origin.cornerVector() + QVector3D(SceneMesh::kOriginGrid + margin,
+                                                          SceneMesh::kOriginGrid + margin,
+                                                          SceneMesh::kOriginGrid + margin);
+  QVector3D offset(qMax<qreal>(qMax(min.x() - eye.x(), eye.x() - max.x()), 0),
+                   qMax<qreal>(qMax(min.y() - eye.y(), eye.y() - max.y()), 0),
+                   qMax<qreal>(qMax(min.z() - eye.z(), eye.z() - max.z()), 0));
+  return offset.length();
+}
+
+}  // namespace
+
+#ifndef GL_RESCALE_NORMAL
+#define GL_RESCALE_NORMAL 0x803A
+#endif
+
+const int SceneGeometry::kRegionSize;
+
+SceneGeometry::SceneGeometry()
+    : diagram_(NULL),
+      block_mgr_(NULL),
+      all_dirty_(true),
+      context_hash_(0),
+      arena_(sizeof(SceneVertex)),
+      multi_draw_arrays_(NULL),
+      multi_draw_arrays_resolved_(false) {
+}
+
+SceneGeometry::~SceneGeometry() {
+  Q_ASSERT_X(regions_.isEmpty(), __PRETTY_FUNCTION__, "Call releaseBuffers() before destroying the geometry.");
+  qDeleteAll(regions_);
+}
+
+void SceneGeometry::setDiagram(Diagram* diagram) {
+  diagram_ = diagram;
+  ephemeral_transaction_ = BlockTransaction();
+  invalidateAll();
+}
+
+// Static.
+BlockPosition SceneGeometry::regionOf(const BlockPosition& position) {
+  // Round towards negative infinity, so that the region at -1 runs from -16 to -1.
+  int x = position.x() >= 0 ? position.x() / kRegionSize : (position.x() + 1) / kRegionSize - 1;
+  int y = position.y() >= 0 ? position.y() / kRegionSize : (position.y() + 1) / kRegionSize - 1;
+  int z = position.z() >= 0 ? position.z() / kRegionSize : (position.z() + 1) / kRegionSize - 1;
+  return BlockPosition(x, y, z);
+}
+
+// Static.
+quint64 SceneGeometry::blockHash(const BlockInstance& block) {
+  quint64 appearance = (static_cast<quint64>(static_cast<quint32>(block.prototype()->type())) << 32) |
+                       qHash(block.orientation()->name());
+  return BlockPosition::mix(block.position().packed() ^ BlockPosition::mix(appearance));
+}
+
+void SceneGeometry::invalidate(const BlockTransaction& transaction) {
+  if (all_dirty_) {
+    return;
+  }
+  int changed = transaction.old_blocks().size() + transaction.new_blocks().size();
+  if (!diagram_ || changed > diagram_->blockCount() / 2) {
+    // Loading a diagram, for instance.  Rebuilding everything in one pass is cheaper than finding the regions.
+    invalidateAll();
+    return;
+  }
+  foreach (const BlockInstance& block, transaction.old_blocks()) {
+    invalidatePosition(block.position());
+  }
+  foreach (const BlockInstance& block, transaction.new_blocks()) {
+    invalidatePosition(block.position());
+  }
+}
+
+void SceneGeometry::invalidateEphemeral(const BlockTransaction& transaction) {
+  invalidate(ephemeral_transaction_);
+  invalidate(transaction);
+  ephemeral_transaction_ = transaction;
+}
+
+void SceneGeometry::invalidateAll() {
+  all_dirty_ = true;
+  dirty_regions_.clear();
+}
+
+void SceneGeometry::invalidatePosition(const BlockPosition& position) {
+  BlockPosition region = regionOf(position);
+  dirty_regions_.insert(region);
+  // The faces of the blocks next door may have been culled against this one.
+  int offsets[3] = { position.x() - region.x() * kRegionSize,
+                     position.y() - region.y() * kRegionSize,
+                     position.z() - region.z() * kRegionSize };
+  for (int axis = 0; axis < 3; ++axis) {
+    int step[3] = { 0, 0, 0 };
+    if (offsets[axis] == 0) {
+      step[axis] = -1;
+    } else if (offsets[axis] == kRegionSize - 1) {
+      step[axis] = 1;
+    } else {
+      continue;
+    }
+    dirty_regions_.insert(BlockPosition(region.x() + step[0], region.y() + step[1], region.z() + step[2]));
+  }
+}
+
+quint64 SceneGeometry::contextHash() const {
+  quint64 hash = BlockPosition::mix((static_cast<quint64>(kFileVersion) << 32) |
+                                    BlockPrototype::registryFingerprint());
+  hash = BlockPosition::mix(hash ^ (diagram_->levelsAreVertical() ? 1 : 0));
+  // Placed prefabs hide the faces of the blocks next to them.
+  foreach (const Prefab& prefab, diagram_->prefabs()) {
+    quint64 prefab_hash = 0;
+    foreach (const BlockInstance& block, prefab.blocks()) {
+      prefab_hash += blockHash(block);
+    }
+    hash = BlockPosition::mix(hash ^ prefab_hash);
+  }
+  foreach (const PrefabPlacement& placement, diagram_->placements()) {
+    hash = BlockPosition::mix(hash ^ placement.offset.packed());
+    hash = BlockPosition::mix(hash ^ ((static_cast<quint64>(placement.prefab) << 2) | placement.rotation));
+  }
+  return hash;
+}
+
+quint64 SceneGeometry::regionKey(const BlockPosition& region) const {
+  static const int kNeighbours[6][3] = {
+    { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }
+  };
+  quint64 key = BlockPosition::mix(context_hash_ ^ region.packed());
+  key = BlockPosition::mix(key ^ regions_.value(region)->content_hash);
+  for (int i = 0; i < 6; ++i) {
+    BlockPosition neighbour(region.x() + kNeighbours[i][0],
+                            region.y() + kNeighbours[i][1],
+                            region.z() + kNeighbours[i][2]);
+    Region* neighbour_region = regions_.value(neighbour, NULL);
+    key = BlockPosition::mix(key + (neighbour_region ? neighbour_region->content_hash : 0));
+  }
+  return key;
+}
+
+void SceneGeometry::update() {
+  if (!diagram_) {
+    return;
+  }
+  if (!multi_draw_arrays_resolved_) {
+    multi_draw_arrays_ = reinterpret_cast<MultiDrawArraysFunction>(
+        QGLContext::currentContext()->getProcAddress("glMultiDrawArrays"));
+    multi_draw_arrays_resolved_ = true;
+  }
+  if (all_dirty_) {
+    rebuildAll();
+    all_dirty_ = false;
+    dirty_regions_.clear();
+    return;
+  }
+  foreach (const BlockPosition& position, dirty_regions_.toList()) {
+    BlockPosition min(position.x() * kRegionSize, position.y() * kRegionSize, position.z() * kRegionSize);
+    BlockPosition max = min + BlockPosition(kRegionSize - 1, kRegionSize - 1, kRegionSize - 1);
+    QList<BlockInstance> blocks = diagram_->displayedBlocksBetween(min, max);
+    if (blocks.isEmpty()) {
+      removeRegion(position);
+      continue;
+    }
+    Region* region = regions_.value(position, NULL);
+    if (!region) {
+      region = new Region();
+      regions_.insert(position, region);
+    }
+    freeRange(region);
+    buildMesh(blocks, region);
+    upload(region);
+  }
+  dirty_regions_.clear();
+  if (arena_.fragmentation() > kMaxArenaFragmentation) {
+    repack();
+  }
+  updateDrawBatches();
+}
+
+void SceneGeometry::rebuildAll() {
+  foreach (const BlockPosition& position, regions_.keys()) {
+    removeRegion(position);
+  }
+  context_hash_ = contextHash();
+
+  QHash<BlockPosition, QList<BlockInstance> > blocks_by_region;
+  foreach (const BlockInstance& block, diagram_->displayedBlocks()) {
+    blocks_by_region[regionOf(block.position())].append(block);
+  }
+  // Every region has to be hashed before any key can be worked out, since the keys cover the neighbours too.
+  QHash<BlockPosition, QList<BlockInstance> >::const_iterator iter;
+  for (iter = blocks_by_region.constBegin(); iter != blocks_by_region.constEnd(); ++iter) {
+    Region* region = new Region();
+    foreach (const BlockInstance& block, iter.value()) {
+      region->content_hash += blockHash(block);
+    }
+    regions_.insert(iter.key(), region);
+  }
+  for (iter = blocks_by_region.constBegin(); iter != blocks_by_region.constEnd(); ++iter) {
+    Region* region = regions_.value(iter.key());
+    QHash<quint64, SceneMesh>::iterator cached = cached_meshes_.find(regionKey(iter.key()));
+    if (cached != cached_meshes_.end()) {
+      region->mesh = cached.value();
+    } else {
+      buildMesh(iter.value(), region);
+    }
+  }
+  cached_meshes_.clear();
+  repack();
+  updateDrawBatches();
+}
+
+void SceneGeometry::buildMesh(const QList<BlockInstance>& blocks, Region* region) const {
+  region->mesh = SceneMesh();
+  region->content_hash = 0;
+  foreach (const BlockInstance& block, blocks) {
+    region->content_hash += blockHash(block);
+    block.prototype()->appendInstanceGeometry(block, diagram_, &region->mesh);
+  }
+}
+
+void SceneGeometry::upload(Region* region) {
+  int count = region->mesh.vertexCount();
+  if (count == 0) {
+    return;
+  }
+  int first = arena_.allocate(count);
+  if (first < 0) {
+    // Packing every region again makes room, growing the arena if need be.
+    repack();
+    return;
+  }
+  region->first = first;
+  region->count = count;
+  arena_.bind();
+  const QMap<SceneMaterial, QVector<SceneVertex> >& batches = region->mesh.batches();
+  QMap<SceneMaterial, QVector<SceneVertex> >::const_iterator iter;
+  for (iter = batches.constBegin(); iter != batches.constEnd(); ++iter) {
+    arena_.write(first, iter.value().constData(), iter.value().size());
+    first += iter.value().size();
+  }
+  arena_.release();
+}
+
+void SceneGeometry::freeRange(Region* region) {
+  if (region->first >= 0) {
+    arena_.free(region->first, region->count);
+  }
+  region->first = -1;
+  region->count = 0;
+}
+
+void SceneGeometry::repack() {
+  int total = 0;
+  foreach (Region* region, regions_) {
+    region->first = -1;
+    region->count = 0;
+    total += region->mesh.vertexCount();
+  }
+  // Leave some room to grow, so that the next few edits don't need another repack.
+  if (!arena_.reset(qMax(kMinArenaCapacity, total + total / 2))) {
+    return;
+  }
+  foreach (Region* region, regions_) {
+    upload(region);
+  }
+}
+
+void SceneGeometry::updateDrawBatches() {
+  // Materials are in ascending order, so the transparent batches come out last.
+  QMap<SceneMaterial, QHash<quint64, DrawBatch> > batches_by_material;
+  foreach (Region* region, regions_) {
+    if (region->first < 0) {
+      continue;
+    }
+    int first = region->first;
+    const QMap<SceneMaterial, QVector<SceneVertex> >& batches = region->mesh.batches();
+    QMap<SceneMaterial, QVector<SceneVertex> >::const_iterator iter;
+    for (iter = batches.constBegin(); iter != batches.constEnd(); ++iter) {
+      DrawBatch& batch = batches_by_material[iter.key()][region->mesh.origin().packed()];
+      batch.material = iter.key();
+      batch.origin = region->mesh.origin();
+      batch.firsts.append(first);
+      batch.counts.append(iter.value().size());
+      first += iter.value().size();
+    }
+  }
+  draw_batches_.clear();
+  QMap<SceneMaterial, QHash<quint64, DrawBatch> >::const_iterator material_iter;
+  for (material_iter = batches_by_material.constBegin(); material_iter != batches_by_material.constEnd();
+       ++material_iter) {
+    foreach (const DrawBatch& batch, material_iter.value()) {
+      draw_batches_.append(batch);
+    }
+  }
+}
+
+void SceneGeometry::removeRegion(const BlockPosition& position) {
+  Region* region = regions_.take(position);
+  if (region) {
+    freeRange(region);
+    delete region;
+  }
+}
+
+void SceneGeometry::releaseBuffers() {
+  qDeleteAll(regions_);
+  regions_.clear();
+  draw_batches_.clear();
+  arena_.destroy();
+  all_dirty_ = true;
+}
+
+void SceneGeometry::draw(const QVector3D& eye, float draw_distance) {
+  if (draw_batches_.isEmpty()) {
+    return;
+  }
+  // Undo the quantization of the vertices (see SceneVertex).  Scaling the modelview matrix scales the normals too, so
+  // they need to be rescaled for the lighting to come out right.
+  glPushAttrib(GL_ENABLE_BIT);
+  glEnable(GL_RESCALE_NORMAL);
+  glMatrixMode(GL_TEXTURE);
+  glPushMatrix();
+  glLoadIdentity();
+  glScalef(1.0f / SceneMesh::kTexCoordScale, 1.0f / SceneMesh::kTexCoordScale, 1.0f);
+  glMatrixMode(GL_MODELVIEW);
+
+  arena_.bind();
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  // With the buffer bound, these are offsets into it.
+  glVertexPointer(3, GL_SHORT, sizeof(SceneVertex), reinterpret_cast<const GLvoid*>(offsetof(SceneVertex, position)));
+  glNormalPointer(GL_BYTE, sizeof(SceneVertex), reinterpret_cast<const GLvoid*>(offsetof(SceneVertex, normal)));
+  glTexCoordPointer(2, GL_SHORT, sizeof(SceneVertex),
+                    reinterpret_cast<const GLvoid*>(offsetof(SceneVertex, tex_coord)));
+  const GLfloat scale = 1.0f / SceneMesh::kPositionScale;
+  QVector<DrawBatch>::const_iterator batch;
+  for (batch = draw_batches_.constBegin(); batch != draw_batches_.constEnd(); ++batch) {
+    if (distanceToBatch(eye, batch->origin) > draw_distance) {
+      continue;
+    }
+    const SceneMaterial& material = batch->material;
+    glBindTexture(GL_TEXTURE_2D, block_mgr_->getPrototype(material.type)->textureId(material.texture_slot));
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, material.min_filter);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPushMatrix();
+    glTranslatef(batch->origin.x(), batch->origin.y(), batch->origin.z());
+    glScalef(scale, scale, scale);
+    if (multi_draw_arrays_) {
+      multi_draw_arrays_(GL_QUADS, batch->firsts.constData(), batch->counts.constData(), batch->firsts.size());
+    } else {
+      for (int i = 0; i < batch->firsts.size(); ++i) {
+        glDrawArrays(GL_QUADS, batch->firsts.at(i), batch->counts.at(i));
+      }
+    }
+    glPopMatrix();
+  }
+  arena_.release();
+
+  glMatrixMode(GL_TEXTURE);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopAttrib();
+}
+
+bool SceneGeometry::save(const QString& path) const {
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_7);
+  stream << kFileMagic << kFileVersion << static_cast<quint32>(regions_.size());
+  QHash<BlockPosition, Region*>::const_iterator iter;
+  for (iter = regions_.constBegin(); iter != regions_.constEnd(); ++iter) {
+    stream << regionKey(iter.key());
+    iter.value()->mesh.save(&stream);
+  }
+  return stream.status() == QDataStream::Ok;
+}
+
+bool SceneGeometry::load(const QString& path) {
+  cached_meshes_.clear();
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_7);
+  quint32 magic;
+  quint32 version;
+  quint32 region_count;
+  stream >> magic >> version >> region_count;
+  if (stream.status() != QDataStream::Ok || magic != kFileMagic || version != kFileVersion) {
+    return false;
+  }
+  for (quint32 i = 0; i < region_count; ++i) {
+    quint64 key;
+    SceneMesh mesh;
+    stream >> key;
+    if (stream.status() != QDataStream::Ok || !mesh.load(&stream)) {
+      cached_meshes_.clear();
+      return false;
+    }
+    cached_meshes_.insert(key, mesh);
+  }
+  return true;
+}
@@ -0,0 +1,255 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCENE_GEOMETRY_H
+#define SCENE_GEOMETRY_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QtOpenGL>
+
+#include "block_position.h"
+#include "block_transaction.h"
+#include "buffer_arena.h"
+#include "position_hash.h"
+#include "scene_mesh.h"
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+class BlockInstance;
+class BlockManager;
+class Diagram;
+
+/**
+  * The geometry of the blocks of a Diagram, as drawn by the 3D preview, split into cubic regions.
+  *
+  * Each region keeps a SceneMesh of its blocks, so a change to the diagram only has to rebuild the regions it touches
+  * (see invalidate()).  The meshes of all the regions are uploaded into one BufferArena, and draw() draws every region
+  * whose mesh shares a material and an origin with a single multi-draw call.  When the arena runs out of room or
+  * becomes too fragmented, every mesh is uploaded again, packed together.
+  *
+  * Each region is also given a key, which is a hash of the blocks in the region and its six neighbours (which decide
+  * which faces are culled), of the placed prefabs, and of the block definitions.  save() writes every mesh to a
+  * sidecar file under its key, and after load(), the next full rebuild takes the mesh of any region whose key is
+  * unchanged from the file instead of building it.
+  */
+class SceneGeometry {
+ public:
+  /**
+    * The length of the side of a region, in blocks.
+    */
+  static const int kRegionSize = 16;
+
+  SceneGeometry();
+
+  /**
+    * Destroys the geometry.  The vertex buffer must already have been released with releaseBuffers().
+    */
+  ~SceneGeometry();
+
+  /**
+    * Sets the diagram to build geometry for, and invalidates everything.
+    */
+  void setDiagram(Diagram* diagram);
+
+  /**
+    * Sets the block manager through which the textures of the blocks are looked up.
+    */
+  void setBlockManager(BlockManager* block_mgr) {
+    block_mgr_ = block_mgr;
+  }
+
+  /**
+    * Marks the regions holding the blocks of \p transaction, and any region whose blocks touch them, as needing to be
+    * rebuilt.  If the transaction touches a large part of the diagram, everything is invalidated instead.
+    */
+  void invalidate(const BlockTransaction& transaction);
+
+  /**
+    * Like invalidate(), for a transaction that replaces the diagram's ephemeral blocks.  The regions of the ephemeral
+    * blocks shown before are invalidated too, since they are dropped without being reported.
+    */
+  void invalidateEphemeral(const BlockTransaction& transaction);
+
+  /**
+    * Marks every region as needing to be rebuilt.
+    */
+  void invalidateAll();
+
+  /**
+    * Returns \c true if any region needs to be rebuilt.
+    */
+  bool isDirty() const {
+    return all_dirty_ || !dirty_regions_.isEmpty();
+  }
+
+  /**
+    * Rebuilds every region that needs it and uploads its mesh.  The GL context must be current.
+    */
+  void update();
+
+  /**
+    * Draws every region within \p draw_distance blocks of \p eye: all the opaque geometry first, then all the
+    * transparent geometry.  Regions are culled a batch at a time, so some geometry a little further away is drawn too.
+    */
+  void draw(const QVector3D& eye, float draw_distance);
+
+  /**
+    * Deletes the vertex buffer and every region.  The GL context must be current.
+    */
+  void releaseBuffers();
+
+  /**
+    * Returns the number of regions that have any geometry.
+    */
+  int regionCount() const {
+    return regions_.size();
+  }
+
+  /**
+    * Returns the arena the meshes are uploaded into, for reporting how full and fragmented it is.
+    */
+  const BufferArena& arena() const {
+    return arena_;
+  }
+
+  /**
+    * Writes the mesh of every region, under its key, to the file at \p path.  Call update() first.
+    * @return \c false if the file could not be written.
+    */
+  bool save(const QString& path) const;
+
+  /**
+    * Reads meshes written by save() from the file at \p path, for the next full rebuild to use.  Meshes that the
+    * rebuild doesn't use are then discarded.
+    * @return \c false if the file could not be read or was not written by this version of the program.
+    */
+  bool load(const QString& path);
+
+ private:
+  /**
+    * The geometry of one region.  Its position is the position of its lowest corner divided by kRegionSize.
+    */
+  struct Region {
+    Region() : content_hash(0), first(-1), count(0) {}
+
+    quint64 content_hash;
+    SceneMesh mesh;
+
+    /** The range of the arena holding the mesh, batch after batch, or -1 if it has not been uploaded. */
+    int first;
+    int count;
+  };
+
+  /**
+    * The regions to draw with one multi-draw call: those whose meshes share an origin and have a batch of one
+    * material.
+    */
+  struct DrawBatch {
+    SceneMaterial material;
+    BlockPosition origin;
+    QVector<GLint> firsts;
+    QVector<GLsizei> counts;
+  };
+
+  typedef void (APIENTRY *MultiDrawArraysFunction)(GLenum mode, const GLint* first, const GLsizei* count,
+                                                   GLsizei primcount);
+
+  /**
+    * Returns the position of the region holding \p position.
+    */
+  static BlockPosition regionOf(const BlockPosition& position);
+
+  /**
+    * Returns a hash of the position, type and orientation of \p block.
+    */
+  static quint64 blockHash(const BlockInstance& block);
+
+  /**
+    * Marks the region holding \p position as needing to be rebuilt, along with the regions next to it if \p position
+    * is on their boundary.
+    */
+  void invalidatePosition(const BlockPosition& position);
+
+  /**
+    * Returns a hash of everything outside the diagram's own blocks that affects their geometry.
+    */
+  quint64 contextHash() const;
+
+  /**
+    * Returns the key under which the mesh of the region at \p region is saved.
+    */
+  quint64 regionKey(const BlockPosition& region) const;
+
+  /**
+    * Builds the geometry of every region from scratch.
+    */
+  void rebuildAll();
+
+  /**
+    * Builds the mesh of \p region from \p blocks, which must be every displayed block in it.
+    */
+  void buildMesh(const QList<BlockInstance>& blocks, Region* region) const;
+
+  /**
+    * Uploads the mesh of \p region into the arena, packing every region again if there is no room for it.
+    */
+  void upload(Region* region);
+
+  /**
+    * Frees the range of the arena held by \p region.
+    */
+  void freeRange(Region* region);
+
+  /**
+    * Throws away the contents of the arena and uploads every region into it again, one after the other.
+    */
+  void repack();
+
+  /**
+    * Works out draw_batches_ from the ranges of the regions.
+    */
+  void updateDrawBatches();
+
+  /**
+    * Removes the region at \p region and frees its range of the arena.
+    */
+  void removeRegion(const BlockPosition& region);
+
+  Diagram* diagram_;
+  BlockManager* block_mgr_;
+  QHash<BlockPosition, Region*> regions_;
+  PositionSet dirty_regions_;
+  bool all_dirty_;
+  quint64 context_hash_;
+
+  BufferArena arena_;
+  QVector<DrawBatch> draw_batches_;
+
+  /** glMultiDrawArrays(), or NULL if it is not available and the batches have to be drawn one range at a time. */
+  MultiDrawArraysFunction multi_draw_arrays_;
+  bool multi_draw_arrays_resolved_;
+
+  /** The transaction last passed to invalidateEphemeral(). */
+  BlockTransaction ephemeral_transaction_;
+
+  /** The meshes read by load(), keyed on region key. */
+  QHash<quint64, SceneMesh> cached_meshes_;
+};
+
+#endif // SCENE_GEOMETRY_H
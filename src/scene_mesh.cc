@@ -0,0 +1,146 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scene_mesh.h"
+
+#include <QDataStream>
+#include <qmath.h>
+
+namespace {
+
+/**
+  * Returns \p value multiplied by \p scale and rounded to a GLshort.
+  */
+GLshort quantize(GLfloat value, int scale) {
+  int quantized = qRound(value * scale);
+  Q_ASSERT_X(quantized >= -32768 && quantized <= 32767, __PRETTY_FUNCTION__, "Value out of range.");
+  return static_cast<GLshort>(quantized);
+}
+
+}  // namespace
+
+const int SceneMesh::kPositionScale;
+const int SceneMesh::kTexCoordScale;
+const int SceneMesh::kOriginGrid;
+
+bool SceneMaterial::operator<(const SceneMaterial& other) const {
+  if (transparent != other.transparent) {
+    return !transparent;
+  } else if (type != other.type) {
+    return type < other.type;
+  } else if (texture_slot != other.texture_slot) {
+    return texture_slot < other.texture_slot;
+  }
+  return min_filter < other.min_filter;
+}
+
+SceneMesh::SceneMesh() {
+}
+
+int SceneMesh::vertexCount() const {
+  int count = 0;
+  QMap<SceneMaterial, QVector<SceneVertex> >::const_iterator iter;
+  for (iter = batches_.constBegin(); iter != batches_.constEnd(); ++iter) {
+    count += iter.value().size();
+  }
+  return count;
+}
+
+void SceneMesh::appendQuad(const SceneMaterial& material, const SceneCorner* corners, const QVector3D& offset) {
+  if (batches_.isEmpty()) {
+    origin_ = BlockPosition(qFloor(offset.x() / kOriginGrid) * kOriginGrid,
+                            qFloor(offset.y() / kOriginGrid) * kOriginGrid,
+                            qFloor(offset.z() / kOriginGrid) * kOriginGrid);
+  }
+  QVector3D relative_offset = offset - origin_.cornerVector();
+  QVector<SceneVertex>& vertices = batches_[material];
+  for (int i = 0; i < 4; ++i) {
+    const SceneCorner& corner = corners[i];
+    SceneVertex vertex;
+    vertex.position[0] = quantize(corner.position[0] + relative_offset.x(), kPositionScale);
+    vertex.position[1] = quantize(corner.position[1] + relative_offset.y(), kPositionScale);
+    vertex.position[2] = quantize(corner.position[2] + relative_offset.z(), kPositionScale);
+    vertex.position_padding = 0;
+    vertex.tex_coord[0] = quantize(corner.tex_coord[0], kTexCoordScale);
+    vertex.tex_coord[1] = quantize(corner.tex_coord[1], kTexCoordScale);
+    for (int axis = 0; axis < 3; ++axis) {
+      vertex.normal[axis] = static_cast<GLbyte>(qRound(corner.normal[axis] * 127.0f));
+    }
+    vertex.normal_padding = 0;
+    vertices.append(vertex);
+  }
+}
+
+void SceneMesh::save(QDataStream* stream) const {
+  *stream << static_cast<qint32>(origin_.x()) << static_cast<qint32>(origin_.y()) << static_cast<qint32>(origin_.z());
+  *stream << static_cast<qint32>(batches_.size());
+  QMap<SceneMaterial, QVector<SceneVertex> >::const_iterator iter;
+  for (iter = batches_.constBegin(); iter != batches_.constEnd(); ++iter) {
+    const SceneMaterial& material = iter.key();
+    *stream << material.transparent << static_cast<qint32>(material.type)
+            << static_cast<qint32>(material.texture_slot) << static_cast<qint32>(material.min_filter);
+    *stream << static_cast<qint32>(iter.value().size());
+    // Vertices are plain integers, so they can be written as they are; the cache is only read back on this machine.
+    stream->writeRawData(reinterpret_cast<const char*>(iter.value().constData()),
+                         iter.value().size() * sizeof(SceneVertex));
+  }
+}
+
+bool SceneMesh::load(QDataStream* stream) {
+  batches_.clear();
+  qint32 x;
+  qint32 y;
+  qint32 z;
+  qint32 batch_count;
+  *stream >> x >> y >> z >> batch_count;
+  if (stream->status() != QDataStream::Ok || !BlockPosition::isInRange(x, y, z)) {
+    stream->setStatus(QDataStream::ReadCorruptData);
+    return false;
+  }
+  origin_ = BlockPosition(x, y, z);
+  for (int i = 0; i < batch_count && stream->status() == QDataStream::Ok; ++i) {
+    SceneMaterial material;
+    qint32 type;
+    qint32 texture_slot;
+    qint32 min_filter;
+    qint32 vertex_count;
+    *stream >> material.transparent >> type >> texture_slot >> min_filter >> vertex_count;
+    if (stream->status() != QDataStream::Ok) {
+      break;
+    }
+    // Check the count against what is left of the file before allocating for it, so that a corrupt count can't ask for
+    // gigabytes, or overflow the byte count below.
+    if (vertex_count < 0 || !stream->device() ||
+        vertex_count > stream->device()->bytesAvailable() / static_cast<qint64>(sizeof(SceneVertex))) {
+      stream->setStatus(QDataStream::ReadCorruptData);
+      break;
+    }
+    material.type = type;
+    material.texture_slot = texture_slot;
+    material.min_filter = min_filter;
+    QVector<SceneVertex> vertices(vertex_count);
+    int bytes = vertex_count * sizeof(SceneVertex);
+    if (stream->readRawData(reinterpret_cast<char*>(vertices.data()), bytes) != bytes) {
+      stream->setStatus(QDataStream::ReadPastEnd);
+      break;
+    }
+    batches_.insert(material, vertices);
+  }
+  if (stream->status() != QDataStream::Ok) {
+    batches_.clear();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,153 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCENE_MESH_H
+#define SCENE_MESH_H
+
+#include <QMap>
+#include <QVector>
+#include <QVector3D>
+#include <QtOpenGL>
+
+#include "block_position.h"
+#include "block_type.h"
+
+class QDataStream;
+
+/**
+  * One corner of a quad of scene geometry, relative to the center of its block, before it is packed into a
+  * SceneVertex.
+  */
+struct SceneCorner {
+  GLfloat position[3];
+  GLfloat normal[3];
+  GLfloat tex_coord[2];
+};
+
+/**
+  * One corner of a quad of baked scene geometry, packed into 16 bytes.
+  *
+  * Positions are in units of 1/SceneMesh::kPositionScale of a block from the origin of the mesh, and texture
+  * coordinates in units of 1/SceneMesh::kTexCoordScale.  Block geometry is small and mostly on a 1/16 block grid, so
+  * this loses nothing visible.  GL turns the integers back into blocks itself: SceneGeometry::draw() scales the
+  * modelview and texture matrices, and byte normals are mapped onto -1 to 1.
+  *
+  * The padding keeps the vertex, and each of its attributes, on a 4-byte boundary, since many drivers fall back to a
+  * slow path for vertex data that isn't.  It is always zero, so that saved meshes are the same from run to run.
+  */
+struct SceneVertex {
+  GLshort position[3];
+  GLshort position_padding;
+  GLshort tex_coord[2];
+  GLbyte normal[3];
+  GLbyte normal_padding;
+};
+
+/**
+  * Identifies what a batch of scene geometry is drawn with: one of the textures of a block type, and how to filter it.
+  * The texture is named by its slot rather than its GL texture id, so that baked geometry stays valid across runs.
+  */
+struct SceneMaterial {
+  SceneMaterial() : transparent(false), type(kBlockTypeUnknown), texture_slot(-1), min_filter(GL_LINEAR) {}
+
+  /**
+    * Orders transparent materials after opaque ones, so that transparent geometry can be drawn last.
+    */
+  bool operator<(const SceneMaterial& other) const;
+
+  bool transparent;
+  blocktype_t type;
+  int texture_slot;
+  GLint min_filter;
+};
+
+/**
+  * Scene geometry baked into plain vertex arrays, grouped by material.
+  *
+  * Rather than issuing GL calls, a Renderable can append the quads it would draw for a block to a SceneMesh (see
+  * Renderable::appendGeometry()).  The mesh can then be uploaded to a vertex buffer, or saved and loaded again without
+  * asking the renderables about each block.
+  */
+class SceneMesh {
+ public:
+  /**
+    * The number of steps SceneVertex positions are divided into per block.  A mesh can reach 127 blocks from its
+    * origin.
+    */
+  static const int kPositionScale = 256;
+
+  /**
+    * The number of steps SceneVertex texture coordinates are divided into per texture.
+    */
+  static const int kTexCoordScale = 4096;
+
+  /**
+    * The origins of meshes are multiples of this many blocks, so that the meshes of nearby regions share an origin
+    * and can be drawn together.
+    */
+  static const int kOriginGrid = 64;
+
+  SceneMesh();
+
+  /**
+    * Returns \c true if the mesh has no geometry.
+    */
+  bool isEmpty() const {
+    return batches_.isEmpty();
+  }
+
+  /**
+    * Returns the number of vertices in the mesh.
+    */
+  int vertexCount() const;
+
+  /**
+    * Appends a quad drawn with \p material, whose corners are \p corners moved by \p offset.  The first quad appended
+    * to an empty mesh decides its origin, the nearest multiple of kOriginGrid below it, so every quad must lie within
+    * about 60 blocks of the first.
+    */
+  void appendQuad(const SceneMaterial& material, const SceneCorner* corners, const QVector3D& offset);
+
+  /**
+    * Returns the point the positions of the vertices are relative to.
+    */
+  const BlockPosition& origin() const {
+    return origin_;
+  }
+
+  /**
+    * Returns the vertices of the mesh, four per quad, grouped by material.  Materials are in ascending order, so
+    * transparent geometry comes last.
+    */
+  const QMap<SceneMaterial, QVector<SceneVertex> >& batches() const {
+    return batches_;
+  }
+
+  /**
+    * Writes the mesh to \p stream.
+    */
+  void save(QDataStream* stream) const;
+
+  /**
+    * Reads a mesh written by save() from \p stream.  Returns \c false if the stream ended early.
+    */
+  bool load(QDataStream* stream);
+
+ private:
+  BlockPosition origin_;
+  QMap<SceneMaterial, QVector<SceneVertex> > batches_;
+};
+
+#endif // SCENE_MESH_H
@@ -0,0 +1,255 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shape.h"
+
+#include <QVarLengthArray>
+
+#include <qmath.h>
+
+namespace {
+
+inline QVector3D componentMin(const QVector3D& a, const QVector3D& b) {
+  return QVector3D(qMin(a.x(), b.x()), qMin(a.y(), b.y()), qMin(a.z(), b.z()));
+}
+
+inline QVector3D componentMax(const QVector3D& a, const QVector3D& b) {
+  return QVector3D(qMax(a.x(), b.x()), qMax(a.y(), b.y()), qMax(a.z(), b.z()));
+}
+
+}  // namespace
+
+void Shape::distanceRow(float x, float y, float z, int count, float* distances) const {
+  for (int i = 0; i < count; ++i) {
+    distances[i] = distance(QVector3D(x + i, y, z));
+  }
+}
+
+BoxShape::BoxShape(const QVector3D& center, const QVector3D& half_extents)
+    : center_(center), half_extents_(half_extents) {}
+
+float BoxShape::distance(const QVector3D& point) const {
+  float qx = qAbs(point.x() - center_.x()) - half_extents_.x();
+  float qy = qAbs(point.y() - center_.y()) - half_extents_.y();
+  float qz = qAbs(point.z() - center_.z()) - half_extents_.z();
+  float outside = qSqrt(qMax(qx, 0.0f) * qMax(qx, 0.0f) +
+                        qMax(qy, 0.0f) * qMax(qy, 0.0f) +
+                        qMax(qz, 0.0f) * qMax(qz, 0.0f));
+  float inside = qMin(qMax(qx, qMax(qy, qz)), 0.0f);
+  return outside + inside;
+}
+
+void BoxShape::distanceRow(float x, float y, float z, int count, float* distances) const {
+  // y and z are constant along the row, so only the x term varies.
+  float qy = qAbs(y - static_cast<float>(center_.y())) - static_cast<float>(half_extents_.y());
+  float qz = qAbs(z - static_cast<float>(center_.z())) - static_cast<float>(half_extents_.z());
+  float yz_outside_sq = qMax(qy, 0.0f) * qMax(qy, 0.0f) + qMax(qz, 0.0f) * qMax(qz, 0.0f);
+  float yz_max = qMax(qy, qz);
+  float cx = static_cast<float>(center_.x());
+  float hx = static_cast<float>(half_extents_.x());
+  for (int i = 0; i < count; ++i) {
+    float qx = qAbs(x + i - cx) - hx;
+    float ox = qMax(qx, 0.0f);
+    distances[i] = qSqrt(ox * ox + yz_outside_sq) + qMin(qMax(qx, yz_max), 0.0f);
+  }
+}
+
+void BoxShape::bounds(QVector3D* min, QVector3D* max) const {
+  *min = center_ - half_extents_;
+  *max = center_ + half_extents_;
+}
+
+SphereShape::SphereShape(const QVector3D& center, float radius) : center_(center), radius_(radius) {}
+
+float SphereShape::distance(const QVector3D& point) const {
+  return (point - center_).length() - radius_;
+}
+
+void SphereShape::distanceRow(float x, float y, float z, int count, float* distances) const {
+  float dy = y - static_cast<float>(center_.y());
+  float dz = z - static_cast<float>(center_.z());
+  float yz_sq = dy * dy + dz * dz;
+  float cx = static_cast<float>(center_.x());
+  for (int i = 0; i < count; ++i) {
+    float dx = x + i - cx;
+    distances[i] = qSqrt(dx * dx + yz_sq) - radius_;
+  }
+}
+
+void SphereShape::bounds(QVector3D* min, QVector3D* max) const {
+  QVector3D extent(radius_, radius_, radius_);
+  *min = center_ - extent;
+  *max = center_ + extent;
+}
+
+EllipsoidShape::EllipsoidShape(const QVector3D& center, const QVector3D& radii)
+    : center_(center), radii_(radii), min_radius_(qMin(radii.x(), qMin(radii.y(), radii.z()))) {}
+
+float EllipsoidShape::distance(const QVector3D& point) const {
+  // Scaling space to turn the ellipsoid into a unit sphere stretches distances by at most 1 / min_radius_, so scaling
+  // the result back by min_radius_ gives a bound that is exact on the surface and never overestimates elsewhere.
+  QVector3D p = point - center_;
+  QVector3D scaled(p.x() / radii_.x(), p.y() / radii_.y(), p.z() / radii_.z());
+  return (scaled.length() - 1.0f) * min_radius_;
+}
+
+void EllipsoidShape::bounds(QVector3D* min, QVector3D* max) const {
+  *min = center_ - radii_;
+  *max = center_ + radii_;
+}
+
+CylinderShape::CylinderShape(const QVector3D& base_center, float radius, float height)
+    : base_center_(base_center), radius_(radius), height_(height) {}
+
+float CylinderShape::distance(const QVector3D& point) const {
+  QVector3D p = point - base_center_;
+  float half_height = height_ / 2.0f;
+  float dr = qSqrt(p.x() * p.x() + p.z() * p.z()) - radius_;
+  float dy = qAbs(p.y() - half_height) - half_height;
+  float outside = qSqrt(qMax(dr, 0.0f) * qMax(dr, 0.0f) + qMax(dy, 0.0f) * qMax(dy, 0.0f));
+  return outside + qMin(qMax(dr, dy), 0.0f);
+}
+
+void CylinderShape::bounds(QVector3D* min, QVector3D* max) const {
+  *min = base_center_ - QVector3D(radius_, 0, radius_);
+  *max = base_center_ + QVector3D(radius_, height_, radius_);
+}
+
+ConeShape::ConeShape(const QVector3D& base_center, float radius, float height)
+    : base_center_(base_center), radius_(radius), height_(height), slant_(qSqrt(radius * radius + height * height)) {}
+
+float ConeShape::distance(const QVector3D& point) const {
+  QVector3D p = point - base_center_;
+  float q = qSqrt(p.x() * p.x() + p.z() * p.z());
+  // Signed distance to the infinite sloped side, intersected with the half-space above the base.  Both terms are
+  // exact distances to a plane, so their maximum is a valid bound.
+  float side = (height_ * q + radius_ * p.y() - radius_ * height_) / slant_;
+  return qMax(side, static_cast<float>(-p.y()));
+}
+
+void ConeShape::bounds(QVector3D* min, QVector3D* max) const {
+  *min = base_center_ - QVector3D(radius_, 0, radius_);
+  *max = base_center_ + QVector3D(radius_, height_, radius_);
+}
+
+TorusShape::TorusShape(const QVector3D& center, float major_radius, float minor_radius)
+    : center_(center), major_radius_(major_radius), minor_radius_(minor_radius) {}
+
+float TorusShape::distance(const QVector3D& point) const {
+  QVector3D p = point - center_;
+  float ring = qSqrt(p.x() * p.x() + p.z() * p.z()) - major_radius_;
+  return qSqrt(ring * ring + p.y() * p.y()) - minor_radius_;
+}
+
+void TorusShape::bounds(QVector3D* min, QVector3D* max) const {
+  float extent = major_radius_ + minor_radius_;
+  *min = center_ - QVector3D(extent, minor_radius_, extent);
+  *max = center_ + QVector3D(extent, minor_radius_, extent);
+}
+
+CapsuleShape::CapsuleShape(const QVector3D& start, const QVector3D& end, float radius)
+    : start_(start), end_(end), radius_(radius) {}
+
+float CapsuleShape::distance(const QVector3D& point) const {
+  QVector3D segment = end_ - start_;
+  QVector3D offset = point - start_;
+  float length_sq = QVector3D::dotProduct(segment, segment);
+  float t = length_sq > 0 ? qBound(0.0f, static_cast<float>(QVector3D::dotProduct(offset, segment)) / length_sq, 1.0f)
+                          : 0.0f;
+  return (offset - segment * t).length() - radius_;
+}
+
+void CapsuleShape::bounds(QVector3D* min, QVector3D* max) const {
+  QVector3D extent(radius_, radius_, radius_);
+  *min = componentMin(start_, end_) - extent;
+  *max = componentMax(start_, end_) + extent;
+}
+
+ShellShape::ShellShape(Shape* shape, float thickness) : shape_(shape), thickness_(thickness) {}
+
+ShellShape::~ShellShape() {
+  delete shape_;
+}
+
+float ShellShape::distance(const QVector3D& point) const {
+  return qAbs(shape_->distance(point)) - thickness_;
+}
+
+void ShellShape::distanceRow(float x, float y, float z, int count, float* distances) const {
+  shape_->distanceRow(x, y, z, count, distances);
+  for (int i = 0; i < count; ++i) {
+    distances[i] = qAbs(distances[i]) - thickness_;
+  }
+}
+
+void ShellShape::bounds(QVector3D* min, QVector3D* max) const {
+  shape_->bounds(min, max);
+  QVector3D extent(thickness_, thickness_, thickness_);
+  *min -= extent;
+  *max += extent;
+}
+
+UnionShape::UnionShape(Shape* first, Shape* second) : first_(first), second_(second) {}
+
+UnionShape::~UnionShape() {
+  delete first_;
+  delete second_;
+}
+
+float UnionShape::distance(const QVector3D& point) const {
+  return qMin(first_->distance(point), second_->distance(point));
+}
+
+void UnionShape::distanceRow(float x, float y, float z, int count, float* distances) const {
+  QVarLengthArray<float, 32> other(count);
+  first_->distanceRow(x, y, z, count, distances);
+  second_->distanceRow(x, y, z, count, other.data());
+  for (int i = 0; i < count; ++i) {
+    distances[i] = qMin(distances[i], other[i]);
+  }
+}
+
+void UnionShape::bounds(QVector3D* min, QVector3D* max) const {
+  QVector3D first_min, first_max, second_min, second_max;
+  first_->bounds(&first_min, &first_max);
+  second_->bounds(&second_min, &second_max);
+  *min = componentMin(first_min, second_min);
+  *max = componentMax(first_max, second_max);
+}
+
+SubtractionShape::SubtractionShape(Shape* shape, Shape* cutter) : shape_(shape), cutter_(cutter) {}
+
+SubtractionShape::~SubtractionShape() {
+  delete shape_;
+  delete cutter_;
+}
+
+float SubtractionShape::distance(const QVector3D& point) const {
+  return qMax(shape_->distance(point), -cutter_->distance(point));
+}
+
+void SubtractionShape::distanceRow(float x, float y, float z, int count, float* distances) const {
+  QVarLengthArray<float, 32> cut(count);
+  shape_->distanceRow(x, y, z, count, distances);
+  cutter_->distanceRow(x, y, z, count, cut.data());
+  for (int i = 0; i < count; ++i) {
+    distances[i] = qMax(distances[i], -cut[i]);
+  }
+}
+
+void SubtractionShape::bounds(QVector3D* min, QVector3D* max) const {
+  // Cutting can only make the shape smaller.
+  shape_->bounds(min, max);
+}
@@ -0,0 +1,194 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <QVector3D>
+
+/**
+  * An implicit solid described by a signed distance function.
+  *
+  * distance() returns a negative value for points inside the shape, a positive value for points outside it, and zero
+  * on the surface.  Every Shape must be a distance \e bound: the magnitude of the returned value may underestimate the
+  * true distance to the surface, but must never overestimate it.  ShapeRasterizer relies on this to reject whole
+  * chunks of space after evaluating a single point, so a shape that breaks this rule will lose blocks.
+  *
+  * Shapes are expressed in block coordinates, where the block at BlockPosition(x, y, z) covers the unit cube whose
+  * center is (x + 0.5, y + 0.5, z + 0.5).
+  */
+class Shape {
+ public:
+  virtual ~Shape() {}
+
+  /**
+    * Returns the signed distance bound from \p point to the surface of the shape.
+    */
+  virtual float distance(const QVector3D& point) const = 0;
+
+  /**
+    * Evaluates the shape at the \p count points (x + i, y, z) for i in [0, count) and writes the results to
+    * \p distances.  The default implementation calls distance() once per point; shapes that are evaluated often
+    * override it with a loop the compiler can vectorize.
+    */
+  virtual void distanceRow(float x, float y, float z, int count, float* distances) const;
+
+  /**
+    * Returns an axis-aligned box that contains every point for which distance() is negative.
+    */
+  virtual void bounds(QVector3D* min, QVector3D* max) const = 0;
+};
+
+/** An axis-aligned box given by its center and half-extents. */
+class BoxShape : public Shape {
+ public:
+  BoxShape(const QVector3D& center, const QVector3D& half_extents);
+  virtual float distance(const QVector3D& point) const;
+  virtual void distanceRow(float x, float y, float z, int count, float* distances) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  QVector3D center_;
+  QVector3D half_extents_;
+};
+
+/** A sphere given by its center and radius. */
+class SphereShape : public Shape {
+ public:
+  SphereShape(const QVector3D& center, float radius);
+  virtual float distance(const QVector3D& point) const;
+  virtual void distanceRow(float x, float y, float z, int count, float* distances) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  QVector3D center_;
+  float radius_;
+};
+
+/** An axis-aligned ellipsoid given by its center and the radius along each axis. */
+class EllipsoidShape : public Shape {
+ public:
+  EllipsoidShape(const QVector3D& center, const QVector3D& radii);
+  virtual float distance(const QVector3D& point) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  QVector3D center_;
+  QVector3D radii_;
+  float min_radius_;
+};
+
+/** A capped cylinder standing upright (along the y axis) on the circle at \p base_center. */
+class CylinderShape : public Shape {
+ public:
+  CylinderShape(const QVector3D& base_center, float radius, float height);
+  virtual float distance(const QVector3D& point) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  QVector3D base_center_;
+  float radius_;
+  float height_;
+};
+
+/** An upright cone whose base is the circle at \p base_center and whose apex is \p height blocks above it. */
+class ConeShape : public Shape {
+ public:
+  ConeShape(const QVector3D& base_center, float radius, float height);
+  virtual float distance(const QVector3D& point) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  QVector3D base_center_;
+  float radius_;
+  float height_;
+  float slant_;
+};
+
+/** A torus lying flat (in the x-z plane) around \p center. */
+class TorusShape : public Shape {
+ public:
+  TorusShape(const QVector3D& center, float major_radius, float minor_radius);
+  virtual float distance(const QVector3D& point) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  QVector3D center_;
+  float major_radius_;
+  float minor_radius_;
+};
+
+/** All points within \p radius of the segment from \p start to \p end. */
+class CapsuleShape : public Shape {
+ public:
+  CapsuleShape(const QVector3D& start, const QVector3D& end, float radius);
+  virtual float distance(const QVector3D& point) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  QVector3D start_;
+  QVector3D end_;
+  float radius_;
+};
+
+/**
+  * The hollow shell of another shape: every point within \p thickness of its surface.  A thickness of 0.5 gives a
+  * shell one block thick.  Takes ownership of \p shape.
+  */
+class ShellShape : public Shape {
+ public:
+  ShellShape(Shape* shape, float thickness);
+  virtual ~ShellShape();
+  virtual float distance(const QVector3D& point) const;
+  virtual void distanceRow(float x, float y, float z, int count, float* distances) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  Q_DISABLE_COPY(ShellShape)
+  Shape* shape_;
+  float thickness_;
+};
+
+/** The union of two shapes.  Takes ownership of both. */
+class UnionShape : public Shape {
+ public:
+  UnionShape(Shape* first, Shape* second);
+  virtual ~UnionShape();
+  virtual float distance(const QVector3D& point) const;
+  virtual void distanceRow(float x, float y, float z, int count, float* distances) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  Q_DISABLE_COPY(UnionShape)
+  Shape* first_;
+  Shape* second_;
+};
+
+/** The part of \p shape that is not inside \p cutter.  Takes ownership of both. */
+class SubtractionShape : public Shape {
+ public:
+  SubtractionShape(Shape* shape, Shape* cutter);
+  virtual ~SubtractionShape();
+  virtual float distance(const QVector3D& point) const;
+  virtual void distanceRow(float x, float y, float z, int count, float* distances) const;
+  virtual void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  Q_DISABLE_COPY(SubtractionShape)
+  Shape* shape_;
+  Shape* cutter_;
+};
+
+#endif // SHAPE_H
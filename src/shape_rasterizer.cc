@@ -0,0 +1,139 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shape_rasterizer.h"
+
+#include <QVector3D>
+
+#include <qmath.h>
+
+#include "block_instance.h"
+#include "block_oracle.h"
+#include "block_prototype.h"
+#include "block_transaction.h"
+#include "shape.h"
+
+namespace {
+
+/**
+  * Returns the first block coordinate whose center is at or above \p value.
+  */
+inline int firstCellAbove(qreal value) {
+  return qCeil(value - 0.5);
+}
+
+/**
+  * Returns the last block coordinate whose center is at or below \p value.
+  */
+inline int lastCellBelow(qreal value) {
+  return qFloor(value - 0.5);
+}
+
+}  // namespace
+
+FillRunVisitor::FillRunVisitor(BlockOracle* oracle, BlockPrototype* prototype, const BlockOrientation* orientation,
+                               BlockTransaction* transaction)
+    : oracle_(oracle), prototype_(prototype), orientation_(orientation), transaction_(transaction) {}
+
+void FillRunVisitor::visitRun(int x_begin, int x_end, int y, int z) {
+  for (int x = x_begin; x < x_end; ++x) {
+    BlockPosition pos(x, y, z);
+    transaction_->replaceBlock(oracle_->blockAt(pos), BlockInstance(prototype_, pos, orientation_));
+  }
+}
+
+CarveRunVisitor::CarveRunVisitor(BlockOracle* oracle, BlockTransaction* transaction)
+    : oracle_(oracle), transaction_(transaction) {}
+
+void CarveRunVisitor::visitRun(int x_begin, int x_end, int y, int z) {
+  for (int x = x_begin; x < x_end; ++x) {
+    transaction_->clearBlock(oracle_->blockAt(BlockPosition(x, y, z)));
+  }
+}
+
+ShapeRasterizer::ShapeRasterizer(BlockOracle* oracle) : oracle_(oracle) {}
+
+void ShapeRasterizer::rasterize(const Shape& shape, RunVisitor* visitor) const {
+  QVector3D min, max;
+  shape.bounds(&min, &max);
+  int min_x = firstCellAbove(min.x());
+  int min_y = firstCellAbove(min.y());
+  int min_z = firstCellAbove(min.z());
+  int max_x = lastCellBelow(max.x());
+  int max_y = lastCellBelow(max.y());
+  int max_z = lastCellBelow(max.z());
+
+  float distances[kChunkSize];
+  for (int chunk_z = min_z; chunk_z <= max_z; chunk_z += kChunkSize) {
+    int end_z = qMin(chunk_z + kChunkSize - 1, max_z);
+    for (int chunk_y = min_y; chunk_y <= max_y; chunk_y += kChunkSize) {
+      int end_y = qMin(chunk_y + kChunkSize - 1, max_y);
+      for (int chunk_x = min_x; chunk_x <= max_x; chunk_x += kChunkSize) {
+        int end_x = qMin(chunk_x + kChunkSize - 1, max_x);
+
+        // Every block center in the chunk is within half_diagonal of the chunk's center, so if the distance bound at
+        // the center is larger than that, the whole chunk is on one side of the surface.
+        QVector3D extent(end_x - chunk_x, end_y - chunk_y, end_z - chunk_z);
+        QVector3D center(chunk_x + 0.5 + extent.x() / 2.0, chunk_y + 0.5 + extent.y() / 2.0,
+                         chunk_z + 0.5 + extent.z() / 2.0);
+        float half_diagonal = extent.length() / 2.0f;
+        float center_distance = shape.distance(center);
+        if (center_distance >= half_diagonal) {
+          continue;
+        }
+        if (center_distance < -half_diagonal) {
+          for (int z = chunk_z; z <= end_z; ++z) {
+            for (int y = chunk_y; y <= end_y; ++y) {
+              visitor->visitRun(chunk_x, end_x + 1, y, z);
+            }
+          }
+          continue;
+        }
+
+        int row_length = end_x - chunk_x + 1;
+        for (int z = chunk_z; z <= end_z; ++z) {
+          for (int y = chunk_y; y <= end_y; ++y) {
+            shape.distanceRow(chunk_x + 0.5f, y + 0.5f, z + 0.5f, row_length, distances);
+            int run_start = -1;
+            for (int i = 0; i < row_length; ++i) {
+              if (distances[i] < 0) {
+                if (run_start < 0) {
+                  run_start = i;
+                }
+              } else if (run_start >= 0) {
+                visitor->visitRun(chunk_x + run_start, chunk_x + i, y, z);
+                run_start = -1;
+              }
+            }
+            if (run_start >= 0) {
+              visitor->visitRun(chunk_x + run_start, chunk_x + row_length, y, z);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void ShapeRasterizer::fill(const Shape& shape, BlockPrototype* prototype, const BlockOrientation* orientation,
+                           BlockTransaction* transaction) const {
+  FillRunVisitor visitor(oracle_, prototype, orientation, transaction);
+  rasterize(shape, &visitor);
+}
+
+void ShapeRasterizer::carve(const Shape& shape, BlockTransaction* transaction) const {
+  CarveRunVisitor visitor(oracle_, transaction);
+  rasterize(shape, &visitor);
+}
@@ -0,0 +1,108 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHAPE_RASTERIZER_H
+#define SHAPE_RASTERIZER_H
+
+class BlockOracle;
+class BlockOrientation;
+class BlockPrototype;
+class BlockTransaction;
+class Shape;
+
+/**
+  * Turns a Shape into blocks.
+  *
+  * The shape's bounding box is walked one chunk (a cube of kChunkSize blocks on a side) at a time.  Because every Shape
+  * is a distance bound, a single evaluation at the center of a chunk is enough to tell whether the chunk lies entirely
+  * outside the shape, in which case it is skipped, or entirely inside it, in which case it is filled without evaluating
+  * any other points.  Only chunks that straddle the surface are evaluated block by block, a row at a time using
+  * Shape::distanceRow(), and the resulting spans of filled blocks are handed to a RunVisitor.
+  */
+class ShapeRasterizer {
+ public:
+  /** The edge length, in blocks, of the chunks the rasterizer works in. */
+  static const int kChunkSize = 16;
+
+  /**
+    * Receives the spans of blocks that lie inside the shape being rasterized.
+    */
+  class RunVisitor {
+   public:
+    virtual ~RunVisitor() {}
+
+    /**
+      * Called for each run of blocks from (\p x_begin, \p y, \p z) up to but not including (\p x_end, \p y, \p z)
+      * that lie inside the shape.  Runs never overlap, but are not reported in any particular order.
+      */
+    virtual void visitRun(int x_begin, int x_end, int y, int z) = 0;
+  };
+
+  /**
+    * Creates a ShapeRasterizer that looks up existing blocks in \p oracle, so that the transactions it produces can be
+    * undone.
+    */
+  explicit ShapeRasterizer(BlockOracle* oracle);
+
+  /**
+    * Reports every block inside \p shape to \p visitor.
+    */
+  void rasterize(const Shape& shape, RunVisitor* visitor) const;
+
+  /**
+    * Records in \p transaction the replacement of every block inside \p shape with a block of type \p prototype.
+    */
+  void fill(const Shape& shape, BlockPrototype* prototype, const BlockOrientation* orientation,
+            BlockTransaction* transaction) const;
+
+  /**
+    * Records in \p transaction the removal of every block inside \p shape.
+    */
+  void carve(const Shape& shape, BlockTransaction* transaction) const;
+
+ private:
+  BlockOracle* oracle_;
+};
+
+/**
+  * A RunVisitor that records in a transaction the replacement of every block in each run with a block of one type.
+  */
+class FillRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  FillRunVisitor(BlockOracle* oracle, BlockPrototype* prototype, const BlockOrientation* orientation,
+                 BlockTransaction* transaction);
+  virtual void visitRun(int x_begin, int x_end, int y, int z);
+
+ private:
+  BlockOracle* oracle_;
+  BlockPrototype* prototype_;
+  const BlockOrientation* orientation_;
+  BlockTransaction* transaction_;
+};
+
+/**
+  * A RunVisitor that records in a transaction the removal of every block in each run.
+  */
+class CarveRunVisitor : public ShapeRasterizer::RunVisitor {
+ public:
+  CarveRunVisitor(BlockOracle* oracle, BlockTransaction* transaction);
+  virtual void visitRun(int x_begin, int x_end, int y, int z);
+
+ private:
+  BlockOracle* oracle_;
+  BlockTransaction* transaction_;
+};
+
+#endif // SHAPE_RASTERIZER_H
@@ -11,8 +11,6 @@
  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
  * See the License for the specific language governing permissions and
  * limitations under the License.
- *
- * Portions Copyright Alois Zingl, Vienna, Austria
  */
 
 #include "sphere_tool.h"
@@ -21,6 +19,8 @@
 #include "block_oracle.h"
 #include "block_prototype.h"
 #include "block_transaction.h"
+#include "shape.h"
+#include "shape_rasterizer.h"
 
 SphereTool::SphereTool(BlockOracle* oracle) : oracle_(oracle) {}
 
@@ -36,12 +36,6 @@ bool SphereTool::isBrush() const {
   return false;
 }
 
-void SphereTool::setPixel(int x, int y, int z, BlockPrototype* prototype, const BlockOrientation* orientation, BlockTransaction* transaction) {
-  BlockPosition pos(x, y, z);
-  BlockInstance new_block(prototype, pos, orientation);
-  transaction->replaceBlock(oracle_->blockAt(pos), new_block);
-}
-
 void SphereTool::draw(BlockPrototype* prototype, const BlockOrientation* orientation, BlockTransaction* transaction) {
   if (wantsMorePositions()) {
     return;
@@ -56,15 +50,6 @@ void SphereTool::draw(BlockPrototype* prototype, const BlockOrientation* orienta
   double x_increment = (end.x() < start.x() ? -1 : 1);
   double z_increment = (end.z() < start.z() ? -1 : 1);
   QVector3D center = start.centerVector() + QVector3D(radius * x_increment, radius, radius * z_increment);
-  for (int z = 0; z <= size; ++z) {
-    for (int y = 0; y <= size; ++y) {
-      for (int x = 0; x <= size; ++x) {
-        BlockPosition pos(start.x() + x * x_increment, start.y() + y, start.z() + z * z_increment);
-        QVector3D distance = pos.centerVector() - center;
-        if (qAbs(radius - distance.length()) < 0.5) {
-          transaction->replaceBlock(oracle_->blockAt(pos), BlockInstance(prototype, pos, orientation));
-        }
-      }
-    }
-  }
+  ShellShape shell(new SphereShape(center, radius), 0.5);
+  ShapeRasterizer(oracle_).fill(shell, prototype, orientation, transaction);
 }
@@ -33,7 +33,6 @@ class SphereTool : public Tool {
   virtual void draw(BlockPrototype* prototype, const BlockOrientation* orientation, BlockTransaction* transaction);
 
  private:
-  void setPixel(int x, int y, int z, BlockPrototype *prototype, const BlockOrientation *orientation, BlockTransaction *transaction);
   BlockOracle* oracle_;
 };
 
@@ -162,25 +162,27 @@ StairsRenderable::TextureCoords StairsRenderable::createTextureCoordsForBlock(QV
   return TextureCoords() << front_tex << back_tex << bottom_tex << right_tex << top_tex << left_tex;
 }
 
-void StairsRenderable::applyOrientationTransform(const BlockOrientation* orientation) const {
+QMatrix4x4 StairsRenderable::orientationTransform(const BlockOrientation* orientation) const {
+  QMatrix4x4 transform;
   if (orientation == BlockOrientation::get("Facing north")) {
-    glRotatef(180.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Facing east")) {
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(90.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Facing west")) {
-    glRotatef(-90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(-90.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Facing north, inverted")) {
-    glRotatef(180.0f, 0.0f, 1.0f, 0.0f);
-    glRotatef(180.0f, 0.0f, 0.0f, 1.0f);
+    transform.rotate(180.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 0.0f, 1.0f);
   } else if (orientation == BlockOrientation::get("Facing east, inverted")) {
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
-    glRotatef(180.0f, 0.0f, 0.0f, 1.0f);
+    transform.rotate(90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 0.0f, 1.0f);
   } else if (orientation == BlockOrientation::get("Facing west, inverted")) {
-    glRotatef(-90.0f, 0.0f, 1.0f, 0.0f);
-    glRotatef(180.0f, 0.0f, 0.0f, 1.0f);
+    transform.rotate(-90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 0.0f, 1.0f);
   } else if (orientation == BlockOrientation::get("Facing south, inverted")) {
-    glRotatef(180.0f, 0.0f, 0.0f, 1.0f);
+    transform.rotate(180.0f, 0.0f, 0.0f, 1.0f);
   }
+  return transform;
 }
 
 Texture StairsRenderable::textureForQuad(int index, const BlockOrientation* orientation) const {
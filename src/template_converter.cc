@@ -0,0 +1,184 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "template_converter.h"
+
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include "block_instance.h"
+#include "block_oracle.h"
+#include "block_position.h"
+#include "block_prototype.h"
+#include "block_transaction.h"
+
+namespace {
+
+/** Cells whose average alpha is below this are treated as empty. */
+const int kMinimumAlpha = 128;
+
+/**
+  * Averages one row of cells.  Used as a QtConcurrent map functor.  The alpha channel of each result is the average
+  * alpha of the cell, and the colour channels are averaged with each pixel weighted by its alpha.
+  */
+class CellRowAverager {
+ public:
+  typedef QVector<QRgb> result_type;
+
+  CellRowAverager(const QImage* image, const QPoint& grid_origin, int cell_size, int columns)
+      : image_(image), grid_origin_(grid_origin), cell_size_(cell_size), columns_(columns) {}
+
+  QVector<QRgb> operator()(int row) const {
+    QVector<QRgb> cells(columns_);
+    int y_begin = qMax(grid_origin_.y() + row * cell_size_, 0);
+    int y_end = qMin(grid_origin_.y() + (row + 1) * cell_size_, image_->height());
+    for (int column = 0; column < columns_; ++column) {
+      int x_begin = qMax(grid_origin_.x() + column * cell_size_, 0);
+      int x_end = qMin(grid_origin_.x() + (column + 1) * cell_size_, image_->width());
+      quint64 red = 0;
+      quint64 green = 0;
+      quint64 blue = 0;
+      quint64 alpha = 0;
+      for (int y = y_begin; y < y_end; ++y) {
+        const QRgb* pixels = reinterpret_cast<const QRgb*>(image_->scanLine(y));
+        for (int x = x_begin; x < x_end; ++x) {
+          int pixel_alpha = qAlpha(pixels[x]);
+          red += qRed(pixels[x]) * pixel_alpha;
+          green += qGreen(pixels[x]) * pixel_alpha;
+          blue += qBlue(pixels[x]) * pixel_alpha;
+          alpha += pixel_alpha;
+        }
+      }
+      // Pixels of the cell that hang off the edge of the image count as transparent.
+      quint64 area = static_cast<quint64>(cell_size_) * cell_size_;
+      if (alpha == 0) {
+        cells[column] = qRgba(0, 0, 0, 0);
+      } else {
+        cells[column] = qRgba(red / alpha, green / alpha, blue / alpha, alpha / area);
+      }
+    }
+    return cells;
+  }
+
+ private:
+  const QImage* image_;
+  QPoint grid_origin_;
+  int cell_size_;
+  int columns_;
+};
+
+}  // namespace
+
+TemplateConverter::TemplateConverter(const QList<BlockPrototype*>& palette, int cell_size, bool dither)
+    : palette_(palette), matcher_(paletteColors(palette)), cell_size_(qMax(cell_size, 1)), dither_(dither) {
+}
+
+// static
+QVector<QRgb> TemplateConverter::paletteColors(const QList<BlockPrototype*>& palette) {
+  QVector<QRgb> colors;
+  foreach (BlockPrototype* prototype, palette) {
+    colors.append(averageColor(prototype->sprite().toImage()));
+  }
+  return colors;
+}
+
+// static
+QRgb TemplateConverter::averageColor(const QImage& image) {
+  QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+  quint64 red = 0;
+  quint64 green = 0;
+  quint64 blue = 0;
+  quint64 alpha = 0;
+  for (int y = 0; y < argb.height(); ++y) {
+    const QRgb* pixels = reinterpret_cast<const QRgb*>(argb.scanLine(y));
+    for (int x = 0; x < argb.width(); ++x) {
+      int pixel_alpha = qAlpha(pixels[x]);
+      red += qRed(pixels[x]) * pixel_alpha;
+      green += qGreen(pixels[x]) * pixel_alpha;
+      blue += qBlue(pixels[x]) * pixel_alpha;
+      alpha += pixel_alpha;
+    }
+  }
+  if (alpha == 0) {
+    return qRgb(0, 0, 0);
+  }
+  return qRgb(red / alpha, green / alpha, blue / alpha);
+}
+
+int TemplateConverter::convert(const QImage& image, const QPoint& grid_origin, const BlockPosition& first_block,
+                               BlockOracle* oracle, BlockTransaction* transaction) const {
+  Q_ASSERT(oracle);
+  Q_ASSERT(transaction);
+  QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+  int columns = (argb.width() - grid_origin.x() + cell_size_ - 1) / cell_size_;
+  int rows = (argb.height() - grid_origin.y() + cell_size_ - 1) / cell_size_;
+  if (columns <= 0 || rows <= 0) {
+    return 0;
+  }
+
+  QList<int> row_indices;
+  for (int row = 0; row < rows; ++row) {
+    row_indices.append(row);
+  }
+  QList< QVector<QRgb> > cells = QtConcurrent::blockingMapped< QList< QVector<QRgb> > >(
+      row_indices, CellRowAverager(&argb, grid_origin, cell_size_, columns));
+
+  // Error diffusion needs the rows in order, so matching happens here on one thread; with the lookup cube it costs
+  // next to nothing per cell anyway.  Errors for the current and next rows are kept with a cell of padding each side.
+  QVector<float> error(3 * (columns + 2), 0.0f);
+  QVector<float> next_error(3 * (columns + 2), 0.0f);
+  int changed = 0;
+  for (int row = 0; row < rows; ++row) {
+    const QVector<QRgb>& row_cells = cells.at(row);
+    for (int column = 0; column < columns; ++column) {
+      QRgb cell = row_cells.at(column);
+      if (qAlpha(cell) < kMinimumAlpha) {
+        continue;
+      }
+
+      int palette_index;
+      if (dither_) {
+        float* cell_error = error.data() + 3 * (column + 1);
+        int red = qBound(0, qRound(qRed(cell) + cell_error[0]), 255);
+        int green = qBound(0, qRound(qGreen(cell) + cell_error[1]), 255);
+        int blue = qBound(0, qRound(qBlue(cell) + cell_error[2]), 255);
+        palette_index = matcher_.nearest(qRgb(red, green, blue));
+        QRgb chosen = matcher_.color(palette_index);
+        float residual[3] = { static_cast<float>(red - qRed(chosen)),
+                              static_cast<float>(green - qGreen(chosen)),
+                              static_cast<float>(blue - qBlue(chosen)) };
+        for (int channel = 0; channel < 3; ++channel) {
+          cell_error[3 + channel] += residual[channel] * (7.0f / 16.0f);
+          next_error[3 * column + channel] += residual[channel] * (3.0f / 16.0f);
+          next_error[3 * (column + 1) + channel] += residual[channel] * (5.0f / 16.0f);
+          next_error[3 * (column + 2) + channel] += residual[channel] * (1.0f / 16.0f);
+        }
+      } else {
+        palette_index = matcher_.nearest(cell);
+      }
+
+      BlockPrototype* prototype = palette_.at(palette_index);
+      BlockPosition position = first_block + BlockPosition(column, 0, row);
+      BlockInstance old_block = oracle->blockAt(position);
+      if (old_block.prototype() != prototype) {
+        transaction->replaceBlock(old_block, BlockInstance(prototype, position, prototype->defaultOrientation()));
+        ++changed;
+      }
+    }
+    qSwap(error, next_error);
+    next_error.fill(0.0f);
+  }
+  return changed;
+}
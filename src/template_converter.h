@@ -0,0 +1,77 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TEMPLATE_CONVERTER_H
+#define TEMPLATE_CONVERTER_H
+
+#include <QColor>
+#include <QImage>
+#include <QList>
+#include <QPoint>
+
+#include "palette_matcher.h"
+
+class BlockOracle;
+class BlockPosition;
+class BlockPrototype;
+class BlockTransaction;
+
+/**
+  * Turns an image into a flat layer of blocks, picking for each square cell of pixels the block whose sprite is
+  * closest in colour to the average colour of the cell.
+  *
+  * Cells are averaged in parallel, a row of cells per task on the global thread pool, and then matched against the
+  * palette with a PaletteMatcher.  Optionally, the difference between each cell and the block chosen for it is spread
+  * over the neighbouring cells (Floyd-Steinberg dithering), which gives a much better impression of colours that no
+  * block matches well.  Cells that are mostly transparent are left alone.
+  */
+class TemplateConverter {
+ public:
+  /**
+    * Creates a TemplateConverter.
+    * @param palette The block types to choose from.  Must not be empty.
+    * @param cell_size The width and height, in pixels, of the cell that each block stands for.
+    * @param dither Whether to dither.
+    */
+  TemplateConverter(const QList<BlockPrototype*>& palette, int cell_size, bool dither);
+
+  /**
+    * Records in \p transaction the replacement of one block per cell of \p image.
+    * @param grid_origin The pixel at the top left corner of the first cell.  This can be outside the image, which
+    *                    lets the grid of cells be aligned with something other than the image's own corner.
+    * @param first_block The position of the block for the first cell.  Columns of cells run along x and rows along z.
+    * @return The number of blocks changed.
+    */
+  int convert(const QImage& image, const QPoint& grid_origin, const BlockPosition& first_block, BlockOracle* oracle,
+              BlockTransaction* transaction) const;
+
+  /**
+    * Returns the average colour of the opaque pixels of \p image.
+    */
+  static QRgb averageColor(const QImage& image);
+
+  /**
+    * Returns the average colour of the sprite of each block in \p palette, in the same order, for a PaletteMatcher.
+    */
+  static QVector<QRgb> paletteColors(const QList<BlockPrototype*>& palette);
+
+ private:
+  QList<BlockPrototype*> palette_;
+  PaletteMatcher matcher_;
+  int cell_size_;
+  bool dither_;
+};
+
+#endif // TEMPLATE_CONVERTER_H
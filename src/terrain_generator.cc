@@ -0,0 +1,209 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "terrain_generator.h"
+
+#include <QList>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <qmath.h>
+
+#include "block_instance.h"
+#include "block_oracle.h"
+#include "block_prototype.h"
+#include "block_transaction.h"
+
+namespace {
+
+/** Persistence of the fractal noise used for hills. */
+const float kHillPersistence = 0.5f;
+
+/** Approximate width, in blocks, of a cave. */
+const float kCaveFeatureSize = 16.0f;
+
+/** Octaves of noise used for caves. */
+const int kCaveOctaves = 2;
+
+/** Cave noise above this value is carved out. */
+const float kCaveThreshold = 0.3f;
+
+struct TerrainRun {
+  int x_begin;
+  int x_end;
+  int y;
+  int z;
+  BlockPrototype* prototype;
+};
+
+/**
+  * Generates one chunk column of terrain.  Used as a QtConcurrent map functor.
+  */
+class ChunkColumnGenerator {
+ public:
+  typedef QVector<TerrainRun> result_type;
+
+  ChunkColumnGenerator(const HeightField* heights, const TerrainGenerator::Layers& layers,
+                       const ValueNoise* cave_noise, const BlockPosition& min_corner, const BlockPosition& max_corner)
+      : heights_(heights), layers_(layers), cave_noise_(cave_noise), min_corner_(min_corner),
+        max_corner_(max_corner) {}
+
+  QVector<TerrainRun> operator()(const BlockPosition& chunk_corner) const {
+    const int size = TerrainGenerator::kChunkSize;
+    int width = qMin(size, max_corner_.x() - chunk_corner.x() + 1);
+    int depth = qMin(size, max_corner_.z() - chunk_corner.z() + 1);
+
+    int heights[TerrainGenerator::kChunkSize * TerrainGenerator::kChunkSize];
+    int top = min_corner_.y() - 1;
+    for (int dz = 0; dz < depth; ++dz) {
+      int* row_heights = heights + dz * size;
+      heights_->heightRow(chunk_corner.x(), chunk_corner.z() + dz, width, row_heights);
+      for (int dx = 0; dx < width; ++dx) {
+        row_heights[dx] = qMin(row_heights[dx], max_corner_.y());
+        top = qMax(top, row_heights[dx]);
+      }
+    }
+
+    QVector<TerrainRun> runs;
+    float caves[TerrainGenerator::kChunkSize];
+    BlockPrototype* row[TerrainGenerator::kChunkSize];
+    for (int dz = 0; dz < depth; ++dz) {
+      const int* row_heights = heights + dz * size;
+      int z = chunk_corner.z() + dz;
+      for (int y = min_corner_.y(); y <= top; ++y) {
+        for (int dx = 0; dx < width; ++dx) {
+          int height = row_heights[dx];
+          if (y > height) {
+            row[dx] = NULL;
+          } else if (y == height) {
+            row[dx] = layers_.surface;
+          } else if (y >= height - layers_.subsurface_depth) {
+            row[dx] = layers_.subsurface;
+          } else {
+            row[dx] = layers_.base;
+          }
+        }
+        if (cave_noise_) {
+          cave_noise_->fractalRow(chunk_corner.x() / kCaveFeatureSize, y / kCaveFeatureSize, z / kCaveFeatureSize,
+                                  1.0f / kCaveFeatureSize, width, kCaveOctaves, 0.5f, caves);
+          for (int dx = 0; dx < width; ++dx) {
+            if (caves[dx] > kCaveThreshold && y < row_heights[dx]) {
+              row[dx] = NULL;
+            }
+          }
+        }
+        appendRuns(row, width, chunk_corner.x(), y, z, &runs);
+      }
+    }
+    return runs;
+  }
+
+ private:
+  static void appendRuns(BlockPrototype* const* row, int width, int x, int y, int z, QVector<TerrainRun>* runs) {
+    int run_start = 0;
+    for (int dx = 1; dx <= width; ++dx) {
+      if (dx < width && row[dx] == row[run_start]) {
+        continue;
+      }
+      if (row[run_start]) {
+        TerrainRun run = { x + run_start, x + dx, y, z, row[run_start] };
+        runs->append(run);
+      }
+      run_start = dx;
+    }
+  }
+
+  const HeightField* heights_;
+  TerrainGenerator::Layers layers_;
+  const ValueNoise* cave_noise_;
+  BlockPosition min_corner_;
+  BlockPosition max_corner_;
+};
+
+}  // namespace
+
+NoiseHeightField::NoiseHeightField(quint32 seed, int mean_height, int variation, int feature_size, int octaves)
+    : noise_(seed),
+      mean_height_(mean_height),
+      variation_(variation),
+      frequency_(1.0f / qMax(feature_size, 1)),
+      octaves_(qMax(octaves, 1)) {
+}
+
+void NoiseHeightField::heightRow(int x, int z, int count, int* heights) const {
+  float values[TerrainGenerator::kChunkSize];
+  for (int start = 0; start < count; start += TerrainGenerator::kChunkSize) {
+    int batch = qMin(count - start, static_cast<int>(TerrainGenerator::kChunkSize));
+    noise_.fractalRow((x + start) * frequency_, z * frequency_, frequency_, batch, octaves_, kHillPersistence,
+                      values);
+    for (int i = 0; i < batch; ++i) {
+      heights[start + i] = mean_height_ + qRound(values[i] * variation_);
+    }
+  }
+}
+
+TerrainGenerator::TerrainGenerator(const HeightField* heights, const Layers& layers, const BlockPosition& min_corner,
+                                   const BlockPosition& max_corner)
+    : heights_(heights),
+      layers_(layers),
+      min_corner_(qMin(min_corner.x(), max_corner.x()),
+                  qMin(min_corner.y(), max_corner.y()),
+                  qMin(min_corner.z(), max_corner.z())),
+      max_corner_(qMax(min_corner.x(), max_corner.x()),
+                  qMax(min_corner.y(), max_corner.y()),
+                  qMax(min_corner.z(), max_corner.z())),
+      caves_enabled_(false),
+      cave_seed_(0) {
+  Q_ASSERT(heights_);
+  Q_ASSERT(layers_.surface && layers_.subsurface && layers_.base);
+}
+
+void TerrainGenerator::enableCaves(quint32 seed) {
+  caves_enabled_ = true;
+  cave_seed_ = seed;
+}
+
+int TerrainGenerator::generate(BlockOracle* oracle, BlockTransaction* transaction) const {
+  Q_ASSERT(oracle);
+  Q_ASSERT(transaction);
+  QList<BlockPosition> chunk_corners;
+  for (int z = min_corner_.z(); z <= max_corner_.z(); z += kChunkSize) {
+    for (int x = min_corner_.x(); x <= max_corner_.x(); x += kChunkSize) {
+      chunk_corners.append(BlockPosition(x, min_corner_.y(), z));
+    }
+  }
+
+  // Scramble the cave seed so that reusing the height field seed does not line the caves up with the hills.
+  ValueNoise cave_noise(cave_seed_ ^ 0x5bd1e995U);
+  ChunkColumnGenerator generator(heights_, layers_, caves_enabled_ ? &cave_noise : NULL, min_corner_, max_corner_);
+  QList< QVector<TerrainRun> > chunk_runs =
+      QtConcurrent::blockingMapped< QList< QVector<TerrainRun> > >(chunk_corners, generator);
+
+  int changed = 0;
+  foreach (const QVector<TerrainRun>& runs, chunk_runs) {
+    foreach (const TerrainRun& run, runs) {
+      for (int x = run.x_begin; x < run.x_end; ++x) {
+        BlockPosition position(x, run.y, run.z);
+        BlockInstance old_block = oracle->blockAt(position);
+        if (old_block.prototype() == run.prototype) {
+          continue;
+        }
+        transaction->replaceBlock(old_block, BlockInstance(run.prototype, position,
+                                                           run.prototype->defaultOrientation()));
+        ++changed;
+      }
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,121 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TERRAIN_GENERATOR_H
+#define TERRAIN_GENERATOR_H
+
+#include "block_position.h"
+#include "noise.h"
+
+class BlockOracle;
+class BlockPrototype;
+class BlockTransaction;
+
+/**
+  * An interface describing a source of terrain heights.
+  */
+class HeightField {
+ public:
+  virtual ~HeightField() {}
+
+  /**
+    * Writes the height (the y coordinate of the topmost solid block) of the \p count columns starting at (\p x, \p z)
+    * and running along the x axis to \p heights.
+    * @note This is called from several threads at once, so implementations must not modify any shared state.
+    */
+  virtual void heightRow(int x, int z, int count, int* heights) const = 0;
+};
+
+/**
+  * A HeightField made of rolling hills from fractal ValueNoise.
+  */
+class NoiseHeightField : public HeightField {
+ public:
+  /**
+    * Creates a NoiseHeightField.
+    * @param seed The noise seed.  The same seed always produces the same hills.
+    * @param mean_height The average height of the terrain.
+    * @param variation The furthest the terrain strays above or below \p mean_height.
+    * @param feature_size The approximate width, in blocks, of the largest hills.
+    * @param octaves The number of octaves of noise.  More octaves add finer detail.
+    */
+  NoiseHeightField(quint32 seed, int mean_height, int variation, int feature_size, int octaves);
+
+  virtual void heightRow(int x, int z, int count, int* heights) const;
+
+ private:
+  ValueNoise noise_;
+  int mean_height_;
+  int variation_;
+  float frequency_;
+  int octaves_;
+};
+
+/**
+  * Fills a box with solid terrain up to the heights given by a HeightField.
+  *
+  * Each column is layered from the top down: one surface block, then \c subsurface_depth subsurface blocks, then base
+  * blocks the rest of the way down to the bottom of the box.  Caves can optionally be carved out of everything below
+  * the surface with 3D noise.
+  *
+  * The box is split into columns one chunk (16 x 16 blocks) across, which are generated in parallel on the global
+  * thread pool.  Each chunk column is reduced to runs of identical blocks, and the runs are written into a single
+  * transaction on the calling thread, so the whole terrain is one step on the undo stack.  Generation depends only on
+  * the HeightField and the cave seed, never on thread scheduling, so it is fully repeatable.
+  */
+class TerrainGenerator {
+ public:
+  /** The edge length, in blocks, of the chunk columns generated on each thread. */
+  static const int kChunkSize = 16;
+
+  struct Layers {
+    BlockPrototype* surface;
+    BlockPrototype* subsurface;
+    BlockPrototype* base;
+    int subsurface_depth;
+  };
+
+  /**
+    * Creates a TerrainGenerator.
+    * @param heights The heights of the terrain.  Must outlive the generator.
+    * @param layers The blocks to build the terrain from.
+    * @param min_corner One corner of the box to fill, inclusive.
+    * @param max_corner The opposite corner of the box, inclusive.  Terrain higher than the box is cut off.
+    */
+  TerrainGenerator(const HeightField* heights, const Layers& layers, const BlockPosition& min_corner,
+                   const BlockPosition& max_corner);
+
+  /**
+    * Turns on cave carving, using \p seed to place the caves.
+    */
+  void enableCaves(quint32 seed);
+
+  /**
+    * Records in \p transaction the replacement of every block in the box that differs from the generated terrain.
+    * Blocks above the terrain and in caves are left alone.
+    * @return The number of blocks changed.
+    */
+  int generate(BlockOracle* oracle, BlockTransaction* transaction) const;
+
+ private:
+  const HeightField* heights_;
+  Layers layers_;
+  BlockPosition min_corner_;
+  BlockPosition max_corner_;
+  bool caves_enabled_;
+  quint32 cave_seed_;
+};
+
+#endif // TERRAIN_GENERATOR_H
@@ -145,18 +145,19 @@ void TorchRenderable::addGeometry(const Geometry& geometry, const TextureCoords&
           slanted_geometry[0][kBottomLeftCorner], slanted_geometry[0][kTopLeftCorner], texture_coords.at(4));   // Left
 }
 
-void TorchRenderable::applyOrientationTransform(const BlockOrientation* orientation) const {
+QMatrix4x4 TorchRenderable::orientationTransform(const BlockOrientation* orientation) const {
+  QMatrix4x4 transform;
   if (orientation == BlockOrientation::get("On north wall")) {
-    glRotatef(-90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(-90.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("On east wall")) {
-    glRotatef(180.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("On south wall")) {
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(90.0f, 0.0f, 1.0f, 0.0f);
   }
+  return transform;
 }
 
-bool TorchRenderable::shouldRenderQuad(int index, const QVector3D& location,
-                                       const BlockOrientation* orientation) const {
+bool TorchRenderable::shouldRenderQuad(int index, const BlockOrientation* orientation) const {
   if (orientation == BlockOrientation::get("On floor")) {
     return index < 5;
   } else {
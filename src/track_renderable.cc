@@ -113,24 +113,24 @@ void TrackRenderable::addGeometry(const Geometry& geometry, const TextureCoords&
           geometry[0][kTopRightCorner], geometry[0][kTopLeftCorner], texture_coords[2]);
 }
 
-void TrackRenderable::applyOrientationTransform(const BlockOrientation* orientation) const {
+QMatrix4x4 TrackRenderable::orientationTransform(const BlockOrientation* orientation) const {
+  QMatrix4x4 transform;
   if (orientation == BlockOrientation::get("Running east/west")) {
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(90.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Ascending east")) {
-    glRotatef(-90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(-90.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Ascending south")) {
-    glRotatef(180.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Ascending west")) {
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(90.0f, 0.0f, 1.0f, 0.0f);
   } else if (orientation == BlockOrientation::get("Southeast corner") ||
              orientation == BlockOrientation::get("Southwest corner")) {
-    glRotatef(180.0f, 0.0f, 1.0f, 0.0f);
+    transform.rotate(180.0f, 0.0f, 1.0f, 0.0f);
   }
+  return transform;
 }
 
-bool TrackRenderable::shouldRenderQuad(int index,
-                                       const QVector3D& location,
-                                       const BlockOrientation* orientation) const {
+bool TrackRenderable::shouldRenderQuad(int index, const BlockOrientation* orientation) const {
   switch (index) {
     case 0:  // Normal flat quad.
     case 1:
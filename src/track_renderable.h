@@ -28,8 +28,8 @@ class TrackRenderable : public BasicRenderable {
   virtual TextureCoords createTextureCoords(const Geometry& geometry);
   virtual Geometry moveToOrigin(const Geometry& geometry);
   virtual void addGeometry(const Geometry& geometry, const TextureCoords& texture_coords);
-  virtual void applyOrientationTransform(const BlockOrientation* orientation) const;
-  virtual bool shouldRenderQuad(int index, const QVector3D& location, const BlockOrientation* orientation) const;
+  virtual QMatrix4x4 orientationTransform(const BlockOrientation* orientation) const;
+  virtual bool shouldRenderQuad(int index, const BlockOrientation* orientation) const;
   virtual Texture textureForQuad(int index, const BlockOrientation* orientation) const;
 };
 
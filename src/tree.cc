@@ -0,0 +1,69 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tree.h"
+
+#include "random.h"
+
+Tree::Tree() : trunk_height_(4), canopy_radius_(4), clip_radius_(3), canopy_offset_(1), foliage_seed_(0) {}
+
+void Tree::randomize(Random* random) {
+  trunk_height_ = random->normalInRange(3, 5);
+  canopy_radius_ = random->normalInRange(2, 4) + (trunk_height_ - 3);
+  clip_radius_ = canopy_radius_ - 1;
+  canopy_offset_ = random->normalInRange(1, 2);
+  foliage_seed_ = random->next64();
+}
+
+void Tree::grow(const BlockPosition& base, QVector<BlockPosition>* trunk, QVector<BlockPosition>* leaves) const {
+  for (int i = 0; i < trunk_height_; ++i) {
+    trunk->append(base + BlockPosition(0, i, 0));
+  }
+
+  Random foliage(foliage_seed_);
+  BlockPosition canopy_center = base + BlockPosition(0, trunk_height_ - canopy_offset_, 0);
+  for (int x = canopy_center.x() - clip_radius_; x <= canopy_center.x() + clip_radius_; ++x) {
+    for (int y = canopy_center.y(); y <= canopy_center.y() + canopy_radius_; ++y) {
+      for (int z = canopy_center.z() - clip_radius_; z <= canopy_center.z() + clip_radius_; ++z) {
+        BlockPosition point(x, y, z);
+        float squared_distance = (point.centerVector() - canopy_center.centerVector()).lengthSquared();
+        if (squared_distance <= canopy_radius_ * canopy_radius_) {
+          // Only compute actual distance if we might draw the leaves.
+          float distance = (point.centerVector() - canopy_center.centerVector()).length();
+          // If the leaf block is on the periphery of the tree, only draw it with 50% probability.  The coin is tossed
+          // for every peripheral block, in the same order, so the pattern depends only on the seed.
+          bool on_periphery = distance >= canopy_radius_;
+          if (!on_periphery || (foliage.next() & 1) != 0) {
+            leaves->append(point);
+          }
+        }
+      }
+    }
+  }
+}
+
+// static
+bool Tree::isWood(blocktype_t type) {
+  return (type & 0xFFFF) == 0x11 || (type & 0xFFFF) == 0x05;
+}
+
+// static
+blocktype_t Tree::leafTypeFor(blocktype_t wood_type) {
+  blocktype_t leaf_type = 0x12;  // Oak leaves by default.
+  if (isWood(wood_type)) {
+    leaf_type = (wood_type & 0xFF0000) + 0x12;  // Select the leaves for that type of wood.
+  }
+  return leaf_type;
+}
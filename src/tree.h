@@ -0,0 +1,77 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TREE_H
+#define TREE_H
+
+#include <QVector>
+
+#include "block_position.h"
+#include "block_type.h"
+
+class Random;
+
+/**
+  * The shape of one tree: a straight trunk topped by a roughly hemispherical canopy of leaves with a ragged edge.
+  *
+  * A Tree only describes which positions are trunk and which are leaves; deciding what to do about blocks that are
+  * already there is up to the caller.  All of the randomness, including the raggedness of the canopy, comes from the
+  * Random passed to randomize(), so the same sequence of random numbers always grows the same tree.
+  */
+class Tree {
+ public:
+  /**
+    * Creates a tree of average size.
+    */
+  Tree();
+
+  /**
+    * Picks a new size and canopy pattern using \p random.
+    */
+  void randomize(Random* random);
+
+  /**
+    * Returns the furthest that a leaf can be from the trunk horizontally.
+    */
+  int canopyRadius() const {
+    return clip_radius_;
+  }
+
+  /**
+    * Appends the positions of the trunk to \p trunk and of the leaves to \p leaves for a tree planted at \p base.
+    * The trunk comes first, from the bottom up.
+    */
+  void grow(const BlockPosition& base, QVector<BlockPosition>* trunk, QVector<BlockPosition>* leaves) const;
+
+  /**
+    * Returns \c true if \p type is a kind of log or planks, which trees can be made of.
+    */
+  static bool isWood(blocktype_t type);
+
+  /**
+    * Returns the leaves that go with a trunk of \p wood_type: the matching leaves for logs and planks, and oak
+    * leaves for anything else.
+    */
+  static blocktype_t leafTypeFor(blocktype_t wood_type);
+
+ private:
+  int trunk_height_;
+  int canopy_radius_;
+  int clip_radius_;
+  int canopy_offset_;
+  quint64 foliage_seed_;
+};
+
+#endif // TREE_H
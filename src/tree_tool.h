@@ -16,7 +16,9 @@
 #ifndef TREE_TOOL_H
 #define TREE_TOOL_H
 
+#include "random.h"
 #include "tool.h"
+#include "tree.h"
 
 class BlockManager;
 class BlockOracle;
@@ -32,15 +34,11 @@ class TreeTool : public Tool {
   virtual void draw(BlockPrototype* prototype, const BlockOrientation* orientation, BlockTransaction* transaction);
 
  private:
-  void randomizeTree();
   BlockOracle* oracle_;
   BlockManager* block_manager_;
 
-  int trunk_height_;
-  int canopy_radius_;
-  int clip_radius_;
-  int canopy_offset_;
-  int foliage_seed_;
+  Random random_;
+  Tree tree_;
 };
 
 #endif // TREE_TOOL_H
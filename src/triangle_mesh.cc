@@ -0,0 +1,299 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "triangle_mesh.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QPointF>
+#include <qmath.h>
+
+namespace {
+
+const QRgb kNoColor = 0;
+
+struct Material {
+  Material() : has_diffuse(false), diffuse(kNoColor) {}
+
+  bool has_diffuse;
+  QRgb diffuse;
+  QImage texture;
+};
+
+/**
+  * Converts an OBJ colour component in [0, 1] to a byte.
+  */
+int colorComponent(const QByteArray& text) {
+  return qBound(0, qRound(text.toFloat() * 255.0f), 255);
+}
+
+/**
+  * Resolves an OBJ index, which counts from 1, or from the end if negative, to an index into a list of \p count items.
+  * Returns -1 if the index is out of range.
+  */
+int resolveIndex(const QByteArray& text, int count) {
+  bool ok = false;
+  int index = text.toInt(&ok);
+  if (!ok || index == 0) {
+    return -1;
+  }
+  index = (index > 0) ? index - 1 : count + index;
+  return (index >= 0 && index < count) ? index : -1;
+}
+
+/**
+  * Splits \p line on runs of spaces and tabs.
+  */
+QList<QByteArray> tokenize(const QByteArray& line) {
+  return line.simplified().split(' ');
+}
+
+void loadMaterials(const QString& filename, QHash<QByteArray, Material>* materials) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Could not open material library" << filename;
+    return;
+  }
+  QDir directory = QFileInfo(filename).absoluteDir();
+  Material* current = NULL;
+  while (!file.atEnd()) {
+    QList<QByteArray> tokens = tokenize(file.readLine());
+    if (tokens.size() < 2) {
+      continue;
+    }
+    if (tokens[0] == "newmtl") {
+      current = &(*materials)[tokens[1]];
+    } else if (current && tokens[0] == "Kd" && tokens.size() >= 4) {
+      current->has_diffuse = true;
+      current->diffuse = qRgb(colorComponent(tokens[1]), colorComponent(tokens[2]), colorComponent(tokens[3]));
+    } else if (current && tokens[0] == "map_Kd") {
+      // Options such as -s may come first; the file name is always last.
+      current->texture = QImage(directory.filePath(QString::fromLocal8Bit(tokens.last())))
+                         .convertToFormat(QImage::Format_ARGB32);
+    }
+  }
+}
+
+QRgb sampleTexture(const QImage& texture, const QPointF& uv) {
+  qreal u = uv.x() - qFloor(uv.x());
+  qreal v = uv.y() - qFloor(uv.y());
+  int x = qBound(0, static_cast<int>(u * texture.width()), texture.width() - 1);
+  int y = qBound(0, static_cast<int>((1.0 - v) * texture.height()), texture.height() - 1);
+  return texture.pixel(x, y);
+}
+
+}  // namespace
+
+TriangleMesh::TriangleMesh() : has_colors_(false) {
+}
+
+bool TriangleMesh::load(const QString& filename, QString* error) {
+  vertices_.clear();
+  triangles_.clear();
+  has_colors_ = false;
+
+  QString suffix = QFileInfo(filename).suffix().toLower();
+  bool loaded;
+  if (suffix == "stl") {
+    loaded = loadStl(filename, error);
+  } else if (suffix == "obj") {
+    loaded = loadObj(filename, error);
+  } else {
+    if (error) {
+      *error = "Only OBJ and STL meshes can be imported.";
+    }
+    return false;
+  }
+  if (loaded && triangles_.isEmpty()) {
+    if (error) {
+      *error = "The mesh does not contain any triangles.";
+    }
+    return false;
+  }
+  return loaded;
+}
+
+bool TriangleMesh::loadObj(const QString& filename, QString* error) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    if (error) {
+      *error = file.errorString();
+    }
+    return false;
+  }
+
+  QDir directory = QFileInfo(filename).absoluteDir();
+  QVector<QRgb> vertex_colors;
+  QVector<QPointF> texture_coordinates;
+  QHash<QByteArray, Material> materials;
+  const Material* material = NULL;
+  QVector<int> face_vertices;
+  QVector<int> face_texture_coordinates;
+  while (!file.atEnd()) {
+    QList<QByteArray> tokens = tokenize(file.readLine());
+    if (tokens.isEmpty()) {
+      continue;
+    }
+    const QByteArray& command = tokens[0];
+    if (command == "v" && tokens.size() >= 4) {
+      vertices_.append(QVector3D(tokens[1].toFloat(), tokens[2].toFloat(), tokens[3].toFloat()));
+      if (tokens.size() >= 7) {
+        vertex_colors.resize(vertices_.size());
+        vertex_colors.last() = qRgb(colorComponent(tokens[4]), colorComponent(tokens[5]), colorComponent(tokens[6]));
+      }
+    } else if (command == "vt" && tokens.size() >= 3) {
+      texture_coordinates.append(QPointF(tokens[1].toFloat(), tokens[2].toFloat()));
+    } else if (command == "mtllib" && tokens.size() >= 2) {
+      loadMaterials(directory.filePath(QString::fromLocal8Bit(tokens[1])), &materials);
+    } else if (command == "usemtl" && tokens.size() >= 2) {
+      QHash<QByteArray, Material>::const_iterator iter = materials.constFind(tokens[1]);
+      material = (iter == materials.constEnd()) ? NULL : &iter.value();
+    } else if (command == "f" && tokens.size() >= 4) {
+      // Each corner is v, v/vt, v//vn or v/vt/vn.
+      face_vertices.clear();
+      face_texture_coordinates.clear();
+      bool is_valid = true;
+      for (int i = 1; i < tokens.size(); ++i) {
+        QList<QByteArray> indices = tokens[i].split('/');
+        int vertex = resolveIndex(indices[0], vertices_.size());
+        is_valid = is_valid && vertex >= 0;
+        face_vertices.append(vertex);
+        face_texture_coordinates.append(indices.size() > 1 ? resolveIndex(indices[1], texture_coordinates.size())
+                                                           : -1);
+      }
+      if (!is_valid) {
+        continue;
+      }
+      for (int i = 1; i + 1 < face_vertices.size(); ++i) {
+        Triangle triangle;
+        int corners[3] = { 0, i, i + 1 };
+        bool has_uvs = material && !material->texture.isNull();
+        bool has_vertex_colors = true;
+        QPointF uv_sum;
+        int red = 0;
+        int green = 0;
+        int blue = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+          int vertex = face_vertices[corners[corner]];
+          int texture_coordinate = face_texture_coordinates[corners[corner]];
+          triangle.vertices[corner] = vertex;
+          has_uvs = has_uvs && texture_coordinate >= 0;
+          if (has_uvs) {
+            uv_sum += texture_coordinates[texture_coordinate];
+          }
+          has_vertex_colors = has_vertex_colors && vertex < vertex_colors.size() && vertex_colors[vertex] != kNoColor;
+          if (has_vertex_colors) {
+            red += qRed(vertex_colors[vertex]);
+            green += qGreen(vertex_colors[vertex]);
+            blue += qBlue(vertex_colors[vertex]);
+          }
+        }
+        if (has_uvs) {
+          triangle.color = sampleTexture(material->texture, uv_sum / 3.0);
+        } else if (material && material->has_diffuse) {
+          triangle.color = material->diffuse;
+        } else if (has_vertex_colors) {
+          triangle.color = qRgb(red / 3, green / 3, blue / 3);
+        } else {
+          triangle.color = kNoColor;
+        }
+        has_colors_ = has_colors_ || triangle.color != kNoColor;
+        triangles_.append(triangle);
+      }
+    }
+  }
+  return true;
+}
+
+bool TriangleMesh::loadStl(const QString& filename, QString* error) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    if (error) {
+      *error = file.errorString();
+    }
+    return false;
+  }
+
+  // Binary STL has no magic number, and some exporters even begin binary files with "solid", so go by the size.
+  QDataStream stream(&file);
+  stream.setByteOrder(QDataStream::LittleEndian);
+  stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  quint32 triangle_count = 0;
+  if (file.size() >= 84) {
+    stream.skipRawData(80);
+    stream >> triangle_count;
+  }
+  if (file.size() >= 84 && file.size() == 84 + 50 * static_cast<qint64>(triangle_count)) {
+    vertices_.reserve(triangle_count * 3);
+    triangles_.reserve(triangle_count);
+    for (quint32 i = 0; i < triangle_count; ++i) {
+      float values[12];  // The normal, which is ignored, then the three corners.
+      for (int j = 0; j < 12; ++j) {
+        stream >> values[j];
+      }
+      quint16 attributes;
+      stream >> attributes;
+      Triangle triangle;
+      for (int corner = 0; corner < 3; ++corner) {
+        triangle.vertices[corner] = vertices_.size();
+        vertices_.append(QVector3D(values[3 + corner * 3], values[4 + corner * 3], values[5 + corner * 3]));
+      }
+      triangle.color = kNoColor;
+      triangles_.append(triangle);
+    }
+    return true;
+  }
+
+  file.seek(0);
+  while (!file.atEnd()) {
+    QList<QByteArray> tokens = tokenize(file.readLine());
+    if (tokens.size() >= 4 && tokens[0] == "vertex") {
+      vertices_.append(QVector3D(tokens[1].toFloat(), tokens[2].toFloat(), tokens[3].toFloat()));
+      if (vertices_.size() % 3 == 0) {
+        Triangle triangle;
+        for (int corner = 0; corner < 3; ++corner) {
+          triangle.vertices[corner] = vertices_.size() - 3 + corner;
+        }
+        triangle.color = kNoColor;
+        triangles_.append(triangle);
+      }
+    }
+  }
+  return true;
+}
+
+void TriangleMesh::bounds(QVector3D* min, QVector3D* max) const {
+  if (vertices_.isEmpty()) {
+    *min = QVector3D();
+    *max = QVector3D();
+    return;
+  }
+  *min = vertices_.first();
+  *max = vertices_.first();
+  foreach (const QVector3D& vertex, vertices_) {
+    min->setX(qMin(min->x(), vertex.x()));
+    min->setY(qMin(min->y(), vertex.y()));
+    min->setZ(qMin(min->z(), vertex.z()));
+    max->setX(qMax(max->x(), vertex.x()));
+    max->setY(qMax(max->y(), vertex.y()));
+    max->setZ(qMax(max->z(), vertex.z()));
+  }
+}
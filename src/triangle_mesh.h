@@ -0,0 +1,77 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include <QColor>
+#include <QString>
+#include <QVector>
+#include <QVector3D>
+
+/**
+  * A triangle mesh loaded from a Wavefront OBJ or STL file, for turning into blocks with a MeshVoxelizer.
+  *
+  * OBJ polygons are split into fans of triangles.  Each triangle gets a colour if the file provides one: from the
+  * texture of its material sampled at the centre of the triangle, from the diffuse colour of its material, or from
+  * per-vertex colours (the common "v x y z r g b" extension), in that order of preference.  STL files, binary or
+  * ASCII, never have colours.
+  */
+class TriangleMesh {
+ public:
+  struct Triangle {
+    int vertices[3];
+    QRgb color;
+  };
+
+  TriangleMesh();
+
+  /**
+    * Loads the mesh in \p filename, replacing any mesh loaded previously.  The format is chosen by file extension.
+    * @param error If not NULL and the file could not be loaded, receives a description of what went wrong.
+    * @return \c true if the file was loaded successfully.
+    */
+  bool load(const QString& filename, QString* error = NULL);
+
+  const QVector<QVector3D>& vertices() const {
+    return vertices_;
+  }
+
+  const QVector<Triangle>& triangles() const {
+    return triangles_;
+  }
+
+  /**
+    * Returns \c true if at least one triangle has a colour.  Triangles without one have a fully transparent colour.
+    */
+  bool hasColors() const {
+    return has_colors_;
+  }
+
+  /**
+    * Computes the axis-aligned bounding box of the mesh.
+    */
+  void bounds(QVector3D* min, QVector3D* max) const;
+
+ private:
+  bool loadObj(const QString& filename, QString* error);
+  bool loadStl(const QString& filename, QString* error);
+
+  QVector<QVector3D> vertices_;
+  QVector<Triangle> triangles_;
+  bool has_colors_;
+};
+
+#endif // TRIANGLE_MESH_H
@@ -17,10 +17,13 @@
 
 #include "diagram.h"
 
-UndoCommand::UndoCommand(const BlockTransaction& transaction, Diagram* diagram, QUndoCommand* parent)
+UndoCommand::UndoCommand(const BlockTransaction& transaction, Diagram* diagram, Diagram::CommitMode mode,
+                         QUndoCommand* parent)
     : QUndoCommand(parent),
       transaction_(transaction),
-      diagram_(diagram) {
+      diagram_(diagram),
+      mode_(mode),
+      has_run_(false) {
   Q_ASSERT(diagram);
 }
 
@@ -28,10 +31,47 @@ UndoCommand::~UndoCommand() {}
 
 void UndoCommand::undo() {
   qDebug() << "UndoCommand::undo()";
-  diagram_->commit(transaction_.reversed());
+  diagram_->commit(transaction_.reversed(), Diagram::kCommitExactly);
 }
 
 void UndoCommand::redo() {
   qDebug() << "UndoCommand::redo()";
-  diagram_->commit(transaction_);
+  if (has_run_) {
+    diagram_->commit(transaction_, Diagram::kCommitExactly);
+  } else {
+    // The first time through, the diagram may join up panes and tracks around the change; remember everything it did
+    // so that undo and redo put back exactly the same blocks.
+    transaction_ = diagram_->commit(transaction_, mode_);
+    has_run_ = true;
+  }
+}
+
+PrefabUndoCommand::PrefabUndoCommand(const QList<Prefab>& prefabs, const QList<PrefabPlacement>& placements,
+                                     const BlockTransaction& transaction, Diagram* diagram, QUndoCommand* parent)
+    : QUndoCommand(parent),
+      new_prefabs_(prefabs),
+      new_placements_(placements),
+      transaction_(transaction),
+      diagram_(diagram),
+      has_run_(false) {
+  Q_ASSERT(diagram);
+  old_prefabs_ = diagram->prefabs();
+  old_placements_ = diagram->placements();
+}
+
+PrefabUndoCommand::~PrefabUndoCommand() {}
+
+void PrefabUndoCommand::undo() {
+  diagram_->setPrefabs(old_prefabs_, old_placements_);
+  diagram_->commit(transaction_.reversed(), Diagram::kCommitExactly);
+}
+
+void PrefabUndoCommand::redo() {
+  if (has_run_) {
+    diagram_->commit(transaction_, Diagram::kCommitExactly);
+  } else {
+    transaction_ = diagram_->commit(transaction_);
+    has_run_ = true;
+  }
+  diagram_->setPrefabs(new_prefabs_, new_placements_);
 }
@@ -16,15 +16,22 @@
 #ifndef UNDO_COMMAND_H
 #define UNDO_COMMAND_H
 
+#include <QList>
 #include <QUndoCommand>
 
 #include "block_transaction.h"
-
-class Diagram;
+#include "diagram.h"
+#include "prefab.h"
 
 class UndoCommand : public QUndoCommand {
  public:
-  explicit UndoCommand(const BlockTransaction& transaction, Diagram* diagram, QUndoCommand* parent = NULL);
+  /**
+    * Creates a command that commits \p transaction to \p diagram.  The first time the command runs, the transaction is
+    * committed with \p mode; after that, redo and undo replay exactly what that first commit did.
+    * @sa Diagram::commit()
+    */
+  explicit UndoCommand(const BlockTransaction& transaction, Diagram* diagram,
+                       Diagram::CommitMode mode = Diagram::kAutoConnect, QUndoCommand* parent = NULL);
   virtual ~UndoCommand();
 
   virtual void undo();
@@ -33,6 +40,35 @@ class UndoCommand : public QUndoCommand {
  private:
   BlockTransaction transaction_;
   Diagram* diagram_;
+  Diagram::CommitMode mode_;
+  bool has_run_;
+};
+
+/**
+  * An undoable change to the prefabs of a diagram and their placements, along with any blocks that change with them,
+  * such as the blocks added by baking the placements or removed by turning them into a prefab.
+  */
+class PrefabUndoCommand : public QUndoCommand {
+ public:
+  /**
+    * Creates a command that commits \p transaction to \p diagram and then gives it \p prefabs and \p placements.
+    * @sa Diagram::setPrefabs()
+    */
+  PrefabUndoCommand(const QList<Prefab>& prefabs, const QList<PrefabPlacement>& placements,
+                    const BlockTransaction& transaction, Diagram* diagram, QUndoCommand* parent = NULL);
+  virtual ~PrefabUndoCommand();
+
+  virtual void undo();
+  virtual void redo();
+
+ private:
+  QList<Prefab> old_prefabs_;
+  QList<PrefabPlacement> old_placements_;
+  QList<Prefab> new_prefabs_;
+  QList<PrefabPlacement> new_placements_;
+  BlockTransaction transaction_;
+  Diagram* diagram_;
+  bool has_run_;
 };
 
 #endif // UNDO_COMMAND_H
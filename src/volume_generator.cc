@@ -0,0 +1,105 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "volume_generator.h"
+
+#include <QList>
+#include <QVector>
+#include <QtConcurrentMap>
+
+namespace {
+
+struct Run {
+  int x_begin;
+  int x_end;
+  int y;
+  int z;
+};
+
+/**
+  * Evaluates one slice of constant z.  Used as a QtConcurrent map functor.
+  */
+class SliceEvaluator {
+ public:
+  typedef QVector<Run> result_type;
+
+  SliceEvaluator(const Expression* expression, const BlockPosition& origin, const BlockPosition& min_corner,
+                 const BlockPosition& max_corner)
+      : expression_(expression), origin_(origin), min_corner_(min_corner), max_corner_(max_corner) {}
+
+  QVector<Run> operator()(int z) const {
+    QVector<Run> runs;
+    int row_length = max_corner_.x() - min_corner_.x() + 1;
+    QVector<float> results(row_length);
+    for (int y = min_corner_.y(); y <= max_corner_.y(); ++y) {
+      expression_->evaluateRow(min_corner_.x() - origin_.x(), y - origin_.y(), z - origin_.z(), row_length,
+                               results.data());
+      int run_start = -1;
+      for (int i = 0; i <= row_length; ++i) {
+        bool inside = (i < row_length && results[i] != 0);
+        if (inside && run_start < 0) {
+          run_start = i;
+        } else if (!inside && run_start >= 0) {
+          Run run = { min_corner_.x() + run_start, min_corner_.x() + i, y, z };
+          runs.append(run);
+          run_start = -1;
+        }
+      }
+    }
+    return runs;
+  }
+
+ private:
+  const Expression* expression_;
+  BlockPosition origin_;
+  BlockPosition min_corner_;
+  BlockPosition max_corner_;
+};
+
+}  // namespace
+
+VolumeGenerator::VolumeGenerator(const Expression& expression, const BlockPosition& origin,
+                                 const BlockPosition& min_corner, const BlockPosition& max_corner)
+    : expression_(expression),
+      origin_(origin),
+      min_corner_(qMin(min_corner.x(), max_corner.x()),
+                  qMin(min_corner.y(), max_corner.y()),
+                  qMin(min_corner.z(), max_corner.z())),
+      max_corner_(qMax(min_corner.x(), max_corner.x()),
+                  qMax(min_corner.y(), max_corner.y()),
+                  qMax(min_corner.z(), max_corner.z())) {}
+
+qint64 VolumeGenerator::cellCount() const {
+  return static_cast<qint64>(max_corner_.x() - min_corner_.x() + 1) *
+         static_cast<qint64>(max_corner_.y() - min_corner_.y() + 1) *
+         static_cast<qint64>(max_corner_.z() - min_corner_.z() + 1);
+}
+
+void VolumeGenerator::generate(ShapeRasterizer::RunVisitor* visitor) const {
+  if (!expression_.isValid()) {
+    return;
+  }
+  QList<int> slices;
+  for (int z = min_corner_.z(); z <= max_corner_.z(); ++z) {
+    slices.append(z);
+  }
+  QList< QVector<Run> > slice_runs = QtConcurrent::blockingMapped< QList< QVector<Run> > >(
+      slices, SliceEvaluator(&expression_, origin_, min_corner_, max_corner_));
+  foreach (const QVector<Run>& runs, slice_runs) {
+    foreach (const Run& run, runs) {
+      visitor->visitRun(run.x_begin, run.x_end, run.y, run.z);
+    }
+  }
+}
@@ -0,0 +1,59 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOLUME_GENERATOR_H
+#define VOLUME_GENERATOR_H
+
+#include "block_position.h"
+#include "expression.h"
+#include "shape_rasterizer.h"
+
+/**
+  * Evaluates an Expression over a box of blocks and reports the blocks for which it is true.
+  *
+  * The box is split into slices of constant z that are evaluated on the global thread pool.  Each slice is evaluated a
+  * row at a time with Expression::evaluateRow() and reduced to runs of consecutive true blocks, which are then handed
+  * to a ShapeRasterizer::RunVisitor on the calling thread in z order.
+  */
+class VolumeGenerator {
+ public:
+  /**
+    * Creates a VolumeGenerator.
+    * @param expression The compiled expression to evaluate.  It is copied.
+    * @param origin The position that the expression sees as x = y = z = 0.
+    * @param min_corner One corner of the box to fill, inclusive, in absolute block coordinates.
+    * @param max_corner The opposite corner of the box, inclusive.
+    */
+  VolumeGenerator(const Expression& expression, const BlockPosition& origin, const BlockPosition& min_corner,
+                  const BlockPosition& max_corner);
+
+  /**
+    * Returns the number of blocks in the box.
+    */
+  qint64 cellCount() const;
+
+  /**
+    * Evaluates the expression over the whole box and reports every block for which it is true to \p visitor.
+    */
+  void generate(ShapeRasterizer::RunVisitor* visitor) const;
+
+ private:
+  Expression expression_;
+  BlockPosition origin_;
+  BlockPosition min_corner_;
+  BlockPosition max_corner_;
+};
+
+#endif // VOLUME_GENERATOR_H
@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Measures the throughput and memory use of the diagram model and the drawing tools.  Run it from the root of the
+# repository so that it can find blocks.json.
+#
+#-------------------------------------------------
+
+include(../../src/MCModeler.pri)
+
+QT       += core gui
+
+TARGET = MCModelerBenchmark
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += main.cc
+
+macx {
+    QMAKE_POST_LINK += echo "Running install_name_tool..."; \
+                       install_name_tool -change qjson.framework/Versions/0/qjson \
+                                                 @loader_path/../../third_party/qjson/lib/qjson.framework/Versions/0/qjson \
+                                                 $$OUT_PWD/$$TARGET; \
+                       install_name_tool -change libquazip.1.dylib \
+                                                 @loader_path/../../third_party/quazip/lib/libquazip.1.0.0.dylib \
+                                                 $$OUT_PWD/$$TARGET;
+}
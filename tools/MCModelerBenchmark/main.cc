@@ -0,0 +1,249 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QApplication>
+#include <QBuffer>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGLWidget>
+#include <QTextStream>
+
+#include "../../src/block_instance.h"
+#include "../../src/block_manager.h"
+#include "../../src/block_orientation.h"
+#include "../../src/block_position.h"
+#include "../../src/block_prototype.h"
+#include "../../src/block_transaction.h"
+#include "../../src/circle_tool.h"
+#include "../../src/diagram.h"
+#include "../../src/filled_rectangle_tool.h"
+#include "../../src/flood_fill_tool.h"
+#include "../../src/line_tool.h"
+#include "../../src/position_hash.h"
+#include "../../src/rectangle_tool.h"
+#include "../../src/sphere_tool.h"
+
+namespace {
+
+/** The edge length, in blocks, of the solid cube the benchmark builds. */
+const int kCubeSize = 64;
+
+/** How many scattered positions the PositionHash benchmark inserts.  They are spread over a much larger volume. */
+const int kScatteredPositions = 200000;
+const int kScatterRange = 4096;
+
+/** How many times each tool is drawn.  Every run draws into a fresh transaction, as dragging the mouse does. */
+const int kToolRuns = 20;
+
+const blocktype_t kStone = 1;
+const blocktype_t kGlass = 20;
+
+QTextStream out(stdout);
+
+/**
+  * Returns the resident set size of this process in kilobytes, or -1 if this platform has no cheap way to find out.
+  */
+qint64 residentKilobytes() {
+#ifdef Q_OS_LINUX
+  QFile status("/proc/self/status");
+  if (status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    QTextStream stream(&status);
+    for (QString line = stream.readLine(); !line.isNull(); line = stream.readLine()) {
+      if (line.startsWith("VmRSS:")) {
+        return line.section(' ', 1, 1, QString::SectionSkipEmpty).toLongLong();
+      }
+    }
+  }
+#endif
+  return -1;
+}
+
+/**
+  * Prints one line of results: the time taken, how many blocks were handled per second and, when it is known, how
+  * much the resident set grew while doing it.
+  */
+void report(const QString& name, qint64 elapsed_ms, int blocks, qint64 rss_before) {
+  qint64 rss_after = residentKilobytes();
+  double seconds = qMax<qint64>(elapsed_ms, 1) / 1000.0;
+  out << QString("%1 %2 ms %3 blocks/s").arg(name, -32).arg(elapsed_ms, 8).arg(blocks / seconds, 12, 'f', 0);
+  if (rss_before >= 0 && rss_after >= 0) {
+    out << QString(" %1 KB resident").arg(rss_after - rss_before, 8);
+  }
+  out << endl;
+}
+
+/**
+  * Draws \p tool between \p first and \p second kToolRuns times and reports how fast it filled in its transactions.
+  * The last transaction is committed to \p diagram, so that tools which read the diagram see a realistic scene.
+  */
+void benchmarkTool(const QString& name, Tool* tool, const BlockPosition& first, const BlockPosition& second,
+                   BlockPrototype* prototype, Diagram* diagram) {
+  qint64 rss_before = residentKilobytes();
+  QElapsedTimer timer;
+  timer.start();
+  int blocks = 0;
+  BlockTransaction transaction;
+  for (int run = 0; run < kToolRuns; ++run) {
+    transaction = BlockTransaction();
+    tool->clear();
+    tool->proposePosition(first);
+    tool->acceptLastPosition();
+    if (tool->wantsMorePositions()) {
+      tool->proposePosition(second);
+      tool->acceptLastPosition();
+    }
+    tool->draw(prototype, BlockOrientation::noOrientation(), &transaction);
+    blocks += transaction.new_blocks().size();
+  }
+  report(name, timer.elapsed(), blocks, rss_before);
+  diagram->commit(transaction);
+}
+
+/**
+  * Prints how long the probe sequences of a PositionHash holding \p statistics are.  Long probes mean that
+  * BlockPosition::mix() is clustering keys.
+  */
+void reportProbes(const QString& name, const PositionHashStatistics& statistics) {
+  out << QString("  %1 %2 entries in %3 slots (load %4), %5 collisions, probe length %6 average / %7 max")
+         .arg(name, -24).arg(statistics.size).arg(statistics.capacity).arg(statistics.loadFactor(), 0, 'f', 2)
+         .arg(statistics.collisions).arg(statistics.averageProbeLength(), 0, 'f', 2).arg(statistics.max_probe_length)
+      << endl;
+}
+
+/**
+  * Inserts \p positions into a PositionHash, looks each of them up again, and reports the throughput of both along
+  * with the shape of the resulting table.
+  */
+void benchmarkPositionHash(const QString& name, const QVector<BlockPosition>& positions) {
+  qint64 rss_before = residentKilobytes();
+  QElapsedTimer timer;
+  timer.start();
+  PositionHash<int> hash;
+  for (int i = 0; i < positions.size(); ++i) {
+    hash.insert(positions[i], i);
+  }
+  report(QString("PositionHash::insert (%1)").arg(name), timer.elapsed(), positions.size(), rss_before);
+
+  rss_before = residentKilobytes();
+  timer.restart();
+  int found = 0;
+  for (int i = 0; i < positions.size(); ++i) {
+    found += hash.contains(positions[i]) ? 1 : 0;
+  }
+  report(QString("PositionHash::contains (%1)").arg(name), timer.elapsed(), found, rss_before);
+  reportProbes(name, hash.probeStatistics());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  QApplication app(argc, argv);
+  app.setApplicationName("MCModelerBenchmark");
+
+  BlockPrototype::setupBlockProperties();
+  QGLWidget gl_widget;
+  BlockManager block_manager(&gl_widget);
+  BlockPrototype* stone = block_manager.getPrototype(kStone);
+  BlockPrototype* glass = block_manager.getPrototype(kGlass);
+  const BlockOrientation* no_orientation = BlockOrientation::noOrientation();
+
+  Diagram diagram;
+  diagram.setBlockManager(&block_manager);
+  int cube_blocks = kCubeSize * kCubeSize * kCubeSize;
+
+  out << QString("Benchmarking a %1 x %1 x %1 cube (%2 blocks).").arg(kCubeSize).arg(cube_blocks) << endl;
+
+  qint64 rss_before = residentKilobytes();
+  QElapsedTimer timer;
+  timer.start();
+  BlockTransaction cube;
+  for (int y = 0; y < kCubeSize; ++y) {
+    for (int z = 0; z < kCubeSize; ++z) {
+      for (int x = 0; x < kCubeSize; ++x) {
+        cube.setBlock(BlockInstance(stone, BlockPosition(x, y, z), no_orientation));
+      }
+    }
+  }
+  report("BlockTransaction::setBlock", timer.elapsed(), cube_blocks, rss_before);
+
+  rss_before = residentKilobytes();
+  timer.restart();
+  diagram.commit(cube);
+  report("Diagram::commit", timer.elapsed(), cube_blocks, rss_before);
+
+  rss_before = residentKilobytes();
+  timer.restart();
+  BlockTransaction undo = cube.reversed();
+  diagram.commit(undo, Diagram::kCommitExactly);
+  diagram.commit(cube, Diagram::kCommitExactly);
+  report("Diagram::commit (undo and redo)", timer.elapsed(), 2 * cube_blocks, rss_before);
+
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  rss_before = residentKilobytes();
+  timer.restart();
+  {
+    QDataStream stream(&buffer);
+    diagram.save(&stream);
+  }
+  report("Diagram::save", timer.elapsed(), cube_blocks, rss_before);
+  out << QString("  saved %1 bytes").arg(buffer.size()) << endl;
+
+  Diagram loaded;
+  loaded.setBlockManager(&block_manager);
+  buffer.seek(0);
+  rss_before = residentKilobytes();
+  timer.restart();
+  {
+    QDataStream stream(&buffer);
+    loaded.load(&stream);
+  }
+  report("Diagram::load", timer.elapsed(), cube_blocks, rss_before);
+
+  QVector<BlockPosition> positions;
+  positions.reserve(cube_blocks);
+  foreach (const BlockInstance& block, cube.new_blocks()) {
+    positions.append(block.position());
+  }
+  benchmarkPositionHash("cube", positions);
+  positions.clear();
+  qsrand(1);
+  for (int i = 0; i < kScatteredPositions; ++i) {
+    positions.append(BlockPosition(qrand() % (2 * kScatterRange) - kScatterRange, qrand() % 256,
+                                   qrand() % (2 * kScatterRange) - kScatterRange));
+  }
+  benchmarkPositionHash("scattered", positions);
+
+  // The tools draw on the level just above the cube, except for flood fill, which needs something to fill.
+  BlockPosition first(0, kCubeSize, 0);
+  BlockPosition second(kCubeSize - 1, kCubeSize, kCubeSize - 1);
+  LineTool line_tool(&diagram);
+  benchmarkTool("LineTool", &line_tool, first, second, glass, &diagram);
+  RectangleTool rectangle_tool(&diagram);
+  benchmarkTool("RectangleTool", &rectangle_tool, first, second, glass, &diagram);
+  FilledRectangleTool filled_rectangle_tool(&diagram);
+  benchmarkTool("FilledRectangleTool", &filled_rectangle_tool, first, second, glass, &diagram);
+  CircleTool circle_tool(&diagram);
+  benchmarkTool("CircleTool", &circle_tool, first, second, glass, &diagram);
+  SphereTool sphere_tool(&diagram);
+  benchmarkTool("SphereTool", &sphere_tool, first, second, glass, &diagram);
+  FloodFillTool flood_fill_tool(&diagram);
+  benchmarkTool("FloodFillTool", &flood_fill_tool, BlockPosition(kCubeSize / 2, 0, kCubeSize / 2), BlockPosition(),
+                glass, &diagram);
+
+  out << QString("Resident set at exit: %1 KB").arg(residentKilobytes()) << endl;
+  return 0;
+}
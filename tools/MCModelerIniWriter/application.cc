@@ -125,7 +125,8 @@ QVariantMap block(const QString& name,
                   const QVariantList& textures,
                   bool transparent,
                   bool biome_grass = false,
-                  bool biome_tree = false) {
+                  bool biome_tree = false,
+                  const QString& tint = QString()) {
   // Sanity checking for IDs:
   if (s_used_block_ids_.contains(id)) {
     qFatal("Error: block ID 0x%x is already used by block %s and cannot be assigned to block %s.",
@@ -143,6 +144,9 @@ QVariantMap block(const QString& name,
   block.insert(kBlockPropertyKeyTransparent, transparent);
   block.insert(kBlockPropertyKeyBiomeGrass, biome_grass);
   block.insert(kBlockPropertyKeyBiomeTree, biome_tree);
+  if (!tint.isEmpty()) {
+    block.insert(kBlockPropertyKeyTint, tint);
+  }
   return block;
 }
 
@@ -1171,6 +1175,78 @@ Application::Application(int argc, char* argv[]) :
                   textures(QList<QPoint>() << QPoint(0, 5) << QPoint(0, 5) << QPoint(0, 5) << QPoint(0, 5)),
                   true);
 
+  // The wire texture is greyscale; Minecraft colors it by signal strength, so we tint it for the two states we show.
+  blocks << block("Redstone Wire",
+                  0x37,
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometrySnow,
+                  QPoint(4, 10),
+                  QVariantList() << kOrientationNone,
+                  textures(QPoint(4, 10)),
+                  true, false, false, "#5A0000");
+  blocks << block("Redstone Wire (Powered)",
+                  0x37 + (0xF << kBlockDataShift),
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometrySnow,
+                  QPoint(4, 10),
+                  QVariantList() << kOrientationNone,
+                  textures(QPoint(4, 10)),
+                  true, false, false, "#FF2800");
+  blocks << block("Redstone Torch (Off)",
+                  0x4B,
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometryTorch,
+                  QPoint(3, 7),
+                  QVariantList() << kOrientationOnFloor << kOrientationOnSouthWall << kOrientationOnWestWall
+                                 << kOrientationOnNorthWall << kOrientationOnEastWall,
+                  textures(QList<QPoint>() << QPoint(3, 7) << QPoint(3, 7) << QPoint(3, 7) << QPoint(3, 7)),
+                  true);
+  blocks << block("Redstone Torch (On)",
+                  0x4C,
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometryTorch,
+                  QPoint(3, 6),
+                  QVariantList() << kOrientationOnFloor << kOrientationOnSouthWall << kOrientationOnWestWall
+                                 << kOrientationOnNorthWall << kOrientationOnEastWall,
+                  textures(QList<QPoint>() << QPoint(3, 6) << QPoint(3, 6) << QPoint(3, 6) << QPoint(3, 6)),
+                  true);
+  blocks << block("Redstone Repeater (Off)",
+                  0x5D,
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometryPressurePlate,
+                  QPoint(3, 8),
+                  QVariantList() << kOrientationFacingSouth << kOrientationFacingWest << kOrientationFacingNorth << kOrientationFacingEast,
+                  // FRONT BACK BOTTOM RIGHT TOP LEFT
+                  textures(QList<QPoint>() << QPoint(5, 0) << QPoint(5, 0) << QPoint(6, 0) << QPoint(5, 0) << QPoint(3, 8) << QPoint(5, 0)),
+                  true);
+  blocks << block("Redstone Repeater (On)",
+                  0x5E,
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometryPressurePlate,
+                  QPoint(3, 9),
+                  QVariantList() << kOrientationFacingSouth << kOrientationFacingWest << kOrientationFacingNorth << kOrientationFacingEast,
+                  textures(QList<QPoint>() << QPoint(5, 0) << QPoint(5, 0) << QPoint(6, 0) << QPoint(5, 0) << QPoint(3, 9) << QPoint(5, 0)),
+                  true);
+  blocks << block("Lever (Off)",
+                  0x45,
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometryTorch,
+                  QPoint(0, 6),
+                  QVariantList() << kOrientationOnFloor << kOrientationOnSouthWall << kOrientationOnWestWall
+                                 << kOrientationOnNorthWall << kOrientationOnEastWall,
+                  textures(QList<QPoint>() << QPoint(0, 6) << QPoint(0, 6) << QPoint(0, 6) << QPoint(0, 6)),
+                  true);
+  // Both lever states use the same texture, so the thrown one is tinted to tell them apart.
+  blocks << block("Lever (On)",
+                  0x45 + (0x8 << kBlockDataShift),
+                  QStringList() << kCategoryRedstone,
+                  BlockGeometry::kGeometryTorch,
+                  QPoint(0, 6),
+                  QVariantList() << kOrientationOnFloor << kOrientationOnSouthWall << kOrientationOnWestWall
+                                 << kOrientationOnNorthWall << kOrientationOnEastWall,
+                  textures(QList<QPoint>() << QPoint(0, 6) << QPoint(0, 6) << QPoint(0, 6) << QPoint(0, 6)),
+                  true, false, false, "#FFD080");
+
   QJson::Serializer serializer;
   QByteArray json = serializer.serialize(blocks);
 
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Checks PositionHash against std::map with a long run of random operations.  Exits with a nonzero status, after
+# printing the seed that reproduces it, as soon as the two disagree.
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = PositionHashTest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += main.cc \
+    ../../src/block_position.cc
+
+HEADERS += \
+    ../../src/block_position.h \
+    ../../src/position_hash.h \
+    ../../src/position_hash_impl.h
@@ -0,0 +1,204 @@
+/* Copyright 2012 Brian Ellis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTextStream>
+
+#include <map>
+
+#include "../../src/block_position.h"
+#include "../../src/position_hash.h"
+
+namespace {
+
+typedef std::map<quint64, int> ReferenceMap;
+
+/** How many random operations each seed performs. */
+const int kOperations = 200000;
+
+/** How many seeds are tried when none is given on the command line. */
+const int kDefaultSeeds = 20;
+
+QTextStream out(stdout);
+
+/**
+  * Returns a random position.  Most are drawn from a small box so that the same positions keep coming back and their
+  * probe sequences overlap; the rest sit at the very edges of the range a BlockPosition can hold.
+  */
+BlockPosition randomPosition() {
+  if (qrand() % 16 == 0) {
+    int corner = qrand() % 8;
+    return BlockPosition((corner & 1) ? BlockPosition::kMaxCoordinate : BlockPosition::kMinCoordinate,
+                         (corner & 2) ? BlockPosition::kMaxCoordinate : BlockPosition::kMinCoordinate,
+                         (corner & 4) ? BlockPosition::kMaxCoordinate : BlockPosition::kMinCoordinate);
+  }
+  return BlockPosition(qrand() % 32 - 16, qrand() % 8, qrand() % 32 - 16);
+}
+
+/** Returns \c true, having printed what differs, if \p hash does not hold exactly the entries of \p reference. */
+bool differs(const PositionHash<int>& hash, const ReferenceMap& reference) {
+  if (hash.size() != static_cast<int>(reference.size())) {
+    out << "Size is " << hash.size() << ", expected " << static_cast<int>(reference.size()) << endl;
+    return true;
+  }
+  int iterated = 0;
+  for (PositionHash<int>::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it) {
+    ReferenceMap::const_iterator expected = reference.find(it.key().packed());
+    if (expected == reference.end() || expected->second != it.value()) {
+      out << "Unexpected entry " << it.key().x() << "," << it.key().y() << "," << it.key().z() << endl;
+      return true;
+    }
+    ++iterated;
+  }
+  if (iterated != hash.size()) {
+    out << "Iterated over " << iterated << " entries, expected " << hash.size() << endl;
+    return true;
+  }
+  for (ReferenceMap::const_iterator it = reference.begin(); it != reference.end(); ++it) {
+    BlockPosition position = BlockPosition::fromPacked(it->first);
+    if (!hash.contains(position) || hash.value(position, -1) != it->second ||
+        hash.constFind(position) == hash.constEnd()) {
+      out << "Missing entry " << position.x() << "," << position.y() << "," << position.z() << endl;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Runs kOperations random operations on a PositionHash and a std::map, and returns \c true if they stayed equal. */
+bool runSeed(uint seed) {
+  qsrand(seed);
+  PositionHash<int> hash;
+  ReferenceMap reference;
+  for (int operation = 0; operation < kOperations; ++operation) {
+    BlockPosition position = randomPosition();
+    quint64 key = position.packed();
+    int value = qrand();
+    switch (qrand() % 8) {
+      case 0:
+      case 1:
+      case 2:
+        hash.insert(position, value);
+        reference[key] = value;
+        break;
+      case 3:
+      case 4:
+        if (hash.remove(position) != static_cast<int>(reference.erase(key))) {
+          out << "remove() returned the wrong count" << endl;
+          return false;
+        }
+        break;
+      case 5:
+        hash[position] += value;
+        reference[key] += value;
+        break;
+      case 6: {
+        // A copy must not see changes made to the original after it was taken.  Comparing it is slow, so this is rare.
+        if (qrand() % 64 != 0) {
+          break;
+        }
+        PositionHash<int> copy = hash;
+        ReferenceMap copy_reference = reference;
+        hash.insert(position, value);
+        reference[key] = value;
+        if (differs(copy, copy_reference)) {
+          out << "A copy changed along with its original" << endl;
+          return false;
+        }
+        break;
+      }
+      case 7:
+        if (qrand() % 1000 == 0) {
+          hash.clear();
+          reference.clear();
+        } else if (qrand() % 100 == 0) {
+          hash.reserve(qrand() % 4096);
+        }
+        break;
+    }
+    if (hash.size() != static_cast<int>(reference.size())) {
+      out << "Size is " << hash.size() << ", expected " << static_cast<int>(reference.size()) << endl;
+      return false;
+    }
+    if (operation % 1000 == 0 && differs(hash, reference)) {
+      return false;
+    }
+  }
+  if (differs(hash, reference)) {
+    return false;
+  }
+
+  PositionHashStatistics statistics = hash.probeStatistics();
+  if (statistics.size != hash.size() || statistics.max_probe_length > statistics.capacity ||
+      (statistics.size > 0 && statistics.max_probe_length < 1)) {
+    out << "Probe statistics are inconsistent with the table" << endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+  * Returns \c true if assigning to entries that already exist leaves a table that is as full as it can get without
+  * growing at its original size, so that references to its slots stay valid.
+  */
+bool assignmentDoesNotGrow() {
+  PositionHash<int> hash;
+  int count = 0;
+  while (true) {
+    hash.insert(BlockPosition(count, 0, 0), count);
+    ++count;
+    PositionHash<int> probe = hash;
+    probe.insert(BlockPosition(count, 0, 0), count);
+    if (probe.probeStatistics().capacity != hash.probeStatistics().capacity) {
+      break;
+    }
+  }
+  int capacity = hash.probeStatistics().capacity;
+  for (int i = 0; i < count; ++i) {
+    hash[BlockPosition(i, 0, 0)] += 1;
+    hash.insert(BlockPosition(i, 0, 0), i);
+  }
+  if (hash.probeStatistics().capacity != capacity) {
+    out << "Assigning to an existing entry grew a full table" << endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  QList<uint> seeds;
+  for (int i = 1; i < argc; ++i) {
+    seeds.append(QString(argv[i]).toUInt());
+  }
+  if (seeds.isEmpty()) {
+    for (uint seed = 1; seed <= kDefaultSeeds; ++seed) {
+      seeds.append(seed);
+    }
+  }
+
+  if (!assignmentDoesNotGrow()) {
+    out << "FAILED" << endl;
+    return 1;
+  }
+  foreach (uint seed, seeds) {
+    if (!runSeed(seed)) {
+      out << "FAILED with seed " << seed << endl;
+      return 1;
+    }
+  }
+  out << "PASSED " << seeds.size() << " seeds of " << kOperations << " operations" << endl;
+  return 0;
+}